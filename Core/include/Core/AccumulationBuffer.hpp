@@ -0,0 +1,164 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * A float buffer that progressively refines an image by averaging every sample taken for each pixel, while
+     * estimating how noisy each tile of the image still is, so samples go where they reduce noise the most.
+     *
+     * Each pass, planPass() shares a budget of samples between the tiles in proportion to their estimated relative
+     * error. Tiles whose error falls below the target are converged and receive no more samples, so a still image
+     * concentrates its rays in the regions that are slow to converge. Anything that changes the image, such as the
+     * camera moving, must reset() the buffer.
+     *
+     * Different tiles may be sampled from different threads at once, but each tile from one thread at a time.
+     */
+    class AccumulationBuffer {
+    public:
+        /**
+         * @param width: The image width in pixels
+         * @param height: The image height in pixels
+         * @param tileSize: The width and height of the square tiles that samples are allocated to
+         */
+        AccumulationBuffer(uint32_t width, uint32_t height, uint32_t tileSize = 16);
+        ~AccumulationBuffer();
+
+        /// Disallowed operations
+        AccumulationBuffer(const AccumulationBuffer&) = delete;
+        AccumulationBuffer(AccumulationBuffer&&) = delete;
+        AccumulationBuffer& operator=(const AccumulationBuffer&) = delete;
+        AccumulationBuffer& operator=(AccumulationBuffer&&) = delete;
+
+        /// -- Members for configuration --
+
+        /// Change the image size, which also resets it
+        void resize(uint32_t width, uint32_t height);
+
+        /**
+         * Set when tiles stop receiving samples
+         * @param targetError: The relative standard error of a pixel's mean luminance a tile must average below
+         * @param minSamples: The samples per pixel every tile takes before its error estimate is trusted
+         * @param maxSamplesPerPass: The most samples per pixel one tile may take in a pass
+         */
+        void setConvergence(float targetError, uint32_t minSamples, uint32_t maxSamplesPerPass);
+
+        /// -- End members for configuration --
+
+        /// Forget every sample, eg. when the camera moves
+        void reset();
+
+        /// Exchange every sample and tile with another buffer, eg. to keep the previous view as history
+        void swap(AccumulationBuffer& other);
+
+        [[nodiscard]] uint32_t getWidth() const;
+        [[nodiscard]] uint32_t getHeight() const;
+        [[nodiscard]] uint32_t getTileCount() const;
+
+        /// The pixels of a tile to sample in a pass
+        struct TileWork {
+            uint32_t tile;
+            uint32_t x0, y0, x1, y1; // Pixel bounds, x1 and y1 exclusive
+            uint32_t samplesPerPixel;
+        };
+
+        /**
+         * Share a budget of samples between the unconverged tiles, in proportion to their estimated error.
+         * Until every tile has minSamples, each unconverged tile takes one sample per pixel instead.
+         * @param sampleBudget: The number of samples to aim for, across the whole image
+         * @return The work of the pass, empty once every tile has converged
+         */
+        [[nodiscard]] std::vector<TileWork> planPass(uint64_t sampleBudget);
+
+        /**
+         * Add one sample to a pixel
+         * @param x: The pixel's column
+         * @param y: The pixel's row
+         * @param radiance: The sample's linear radiance
+         */
+        void addSample(uint32_t x, uint32_t y, glm::vec3 radiance);
+
+        /**
+         * Add samples that were taken elsewhere, eg. reprojected from a previous view, as if they had been added one
+         * at a time. Different pixels may be added from different threads at once.
+         * @param x: The pixel's column
+         * @param y: The pixel's row
+         * @param mean: The samples' average linear radiance
+         * @param luminanceSquareMean: The average of the samples' squared luminance
+         * @param count: The number of samples
+         */
+        void addSamples(uint32_t x, uint32_t y, glm::vec3 mean, float luminanceSquareMean, uint32_t count);
+
+        /// The number of samples already added to a pixel, for seeding the next
+        [[nodiscard]] uint32_t getSampleCount(uint32_t x, uint32_t y) const;
+
+        /// Re-estimate a tile's error once its samples for the pass are added, from the thread that added them
+        void finishTile(uint32_t tile);
+
+        /// The average radiance of a pixel's samples
+        [[nodiscard]] glm::vec3 getMean(uint32_t x, uint32_t y) const;
+
+        /// The variance of the luminance of a pixel's samples, zero with fewer than two
+        [[nodiscard]] float getLuminanceVariance(uint32_t x, uint32_t y) const;
+
+        /// The average of the squared luminance of a pixel's samples
+        [[nodiscard]] float getLuminanceSquareMean(uint32_t x, uint32_t y) const;
+
+        /**
+         * Tone map rows of the mean into 8 bit sRGB, eg. for a staging buffer copied to the swapchain
+         * @param firstRow: The first row to resolve
+         * @param rowCount: The number of rows to resolve
+         * @param out: The first row's pixels, 4 bytes each
+         * @param rowPitch: The bytes from one row of out to the next
+         * @param bgra: Write blue first, for BGRA formats
+         * @param exposure: Multiplies radiance before tone mapping
+         */
+        void resolveRows(uint32_t firstRow, uint32_t rowCount, uint8_t* out, std::size_t rowPitch, bool bgra, float exposure) const;
+
+        struct Stats {
+            uint64_t passes;         // Since the last reset
+            uint64_t samples;        // Since the last reset
+            uint32_t convergedTiles;
+            uint32_t tileCount;
+            float averageSamplesPerPixel;
+            float maxTileError; // Of the unconverged tiles
+        };
+
+        [[nodiscard]] Stats getStats() const;
+        void printStats(std::ostream& out) const;
+
+    private:
+        struct Tile {
+            float error;
+            uint32_t samplesPerPixel; // The least any pixel of the tile has
+            bool converged;
+        };
+
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+        uint32_t m_tileSize;
+        uint32_t m_tilesX = 0;
+        uint32_t m_tilesY = 0;
+
+        float m_targetError = 0.02f;
+        uint32_t m_minSamples = 8;
+        uint32_t m_maxSamplesPerPass = 8;
+
+        /// Per pixel, row major
+        std::vector<glm::vec3> m_sums;
+        std::vector<float> m_luminanceSquareSums;
+        std::vector<uint32_t> m_sampleCounts;
+
+        std::vector<Tile> m_tiles;
+        uint64_t m_passes = 0;
+        uint64_t m_samples = 0;
+
+        [[nodiscard]] TileWork getTileBounds(uint32_t tile) const;
+    };
+}
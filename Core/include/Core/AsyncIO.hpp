@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Core/ThreadPool.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * Reads whole files without blocking the calling thread, so assets can load while the app keeps rendering.
+     *
+     * On Linux reads are queued on an io_uring, so a batch of reads costs one system call and the kernel works on all
+     * of them at once. A completion thread reaps the results and runs the callbacks. Where io_uring is unavailable
+     * (other platforms, old kernels, sandboxes that forbid it) every read is a blocking read on a small thread pool.
+     */
+    class AsyncIO {
+    public:
+        /// A finished read. If it failed, error holds the exception and data is empty.
+        struct ReadResult {
+            std::string path;
+            std::vector<char> data;
+            std::exception_ptr error;
+        };
+
+        /// Called once per read, from an I/O thread. Callbacks should be short and must not throw.
+        using Callback = std::function<void(ReadResult& result)>;
+
+        struct Stats {
+            uint64_t completedReads;
+            uint64_t failedReads;
+            uint64_t bytesRead;
+            uint32_t peakQueueDepth;   // The most reads outstanding at once
+            float averageQueueDepth;   // Reads outstanding, sampled as each read was submitted
+            double busySeconds;        // Time with at least one read outstanding
+        };
+
+        /**
+         * @param queueDepth: The most reads given to the kernel at once, further reads wait in a backlog
+         * @param fallbackThreadCount: The number of blocking readers when io_uring is unavailable
+         */
+        explicit AsyncIO(uint32_t queueDepth = 64, std::size_t fallbackThreadCount = 2);
+
+        /// Waits for every outstanding read
+        ~AsyncIO();
+
+        /// Disallowed operations
+        AsyncIO(const AsyncIO&) = delete;
+        AsyncIO(AsyncIO&&) = delete;
+        AsyncIO& operator=(const AsyncIO&) = delete;
+        AsyncIO& operator=(AsyncIO&&) = delete;
+
+        /**
+         * Read a whole file
+         * @param path: The file to read
+         * @param callback: Receives the contents, or the error
+         */
+        void read(const std::string& path, Callback callback);
+
+        /// Read a whole file. Errors are rethrown from the future's get().
+        std::future<std::vector<char>> read(const std::string& path);
+
+        /// Read several files with a single submission. The callback is run once per file, in any order.
+        void readBatch(const std::vector<std::string>& paths, const Callback& callback);
+
+        /// Read several files with a single submission. The futures are in the order of paths.
+        std::vector<std::future<std::vector<char>>> readBatch(const std::vector<std::string>& paths);
+
+        /**
+         * Block until every outstanding read has completed and its callback has returned.
+         * Rethrows the error that stopped the io_uring, if one did. Its reads have failed with it, and later reads throw it too.
+         */
+        void waitIdle();
+
+        [[nodiscard]] bool isUsingIoUring() const;
+
+        [[nodiscard]] Stats getStats() const;
+
+        /// Print the read count, throughput and queue depth
+        void printStats(std::ostream& out) const;
+
+    private:
+        /// -- Members for the backends --
+        class Ring;
+        std::unique_ptr<Ring> m_ring;               // Null when io_uring is unavailable
+        std::unique_ptr<ThreadPool> m_fallbackPool; // Null when io_uring is in use
+
+        /// -- Members for tracking reads --
+        mutable std::mutex m_mutex;
+        std::condition_variable m_idle;
+        uint32_t m_outstandingReads = 0;
+        uint64_t m_queueDepthSamples = 0;
+        uint64_t m_queueDepthSum = 0;
+        Stats m_stats{};
+        std::chrono::steady_clock::time_point m_busyStart;
+        std::exception_ptr m_error; // Set once the io_uring has stopped after an error
+
+        struct Request {
+            std::string path;
+            Callback callback;
+        };
+
+        void submit(std::vector<Request> requests);
+
+        /// Record a read as finished, then run its callback
+        void complete(ReadResult& result, const Callback& callback);
+
+        /// Remember the error that stopped the io_uring, for waitIdle() and later reads to rethrow
+        void fail(std::exception_ptr error);
+    };
+}
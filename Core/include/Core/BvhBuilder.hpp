@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Core/SceneFormat.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * Builds a bounding volume hierarchy over the triangles of a mesh, using the surface area heuristic
+     * evaluated at a fixed number of bins per axis.
+     *
+     * Nodes are emitted in the layout of SceneBvhNode: siblings are adjacent, and leaves reference a range of a
+     * triangle list, so the mesh's own index order is left untouched.
+     */
+    class BvhBuilder {
+    public:
+        /**
+         * @param maxLeafTriangles: Nodes with more triangles than this are always split
+         * @param binCount: The number of candidate split positions per axis
+         */
+        explicit BvhBuilder(uint32_t maxLeafTriangles = 4, uint32_t binCount = 16);
+        ~BvhBuilder();
+
+        struct Result {
+            std::vector<SceneBvhNode> nodes; // Root first, empty for an empty mesh
+            std::vector<uint32_t> triangles; // Triangle indices in leaf order
+        };
+
+        /**
+         * @param positions: The vertex positions
+         * @param indices: A triangle list indexing positions
+         * @param triangleCount: The number of triangles
+         * @return The hierarchy
+         */
+        [[nodiscard]] Result build(const glm::vec3* positions, const uint32_t* indices, std::size_t triangleCount) const;
+
+        /// The expected cost of tracing a ray through the hierarchy, relative to intersecting one triangle
+        [[nodiscard]] static float computeSahCost(const Result& bvh);
+
+    private:
+        uint32_t m_maxLeafTriangles;
+        uint32_t m_binCount;
+    };
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+
+namespace Core {
+
+    /**
+     * A 64 bit FNV-1a hash of values, usable in constant expressions, eg. to key descriptions of pipeline state
+     * built at compile time. Values are mixed by their numeric value, so the result does not depend on padding.
+     * Accepts enums, integers, floats and vk::Flags.
+     */
+    class ConstexprHash {
+    public:
+        template<typename T>
+        constexpr void addValue(T value) {
+            uint64_t bits;
+            if constexpr (std::is_enum_v<T>) {
+                bits = static_cast<uint64_t>(value);
+            } else if constexpr (std::is_floating_point_v<T>) {
+                bits = std::bit_cast<uint32_t>(static_cast<float>(value));
+            } else if constexpr (std::is_integral_v<T>) {
+                bits = static_cast<uint64_t>(value);
+            } else {
+                // vk::Flags
+                bits = static_cast<uint64_t>(static_cast<typename T::MaskType>(value));
+            }
+            for (int byte = 0; byte < 8; byte++) {
+                m_state = (m_state ^ ((bits >> (byte * 8)) & 0xff)) * 0x100000001b3ull;
+            }
+        }
+
+        [[nodiscard]] constexpr uint64_t get() const { return m_state; }
+
+    private:
+        uint64_t m_state = 0xcbf29ce484222325ull;
+    };
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Core {
+
+    /**
+     * A fast streaming 64 bit hash, for recognising identical content, eg. cooked assets that need no rebuild or
+     * duplicate shader code. Not cryptographic.
+     */
+    class ContentHash {
+    public:
+        ContentHash();
+
+        void add(const void* data, std::size_t size);
+        void addString(std::string_view text);
+
+        template<typename T>
+        void addValue(const T& value) {
+            add(&value, sizeof(value));
+        }
+
+        /// Hash a file's contents, throws std::runtime_error if it cannot be read
+        void addFile(const std::string& path);
+
+        [[nodiscard]] uint64_t get() const;
+
+        /// The hash as 16 hex digits, for file names
+        [[nodiscard]] std::string toHex() const;
+
+    private:
+        uint64_t m_state;
+        uint64_t m_length = 0;
+        uint64_t m_pending = 0; // Bytes that do not yet fill a whole word
+        uint32_t m_pendingSize = 0;
+
+        void mixWord(uint64_t word);
+    };
+}
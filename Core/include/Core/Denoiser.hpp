@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Core/RenderTypes.hpp"
+#include "Core/ThreadPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace Core {
+
+    /// How strongly the denoiser's edge-stopping functions keep differing pixels apart. Larger values blur less.
+    struct DenoiserSettings {
+        uint32_t iterations = 5; // Passes of the 5x5 kernel, each with twice the spacing, so 5 covers 61x61 pixels
+        float colourSigma = 4.0f; // The standard errors of noise two luminances may differ by and still blend
+        float normalPhi = 32.0f;  // Scales the squared distance between normals
+        float albedoPhi = 64.0f;  // Scales the squared distance between albedos
+        float depthPhi = 16.0f;   // Scales the squared relative depth difference per pixel of tap spacing
+    };
+
+    /**
+     * An edge-aware à-trous wavelet denoiser (Dammertz et al. 2010) for path traced images.
+     *
+     * Each iteration blurs with a 5x5 B3 spline kernel whose taps are spread 2^i pixels apart, so a few iterations
+     * cover a wide area for the cost of 25 taps each. Taps are weighted down where the albedo, normal or depth guides
+     * differ, which keeps edges and texture sharp, and where the luminance differs by more than the noise estimated
+     * from the per-pixel variance (as in SVGF, Schied et al. 2017), which keeps converged detail. The variance is
+     * filtered alongside the colour, so later iterations blur less.
+     *
+     * The inputs are planar, one float per pixel per plane, so each tap of a row is a loop over contiguous floats that
+     * the compiler vectorizes. Compute implementations read the same planes, see getInputs().
+     */
+    class Denoiser {
+    public:
+        /// The planes of the inputs, in the order they are laid out in getInputs()
+        enum Plane : uint32_t {
+            ColourR,
+            ColourG,
+            ColourB,
+            Variance, // Of the mean luminance, ie. the luminance variance over the sample count
+            AlbedoR,
+            AlbedoG,
+            AlbedoB,
+            NormalX,
+            NormalY,
+            NormalZ,
+            Depth, // Distance from the camera
+            PlaneCount,
+        };
+
+        /// The planes each iteration filters, the first of the inputs
+        static constexpr uint32_t FILTERED_PLANE_COUNT = 4;
+
+        Denoiser(uint32_t width, uint32_t height);
+        ~Denoiser();
+
+        /// Disallowed operations
+        Denoiser(const Denoiser&) = delete;
+        Denoiser(Denoiser&&) = delete;
+        Denoiser& operator=(const Denoiser&) = delete;
+        Denoiser& operator=(Denoiser&&) = delete;
+
+        /// -- Members for configuration --
+
+        void resize(uint32_t width, uint32_t height);
+        void setSettings(const DenoiserSettings& settings);
+        [[nodiscard]] const DenoiserSettings& getSettings() const;
+
+        /// -- End members for configuration --
+
+        [[nodiscard]] uint32_t getWidth() const;
+        [[nodiscard]] uint32_t getHeight() const;
+
+        /**
+         * Set a pixel of the inputs. Different pixels may be set from different threads at once.
+         * @param x: The pixel's column
+         * @param y: The pixel's row
+         * @param colour: The noisy linear radiance
+         * @param variance: The variance of the colour's luminance, as an estimate of its noise
+         * @param albedo: The surface's albedo at the first hit
+         * @param normal: The surface's unit normal at the first hit
+         * @param depth: The distance to the first hit
+         */
+        void setPixel(uint32_t x, uint32_t y, glm::vec3 colour, float variance, glm::vec3 albedo, glm::vec3 normal, float depth);
+
+        /// The PlaneCount planes of the inputs, each a row major image of floats
+        [[nodiscard]] std::span<const float> getInputs() const;
+
+        /**
+         * Denoise the inputs, splitting each iteration into bands of rows on the workers.
+         * Must not be called from one of the workers.
+         * @param workers: The threads to filter on
+         */
+        void denoise(ThreadPool& workers);
+
+        /// A pixel of the last denoise()
+        [[nodiscard]] glm::vec3 getColour(uint32_t x, uint32_t y) const;
+
+        /// Tone map rows of the last denoise() into 8 bit sRGB, see AccumulationBuffer::resolveRows()
+        void resolveRows(uint32_t firstRow, uint32_t rowCount, uint8_t* out, std::size_t rowPitch, bool bgra, float exposure) const;
+
+        struct Stats {
+            uint64_t denoises;
+            TimeDelta lastTime;
+            TimeDelta averageTime;
+        };
+
+        [[nodiscard]] Stats getStats() const;
+        void resetStats();
+        void printStats(std::ostream& out) const;
+
+    private:
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+        DenoiserSettings m_settings;
+
+        std::vector<float> m_inputs;
+        /// Iterations alternate between these, each FILTERED_PLANE_COUNT planes
+        std::vector<float> m_iterationPlanes[2];
+        /// The planes of the last denoise()
+        const float* m_output = nullptr;
+
+        uint64_t m_denoises = 0;
+        TimeDelta m_lastTime = TimeDelta::zero();
+        TimeDelta m_timeSum = TimeDelta::zero();
+
+        /// Filter the rows [firstRow, lastRow) of one iteration
+        void filterRows(uint32_t firstRow, uint32_t lastRow, uint32_t iteration, const float* source, float* destination) const;
+    };
+}
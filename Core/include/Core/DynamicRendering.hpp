@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+namespace Core {
+
+    /**
+     * Records rendering without render pass or framebuffer objects, see VK_KHR_dynamic_rendering, owned by the Renderer.
+     *
+     * Attachments are given as image views when rendering begins, and pipelines are created for attachment formats
+     * with RasterPipelineBuilder::setRenderingFormats(), so nothing has to be rebuilt when the swapchain is.
+     * Attachments are not transitioned either, the caller records barriers into and out of the attachment layouts.
+     *
+     * Without the extension, apps fall back to a RenderPass and framebuffers.
+     */
+    class DynamicRendering {
+    public:
+        /**
+         * @param device: The device to record for
+         * @param enabled: Whether VK_KHR_dynamic_rendering and its feature are enabled on the device
+         */
+        DynamicRendering(vk::Device& device, bool enabled);
+        ~DynamicRendering();
+
+        /// Disallowed operations
+        DynamicRendering(const DynamicRendering&) = delete;
+        DynamicRendering(DynamicRendering&&) = delete;
+        DynamicRendering& operator=(const DynamicRendering&) = delete;
+        DynamicRendering& operator=(DynamicRendering&&) = delete;
+
+        [[nodiscard]] bool isEnabled() const;
+
+        /**
+         * Begin rendering to attachments, in place of beginning a render pass
+         * @param buffer: The command buffer to record into
+         * @param renderingInfo: The attachments and area to render to
+         */
+        void begin(vk::CommandBuffer& buffer, const vk::RenderingInfoKHR& renderingInfo) const;
+
+        /// End the rendering begun with begin()
+        void end(vk::CommandBuffer& buffer) const;
+
+    private:
+        bool m_enabled;
+
+        /// Extension commands, which the loader does not export
+        PFN_vkCmdBeginRenderingKHR m_cmdBeginRendering = nullptr;
+        PFN_vkCmdEndRenderingKHR m_cmdEndRendering = nullptr;
+    };
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Core/RenderTypes.hpp"
+#include "Core/Renderer.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace Core {
+
+    /// The frame time dynamic resolution aims for, and how far and how quickly it may change the scale
+    struct DynamicResolutionSettings {
+        TimeDelta targetFrameTime = TimeDelta(1.0 / 60.0); // The GPU time budget of a frame
+        float minScale = 0.5f;       // Of the output's width and height
+        float maxScale = 1.0f;       // Above one renders more pixels than are shown, and the target is made larger to fit
+        float scaleStep = 0.05f;     // Scales are multiples of this, so small changes in frame time do not change the scale
+        float headroom = 0.9f;       // The fraction of the budget scales are chosen for, leaving room for frames that run long
+        uint32_t increaseDelay = 30; // Frames that must have room for a larger scale before it is raised by a step
+        float fixedScale = 1.0f;     // The scale rendered at while disabled
+    };
+
+    /**
+     * Chooses the resolution to render at from the GPU time of previous frames, so frames stay within a time budget as
+     * their cost changes.
+     *
+     * Apps render into a target large enough for the largest scale, with the viewport and render area reduced to the
+     * current scale, then scale the rendered region to the output. Changing the scale needs no new images, only new
+     * command buffers, and apps that record them up front record them again when collectCompleted() changes it.
+     *
+     * Each frame's command buffer writes a timestamp at its start and end into its own slot of a query pool. Once the
+     * frame has completed, its GPU time predicts the scale that fits the budget, as the cost of a frame mostly grows
+     * with its pixel count. A frame over budget drops the scale straight away, so one spike costs at most one more
+     * frame over budget. The scale only rises a step at a time, once enough frames in a row had room for it, so it
+     * does not oscillate around the budget.
+     *
+     * Used only from the thread that renders.
+     */
+    class DynamicResolution {
+    public:
+        /**
+         * @param renderer: The renderer whose graphics queue the frames are submitted to
+         * @param settings: The budget and the range of scales
+         */
+        explicit DynamicResolution(Renderer& renderer, const DynamicResolutionSettings& settings = DynamicResolutionSettings{});
+        /// Frames submitted with its timestamps must have completed
+        ~DynamicResolution();
+
+        /// Disallowed operations
+        DynamicResolution(const DynamicResolution&) = delete;
+        DynamicResolution(DynamicResolution&&) = delete;
+        DynamicResolution& operator=(const DynamicResolution&) = delete;
+        DynamicResolution& operator=(DynamicResolution&&) = delete;
+
+        /// -- Members for configuration --
+
+        /// Changing the settings restarts at the largest scale, and may change the target extent
+        void setSettings(const DynamicResolutionSettings& settings);
+        [[nodiscard]] const DynamicResolutionSettings& getSettings() const;
+
+        /// While disabled the scale is the settings' fixed scale, and frames are still timed
+        void setEnabled(bool enabled);
+        [[nodiscard]] bool isEnabled() const;
+
+        /**
+         * Recreate the timestamp slots, one per frame that may be in flight. Frames submitted earlier are forgotten,
+         * so must have completed.
+         * @param slotCount: The number of frames that may be in flight at once, eg. the number of command buffers
+         */
+        void resize(std::size_t slotCount);
+
+        /// -- End members for configuration --
+
+        /// The scale of the output's width and height to render at
+        [[nodiscard]] float getScale() const;
+
+        /// The size to render at for an output size, at the current scale
+        [[nodiscard]] vk::Extent2D getRenderExtent(vk::Extent2D outputExtent) const;
+
+        /// The size of render target that fits every scale the settings allow, fixed or not, and at least the output size
+        [[nodiscard]] vk::Extent2D getTargetExtent(vk::Extent2D outputExtent) const;
+
+        /**
+         * Record the timestamp that starts a frame. Must be outside a render pass, before the frame's other commands.
+         * @param buffer: The frame's command buffer
+         * @param slot: The slot to time the frame with, which must not be used by a frame still in flight
+         */
+        void recordBegin(vk::CommandBuffer& buffer, std::size_t slot) const;
+
+        /// Record the timestamp that ends a frame, after the frame's other commands
+        void recordEnd(vk::CommandBuffer& buffer, std::size_t slot) const;
+
+        /// Note that a command buffer timed with the slot has been submitted
+        void frameSubmitted(std::size_t slot);
+
+        /**
+         * Read the GPU time of every submitted frame and choose the scale of the next ones.
+         * Call once the frames submitted so far have completed, and before their slots are submitted again.
+         * Returns whether the scale changed.
+         */
+        bool collectCompleted();
+
+        struct Stats {
+            uint64_t frames;           // Timed on the GPU
+            uint64_t framesOverBudget;
+            uint64_t scaleChanges;
+            float lastScale;
+            float averageScale;        // Of the timed frames
+            TimeDelta lastGpuTime;
+            TimeDelta averageGpuTime;
+            TimeDelta peakGpuTime;
+        };
+
+        /// Counts since construction or the last resetStats()
+        [[nodiscard]] Stats getStats() const;
+        void resetStats();
+        void printStats(std::ostream& out) const;
+
+    private:
+        vk::Device m_device;
+        DynamicResolutionSettings m_settings;
+        bool m_enabled = true;
+        float m_scale;
+        uint32_t m_framesWithRoom = 0; // In a row, with room for a larger scale
+
+        /// Two timestamps per slot, around the frame
+        vk::QueryPool m_queryPool;
+        std::vector<bool> m_submitted;
+        bool m_timestampsSupported;
+        double m_timestampPeriod; // Nanoseconds per tick
+
+        Stats m_stats{};
+        double m_scaleSum = 0.0;
+        TimeDelta m_gpuTimeSum = TimeDelta::zero();
+
+        /// The scales the settings allow, as multiples of the step
+        [[nodiscard]] float quantize(float scale) const;
+
+        /// Choose the scale of the next frames from the GPU time of one at the current scale
+        void update(TimeDelta gpuTime);
+    };
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * Registers SPIR-V compiled into the executable. With RT_EMBED_SHADERS, add_shaders() generates one source per
+     * shader holding its code as a constexpr array and one of these, so the registry is filled before main() runs.
+     */
+    class EmbeddedShaderRegistration {
+    public:
+        /**
+         * @param name: The path the shader would otherwise be loaded from, eg. "Resources/Shaders/trivial.vert.spv"
+         * @param code: The SPIR-V words, which must outlive the program, ie. be static
+         */
+        EmbeddedShaderRegistration(const char* name, std::span<const uint32_t> code);
+    };
+
+    /**
+     * Find an embedded shader
+     * @param name: The path the shader would otherwise be loaded from
+     * @return The SPIR-V words, or nothing if the shader was not embedded
+     */
+    std::optional<std::span<const uint32_t>> findEmbeddedShader(std::string_view name);
+
+    /// The names of every embedded shader, in no particular order
+    std::vector<std::string_view> getEmbeddedShaderNames();
+}
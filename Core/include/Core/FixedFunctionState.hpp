@@ -0,0 +1,267 @@
+#pragma once
+
+#include "Core/ConstexprHash.hpp"
+#include "Core/RenderPassDescription.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <iterator>
+#include <span>
+
+namespace Core {
+
+    /**
+     * The fixed-function state of a raster pipeline, described at compile time: input assembly, rasterization,
+     * multisampling, depth and stencil, colour blending and the dynamic states.
+     *
+     * Like RenderPassDescription, arrays live in constexpr storage and are only pointed at, so a description needs no
+     * allocation and its create infos feed straight into pipeline creation, see RasterPipelineBuilder::setFixedFunctionState().
+     * Start from the defaults, which match RasterPipelineBuilder's, and replace parts:
+     *
+     *     constexpr vk::PipelineColorBlendAttachmentState OPAQUE[] = {...};
+     *     constexpr Core::FixedFunctionState STATE = Core::FixedFunctionState().withColourBlendAttachments(OPAQUE);
+     *     static_assert(STATE.isValid() && STATE.isCompatible(PASS, 0));
+     */
+    class FixedFunctionState {
+    public:
+        constexpr FixedFunctionState() = default;
+
+        /// -- Members for configuration, each returning a copy with one part replaced --
+
+        [[nodiscard]] constexpr FixedFunctionState withInputAssembly(vk::PrimitiveTopology topology, bool primitiveRestart = false) const {
+            FixedFunctionState state = *this;
+            state.m_inputAssembly.topology = topology;
+            state.m_inputAssembly.primitiveRestartEnable = primitiveRestart ? VK_TRUE : VK_FALSE;
+            return state;
+        }
+
+        [[nodiscard]] constexpr FixedFunctionState withRasterization(const vk::PipelineRasterizationStateCreateInfo& rasterization) const {
+            FixedFunctionState state = *this;
+            state.m_rasterization = rasterization;
+            return state;
+        }
+
+        [[nodiscard]] constexpr FixedFunctionState withMultisample(const vk::PipelineMultisampleStateCreateInfo& multisample) const {
+            FixedFunctionState state = *this;
+            state.m_multisample = multisample;
+            return state;
+        }
+
+        [[nodiscard]] constexpr FixedFunctionState withDepthStencil(const vk::PipelineDepthStencilStateCreateInfo& depthStencil) const {
+            FixedFunctionState state = *this;
+            state.m_depthStencil = depthStencil;
+            state.m_hasDepthStencil = true;
+            return state;
+        }
+
+        /// One blend state per colour attachment of the subpass
+        [[nodiscard]] constexpr FixedFunctionState withColourBlendAttachments(std::span<const vk::PipelineColorBlendAttachmentState> attachments) const {
+            FixedFunctionState state = *this;
+            state.m_colourBlend.attachmentCount = static_cast<uint32_t>(attachments.size());
+            state.m_colourBlend.pAttachments = attachments.data();
+            return state;
+        }
+
+        [[nodiscard]] constexpr FixedFunctionState withDynamicStates(std::span<const vk::DynamicState> dynamicStates) const {
+            FixedFunctionState state = *this;
+            state.m_dynamic.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+            state.m_dynamic.pDynamicStates = dynamicStates.data();
+            return state;
+        }
+
+        /// -- End members for configuration --
+
+        /// -- Create infos, pointing into this object and the described arrays --
+
+        [[nodiscard]] constexpr const vk::PipelineInputAssemblyStateCreateInfo* getInputAssemblyState() const { return &m_inputAssembly; }
+        [[nodiscard]] constexpr const vk::PipelineRasterizationStateCreateInfo* getRasterizationState() const { return &m_rasterization; }
+        [[nodiscard]] constexpr const vk::PipelineMultisampleStateCreateInfo* getMultisampleState() const { return &m_multisample; }
+        [[nodiscard]] constexpr const vk::PipelineDepthStencilStateCreateInfo* getDepthStencilState() const {
+            return m_hasDepthStencil ? &m_depthStencil : nullptr;
+        }
+        [[nodiscard]] constexpr const vk::PipelineColorBlendStateCreateInfo* getColourBlendState() const { return &m_colourBlend; }
+        [[nodiscard]] constexpr const vk::PipelineDynamicStateCreateInfo* getDynamicState() const { return &m_dynamic; }
+
+        /// Check the values are within the ranges Vulkan allows, and that no dynamic state is listed twice
+        [[nodiscard]] constexpr bool isValid() const {
+            if (m_inputAssembly.primitiveRestartEnable && (m_inputAssembly.topology == vk::PrimitiveTopology::ePointList ||
+                                                           m_inputAssembly.topology == vk::PrimitiveTopology::eLineList ||
+                                                           m_inputAssembly.topology == vk::PrimitiveTopology::eTriangleList)) {
+                return false;
+            }
+            if (m_rasterization.lineWidth <= 0.0f) {
+                return false;
+            }
+            if (m_multisample.minSampleShading < 0.0f || m_multisample.minSampleShading > 1.0f) {
+                return false;
+            }
+            if (m_hasDepthStencil && m_depthStencil.depthBoundsTestEnable && m_depthStencil.minDepthBounds > m_depthStencil.maxDepthBounds) {
+                return false;
+            }
+            for (uint32_t i = 0; i < m_dynamic.dynamicStateCount; i++) {
+                for (uint32_t j = i + 1; j < m_dynamic.dynamicStateCount; j++) {
+                    if (m_dynamic.pDynamicStates[i] == m_dynamic.pDynamicStates[j]) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Check the state can be used in a subpass: one blend state per colour attachment, the attachments' sample
+         * count, and depth testing only with a depth attachment
+         */
+        [[nodiscard]] constexpr bool isCompatible(const RenderPassDescription& renderPass, uint32_t subpassIndex) const {
+            std::span<const vk::SubpassDescription> subpasses = renderPass.getSubpasses();
+            if (subpassIndex >= subpasses.size()) {
+                return false;
+            }
+            const vk::SubpassDescription& subpass = subpasses[subpassIndex];
+            if (subpass.colorAttachmentCount != m_colourBlend.attachmentCount) {
+                return false;
+            }
+
+            std::span<const vk::AttachmentDescription> attachments = renderPass.getAttachments();
+            for (uint32_t i = 0; i < subpass.colorAttachmentCount; i++) {
+                uint32_t attachment = subpass.pColorAttachments[i].attachment;
+                if (attachment != VK_ATTACHMENT_UNUSED && attachments[attachment].samples != m_multisample.rasterizationSamples) {
+                    return false;
+                }
+            }
+
+            bool hasDepthAttachment = subpass.pDepthStencilAttachment && subpass.pDepthStencilAttachment->attachment != VK_ATTACHMENT_UNUSED;
+            return hasDepthAttachment || !m_hasDepthStencil || !(m_depthStencil.depthTestEnable || m_depthStencil.stencilTestEnable);
+        }
+
+        /// A hash of everything described, equal for equal states
+        [[nodiscard]] constexpr uint64_t getHash() const {
+            ConstexprHash hash;
+            hash.addValue(m_inputAssembly.topology);
+            hash.addValue(m_inputAssembly.primitiveRestartEnable);
+
+            hash.addValue(m_rasterization.depthClampEnable);
+            hash.addValue(m_rasterization.rasterizerDiscardEnable);
+            hash.addValue(m_rasterization.polygonMode);
+            hash.addValue(m_rasterization.cullMode);
+            hash.addValue(m_rasterization.frontFace);
+            hash.addValue(m_rasterization.depthBiasEnable);
+            hash.addValue(m_rasterization.depthBiasConstantFactor);
+            hash.addValue(m_rasterization.depthBiasClamp);
+            hash.addValue(m_rasterization.depthBiasSlopeFactor);
+            hash.addValue(m_rasterization.lineWidth);
+
+            hash.addValue(m_multisample.rasterizationSamples);
+            hash.addValue(m_multisample.sampleShadingEnable);
+            hash.addValue(m_multisample.minSampleShading);
+            hash.addValue(m_multisample.alphaToCoverageEnable);
+            hash.addValue(m_multisample.alphaToOneEnable);
+
+            hash.addValue(m_hasDepthStencil);
+            if (m_hasDepthStencil) {
+                hash.addValue(m_depthStencil.depthTestEnable);
+                hash.addValue(m_depthStencil.depthWriteEnable);
+                hash.addValue(m_depthStencil.depthCompareOp);
+                hash.addValue(m_depthStencil.depthBoundsTestEnable);
+                hash.addValue(m_depthStencil.stencilTestEnable);
+                for (const vk::StencilOpState& stencil : {m_depthStencil.front, m_depthStencil.back}) {
+                    hash.addValue(stencil.failOp);
+                    hash.addValue(stencil.passOp);
+                    hash.addValue(stencil.depthFailOp);
+                    hash.addValue(stencil.compareOp);
+                    hash.addValue(stencil.compareMask);
+                    hash.addValue(stencil.writeMask);
+                    hash.addValue(stencil.reference);
+                }
+                hash.addValue(m_depthStencil.minDepthBounds);
+                hash.addValue(m_depthStencil.maxDepthBounds);
+            }
+
+            hash.addValue(m_colourBlend.logicOpEnable);
+            hash.addValue(m_colourBlend.logicOp);
+            hash.addValue(m_colourBlend.attachmentCount);
+            for (uint32_t i = 0; i < m_colourBlend.attachmentCount; i++) {
+                const vk::PipelineColorBlendAttachmentState& attachment = m_colourBlend.pAttachments[i];
+                hash.addValue(attachment.blendEnable);
+                hash.addValue(attachment.srcColorBlendFactor);
+                hash.addValue(attachment.dstColorBlendFactor);
+                hash.addValue(attachment.colorBlendOp);
+                hash.addValue(attachment.srcAlphaBlendFactor);
+                hash.addValue(attachment.dstAlphaBlendFactor);
+                hash.addValue(attachment.alphaBlendOp);
+                hash.addValue(attachment.colorWriteMask);
+            }
+            for (float constant : m_colourBlend.blendConstants) {
+                hash.addValue(constant);
+            }
+
+            hash.addValue(m_dynamic.dynamicStateCount);
+            for (uint32_t i = 0; i < m_dynamic.dynamicStateCount; i++) {
+                hash.addValue(m_dynamic.pDynamicStates[i]);
+            }
+            return hash.get();
+        }
+
+    private:
+        /// The dynamic states RasterPipelineBuilder ends up with, whose count only covers the viewport
+        constexpr static const vk::DynamicState s_defaultDynamicStates[] = {
+            vk::DynamicState::eViewport,
+        };
+
+        vk::PipelineInputAssemblyStateCreateInfo m_inputAssembly{
+            vk::PipelineInputAssemblyStateCreateFlags(),
+            vk::PrimitiveTopology::eTriangleList,
+            VK_FALSE,
+        };
+
+        vk::PipelineRasterizationStateCreateInfo m_rasterization{
+            vk::PipelineRasterizationStateCreateFlags(),
+            VK_FALSE, // Depth clamp
+            VK_FALSE, // Discard
+            vk::PolygonMode::eFill,
+            vk::CullModeFlagBits::eBack,
+            vk::FrontFace::eClockwise,
+
+            // Depth bias features
+            VK_FALSE,
+            0.0f,
+            0.0f,
+            0.0f,
+
+            1.0f, // Line width
+        };
+
+        vk::PipelineMultisampleStateCreateInfo m_multisample{
+            vk::PipelineMultisampleStateCreateFlags(),
+            vk::SampleCountFlagBits::e1,
+
+            // Sample Shading features
+            VK_FALSE,
+            1.0f,
+
+            // Misc options
+            nullptr,
+            VK_FALSE,
+            VK_FALSE,
+        };
+
+        vk::PipelineDepthStencilStateCreateInfo m_depthStencil;
+        bool m_hasDepthStencil = false;
+
+        vk::PipelineColorBlendStateCreateInfo m_colourBlend{
+            vk::PipelineColorBlendStateCreateFlags(),
+            VK_FALSE,
+            vk::LogicOp::eCopy,
+            0,
+            nullptr,
+            {0, 0, 0, 0},
+        };
+
+        vk::PipelineDynamicStateCreateInfo m_dynamic{
+            vk::PipelineDynamicStateCreateFlags(),
+            static_cast<uint32_t>(std::size(s_defaultDynamicStates)),
+            s_defaultDynamicStates,
+        };
+    };
+}
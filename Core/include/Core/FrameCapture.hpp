@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Core/ImageWriter.hpp"
+#include "Core/MemoryAllocator.hpp"
+#include "Core/RenderTypes.hpp"
+#include "Core/ThreadPool.hpp"
+
+#include <vk_mem_alloc.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * Captures rendered frames to numbered image files without stalling the GPU.
+     *
+     * The app records recordCopy() into each frame's own command buffer, after rendering, which copies the image into
+     * one slot of a ring of host-visible readback buffers. Apps that record a command buffer per swapchain image use
+     * the image index as the slot. Once a frame has completed, collectCompleted() copies its pixels out of the ring,
+     * and the file is encoded and written on worker threads.
+     *
+     * If the workers fall behind, frames beyond maxPendingFrames are dropped rather than waited for. Dropped frames
+     * still use up their frame number, so gaps in the file sequence show where they were. Offline output, which must
+     * not lose frames, can instead wait for the workers, which slows rendering to the speed of the writes.
+     *
+     * Used only from the thread that renders.
+     */
+    class FrameCapture {
+    public:
+        /**
+         * Encodes and writes one frame, on a worker. Frames are numbered from zero in the order they were submitted.
+         * Returns the number of bytes written, or throws if the frame could not be written.
+         */
+        using FrameWriter = std::function<std::size_t(uint64_t frameNumber, ImageRGBA8& image)>;
+
+        /**
+         * Capture to a numbered image file per frame
+         * @param allocator: The allocator the readback ring is created from
+         * @param pathPrefix: Files are named this followed by the frame number and the format's extension
+         * @param format: The format files are written in
+         * @param maxPendingFrames: The most frames that may be waiting for or being written before frames are dropped
+         * @param threadCount: The number of workers encoding and writing files
+         */
+        FrameCapture(MemoryAllocator& allocator, std::string pathPrefix, ImageFileFormat format, std::size_t maxPendingFrames = 4, std::size_t threadCount = 2);
+
+        /**
+         * Capture through any writer, eg. into a VideoStream
+         * @param allocator: The allocator the readback ring is created from
+         * @param description: What the frames are written as, for printStats()
+         * @param writer: Writes each frame, called from several workers at once
+         * @param dropWhenBehind: Whether to drop frames when maxPendingFrames are pending, rather than wait for the workers
+         * @param maxPendingFrames: The most frames that may be waiting for or being written at once
+         * @param threadCount: The number of workers running the writer
+         */
+        FrameCapture(MemoryAllocator& allocator,
+                     std::string description,
+                     FrameWriter writer,
+                     bool dropWhenBehind,
+                     std::size_t maxPendingFrames = 4,
+                     std::size_t threadCount = 2);
+
+        /// The device must be idle. Frames still in the ring are collected, and every file is written before returning.
+        ~FrameCapture();
+
+        /// Disallowed operations
+        FrameCapture(const FrameCapture&) = delete;
+        FrameCapture(FrameCapture&&) = delete;
+        FrameCapture& operator=(const FrameCapture&) = delete;
+        FrameCapture& operator=(FrameCapture&&) = delete;
+
+        /// -- Members for configuration --
+
+        /// Whether frames should be captured. Apps record copies and call frameSubmitted() only while enabled.
+        void setEnabled(bool enabled);
+        [[nodiscard]] bool isEnabled() const;
+
+        /**
+         * Recreate the ring for a new image size. Frames submitted earlier are collected first, so must have completed.
+         * @param extent: The size of the captured image
+         * @param format: The format of the captured image, one of the 8 bit RGBA or BGRA formats
+         * @param slotCount: The number of frames that may be in flight at once, eg. the number of command buffers
+         */
+        void resize(vk::Extent2D extent, vk::Format format, std::size_t slotCount);
+
+        /// -- End members for configuration --
+
+        /**
+         * Record the copy of a rendered image into a slot of the ring, and make it visible to the host
+         * @param buffer: The frame's command buffer
+         * @param slot: The slot to copy into, which must not be used by a frame still in flight
+         * @param source: The rendered image, in the transfer source layout, with its writes already made available
+         */
+        void recordCopy(vk::CommandBuffer& buffer, std::size_t slot, vk::Image source) const;
+
+        /// Note that a command buffer with recordCopy() for the slot has been submitted
+        void frameSubmitted(std::size_t slot);
+
+        /**
+         * Hand every submitted frame to the workers in order, dropping or waiting when too many are pending.
+         * Call once the frames submitted so far have completed on the GPU, eg. after Renderer::waitForNextRenderFrame(),
+         * and before their slots are submitted again.
+         */
+        void collectCompleted();
+
+        /// Block until every collected frame has been written
+        void waitIdle();
+
+        struct Stats {
+            uint64_t submittedFrames;
+            uint64_t writtenFrames;
+            uint64_t droppedFrames; // Not written because too many frames were pending
+            uint64_t failedFrames;  // Not written because encoding or writing threw
+            uint64_t bytesWritten;
+            uint32_t peakPendingFrames;
+            TimeDelta averageWriteTime; // Encoding and writing one frame, on a worker
+            TimeDelta blockedTime;      // Spent by collectCompleted() waiting for the workers, when frames are not dropped
+        };
+
+        /// Counts since construction or the last resetStats()
+        [[nodiscard]] Stats getStats() const;
+        void resetStats();
+        void printStats(std::ostream& out) const;
+
+    private:
+        /// One readback buffer of the ring
+        struct Slot {
+            vk::Buffer buffer;
+            vma::Allocation allocation;
+            const uint8_t* data = nullptr; // Persistently mapped
+            bool submitted = false;
+            uint64_t frameNumber = 0;
+        };
+
+        MemoryAllocator& m_allocator;
+        std::string m_description;
+        FrameWriter m_writer;
+        bool m_dropWhenBehind;
+        std::size_t m_maxPendingFrames;
+        bool m_enabled = false;
+
+        vk::Extent2D m_extent;
+        bool m_swizzleBgra = false;
+        std::vector<Slot> m_slots;
+        uint64_t m_nextFrameNumber = 0;
+
+        /// Guards everything below, which workers update
+        mutable std::mutex m_mutex;
+        std::condition_variable m_frameWritten;
+        std::size_t m_pendingFrames = 0;
+        /// Pixel storage of written frames, reused so a sequence does not allocate every frame
+        std::vector<std::vector<uint8_t>> m_freePixels;
+        Stats m_stats{};
+        TimeDelta m_writeTimeSum = TimeDelta::zero();
+        bool m_reportedFailure = false;
+
+        /// Declared last so the workers finish before anything they use is destroyed
+        ThreadPool m_workers;
+
+        void destroySlots();
+
+        /**
+         * Run the writer for one frame, on a worker
+         * @param frameNumber: The frame's number, counting from zero
+         * @param swizzleBgra: Whether the pixels were copied from a BGRA image, so need red and blue swapped
+         * @param image: The frame's pixels, whose storage is kept for later frames
+         */
+        void writeFrame(uint64_t frameNumber, bool swizzleBgra, ImageRGBA8& image);
+    };
+}
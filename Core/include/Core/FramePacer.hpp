@@ -0,0 +1,160 @@
+#pragma once
+
+#include "Core/RenderTypes.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <span>
+
+namespace Core {
+
+    /// How frames are paced, trading latency against throughput
+    enum class FramePacingProfile {
+        Balanced,   // The fewest images and the first supported of mailbox, immediate and FIFO relaxed, with no extra pacing
+        LowLatency, // The fewest images, and each frame starts once the previous one is displayed
+        Throughput, // An extra image, so rendering never waits for presentation to free one
+    };
+    const char* to_string(FramePacingProfile profile);
+
+    /**
+     * Paces the frames presented to the swapchain and measures their latency, owned by the Renderer.
+     *
+     * The profile chooses the present modes to prefer and the number of swapchain images, see Renderer::recreateSwapChain(),
+     * and how long beginFrame() holds back the start of a frame. Starting a frame later samples input later, so the
+     * frame is closer to current when it is displayed.
+     *
+     * With VK_KHR_present_id and VK_KHR_present_wait, each present is tagged with an id and its display is waited on,
+     * so latencies are measured against when frames are actually displayed. Otherwise frames are paced on the CPU from
+     * the measured present interval, and display is estimated as one present interval after the present call.
+     *
+     * Used only from the thread that renders.
+     */
+    class FramePacer {
+    public:
+        /**
+         * @param device: The device the swapchain is created on
+         * @param presentWaitEnabled: Whether VK_KHR_present_id, VK_KHR_present_wait and their features are enabled
+         */
+        FramePacer(vk::Device& device, bool presentWaitEnabled);
+        ~FramePacer();
+
+        /// Disallowed operations
+        FramePacer(const FramePacer&) = delete;
+        FramePacer(FramePacer&&) = delete;
+        FramePacer& operator=(const FramePacer&) = delete;
+        FramePacer& operator=(FramePacer&&) = delete;
+
+        [[nodiscard]] bool isPresentWaitEnabled() const;
+
+        /// -- Members for configuration --
+
+        /// Set the profile. Its present modes and image count apply from the next swapchain recreation.
+        void setProfile(FramePacingProfile profile);
+        [[nodiscard]] FramePacingProfile getProfile() const;
+
+        /// The present modes the profile prefers, most preferred first. FIFO is always supported, so is not listed.
+        [[nodiscard]] std::span<const vk::PresentModeKHR> getPreferredPresentModes() const;
+
+        /// The number of swapchain images the profile wants beyond the surface's minimum
+        [[nodiscard]] uint32_t getExtraImageCount() const;
+
+        /// -- End members for configuration --
+
+        /// -- Calls through each frame, in order --
+
+        /**
+         * Wait until the next frame should start, then start it. Call before the frame samples any input.
+         * Frames presented earlier are measured here.
+         */
+        void beginFrame();
+
+        /// Note that the frame is about to acquire its swapchain image. The time blocked in acquiring is not counted as the frame's work.
+        void acquireStarted();
+
+        /// Note that the frame's swapchain image has been acquired
+        void imageAcquired();
+
+        /**
+         * Present the frame, tagged with a present id when present wait is enabled
+         * @param queue: The queue to present on
+         * @param presentInfo: The presentation of a single swapchain image
+         * @return The result of presentation
+         */
+        vk::Result present(vk::Queue queue, const vk::PresentInfoKHR& presentInfo);
+
+        /// -- End calls through each frame --
+
+        /**
+         * Forget frames presented to a previous swapchain, which can no longer be waited on
+         * @param swapchain: The swapchain presented to from now on
+         */
+        void swapchainRecreated(vk::SwapchainKHR swapchain);
+
+        /// The latency of one frame
+        struct FrameTiming {
+            TimeDelta acquireToPresent; // From acquiring the swapchain image to its display
+            TimeDelta inputToDisplay;   // From the start of the frame, when input is sampled, to its display
+            bool measured;              // Whether display was waited on, rather than estimated
+        };
+
+        /// The latency of the most recent frame known to be displayed
+        [[nodiscard]] FrameTiming getLastFrameTiming() const;
+
+        struct Stats {
+            uint64_t frames; // Frames whose latency is known
+            uint64_t measuredFrames;
+            TimeDelta averageAcquireToPresent;
+            TimeDelta averageInputToDisplay;
+            TimeDelta maxInputToDisplay;
+            TimeDelta averagePresentInterval;
+        };
+
+        /// The latency of the frames displayed since the last resetStats()
+        [[nodiscard]] Stats getStats() const;
+        void resetStats();
+        void printStats(std::ostream& out) const;
+
+    private:
+        struct PendingFrame {
+            uint64_t presentId;
+            TimePoint start;
+            TimePoint acquireStarted;
+            TimePoint acquired;
+            TimePoint presented;
+        };
+
+        vk::Device& m_device;
+        bool m_presentWaitEnabled;
+        PFN_vkWaitForPresentKHR m_waitForPresent = nullptr;
+
+        FramePacingProfile m_profile = FramePacingProfile::Balanced;
+        vk::SwapchainKHR m_swapchain;
+        uint64_t m_nextPresentId = 1;
+
+        /// The frame being built, between beginFrame() and present()
+        PendingFrame m_currentFrame{};
+        /// Frames presented but not yet known to be displayed, oldest first
+        std::deque<PendingFrame> m_presentedFrames;
+
+        /// Smoothed durations that CPU pacing is planned from
+        TimeDelta m_presentInterval = TimeDelta::zero();
+        TimeDelta m_frameWork = TimeDelta::zero();
+        TimePoint m_lastPresent;
+
+        FrameTiming m_lastFrameTiming{};
+        Stats m_stats{};
+        TimeDelta m_acquireToPresentSum = TimeDelta::zero();
+        TimeDelta m_inputToDisplaySum = TimeDelta::zero();
+
+        /**
+         * Wait for presented frames to be displayed in order, and record the latency of each that is
+         * @param timeout: How long to wait for each frame in nanoseconds, zero to only check
+         */
+        void waitForDisplay(uint64_t timeout);
+
+        void recordFrame(const PendingFrame& frame, TimePoint displayed, bool measured);
+    };
+}
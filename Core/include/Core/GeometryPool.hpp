@@ -0,0 +1,165 @@
+#pragma once
+
+#include "Core/MemoryAllocator.hpp"
+#include "Core/RangeAllocator.hpp"
+#include "Core/Renderer.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * Vertex and index storage for many meshes, suballocated from a few large device local buffers.
+     *
+     * Every mesh in a page shares the page's vertex and index buffer, so they can all be drawn with a single bind
+     * and per-draw offsets. All vertices in a pool share one stride, and all indices are 32 bit.
+     * Pages are added as needed, and ranges within them are managed by a RangeAllocator.
+     * Pages share memory blocks with other geometry, so MemoryAllocator::defragment() may move a whole page. Ranges keep
+     * their offsets within it, and the owner of the allocator's move callback passes moves on to bufferMoved().
+     */
+    class GeometryPool {
+    public:
+        /**
+         * @param renderer: The renderer whose graphics queue is used for uploads
+         * @param allocator: The allocator that pages are created from
+         * @param vertexStride: The size in bytes of a single vertex
+         * @param verticesPerPage: The number of vertices in each vertex buffer page
+         * @param indicesPerPage: The number of indices in each index buffer page
+         */
+        GeometryPool(Renderer& renderer, MemoryAllocator& allocator, uint32_t vertexStride, uint32_t verticesPerPage, uint32_t indicesPerPage);
+        ~GeometryPool();
+
+        /// Disallowed operations
+        GeometryPool(const GeometryPool&) = delete;
+        GeometryPool(GeometryPool&&) = delete;
+        GeometryPool& operator=(const GeometryPool&) = delete;
+        GeometryPool& operator=(GeometryPool&&) = delete;
+
+        /// The location of one mesh within the pool. Offsets are in vertices and indices, not bytes.
+        struct Range {
+            uint32_t page;
+            uint32_t firstVertex;
+            uint32_t vertexCount;
+            uint32_t firstIndex;
+            uint32_t indexCount; // Zero for non-indexed geometry
+        };
+
+        /**
+         * Reserve space for a mesh. A new page is created if no existing page has room.
+         * @param vertexCount: The number of vertices
+         * @param indexCount: The number of indices, or zero for non-indexed geometry
+         * @return The reserved range
+         */
+        Range allocate(uint32_t vertexCount, uint32_t indexCount);
+
+        /**
+         * Release a range returned by allocate(). The caller must ensure no pending draws reference it.
+         */
+        void free(const Range& range);
+
+        /**
+         * Queue data to be copied into a range. The data is copied into a persistently mapped staging buffer
+         * immediately, and reaches the device on the next flushUploads(). If the staging buffer is full the
+         * pending uploads are flushed first, so uploads of any size stream through a staging buffer of fixed size.
+         * @param range: A range returned by allocate()
+         * @param vertices: range.vertexCount * vertexStride bytes of vertex data
+         * @param indices: range.indexCount indices, relative to the first vertex of the range
+         */
+        void upload(const Range& range, const void* vertices, const uint32_t* indices);
+
+        /**
+         * Submit all queued uploads in a single command buffer and wait for them to complete.
+         */
+        void flushUploads();
+
+        /**
+         * Bind the vertex and index buffers of a page
+         * @param commandBuffer: The command buffer to record into
+         * @param page: The page of the ranges that will be drawn
+         * @param vertexBinding: The binding of the vertex buffer
+         */
+        void bind(vk::CommandBuffer commandBuffer, uint32_t page, uint32_t vertexBinding = 0) const;
+
+        /**
+         * Record a draw of a range. The range's page must be bound.
+         */
+        void draw(vk::CommandBuffer commandBuffer, const Range& range, uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
+
+        /**
+         * Swap in a page buffer replaced by MemoryAllocator::defragment(). Command buffers that bound the page must be
+         * recorded again, as the old buffer has been destroyed. Ranges within the page are unchanged.
+         * @param allocation: The allocation that was moved
+         * @param oldBuffer: The destroyed buffer
+         * @param newBuffer: The buffer now bound to the allocation
+         * @return Whether the buffer belonged to a page of this pool
+         */
+        bool bufferMoved(vma::Allocation allocation, vk::Buffer oldBuffer, vk::Buffer newBuffer);
+
+        [[nodiscard]] uint32_t getPageCount() const;
+        [[nodiscard]] uint32_t getVertexStride() const;
+
+        struct Stats {
+            uint32_t pageCount;
+            std::size_t meshCount;
+            RangeAllocator::Stats vertices; // Summed over all pages, except largestFreeRange which is the maximum
+            RangeAllocator::Stats indices;
+        };
+        [[nodiscard]] Stats getStats() const;
+
+        /// Print occupancy and fragmentation for every page
+        void printStats(std::ostream& out) const;
+
+    private:
+        vk::Device m_device;
+        const QueueGroup& m_graphicsQueue;
+        MemoryAllocator& m_allocator;
+
+        uint32_t m_vertexStride;
+        uint32_t m_verticesPerPage;
+        uint32_t m_indicesPerPage;
+
+        struct Page {
+            vk::Buffer vertexBuffer;
+            vma::Allocation vertexAllocation;
+            RangeAllocator vertices;
+
+            vk::Buffer indexBuffer;
+            vma::Allocation indexAllocation;
+            RangeAllocator indices;
+        };
+        std::vector<std::unique_ptr<Page>> m_pages;
+        std::size_t m_meshCount = 0;
+
+        /// Uploads waiting for flushUploads()
+        struct PendingCopy {
+            uint32_t page;
+            bool index;
+            vk::BufferCopy region;
+        };
+        std::vector<PendingCopy> m_pendingCopies;
+
+        /// A mapped host buffer that uploads are written into, created on first use
+        vk::Buffer m_stagingBuffer;
+        vma::Allocation m_stagingAllocation;
+        char* m_stagingData = nullptr;
+        vk::DeviceSize m_stagingCapacity = 0;
+        vk::DeviceSize m_stagingUsed = 0;
+
+        vk::CommandPool m_commandPool;
+
+        /// Create a page large enough for at least the given counts
+        Page& addPage(uint32_t vertexCount, uint32_t indexCount);
+        void destroyPage(Page& page);
+
+        /// Copy data into the staging buffer in pieces, queueing a copy to the page's vertex or index buffer for each
+        void stage(uint32_t page, bool index, vk::DeviceSize destinationOffset, const void* data, vk::DeviceSize size);
+
+        /// Get space for size bytes in the staging buffer, flushing it first if it is full. size must not exceed its capacity.
+        vk::DeviceSize reserveStaging(vk::DeviceSize size);
+        void destroyStaging();
+    };
+}
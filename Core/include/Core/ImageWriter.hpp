@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+    /// The file formats rendered images can be written as
+    enum class ImageFileFormat {
+        Png, // 8 bit RGBA, stored without compression so encoding costs little more than the write
+        Exr, // Half float RGBA, linear
+    };
+    const char* to_string(ImageFileFormat format);
+
+    /// The extension for a format, including the dot
+    const char* getFileExtension(ImageFileFormat format);
+
+    /**
+     * 8 bit RGBA pixels, rows top to bottom with no padding between them.
+     * The values are display referred, as they would be shown by an sRGB display.
+     */
+    struct ImageRGBA8 {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> pixels;
+    };
+
+    /**
+     * Write an image as a PNG. Throws a std::runtime_error if the file cannot be written.
+     * @return The size of the file in bytes
+     */
+    std::size_t writePng(const std::string& path, const ImageRGBA8& image);
+
+    /**
+     * Write an image as an uncompressed scanline OpenEXR file, decoding the sRGB curve so the file is linear.
+     * Throws a std::runtime_error if the file cannot be written.
+     * @return The size of the file in bytes
+     */
+    std::size_t writeExr(const std::string& path, const ImageRGBA8& image);
+
+    /// Write an image in the given format, returning the size of the file in bytes
+    std::size_t writeImage(const std::string& path, const ImageRGBA8& image, ImageFileFormat format);
+}
@@ -23,6 +23,14 @@ namespace Core {
          */
         virtual bool windowResized(int width, int height);
 
+        /**
+         * Indicates that a key has been pressed.
+         * @param key: The GLFW key code, eg. GLFW_KEY_F2
+         * @param mods: A bitfield of the GLFW modifier keys held down at the time
+         * @return true if the event was handled
+         */
+        virtual bool keyPressed(int key, int mods);
+
         // -- End GLFW Events --
     };
 }
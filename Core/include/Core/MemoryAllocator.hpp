@@ -0,0 +1,199 @@
+#pragma once
+
+#include "Core/Renderer.hpp"
+
+#include <vk_mem_alloc.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * The kind of resource an allocation backs. Every allocation made through MemoryAllocator is tagged with one,
+     * which decides the placement policy and shows up as the allocation name in exported statistics.
+     */
+    enum class AllocationCategory {
+        Framebuffer, // Swapchain-sized render targets, recreated on resize
+        Geometry,    // Vertex and index data
+        BVH,         // Acceleration structures and their scratch memory
+        Staging,     // Host-visible upload and readback buffers
+    };
+    constexpr std::size_t AllocationCategoryCount = 4;
+
+    const char* to_string(AllocationCategory category);
+
+    /**
+     * Owns the VMA allocator for a Renderer's device and tracks how it is being used.
+     *
+     * Framebuffers always receive dedicated memory, so the churn of swapchain recreation hands whole blocks back to
+     * the driver instead of punching holes in the blocks shared by long-lived resources. Geometry and BVH buffers are
+     * movable and are compacted by defragment(), which is intended to be called during idle frames.
+     */
+    class MemoryAllocator {
+    public:
+        explicit MemoryAllocator(Renderer& renderer);
+        ~MemoryAllocator();
+
+        /// Disallowed operations
+        MemoryAllocator(const MemoryAllocator&) = delete;
+        MemoryAllocator(MemoryAllocator&&) = delete;
+        MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+        MemoryAllocator& operator=(MemoryAllocator&&) = delete;
+
+        /// Get the underlying allocator, for calls that do not change allocation lifetimes (map, flush, etc.)
+        [[nodiscard]] vma::Allocator getHandle() const;
+
+        /// -- Allocation --
+
+        /**
+         * Create a buffer and its backing memory, tagged with a category.
+         * Geometry and BVH buffers may be moved by defragment(), see setMoveCallback(), unless they have dedicated memory or are mapped.
+         * @param bufferInfo: The buffer to create
+         * @param allocationInfo: Allocation requirements. pUserData is replaced by the category name.
+         * @param category: The category to account this buffer under
+         * @return The buffer and its allocation, to be destroyed with destroyBuffer()
+         */
+        std::pair<vk::Buffer, vma::Allocation> createBuffer(const vk::BufferCreateInfo& bufferInfo,
+                                                            const vma::AllocationCreateInfo& allocationInfo,
+                                                            AllocationCategory category);
+
+        /**
+         * Create an image and its backing memory, tagged with a category.
+         * Images are never moved by defragmentation.
+         * @param imageInfo: The image to create
+         * @param allocationInfo: Allocation requirements. pUserData is replaced by the category name.
+         * @param category: The category to account this image under
+         * @return The image and its allocation, to be destroyed with destroyImage()
+         */
+        std::pair<vk::Image, vma::Allocation> createImage(const vk::ImageCreateInfo& imageInfo,
+                                                          const vma::AllocationCreateInfo& allocationInfo,
+                                                          AllocationCategory category);
+
+        void destroyBuffer(vk::Buffer buffer, vma::Allocation allocation);
+        void destroyImage(vk::Image image, vma::Allocation allocation);
+
+        /// -- End allocation --
+
+        /// -- Budget and statistics --
+
+        /// Usage and budget for a single memory heap, as reported by VK_EXT_memory_budget when available
+        struct HeapBudget {
+            vk::DeviceSize blockBytes;      // Bytes allocated from the driver for this heap by VMA
+            vk::DeviceSize allocationBytes; // Bytes of blockBytes occupied by live allocations
+            vk::DeviceSize usage;           // Estimated usage of the heap by the whole process
+            vk::DeviceSize budget;          // Estimated amount the process can use before running into trouble
+            bool deviceLocal;
+        };
+
+        /// Live allocations and bytes per category
+        struct CategoryStats {
+            std::size_t allocationCount = 0;
+            vk::DeviceSize allocatedBytes = 0;
+            vk::DeviceSize peakBytes = 0;
+        };
+
+        /**
+         * Advance to the next frame. VMA refreshes its budget numbers on frame boundaries, so this
+         * should be called once per frame before using getHeapBudgets().
+         */
+        void beginFrame(uint32_t frameIndex);
+
+        /// Whether VK_EXT_memory_budget is feeding the budget numbers, rather than VMA's own estimate
+        [[nodiscard]] bool hasMemoryBudget() const;
+
+        /// Get usage and budget for every heap of the device
+        [[nodiscard]] std::vector<HeapBudget> getHeapBudgets() const;
+
+        /**
+         * Check whether any device local heap is above a fraction of its budget.
+         * @param fraction: The fraction of the budget to test against, 1.0 being the whole budget
+         */
+        [[nodiscard]] bool isOverBudget(float fraction = 1.0f) const;
+
+        [[nodiscard]] CategoryStats getCategoryStats(AllocationCategory category) const;
+
+        /**
+         * Build the VMA JSON statistics dump, which can be viewed with VMA's VmaDumpVis tool.
+         * Allocations are named by their category.
+         * @param detailedMap: Include the placement of each allocation within each block
+         */
+        [[nodiscard]] std::string buildStatsJson(bool detailedMap) const;
+
+        /// Write buildStatsJson() to a file. Throws a std::runtime_error if the file cannot be written.
+        void writeStatsJson(const std::string& filename, bool detailedMap) const;
+
+        /// Print a short per-heap and per-category summary
+        void printSummary(std::ostream& out) const;
+
+        /// -- End budget and statistics --
+
+        /// -- Defragmentation --
+
+        /// Called for every buffer that was moved, after the new buffer has been bound to the moved memory.
+        using MoveCallback = std::function<void(vma::Allocation allocation, vk::Buffer oldBuffer, vk::Buffer newBuffer)>;
+
+        /**
+         * Set the function notified when defragment() replaces a buffer. Owners of movable buffers must swap their
+         * handles (and re-record any command buffers or descriptors referencing them) from this callback.
+         */
+        void setMoveCallback(MoveCallback callback);
+
+        struct DefragmentationResult {
+            vk::DeviceSize bytesMoved = 0;
+            vk::DeviceSize bytesFreed = 0;
+            uint32_t allocationsMoved = 0;
+            uint32_t deviceMemoryBlocksFreed = 0;
+        };
+
+        /**
+         * Run one incremental defragmentation step over the movable device local buffers.
+         * The copies are recorded and submitted to the graphics queue, and this call waits for them to complete,
+         * so the caller must ensure no submitted work is still using the movable buffers.
+         * @param maxBytesToMove: The most bytes that may be copied in this step
+         * @param maxAllocationsToMove: The most allocations that may be moved in this step
+         * @return Statistics about what was moved
+         */
+        DefragmentationResult defragment(vk::DeviceSize maxBytesToMove, uint32_t maxAllocationsToMove);
+
+        /// -- End defragmentation --
+
+    private:
+        vk::Device m_device;
+        const QueueGroup& m_graphicsQueue;
+        vma::Allocator m_allocator;
+        bool m_memoryBudgetEnabled;
+        uint32_t m_frameIndex = 0;
+
+        /// A one-off pool used to record defragmentation copies
+        vk::CommandPool m_commandPool;
+
+        /// Buffers that may be moved by defragmentation, along with the info needed to recreate them
+        struct MovableBuffer {
+            vk::Buffer buffer;
+            vk::BufferCreateInfo createInfo;
+        };
+        std::unordered_map<VmaAllocation, MovableBuffer> m_movableBuffers;
+        MoveCallback m_moveCallback;
+
+        /// Per-category accounting, indexed by AllocationCategory
+        struct AllocationRecord {
+            AllocationCategory category;
+            vk::DeviceSize size;
+        };
+        std::unordered_map<VmaAllocation, AllocationRecord> m_allocations;
+        std::array<CategoryStats, AllocationCategoryCount> m_categoryStats;
+        mutable std::mutex m_mutex;
+
+        /// Adjust the allocation info to the placement policy for a category
+        vma::AllocationCreateInfo applyCategoryPolicy(const vma::AllocationCreateInfo& allocationInfo, AllocationCategory category) const;
+
+        void recordAllocation(vma::Allocation allocation, AllocationCategory category);
+        void forgetAllocation(vma::Allocation allocation);
+    };
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace Core {
+
+    /// Vertex data of any layout with a triangle list index buffer
+    struct IndexedMesh {
+        uint32_t vertexStride = 0;
+        std::vector<uint8_t> vertices;
+        std::vector<uint32_t> indices;
+
+        [[nodiscard]] uint32_t getVertexCount() const;
+        [[nodiscard]] uint32_t getTriangleCount() const;
+    };
+
+    /**
+     * The mesh ingestion stage: turns triangle soups into indexed meshes ordered for the GPU.
+     *
+     * ingest() runs every stage in order:
+     *  1. Weld bitwise identical vertices into an indexed mesh
+     *  2. Reorder triangles for post-transform vertex cache hits (Forsyth's linear-speed algorithm)
+     *  3. Reorder clusters of triangles to draw outward facing geometry first, reducing overdraw
+     *     (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+     *  4. Reorder vertices into first-use order, so vertex fetch walks memory linearly
+     *
+     * Vertices are treated as opaque bytes, except for the overdraw stage, which reads a float3 position.
+     */
+    class MeshOptimizer {
+    public:
+        /**
+         * @param vertexStride: The size in bytes of a single vertex
+         * @param positionOffset: The offset in bytes of the float3 position within a vertex
+         */
+        explicit MeshOptimizer(uint32_t vertexStride, uint32_t positionOffset = 0);
+        ~MeshOptimizer();
+
+        /// -- Members for configuration --
+
+        /// The FIFO cache size used to measure ACMR/ATVR. 16 is representative of current hardware.
+        void setAnalysisCacheSize(uint32_t cacheSize);
+
+        /**
+         * Set how much vertex cache efficiency may be traded for overdraw.
+         * @param threshold: Clusters are split while their ACMR stays within this factor of the optimized ACMR.
+         *                   1.0 keeps vertex cache efficiency, 1.05 is a good trade off.
+         */
+        void setOverdrawThreshold(float threshold);
+
+        /// -- End members for configuration --
+
+        /// Post-transform cache efficiency for an index buffer
+        struct CacheStats {
+            float acmr; // Average cache miss ratio: transformed vertices per triangle, 0.5 is ideal, 3 is worst
+            float atvr; // Average transformed vertex ratio: transformed vertices per unique vertex, 1 is ideal
+        };
+
+        /// Measurements taken by the last ingest() or optimize()
+        struct Report {
+            uint32_t inputVertices; // The soup given to ingest(), or the mesh given to optimize()
+            uint32_t outputVertices;
+            uint32_t triangles;
+            CacheStats before;
+            CacheStats after;
+        };
+
+        /**
+         * Run the whole ingestion stage on a non-indexed triangle list.
+         * @param vertices: vertexCount * vertexStride bytes of vertex data, three vertices per triangle
+         * @param vertexCount: The number of vertices
+         * @return The optimized indexed mesh
+         */
+        IndexedMesh ingest(const void* vertices, std::size_t vertexCount);
+
+        /**
+         * Run the ordering stages on an already indexed mesh, eg. one from an asset file.
+         * Duplicate vertices are not welded. Throws if the indices are not whole triangles, or reference a vertex past the end.
+         */
+        void optimize(IndexedMesh& mesh);
+
+        [[nodiscard]] const Report& getReport() const;
+        void printReport(std::ostream& out) const;
+
+        /// -- Individual stages --
+
+        [[nodiscard]] IndexedMesh weld(const void* vertices, std::size_t vertexCount) const;
+        void optimizeVertexCache(IndexedMesh& mesh) const;
+        void optimizeOverdraw(IndexedMesh& mesh) const;
+        void optimizeVertexFetch(IndexedMesh& mesh) const;
+        [[nodiscard]] CacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount) const;
+
+        /// -- End individual stages --
+
+    private:
+        uint32_t m_vertexStride;
+        uint32_t m_positionOffset;
+        uint32_t m_analysisCacheSize = 16;
+        float m_overdrawThreshold = 1.05f;
+
+        Report m_report{};
+
+        /// Simulate a FIFO cache over a range of triangles, returning the number of cache misses
+        uint32_t countCacheMisses(const uint32_t* indices, std::size_t indexCount, uint32_t vertexCount) const;
+    };
+}
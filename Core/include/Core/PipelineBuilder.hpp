@@ -1,9 +1,12 @@
 #pragma once
 
 #include "Core/Shader.hpp"
+#include "Core/SpecializationConstants.hpp"
 
 #include <vulkan/vulkan.hpp>
 
+#include <map>
+
 namespace Core {
 
     /**
@@ -24,6 +27,14 @@ namespace Core {
          */
         void addShader(Shader& shader);
 
+        /**
+         * Add a shader specialized with constants, see SpecializationConstants.
+         * The constants are copied, so only the shader must outlive this object.
+         * @param shader: The shader to add
+         * @param specialization: Values for the shader's specialization constants
+         */
+        void addShader(Shader& shader, const SpecializationConstants& specialization);
+
         /**
          * Set the pipeline to derive from to a previously created pipeline
          * Only one of pipeline and index can be set for derivation.
@@ -43,8 +54,9 @@ namespace Core {
 
     protected:
         /// Handlers for pipeline implementations to support specific shader types
-        virtual void addVertexShader(Shader& shader);
-        virtual void addFragmentShader(Shader& shader);
+        /// specialization is owned by this object, or null for an unspecialized shader
+        virtual void addVertexShader(Shader& shader, const SpecializationConstants* specialization);
+        virtual void addFragmentShader(Shader& shader, const SpecializationConstants* specialization);
 
         /// Flags used for creating the pipeline
         vk::PipelineCreateFlags m_pipelineCreateFlags = vk::PipelineCreateFlags();
@@ -52,5 +64,12 @@ namespace Core {
         /// Members used for creating pipeline derivatives
         vk::Pipeline m_basePipeline = vk::Pipeline(); // Null handle
         int32_t m_basePipelineIndex = -1;
+
+        /// Copies of the constants given to addShader(), by stage. Map nodes never move, so stage infos can point at them.
+        std::map<ShaderType, SpecializationConstants> m_specializations;
+
+    private:
+        /// Hand a shader to the handler for its stage
+        void addStage(Shader& shader, const SpecializationConstants* specialization);
     };
 }
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Core/GraphicsPipeline.hpp"
+#include "Core/RasterPipelineBuilder.hpp"
+#include "Core/SpecializationConstants.hpp"
+#include "Core/ThreadPool.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * Compiles graphics pipelines on a pool of worker threads, owned by the Renderer.
+     * Drivers compile shaders to machine code at pipeline creation, which can take milliseconds per pipeline, so
+     * creating many permutations up front stalls whichever thread does it. Draw with a cheap fallback, see
+     * AsyncPipeline, until the compiled pipeline is ready.
+     *
+     * The shaders, layout and render pass a builder references must outlive its compilation.
+     */
+    class PipelineCompiler {
+    public:
+        /**
+         * @param device: The device to create pipelines on, which must outlive every pipeline created
+         * @param threadCount: The number of workers, zero for one per hardware thread but the main one
+         */
+        explicit PipelineCompiler(vk::Device& device, uint32_t threadCount = 0);
+
+        /// Finishes every queued compilation
+        ~PipelineCompiler();
+
+        /// Disallowed operations
+        PipelineCompiler(const PipelineCompiler&) = delete;
+        PipelineCompiler(PipelineCompiler&&) = delete;
+        PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+        PipelineCompiler& operator=(PipelineCompiler&&) = delete;
+
+        /**
+         * Queue a pipeline for compilation
+         * @param builder: The configured builder, which is kept until the pipeline is created
+         * @return The pipeline. Creation errors are rethrown from get().
+         */
+        std::future<std::unique_ptr<GraphicsPipeline>> compile(std::shared_ptr<RasterPipelineBuilder> builder);
+
+        /**
+         * Queue permutations of a pipeline that differ only by the specialization constants of one stage, see
+         * RasterPipelineBuilder::getPermutationCreateInfos(). Each is compiled on its own, so they compile in parallel.
+         * @param builder: The configured builder, which is kept until every permutation is created
+         * @param stage: The stage to specialize
+         * @param permutations: The constants for each permutation
+         * @return One pipeline per permutation, in order
+         */
+        std::vector<std::future<std::unique_ptr<GraphicsPipeline>>> compilePermutations(std::shared_ptr<RasterPipelineBuilder> builder,
+                                                                                        ShaderType stage,
+                                                                                        std::span<const SpecializationConstants> permutations);
+
+        /**
+         * Queue a pipeline for compilation from a createInfo
+         * @param owner: Kept until the pipeline is created, to keep alive everything the createInfo points into
+         * @param createInfo: The pipeline to create
+         * @return The pipeline. Creation errors are rethrown from get().
+         */
+        std::future<std::unique_ptr<GraphicsPipeline>> compile(std::shared_ptr<const void> owner, const vk::GraphicsPipelineCreateInfo& createInfo);
+
+        /// Block until no compilation is queued or running
+        void waitIdle();
+
+        struct Stats {
+            uint64_t queued;    // Pipelines waiting for or being compiled
+            uint64_t compiled;
+            uint64_t failed;
+            double compileSeconds; // Summed over every worker, so it can exceed the wall clock time
+        };
+
+        [[nodiscard]] Stats getStats() const;
+        void printStats(std::ostream& out) const;
+
+    private:
+        vk::Device& m_device;
+
+        std::atomic<uint64_t> m_queued = 0;
+        std::atomic<uint64_t> m_compiled = 0;
+        std::atomic<uint64_t> m_failed = 0;
+        std::atomic<uint64_t> m_compileNanoseconds = 0;
+
+        /// Last, so the workers are joined before anything they use is destroyed
+        ThreadPool m_workers;
+    };
+
+    /**
+     * A pipeline that is drawn with a fallback until its compilation finishes.
+     * Call update() at a frame boundary, so a pipeline never changes while command buffers using it are recorded.
+     */
+    class AsyncPipeline {
+    public:
+        /// A pipeline that is already compiled
+        explicit AsyncPipeline(std::shared_ptr<GraphicsPipeline> pipeline);
+
+        /**
+         * @param fallback: The pipeline to draw with meanwhile, which may be shared between many AsyncPipelines
+         * @param compiled: The pipeline being compiled, eg. from PipelineCompiler::compile()
+         */
+        AsyncPipeline(std::shared_ptr<GraphicsPipeline> fallback, std::future<std::unique_ptr<GraphicsPipeline>> compiled);
+
+        /**
+         * Swap in the compiled pipeline if it has finished. Compilation errors are rethrown from here.
+         * @return True if the pipeline changed, so command buffers that use it must be recorded again
+         */
+        bool update();
+
+        /// Whether the compiled pipeline is in use
+        [[nodiscard]] bool isReady() const;
+
+        /// The pipeline to draw with now
+        [[nodiscard]] const GraphicsPipeline& get() const;
+
+    private:
+        std::shared_ptr<GraphicsPipeline> m_current;
+        std::future<std::unique_ptr<GraphicsPipeline>> m_pending;
+    };
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Core/GraphicsPipeline.hpp"
+#include "Core/PipelineCompiler.hpp"
+#include "Core/PipelineState.hpp"
+#include "Core/RasterPipelineBuilder.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+namespace Core {
+
+    /**
+     * Builds pipelines from separately created parts, see VK_EXT_graphics_pipeline_library, owned by the Renderer.
+     *
+     * Each part of a pipeline (vertex input, pre-rasterization shaders, fragment shader, fragment output) is created
+     * once as a library and cached by its PipelineState. A pipeline is then a fast link of four libraries, which
+     * takes far less time than a full compile, so a new combination of parts is usable in the frame it is first needed.
+     * An optimized link is queued on the PipelineCompiler and replaces the fast one when ready.
+     *
+     * Without the extension, pipelines are created monolithically on the calling thread.
+     */
+    class PipelineLibraryCache {
+    public:
+        /**
+         * @param device: The device to create pipelines on, which must outlive every pipeline created
+         * @param compiler: The compiler to run optimized links on, which must be destroyed first
+         * @param enabled: Whether VK_EXT_graphics_pipeline_library and its feature are enabled on the device
+         */
+        PipelineLibraryCache(vk::Device& device, PipelineCompiler& compiler, bool enabled);
+        ~PipelineLibraryCache();
+
+        /// Disallowed operations
+        PipelineLibraryCache(const PipelineLibraryCache&) = delete;
+        PipelineLibraryCache(PipelineLibraryCache&&) = delete;
+        PipelineLibraryCache& operator=(const PipelineLibraryCache&) = delete;
+        PipelineLibraryCache& operator=(PipelineLibraryCache&&) = delete;
+
+        /// Whether pipelines are linked from libraries, rather than created monolithically
+        [[nodiscard]] bool isEnabled() const;
+
+        /**
+         * Get a pipeline for the builder's current state, usable at once.
+         * The builder is only used during this call.
+         * @param builder: The configured builder
+         * @return The fast-linked pipeline, which update() replaces with the optimized one. Ready at once when monolithic.
+         */
+        AsyncPipeline getPipeline(RasterPipelineBuilder& builder);
+
+        /// Destroy every cached library. Pipelines already linked are not affected.
+        void clear();
+
+        /**
+         * Forget the libraries created with a handle that is about to be destroyed, as a later object may be given the
+         * same handle value. Pipelines already linked are not affected.
+         * @param handleKey: The shader module, pipeline layout or render pass, from PipelineState::getHandleKey()
+         * @return The number of libraries forgotten
+         */
+        std::size_t releaseReferencing(uint64_t handleKey);
+
+        struct Stats {
+            uint64_t libraryHits;
+            uint64_t libraryMisses; // Libraries created
+            uint64_t fastLinks;
+            uint64_t monolithicPipelines; // Created without libraries, as the extension is missing
+            std::size_t libraryCount;
+        };
+
+        [[nodiscard]] Stats getStats() const;
+        void printStats(std::ostream& out) const;
+
+    private:
+        vk::Device& m_device;
+        PipelineCompiler& m_compiler;
+        const bool m_enabled;
+
+        mutable std::mutex m_mutex;
+        /// Shared with optimized links still running
+        std::unordered_map<PipelineState, std::shared_ptr<GraphicsPipeline>> m_libraries;
+        Stats m_stats{};
+
+        /// Expects m_mutex to be held
+        std::shared_ptr<GraphicsPipeline> findOrCreateLibrary(const vk::GraphicsPipelineCreateInfo& createInfo);
+    };
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * A canonical description of a graphics pipeline, for recognising equal pipelines.
+     *
+     * A vk::GraphicsPipelineCreateInfo is full of pointers into whichever builder made it, so two equal pipelines
+     * rarely have equal createInfos. This follows every pointer and stores the state it reaches as plain values.
+     * Handles, ie. shader modules, layouts and render passes, are compared by value, so equal states must share them.
+     * The ShaderLibrary already gives equal code the same module. Vulkan may give a new object the value of a destroyed
+     * one, so caches of states must forget those that reference a handle before it is destroyed, see references().
+     *
+     * The base pipeline of a derivative is not part of the state, since it does not change what the pipeline does.
+     */
+    class PipelineState {
+    public:
+        /**
+         * Describe a pipeline, or a pipeline library
+         * @param createInfo: The info the pipeline would be created with. Throws std::runtime_error if its pNext chain
+         * holds a structure this does not know how to describe.
+         */
+        explicit PipelineState(const vk::GraphicsPipelineCreateInfo& createInfo);
+
+        [[nodiscard]] uint64_t getHash() const;
+
+        /**
+         * Whether the state was described with a handle, so must be forgotten before the handle is destroyed
+         * @param handleKey: A shader module, pipeline layout or render pass, from getHandleKey()
+         */
+        [[nodiscard]] bool references(uint64_t handleKey) const;
+
+        /// The value a handle is recorded with, whichever way the platform defines non-dispatchable handles
+        template<typename Handle>
+        static uint64_t getHandleKey(Handle handle) {
+            static_assert(sizeof(Handle) <= sizeof(uint64_t));
+            uint64_t key = 0;
+            memcpy(&key, &handle, sizeof(handle));
+            return key;
+        }
+
+        bool operator==(const PipelineState& other) const;
+
+    private:
+        std::vector<std::byte> m_state;
+        std::vector<uint64_t> m_handles; // Keys of the handles in m_state
+        uint64_t m_hash;
+    };
+}
+
+template<>
+struct std::hash<Core::PipelineState> {
+    std::size_t operator()(const Core::PipelineState& state) const noexcept { return static_cast<std::size_t>(state.getHash()); }
+};
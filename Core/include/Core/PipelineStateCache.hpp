@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Core/GraphicsPipeline.hpp"
+#include "Core/PipelineState.hpp"
+#include "Core/RasterPipelineBuilder.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+namespace Core {
+
+    /**
+     * Device scoped cache of pipelines by their PipelineState, owned by the Renderer.
+     *
+     * Asking for a pipeline equal to one created before returns the existing pipeline, so code that builds the same
+     * pipelines repeatedly, eg. on every swapchain resize or for every material sharing a shader, pays for each once.
+     * Pipelines stay alive while the cache holds them, until releaseUnused().
+     *
+     * Safe to use from several threads, though pipelines are created with the cache locked.
+     */
+    class PipelineStateCache {
+    public:
+        /// @param device: The device to create pipelines on, which must outlive every pipeline created
+        explicit PipelineStateCache(vk::Device& device);
+        ~PipelineStateCache();
+
+        /// Disallowed operations
+        PipelineStateCache(const PipelineStateCache&) = delete;
+        PipelineStateCache(PipelineStateCache&&) = delete;
+        PipelineStateCache& operator=(const PipelineStateCache&) = delete;
+        PipelineStateCache& operator=(PipelineStateCache&&) = delete;
+
+        /**
+         * Get the pipeline for a createInfo
+         * @param createInfo: The pipeline to find or create. A base pipeline to derive from is only used on creation.
+         * @return The shared pipeline, which is an existing one if an equal state has been seen
+         */
+        std::shared_ptr<GraphicsPipeline> get(const vk::GraphicsPipelineCreateInfo& createInfo);
+
+        /**
+         * Get the pipeline for a builder's current state
+         * @param builder: The configured builder, which is only used during this call
+         * @return The shared pipeline, which is an existing one if an equal state has been seen
+         */
+        std::shared_ptr<GraphicsPipeline> get(RasterPipelineBuilder& builder);
+
+        /**
+         * Destroy the pipelines that nothing outside the cache references
+         * @return The number of pipelines destroyed
+         */
+        std::size_t releaseUnused();
+
+        /**
+         * Forget the pipelines created with a handle that is about to be destroyed, as a later object may be given the
+         * same handle value. Pipelines still referenced elsewhere stay alive.
+         * @param handleKey: The shader module, pipeline layout or render pass, from PipelineState::getHandleKey()
+         * @return The number of pipelines forgotten
+         */
+        std::size_t releaseReferencing(uint64_t handleKey);
+
+        struct Stats {
+            uint64_t hits;   // Requests answered with an existing pipeline
+            uint64_t misses; // Requests that created a pipeline
+            std::size_t pipelineCount;
+        };
+
+        [[nodiscard]] Stats getStats() const;
+        void printStats(std::ostream& out) const;
+
+    private:
+        vk::Device& m_device;
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<PipelineState, std::shared_ptr<GraphicsPipeline>> m_pipelines;
+        Stats m_stats{};
+    };
+}
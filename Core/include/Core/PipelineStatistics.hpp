@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Core/Renderer.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * Counts the fragment shader invocations of each frame with a pipeline statistics query, to measure overdraw:
+     * a frame that shades each of its pixels once has one invocation per pixel, and every invocation above that shaded
+     * a fragment something else covered. Comparing the counts with and without a depth prepass shows the shading it saves.
+     *
+     * Each frame's command buffer has its own slot of a query pool, read back once the frame has completed.
+     * The queries need the pipelineStatisticsQuery feature, which Renderer enables where it is supported. Without it
+     * nothing is recorded and the stats say so.
+     *
+     * Used only from the thread that renders.
+     */
+    class PipelineStatistics {
+    public:
+        /// @param renderer: The renderer whose graphics queue the frames are submitted to
+        explicit PipelineStatistics(Renderer& renderer);
+        /// Frames submitted with its queries must have completed
+        ~PipelineStatistics();
+
+        /// Disallowed operations
+        PipelineStatistics(const PipelineStatistics&) = delete;
+        PipelineStatistics(PipelineStatistics&&) = delete;
+        PipelineStatistics& operator=(const PipelineStatistics&) = delete;
+        PipelineStatistics& operator=(PipelineStatistics&&) = delete;
+
+        /// -- Members for configuration --
+
+        /**
+         * Recreate the query slots, one per frame that may be in flight. Frames submitted earlier are forgotten,
+         * so must have completed.
+         * @param slotCount: The number of frames that may be in flight at once, eg. the number of command buffers
+         */
+        void resize(std::size_t slotCount);
+
+        /// -- End members for configuration --
+
+        /// Whether the device can count invocations, otherwise recording does nothing
+        [[nodiscard]] bool isSupported() const;
+
+        /**
+         * Record the start of the counted commands. Must be outside a render pass, and the counted draws must follow it.
+         * @param buffer: The frame's command buffer
+         * @param slot: The slot to count the frame with, which must not be used by a frame still in flight
+         */
+        void recordBegin(vk::CommandBuffer& buffer, std::size_t slot) const;
+
+        /// Record the end of the counted commands, outside a render pass
+        void recordEnd(vk::CommandBuffer& buffer, std::size_t slot) const;
+
+        /**
+         * Note that a command buffer counted with the slot has been submitted
+         * @param slot: The slot the command buffer was recorded with
+         * @param pixelCount: The pixels the frame rendered, which its invocations are compared to
+         */
+        void frameSubmitted(std::size_t slot, uint64_t pixelCount);
+
+        /// Read the counts of every submitted frame. Call once they have completed, and before their slots are submitted again.
+        void collectCompleted();
+
+        struct Stats {
+            uint64_t frames;
+            uint64_t lastFragmentInvocations;
+            uint64_t averageFragmentInvocations;
+            float lastInvocationsPerPixel;    // One when every pixel is shaded once
+            float averageInvocationsPerPixel;
+        };
+
+        /// Counts since construction or the last resetStats()
+        [[nodiscard]] Stats getStats() const;
+        void resetStats();
+        void printStats(std::ostream& out) const;
+
+    private:
+        vk::Device m_device;
+        bool m_supported;
+
+        /// One fragment shader invocation count per slot
+        vk::QueryPool m_queryPool;
+        std::vector<uint64_t> m_submittedPixels; // Zero for slots not submitted since they were last read
+
+        Stats m_stats{};
+        uint64_t m_invocationSum = 0;
+        double m_invocationsPerPixelSum = 0.0;
+    };
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <unordered_map>
+
+namespace Core {
+
+    /**
+     * A free-list suballocator for a fixed range of units (bytes, vertices, indices...).
+     * Allocation is best-fit over free ranges indexed by size, and freed ranges are coalesced with their neighbours
+     * so that the free list stays short. The allocator only does bookkeeping, it never touches the memory itself.
+     */
+    class RangeAllocator {
+    public:
+        using Size = uint64_t;
+
+        explicit RangeAllocator(Size capacity);
+        ~RangeAllocator();
+
+        /**
+         * Allocate a range.
+         * @param size: The number of units to allocate, must be greater than zero
+         * @param alignment: The alignment of the start of the range in units
+         * @return The offset of the range, or nothing if no free range is large enough
+         */
+        [[nodiscard]] std::optional<Size> allocate(Size size, Size alignment = 1);
+
+        /**
+         * Return a range previously returned by allocate().
+         * Throws a std::runtime_error if offset is not the start of a live allocation.
+         * @param offset: The offset returned by allocate()
+         */
+        void free(Size offset);
+
+        struct Stats {
+            Size capacity;
+            Size usedUnits;
+            Size freeUnits;
+            Size largestFreeRange;
+            std::size_t freeRangeCount;
+            std::size_t allocationCount;
+
+            /// 0 when all free space is contiguous, approaching 1 as it is split into small pieces
+            [[nodiscard]] float fragmentation() const;
+
+            /// The fraction of capacity that is allocated
+            [[nodiscard]] float occupancy() const;
+        };
+        [[nodiscard]] Stats getStats() const;
+
+        [[nodiscard]] Size getCapacity() const;
+
+    private:
+        Size m_capacity;
+        Size m_usedUnits = 0;
+
+        /// Free ranges, indexed both ways: by offset for coalescing and by size for best-fit searches
+        std::map<Size, Size> m_freeByOffset;
+        std::multimap<Size, Size> m_freeBySize;
+
+        /// Live allocations, aligned offset to requested size. Alignment padding before an allocation is left free.
+        std::unordered_map<Size, Size> m_allocations;
+
+        void insertFreeRange(Size offset, Size size);
+        void eraseFreeRange(std::map<Size, Size>::iterator range);
+    };
+}
@@ -1,9 +1,15 @@
 #pragma once
 
+#include "Core/FixedFunctionState.hpp"
 #include "Core/PipelineBuilder.hpp"
 #include "Core/PipelineLayout.hpp"
+#include "Core/PipelineState.hpp"
 #include "Core/RenderPass.hpp"
 
+#include <array>
+#include <span>
+#include <vector>
+
 namespace Core {
     class RasterPipelineBuilder : public PipelineBuilder {
     public:
@@ -17,12 +23,49 @@ namespace Core {
          */
         virtual void getPipelineCreateInfo(vk::GraphicsPipelineCreateInfo& createInfo);
 
+        /// Get a description of the configured pipeline that compares equal to that of any equal pipeline
+        PipelineState getPipelineState();
+
+        /**
+         * Get the createInfo objects for permutations of this pipeline that differ only by the specialization
+         * constants of one stage. The first permutation allows derivatives and the rest derive from it by index,
+         * so they must be created together, in order and at the start of the array.
+         * The createInfos point into this object, and are only valid until it is changed or destroyed.
+         * @param stage: The stage to specialize, whose shader must have been added
+         * @param permutations: The constants for each permutation, replacing any the stage was added with
+         * @param createInfos: Filled with one createInfo per permutation
+         */
+        void getPermutationCreateInfos(ShaderType stage, std::span<const SpecializationConstants> permutations,
+                                       std::vector<vk::GraphicsPipelineCreateInfo>& createInfos);
+
+        /**
+         * Get the createInfo for one part of this pipeline as a pipeline library, see VK_EXT_graphics_pipeline_library.
+         * Only the state that belongs to the part is set, so equal parts of different pipelines have equal createInfos.
+         * The createInfo points into this object, and is only valid until it is changed or destroyed.
+         * @param part: The part of the pipeline, one of the vk::GraphicsPipelineLibraryFlagBitsEXT
+         * @param createInfo: The object that will be filled with the info necessary to create the library
+         */
+        void getLibraryCreateInfo(vk::GraphicsPipelineLibraryFlagBitsEXT part, vk::GraphicsPipelineCreateInfo& createInfo);
+
+        /// The parts a pipeline is split into by getLibraryCreateInfo(), in the order they are fed through the pipeline
+        constexpr static const vk::GraphicsPipelineLibraryFlagBitsEXT s_libraryParts[] = {
+            vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface,
+            vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders,
+            vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader,
+            vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface,
+        };
+        constexpr static const std::size_t s_libraryPartCount = std::size(s_libraryParts);
+
         /// -- Members for configuration --
 
         void setWindowSize(uint32_t width, uint32_t height);
 
-        // TODO
-        // void setDepthStensilState();
+        /**
+         * Set the depth and stencil tests, which need a depth or stencil attachment. Without them there are none,
+         * which is only valid for a subpass or rendering formats without a depth or stencil attachment.
+         * @param state: The depth and stencil tests, copied into this builder
+         */
+        void setDepthStencilState(const vk::PipelineDepthStencilStateCreateInfo& state);
 
         /**
          * Add the pipeline layout for this pipeline.
@@ -39,6 +82,24 @@ namespace Core {
          */
         void setRenderPass(const RenderPass& renderPass, uint32_t subpass);
 
+        /**
+         * Create the pipeline for dynamic rendering to attachments of these formats, in place of a RenderPass.
+         * See DynamicRendering, whose extension must be enabled.
+         * @param colourFormats: The format of each colour attachment, in order
+         * @param depthFormat: The format of the depth attachment, if there is one
+         * @param stencilFormat: The format of the stencil attachment, if there is one
+         */
+        void setRenderingFormats(std::span<const vk::Format> colourFormats,
+                                 vk::Format depthFormat = vk::Format::eUndefined,
+                                 vk::Format stencilFormat = vk::Format::eUndefined);
+
+        /**
+         * Use a compile time description for the input assembly, rasterization, multisample, depth stencil,
+         * colour blend and dynamic states, in place of this builder's own.
+         * @param state: The description, which must outlive any createInfo taken from this builder, eg. a constexpr
+         */
+        void setFixedFunctionState(const FixedFunctionState& state);
+
         /**
          * Add the blend state for the next colour attachment.
          * This must be called in order for each colour attachment that will be
@@ -109,6 +170,10 @@ namespace Core {
             VK_FALSE,
         };
 
+        /// Only used once set with setDepthStencilState()
+        vk::PipelineDepthStencilStateCreateInfo m_depthStencilState;
+        bool m_hasDepthStencilState = false;
+
         vk::PipelineColorBlendStateCreateInfo m_colourBlendState{
             vk::PipelineColorBlendStateCreateFlags(),
             VK_FALSE,
@@ -138,5 +203,21 @@ namespace Core {
         vk::PipelineLayout m_pipelineLayout = vk::PipelineLayout();
         vk::RenderPass m_renderPass = vk::RenderPass();
         uint32_t m_subpass = 0;
+
+        /// The attachment formats set with setRenderingFormats(), used when there is no render pass
+        bool m_dynamicRendering = false;
+        std::vector<vk::Format> m_colourFormats;
+        vk::PipelineRenderingCreateInfoKHR m_renderingCreateInfo;
+
+        /// The state set with setFixedFunctionState(), if any
+        const FixedFunctionState* m_fixedFunctionState = nullptr;
+
+        /// Storage for getPermutationCreateInfos(), one set of stages and constants per permutation
+        std::vector<std::vector<vk::PipelineShaderStageCreateInfo>> m_permutationStages;
+        std::vector<SpecializationConstants> m_permutationConstants;
+
+        /// Storage for getLibraryCreateInfo(), by index in s_libraryParts
+        std::array<vk::GraphicsPipelineLibraryCreateInfoEXT, s_libraryPartCount> m_libraryCreateInfos;
+        std::array<std::vector<vk::PipelineShaderStageCreateInfo>, s_libraryPartCount> m_libraryStages;
     };
 }
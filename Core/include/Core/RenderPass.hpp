@@ -1,11 +1,23 @@
 #pragma once
 
+#include "Core/RenderPassDescription.hpp"
+
 #include <vulkan/vulkan.hpp>
 
+#include <span>
+
 namespace Core {
     class RenderPass {
     public:
         RenderPass(vk::Device& device, const vk::RenderPassCreateInfo& createInfo);
+
+        /**
+         * Create a render pass from a description made at compile time
+         * @param device: The device to create the render pass on
+         * @param description: The render pass
+         * @param runtimeFormats: The formats of the attachments described as vk::Format::eUndefined, in attachment order
+         */
+        RenderPass(vk::Device& device, const RenderPassDescription& description, std::span<const vk::Format> runtimeFormats = {});
         ~RenderPass();
 
         [[nodiscard]] const vk::RenderPass& getHandle() const;
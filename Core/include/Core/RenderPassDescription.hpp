@@ -0,0 +1,185 @@
+#pragma once
+
+#include "Core/ConstexprHash.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace Core {
+
+    /**
+     * A render pass described at compile time.
+     *
+     * The attachments, subpasses and dependencies live in constexpr arrays with static storage, and the description
+     * only points at them, so it needs no allocation and its createInfo can be used as is. Check it at compile time:
+     *
+     *     constexpr vk::AttachmentDescription ATTACHMENTS[] = {...};
+     *     constexpr vk::AttachmentReference COLOUR[] = {{0, vk::ImageLayout::eColorAttachmentOptimal}};
+     *     constexpr vk::SubpassDescription SUBPASSES[] = {{{}, vk::PipelineBindPoint::eGraphics, 0, nullptr, 1, COLOUR}};
+     *     constexpr Core::RenderPassDescription PASS(ATTACHMENTS, SUBPASSES);
+     *     static_assert(PASS.isValid());
+     *
+     * Attachment formats that are only known at runtime, eg. the swapchain's, are described as vk::Format::eUndefined
+     * and given when the RenderPass is created.
+     */
+    class RenderPassDescription {
+    public:
+        /// The most attachments a description may have, so runtime formats can be filled in without allocating
+        constexpr static const uint32_t s_maxAttachments = 16;
+
+        constexpr RenderPassDescription(std::span<const vk::AttachmentDescription> attachments,
+                                        std::span<const vk::SubpassDescription> subpasses,
+                                        std::span<const vk::SubpassDependency> dependencies = {})
+            : m_createInfo(vk::RenderPassCreateFlags(),
+                           static_cast<uint32_t>(attachments.size()),
+                           attachments.data(),
+                           static_cast<uint32_t>(subpasses.size()),
+                           subpasses.data(),
+                           static_cast<uint32_t>(dependencies.size()),
+                           dependencies.data()) {}
+
+        /// The info to create the render pass with, pointing at the described arrays
+        [[nodiscard]] constexpr const vk::RenderPassCreateInfo& getCreateInfo() const { return m_createInfo; }
+
+        [[nodiscard]] constexpr std::span<const vk::AttachmentDescription> getAttachments() const {
+            return {m_createInfo.pAttachments, m_createInfo.attachmentCount};
+        }
+        [[nodiscard]] constexpr std::span<const vk::SubpassDescription> getSubpasses() const { return {m_createInfo.pSubpasses, m_createInfo.subpassCount}; }
+        [[nodiscard]] constexpr std::span<const vk::SubpassDependency> getDependencies() const {
+            return {m_createInfo.pDependencies, m_createInfo.dependencyCount};
+        }
+
+        /// The number of attachments whose format is given at creation
+        [[nodiscard]] constexpr uint32_t getRuntimeFormatCount() const {
+            uint32_t count = 0;
+            for (const vk::AttachmentDescription& attachment : getAttachments()) {
+                count += attachment.format == vk::Format::eUndefined ? 1 : 0;
+            }
+            return count;
+        }
+
+        /**
+         * Check that every attachment reference and dependency refers to something that exists, that references use
+         * layouts suited to how they are used, and that there is at least one subpass.
+         */
+        [[nodiscard]] constexpr bool isValid() const {
+            if (m_createInfo.attachmentCount > s_maxAttachments || m_createInfo.subpassCount == 0) {
+                return false;
+            }
+
+            for (const vk::SubpassDescription& subpass : getSubpasses()) {
+                for (uint32_t i = 0; i < subpass.colorAttachmentCount; i++) {
+                    if (!isValidReference(subpass.pColorAttachments[i], false)) {
+                        return false;
+                    }
+                    if (subpass.pResolveAttachments && !isValidReference(subpass.pResolveAttachments[i], false)) {
+                        return false;
+                    }
+                }
+                for (uint32_t i = 0; i < subpass.inputAttachmentCount; i++) {
+                    if (!isValidReference(subpass.pInputAttachments[i], false)) {
+                        return false;
+                    }
+                }
+                if (subpass.pDepthStencilAttachment && !isValidReference(*subpass.pDepthStencilAttachment, true)) {
+                    return false;
+                }
+                for (uint32_t i = 0; i < subpass.preserveAttachmentCount; i++) {
+                    if (subpass.pPreserveAttachments[i] >= m_createInfo.attachmentCount) {
+                        return false;
+                    }
+                }
+            }
+
+            for (const vk::SubpassDependency& dependency : getDependencies()) {
+                bool srcExternal = dependency.srcSubpass == VK_SUBPASS_EXTERNAL;
+                bool dstExternal = dependency.dstSubpass == VK_SUBPASS_EXTERNAL;
+                if ((srcExternal && dstExternal) || (!srcExternal && dependency.srcSubpass >= m_createInfo.subpassCount) ||
+                    (!dstExternal && dependency.dstSubpass >= m_createInfo.subpassCount)) {
+                    return false;
+                }
+                // Work can only wait on earlier subpasses
+                if (!srcExternal && !dstExternal && dependency.srcSubpass > dependency.dstSubpass) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// A hash of everything described, equal for equal descriptions
+        [[nodiscard]] constexpr uint64_t getHash() const {
+            ConstexprHash hash;
+            for (const vk::AttachmentDescription& attachment : getAttachments()) {
+                hash.addValue(attachment.flags);
+                hash.addValue(attachment.format);
+                hash.addValue(attachment.samples);
+                hash.addValue(attachment.loadOp);
+                hash.addValue(attachment.storeOp);
+                hash.addValue(attachment.stencilLoadOp);
+                hash.addValue(attachment.stencilStoreOp);
+                hash.addValue(attachment.initialLayout);
+                hash.addValue(attachment.finalLayout);
+            }
+            for (const vk::SubpassDescription& subpass : getSubpasses()) {
+                hash.addValue(subpass.pipelineBindPoint);
+                hash.addValue(subpass.inputAttachmentCount);
+                for (uint32_t i = 0; i < subpass.inputAttachmentCount; i++) {
+                    addReference(hash, subpass.pInputAttachments[i]);
+                }
+                hash.addValue(subpass.colorAttachmentCount);
+                for (uint32_t i = 0; i < subpass.colorAttachmentCount; i++) {
+                    addReference(hash, subpass.pColorAttachments[i]);
+                    addReference(hash, subpass.pResolveAttachments ? subpass.pResolveAttachments[i] : vk::AttachmentReference{VK_ATTACHMENT_UNUSED});
+                }
+                addReference(hash, subpass.pDepthStencilAttachment ? *subpass.pDepthStencilAttachment : vk::AttachmentReference{VK_ATTACHMENT_UNUSED});
+                hash.addValue(subpass.preserveAttachmentCount);
+                for (uint32_t i = 0; i < subpass.preserveAttachmentCount; i++) {
+                    hash.addValue(subpass.pPreserveAttachments[i]);
+                }
+            }
+            for (const vk::SubpassDependency& dependency : getDependencies()) {
+                hash.addValue(dependency.srcSubpass);
+                hash.addValue(dependency.dstSubpass);
+                hash.addValue(dependency.srcStageMask);
+                hash.addValue(dependency.dstStageMask);
+                hash.addValue(dependency.srcAccessMask);
+                hash.addValue(dependency.dstAccessMask);
+                hash.addValue(dependency.dependencyFlags);
+            }
+            return hash.get();
+        }
+
+    private:
+        vk::RenderPassCreateInfo m_createInfo;
+
+        [[nodiscard]] constexpr bool isValidReference(const vk::AttachmentReference& reference, bool depthStencil) const {
+            if (reference.attachment == VK_ATTACHMENT_UNUSED) {
+                return true;
+            }
+            if (reference.attachment >= m_createInfo.attachmentCount) {
+                return false;
+            }
+            switch (reference.layout) {
+            case vk::ImageLayout::eUndefined:
+            case vk::ImageLayout::ePreinitialized:
+            case vk::ImageLayout::ePresentSrcKHR:
+                return false;
+            case vk::ImageLayout::eColorAttachmentOptimal:
+                return !depthStencil;
+            case vk::ImageLayout::eDepthStencilAttachmentOptimal:
+            case vk::ImageLayout::eDepthStencilReadOnlyOptimal:
+                return depthStencil;
+            default:
+                return true;
+            }
+        }
+
+        constexpr static void addReference(ConstexprHash& hash, const vk::AttachmentReference& reference) {
+            hash.addValue(reference.attachment);
+            hash.addValue(reference.layout);
+        }
+    };
+}
@@ -1,10 +1,18 @@
 #pragma once
 
+#include "Core/DynamicRendering.hpp"
+#include "Core/FramePacer.hpp"
 #include "Core/GraphicsPipeline.hpp"
 #include "Core/RenderTypes.hpp"
+#include "Core/PipelineCompiler.hpp"
+#include "Core/PipelineLibraryCache.hpp"
+#include "Core/PipelineStateCache.hpp"
+#include "Core/ShaderLibrary.hpp"
 
 #include <memory>
+#include <optional>
 #include <set>
+#include <string>
 #include <unordered_map>
 #include <vector>
 #include <vulkan/vulkan.hpp>
@@ -100,6 +108,20 @@ namespace Core {
          */
         const QueueGroup& getQueue(QueueType type);
 
+        /**
+         * Check whether a device extension was enabled on the logical device.
+         * This includes both extensions requested by the app and optional extensions enabled by Core.
+         * @param extensionName: The name of the extension, eg. VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
+         * @return true if the extension is enabled
+         */
+        bool isDeviceExtensionEnabled(const std::string& extensionName) const;
+
+        /**
+         * Get the features enabled on the logical device.
+         * This includes both features requested by the app and optional features enabled by Core, eg. pipelineStatisticsQuery.
+         */
+        [[nodiscard]] const vk::PhysicalDeviceFeatures& getEnabledFeatures() const;
+
         /**
          * Tells the renderer to destroy any swapchains it has, and then create any new ones needed.
          * Useful for situations where previous swapchains have been invalidated.
@@ -108,6 +130,29 @@ namespace Core {
          */
         void recreateSwapChain(vk::Extent2D windowExtents);
 
+        /**
+         * Choose the swapchain's present mode, in place of the frame pacing profile's choice.
+         * Like setSwapchainImageCount(), this applies from the next recreateSwapChain(), which the old swapchain is
+         * retired into, so apps can switch by regenerating their swapchain resources at the current extents.
+         * @param presentMode: One of getSupportedPresentModes(), or std::nullopt for the profile's choice
+         */
+        void setPresentMode(std::optional<vk::PresentModeKHR> presentMode);
+
+        /**
+         * Choose the minimum number of swapchain images, in place of the frame pacing profile's choice
+         * @param imageCount: A count within getSurfaceCapabilities(), or 0 for the profile's choice
+         */
+        void setSwapchainImageCount(uint32_t imageCount);
+
+        /// The present modes the surface supports
+        [[nodiscard]] const std::set<vk::PresentModeKHR>& getSupportedPresentModes() const;
+
+        /// The present mode of the current swapchain
+        [[nodiscard]] vk::PresentModeKHR getPresentMode() const;
+
+        /// The surface's current capabilities, including the image counts it allows
+        [[nodiscard]] vk::SurfaceCapabilitiesKHR getSurfaceCapabilities() const;
+
         /**
          * A helper to create many pipeline objects in a single call
          * @param count: The number of pipelines to create
@@ -116,6 +161,51 @@ namespace Core {
          */
         std::vector<std::unique_ptr<GraphicsPipeline>> createGraphicsPipelines(uint32_t count, const vk::GraphicsPipelineCreateInfo* createInfos);
 
+        /**
+         * Get the device's shader modules, shared by everything that builds pipelines
+         * @return The shader library, valid for the lifetime of the renderer
+         */
+        ShaderLibrary& getShaderLibrary();
+
+        /**
+         * Get the workers that compile pipelines off the calling thread
+         * @return The pipeline compiler, valid for the lifetime of the renderer
+         */
+        PipelineCompiler& getPipelineCompiler();
+
+        /**
+         * Get the cache of pipeline parts, for pipelines that are needed without waiting for a full compile
+         * @return The pipeline library cache, valid for the lifetime of the renderer
+         */
+        PipelineLibraryCache& getPipelineLibraryCache();
+
+        /**
+         * Get the pipelines created through the cache, so that equal pipelines are only created once
+         * @return The pipeline state cache, valid for the lifetime of the renderer
+         */
+        PipelineStateCache& getPipelineStateCache();
+
+        /**
+         * Make the pipeline caches forget everything created with a handle, before it is destroyed. Vulkan may give a
+         * later object the same handle value, which the caches would otherwise mistake for it. Shader modules released
+         * by the shader library are forgotten without this.
+         * @param handleKey: A pipeline layout or render pass, from PipelineState::getHandleKey()
+         */
+        void releaseCachedPipelines(uint64_t handleKey);
+
+        /**
+         * Get the recording of rendering without render pass objects, which apps check isEnabled() on before using
+         * @return The dynamic rendering commands, valid for the lifetime of the renderer
+         */
+        const DynamicRendering& getDynamicRendering() const;
+
+        /**
+         * Get the pacing of frames, whose profile decides the present mode and image count of the swapchain.
+         * Run loops call beginFrame() on it, and apps present through it.
+         * @return The frame pacer, valid for the lifetime of the renderer
+         */
+        FramePacer& getFramePacer();
+
     protected:
         /// Vulkan instance configuration
         vk::Instance m_instance;
@@ -132,11 +222,22 @@ namespace Core {
         /// Vulkan logical device configuration
         vk::Device m_device;
         std::unordered_map<QueueType, QueueGroup> m_queues;
+        std::unique_ptr<ShaderLibrary> m_shaderLibrary;
+        std::unique_ptr<PipelineCompiler> m_pipelineCompiler;
+        std::unique_ptr<PipelineLibraryCache> m_pipelineLibraryCache;
+        std::unique_ptr<PipelineStateCache> m_pipelineStateCache;
+        std::unique_ptr<DynamicRendering> m_dynamicRendering;
+        std::unique_ptr<FramePacer> m_framePacer;
 
         /// Vulkan surface configuration
         vk::SurfaceKHR m_surface;
         vk::SurfaceFormatKHR m_surfaceFormat;
-        vk::PresentModeKHR m_presentMode;
+        std::set<vk::PresentModeKHR> m_supportedPresentModes;
+        vk::PresentModeKHR m_presentMode = vk::PresentModeKHR::eFifo;
+        uint32_t m_minImageCount = 0;
+        /// Set by the app over the frame pacing profile's choices
+        std::optional<vk::PresentModeKHR> m_requestedPresentMode;
+        uint32_t m_requestedImageCount = 0;
         vk::SwapchainKHR m_swapchain;
         vk::Extent2D m_swapchainExtents;
         std::vector<vk::Image> m_swapchainImages;
@@ -188,6 +289,9 @@ namespace Core {
         /// Initialize m_device
         void initLogicalDevice();
 
+        /// The first present mode the frame pacing profile prefers that the surface supports
+        [[nodiscard]] vk::PresentModeKHR choosePresentMode() const;
+
         // -- end ctor helper functions --
 
         // -- swapchain creations helpers --
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Core/SceneFormat.hpp"
+#include "Core/VertexFormat.hpp"
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * A read-only scene file, memory mapped or already read into memory.
+     *
+     * Opening a file validates the header, the section table and every record that indexes other data, so indices and
+     * BVHs are safe to use without bounds checks. Vertex data is paged in by the kernel as it is touched.
+     * A file read ahead of time, such as with AsyncIO, is used as it is. The spans returned point into the mapping or
+     * the contents, and are valid for the lifetime of this object.
+     */
+    class SceneFile {
+    public:
+        /**
+         * Map a scene file
+         * @param filename: The file to open
+         * Throws std::runtime_error if the file cannot be mapped or is not a valid scene file
+         */
+        explicit SceneFile(const std::string& filename);
+
+        /**
+         * Use a scene file that has already been read
+         * @param filename: The file the contents came from, for error messages
+         * @param contents: The whole file
+         * Throws std::runtime_error if the contents are not a valid scene file
+         */
+        SceneFile(const std::string& filename, std::vector<char> contents);
+
+        ~SceneFile();
+
+        /// Disallowed operations
+        SceneFile(const SceneFile&) = delete;
+        SceneFile(SceneFile&&) = delete;
+        SceneFile& operator=(const SceneFile&) = delete;
+        SceneFile& operator=(SceneFile&&) = delete;
+
+        [[nodiscard]] VertexFormat getVertexFormat() const;
+        [[nodiscard]] std::size_t getFileSize() const;
+
+        [[nodiscard]] std::span<const SceneMesh> getMeshes() const;
+        [[nodiscard]] std::span<const std::byte> getVertexData() const;
+        [[nodiscard]] std::size_t getVertexCount() const;
+        [[nodiscard]] std::span<const uint32_t> getIndices() const;
+        [[nodiscard]] std::span<const SceneBvhNode> getBvhNodes() const;
+        [[nodiscard]] std::span<const SceneMaterial> getMaterials() const;
+        [[nodiscard]] std::span<const SceneInstance> getInstances() const;
+        [[nodiscard]] std::span<const uint32_t> getBvhTriangles() const;
+
+        /**
+         * Ask the kernel to start reading a section in the background, ahead of it being used. Does nothing for a file already read.
+         * @param type: The section that will be read next
+         */
+        void prefetch(SceneSectionType type) const;
+
+    private:
+        std::string m_filename;
+        void* m_mapping = nullptr;    // Null when the file was read rather than mapped
+        std::vector<char> m_contents; // The file when it was read
+        const std::byte* m_data = nullptr;
+        std::size_t m_fileSize = 0;
+        VertexFormat m_vertexFormat;
+
+        struct MappedSection {
+            const std::byte* data = nullptr;
+            std::size_t elementCount = 0;
+            std::size_t size = 0;
+        };
+        std::array<MappedSection, SceneSectionTypeCount> m_sections;
+
+        /// Check the header and section table, filling in m_sections
+        void validate();
+
+        template<typename T>
+        std::span<const T> getSection(SceneSectionType type) const {
+            const MappedSection& section = m_sections[static_cast<uint32_t>(type)];
+            return std::span<const T>(reinterpret_cast<const T*>(section.data), section.elementCount);
+        }
+    };
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Core/VertexFormat.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+/**
+ * The packed binary scene format.
+ *
+ * A file is a SceneHeader, followed by a table of SceneSections, followed by the sections themselves.
+ * Each section is a tightly packed array of one of the record types below, starting on a SCENE_SECTION_ALIGNMENT
+ * boundary. Everything is little endian and stored exactly as it is laid out in memory, so a mapped file is used
+ * in place: nothing is parsed, and vertex and index data is copied straight from the mapping into staging.
+ */
+namespace Core {
+
+    constexpr char SCENE_MAGIC[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+    constexpr uint32_t SCENE_VERSION = 1;
+
+    /// For SceneInstance::material, to use the mesh's own material
+    constexpr uint32_t SCENE_MESH_MATERIAL = ~0u;
+
+    /// Sections start on page boundaries, so reading one never touches the pages of another
+    constexpr uint64_t SCENE_SECTION_ALIGNMENT = 4096;
+
+    enum class SceneSectionType : uint32_t {
+        Meshes,       // SceneMesh
+        Vertices,     // Vertices in the header's vertex format, as raw bytes
+        Indices,      // uint32_t, relative to the first vertex of their mesh
+        BvhNodes,     // SceneBvhNode
+        Materials,    // SceneMaterial
+        Instances,    // SceneInstance
+        BvhTriangles, // uint32_t, the triangles of each mesh in BVH leaf order, starting at the mesh's firstIndex / 3
+    };
+    constexpr uint32_t SceneSectionTypeCount = 7;
+    const char* to_string(SceneSectionType type);
+
+    struct SceneHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t vertexFormat; // A Core::VertexFormat, shared by every mesh
+        uint64_t fileSize;
+        uint32_t sectionCount;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(SceneHeader) == 32);
+
+    struct SceneSection {
+        uint32_t type;        // A SceneSectionType
+        uint32_t elementSize; // Must match the size of the record type, so that readers catch layout changes
+        uint64_t offset;      // In bytes from the start of the file
+        uint64_t elementCount;
+    };
+    static_assert(sizeof(SceneSection) == 24);
+
+    struct SceneMesh {
+        VertexQuantization quantization; // Identity for uncompressed vertex formats
+        uint32_t firstVertex;
+        uint32_t vertexCount;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t firstBvhNode; // The root of the mesh's BVH
+        uint32_t bvhNodeCount; // Zero if the mesh has no BVH
+        uint32_t material;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(SceneMesh) == 64);
+
+    /**
+     * A node of a mesh's bounding volume hierarchy.
+     * Inner nodes have triangleCount zero, and their two children are at firstChildOrTriangle and the node after it.
+     * Leaves cover triangleCount entries of the mesh's BvhTriangles list, starting at firstChildOrTriangle.
+     * The triangle list indirection lets the index buffer keep its vertex cache friendly order.
+     * Node indices are relative to the mesh's firstBvhNode.
+     */
+    struct SceneBvhNode {
+        glm::vec3 minimum;
+        uint32_t firstChildOrTriangle;
+        glm::vec3 maximum;
+        uint32_t triangleCount;
+    };
+    static_assert(sizeof(SceneBvhNode) == 32);
+
+    struct SceneMaterial {
+        glm::vec4 baseColour;
+        glm::vec4 emission;
+        float roughness;
+        float metallic;
+        uint32_t reserved[2];
+    };
+    static_assert(sizeof(SceneMaterial) == 48);
+
+    struct SceneInstance {
+        float transform[3][4]; // Row major affine object to world transform
+        uint32_t mesh;
+        uint32_t material; // Overrides the mesh's material, unless SCENE_MESH_MATERIAL
+        uint32_t reserved[2];
+    };
+    static_assert(sizeof(SceneInstance) == 64);
+}
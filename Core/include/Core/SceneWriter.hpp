@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Core/MeshOptimizer.hpp"
+#include "Core/SceneFile.hpp"
+#include "Core/SceneFormat.hpp"
+#include "Core/VertexFormat.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * Builds a scene in memory and writes it in the packed binary scene format.
+     * Meshes are appended to shared vertex, index and BVH node arrays as they are added.
+     */
+    class SceneWriter {
+    public:
+        /**
+         * @param vertexFormat: The format of every mesh's vertices
+         */
+        explicit SceneWriter(VertexFormat vertexFormat);
+        ~SceneWriter();
+
+        /**
+         * Add a mesh
+         * @param mesh: The mesh, with vertices in the writer's vertex format
+         * @param quantization: How the mesh's positions are quantized, the identity for uncompressed formats
+         * @param material: The index of the mesh's material
+         * @param bvhNodes: The mesh's BVH, root first, or empty for none
+         * @param bvhTriangles: The mesh's triangles in BVH leaf order. Ignored if there is no BVH.
+         * @return The index of the mesh, for instances
+         */
+        uint32_t addMesh(const IndexedMesh& mesh,
+                         const VertexQuantization& quantization,
+                         uint32_t material,
+                         const std::vector<SceneBvhNode>& bvhNodes = {},
+                         const std::vector<uint32_t>& bvhTriangles = {});
+
+        /// @return The index of the material
+        uint32_t addMaterial(const SceneMaterial& material);
+
+        /// @return The index of the instance
+        uint32_t addInstance(const SceneInstance& instance);
+
+        /**
+         * Append every mesh, material and instance of another scene, eg. to link separately cooked assets together.
+         * Throws std::runtime_error if the scene's vertex format differs.
+         */
+        void addScene(const SceneFile& scene);
+
+        /**
+         * Write the scene
+         * @param filename: The file to create or replace
+         * Throws std::runtime_error if the file cannot be written
+         */
+        void write(const std::string& filename) const;
+
+    private:
+        VertexFormat m_vertexFormat;
+
+        std::vector<SceneMesh> m_meshes;
+        std::vector<uint8_t> m_vertices;
+        std::vector<uint32_t> m_indices;
+        std::vector<SceneBvhNode> m_bvhNodes;
+        std::vector<SceneMaterial> m_materials;
+        std::vector<SceneInstance> m_instances;
+        std::vector<uint32_t> m_bvhTriangles; // Parallel to the triangles of m_indices
+    };
+}
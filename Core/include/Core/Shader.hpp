@@ -1,18 +1,39 @@
 #pragma once
 
 #include "Core/RenderTypes.hpp"
+#include "Core/SpecializationConstants.hpp"
 
 #include <vulkan/vulkan.hpp>
 
+#include <cstdint>
+#include <span>
+#include <string>
+
 namespace Core {
 
     class Shader {
     public:
         Shader(const std::string& filename, ShaderType type, vk::Device device);
+
+        /**
+         * Create a shader from SPIR-V already in memory, eg. read with AsyncIO
+         * @param name: A name for the shader, used in messages
+         * @param code: The SPIR-V words
+         * @param size: The size of the code in bytes
+         * @param type: The shader stage
+         * @param device: The device to create the shader module on
+         */
+        Shader(const std::string& name, const void* code, std::size_t size, ShaderType type, vk::Device device);
+
+        /// Create a shader from SPIR-V words, eg. an embedded shader
+        Shader(const std::string& name, std::span<const uint32_t> code, ShaderType type, vk::Device device);
         ~Shader();
 
-        /// Retrieve the info needed to use this shader in a pipeline
-        vk::PipelineShaderStageCreateInfo getPipelineStageCreateInfo();
+        /**
+         * Retrieve the info needed to use this shader in a pipeline
+         * @param specialization: Values for the shader's specialization constants, which must outlive the returned info
+         */
+        vk::PipelineShaderStageCreateInfo getPipelineStageCreateInfo(const SpecializationConstants* specialization = nullptr);
 
         /// Retrieve the type
         ShaderType getType();
@@ -29,5 +50,7 @@ namespace Core {
 
         /// The loaded shader
         vk::ShaderModule m_shaderModule;
+
+        void createShaderModule(const void* code, std::size_t size);
     };
 }
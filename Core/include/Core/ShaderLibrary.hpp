@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Core/RenderTypes.hpp"
+#include "Core/Shader.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * Device scoped cache of shader modules, owned by the Renderer.
+     *
+     * Modules are keyed by a hash of their SPIR-V and stage, so identical code is only ever turned into one module,
+     * whatever path or name it came from. Files are read once: later requests for a path are answered from memory.
+     * Modules stay alive while the library holds them, so pipelines can be rebuilt, eg. after a swapchain resize,
+     * without any file I/O or shader module creation.
+     *
+     * Safe to use from several threads.
+     */
+    class ShaderLibrary {
+    public:
+        explicit ShaderLibrary(vk::Device device);
+        ~ShaderLibrary();
+
+        /// Disallowed operations
+        ShaderLibrary(const ShaderLibrary&) = delete;
+        ShaderLibrary(ShaderLibrary&&) = delete;
+        ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+        ShaderLibrary& operator=(ShaderLibrary&&) = delete;
+
+        /**
+         * Get the shader in a SPIR-V file. Embedded shaders (see EmbeddedShaders.hpp) are used without touching the
+         * disk, and other files are only read if the path has not been loaded before.
+         * @param filename: The .spv file
+         * @param type: The shader stage
+         * @return The shared shader
+         */
+        std::shared_ptr<Shader> load(const std::string& filename, ShaderType type);
+
+        /**
+         * Get the shader for SPIR-V already in memory, eg. read with AsyncIO
+         * @param name: The name of the shader, usually its path. Later load() calls with this name are answered from memory.
+         * @param code: The SPIR-V words
+         * @param size: The size of the code in bytes
+         * @param type: The shader stage
+         * @return The shared shader, which is an existing one if the code has been seen before
+         */
+        std::shared_ptr<Shader> get(const std::string& name, const void* code, std::size_t size, ShaderType type);
+
+        /**
+         * Destroy the modules that nothing outside the library references
+         * @return The number of modules destroyed
+         */
+        std::size_t releaseUnused();
+
+        /// Called with each module releaseUnused() is about to destroy, with the library locked
+        using ReleaseCallback = std::function<void(vk::ShaderModule module)>;
+
+        /// Set the function told about destroyed modules, eg. so that pipeline caches forget them before the handle is reused
+        void setReleaseCallback(ReleaseCallback callback);
+
+        struct Stats {
+            uint64_t hits;          // Requests answered with an existing module
+            uint64_t misses;        // Requests that created a module
+            uint64_t fileReads;     // Files read from disk
+            uint64_t embeddedLoads; // Requests answered from code compiled into the executable
+            std::size_t moduleCount;
+            std::size_t codeBytes;
+        };
+
+        [[nodiscard]] Stats getStats() const;
+        void printStats(std::ostream& out) const;
+
+    private:
+        vk::Device m_device;
+
+        struct Entry {
+            std::vector<uint32_t> code; // Kept to tell apart the rare codes whose hashes collide
+            ShaderType type;
+            std::shared_ptr<Shader> shader;
+        };
+
+        ReleaseCallback m_releaseCallback;
+
+        mutable std::mutex m_mutex;
+        std::unordered_multimap<uint64_t, Entry> m_entries; // By hash of code and stage
+        std::unordered_map<std::string, std::weak_ptr<Shader>> m_namedShaders; // By name and stage, expires on releaseUnused()
+        Stats m_stats{};
+
+        static std::string getNameKey(const std::string& name, ShaderType type);
+
+        /// Expects m_mutex to be held
+        std::shared_ptr<Shader> findOrCreate(const std::string& name, const void* code, std::size_t size, ShaderType type);
+    };
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Core {
+
+    /// The types a shader can declare a specialization constant as
+    template <typename T>
+    concept SpecializationConstantType = std::same_as<T, bool> || std::same_as<T, int32_t> || std::same_as<T, uint32_t> || std::same_as<T, float> ||
+                                         std::same_as<T, int64_t> || std::same_as<T, uint64_t> || std::same_as<T, double>;
+
+    /**
+     * Values for a shader's specialization constants, ie. its `layout(constant_id = N) const` declarations.
+     * The driver folds them into the code at pipeline creation, so branches on them cost nothing at runtime and the
+     * untaken side is removed. Use them for tile sizes, sample counts and feature toggles in place of uniforms.
+     *
+     * Constants the shader declares but that are not set here keep the default written in the shader.
+     */
+    class SpecializationConstants {
+    public:
+        SpecializationConstants();
+        ~SpecializationConstants();
+
+        SpecializationConstants(const SpecializationConstants& other);
+        SpecializationConstants& operator=(const SpecializationConstants& other);
+
+        /**
+         * Set a constant. The type must match the declaration in the shader, with bool being a 32 bit VkBool32.
+         * Setting a constant again replaces its value.
+         * @param constantId: The constant_id in the shader
+         * @param value: The value to specialize with
+         * @return This object, so values can be chained
+         */
+        template <SpecializationConstantType T>
+        SpecializationConstants& set(uint32_t constantId, T value) {
+            if constexpr (std::same_as<T, bool>) {
+                const vk::Bool32 boolValue = value ? VK_TRUE : VK_FALSE;
+                setBytes(constantId, &boolValue, sizeof(boolValue));
+            } else {
+                setBytes(constantId, &value, sizeof(value));
+            }
+            return *this;
+        }
+
+        [[nodiscard]] bool empty() const;
+
+        /**
+         * Get the info for a pipeline stage
+         * @return The info, which points into this object and is only valid until it is changed, assigned or destroyed.
+         * Null if no constant is set, so unspecialized stages stay unspecialized.
+         */
+        const vk::SpecializationInfo* getInfo() const;
+
+        bool operator==(const SpecializationConstants& other) const;
+
+    private:
+        std::vector<vk::SpecializationMapEntry> m_entries;
+        std::vector<std::byte> m_data;
+        vk::SpecializationInfo m_info;
+
+        void setBytes(uint32_t constantId, const void* value, std::size_t size);
+        void updateInfo();
+    };
+}
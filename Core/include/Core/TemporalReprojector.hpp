@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Core/AccumulationBuffer.hpp"
+#include "Core/RenderTypes.hpp"
+#include "Core/ThreadPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace Core {
+
+    /// How much history carries over between views, and when it is rejected
+    struct TemporalSettings {
+        uint32_t maxHistorySamples = 64; // Caps the samples carried over, so old views fade out instead of lingering
+        float clampSigma = 2.0f;         // The standard deviations of the new samples' neighbourhood history is clamped to
+        float depthTolerance = 0.05f;    // The relative depth difference at which history is of a different surface
+    };
+
+    /// Where a pixel's surface was seen from the previous camera
+    struct PixelReprojection {
+        glm::vec2 motion;    // The motion vector, in pixels from the surface's previous position to its current one
+        float previousDepth; // The surface's distance from the previous camera, zero if it was behind it
+    };
+
+    /**
+     * Carries the samples of a previous view into the accumulation of a new one, so the number of samples behind each
+     * pixel keeps growing while the camera moves, instead of starting from one after every move.
+     *
+     * Each pixel follows its motion vector back into the history and reads it bilinearly, leaving out the taps whose
+     * depth shows another surface, such as the ones a moving object uncovers. What survives is clamped to the mean
+     * and deviation of the new samples around the pixel (variance clipping, Salvi 2016), which rejects history that
+     * no longer matches what the new view sees. The history's samples are then added to the new ones, at most
+     * maxHistorySamples of them, so the image keeps converging where the new view agrees with the last.
+     */
+    class TemporalReprojector {
+    public:
+        explicit TemporalReprojector(const TemporalSettings& settings = TemporalSettings{});
+        ~TemporalReprojector();
+
+        /// Disallowed operations
+        TemporalReprojector(const TemporalReprojector&) = delete;
+        TemporalReprojector(TemporalReprojector&&) = delete;
+        TemporalReprojector& operator=(const TemporalReprojector&) = delete;
+        TemporalReprojector& operator=(TemporalReprojector&&) = delete;
+
+        /// -- Members for configuration --
+
+        void setSettings(const TemporalSettings& settings);
+        [[nodiscard]] const TemporalSettings& getSettings() const;
+
+        /// -- End members for configuration --
+
+        /**
+         * Add the samples of the previous view that the new view still sees to the new view's accumulation, and
+         * re-estimate the error of every tile. Must not be called from one of the workers.
+         * @param history: The accumulation of the previous view
+         * @param historyDepths: The average depth of each pixel of the history, row major
+         * @param reprojections: Where each pixel of the new view was seen from the previous camera, row major
+         * @param current: The accumulation of the new view, of the history's size with at least its first samples
+         * @param workers: The threads to reproject on
+         */
+        void reproject(const AccumulationBuffer& history,
+                       std::span<const float> historyDepths,
+                       std::span<const PixelReprojection> reprojections,
+                       AccumulationBuffer& current,
+                       ThreadPool& workers);
+
+        struct Stats {
+            uint64_t reprojections;
+            uint64_t pixels;
+            uint64_t offscreenPixels;   // Whose surface was outside the previous view
+            uint64_t disoccludedPixels; // Whose surface was hidden in the previous view
+            uint64_t clampedPixels;     // Whose history was clamped to the new samples
+            float averageHistorySamples; // Carried over per pixel, of the pixels with history
+            TimeDelta lastTime;
+            TimeDelta averageTime;
+        };
+
+        [[nodiscard]] Stats getStats() const;
+        void resetStats();
+        void printStats(std::ostream& out) const;
+
+    private:
+        TemporalSettings m_settings;
+
+        /// The history one pixel carries over
+        struct CarriedSamples {
+            glm::vec3 mean;
+            float luminanceSquareMean;
+            uint32_t count; // Zero when the history was rejected
+        };
+        std::vector<CarriedSamples> m_carried;
+
+        struct RowCounts {
+            uint64_t offscreen = 0;
+            uint64_t disoccluded = 0;
+            uint64_t clamped = 0;
+            uint64_t historyPixels = 0;
+            uint64_t historySamples = 0;
+        };
+
+        Stats m_stats{};
+        uint64_t m_historyPixels = 0;
+        uint64_t m_historySamples = 0;
+        TimeDelta m_timeSum = TimeDelta::zero();
+
+        /// Find the history of the rows [firstRow, lastRow) of the new view
+        RowCounts reprojectRows(uint32_t firstRow,
+                                uint32_t lastRow,
+                                const AccumulationBuffer& history,
+                                std::span<const float> historyDepths,
+                                std::span<const PixelReprojection> reprojections,
+                                const AccumulationBuffer& current);
+    };
+}
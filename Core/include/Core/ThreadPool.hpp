@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * A fixed set of worker threads running tasks from a shared FIFO queue.
+     * Tasks must not wait on other tasks in the same pool, as every worker could end up waiting.
+     */
+    class ThreadPool {
+    public:
+        /**
+         * @param threadCount: The number of workers, zero for one per hardware thread
+         */
+        explicit ThreadPool(std::size_t threadCount = 0);
+
+        /// Finishes every queued task before joining the workers
+        ~ThreadPool();
+
+        /// Disallowed operations
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+
+        /**
+         * Queue a task
+         * @param task: A callable taking no arguments
+         * @return A future for the task's result. Exceptions thrown by the task are rethrown from get().
+         */
+        template<typename F>
+        std::future<std::invoke_result_t<F>> submit(F&& task) {
+            using Result = std::invoke_result_t<F>;
+
+            // std::function needs a copyable callable, so the packaged task is shared
+            auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+            std::future<Result> result = packagedTask->get_future();
+            enqueue([packagedTask]() { (*packagedTask)(); });
+            return result;
+        }
+
+        /// Block until the queue is empty and no task is running
+        void waitIdle();
+
+        [[nodiscard]] std::size_t getThreadCount() const;
+
+    private:
+        std::vector<std::thread> m_workers;
+
+        std::mutex m_mutex;
+        std::condition_variable m_taskAvailable;
+        std::condition_variable m_idle;
+        std::queue<std::function<void()>> m_tasks;
+        std::size_t m_runningTasks = 0;
+        bool m_stopping = false;
+
+        void enqueue(std::function<void()> task);
+        void workerLoop();
+    };
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+namespace Core {
+
+    /**
+     * Tone map linear radiance into an 8 bit sRGB pixel, with a Reinhard curve so highlights roll off instead of
+     * clipping. Compute shaders that display the same images match this, see RT2's denoise.comp.
+     * @param radiance: The linear radiance
+     * @param exposure: Multiplies radiance before tone mapping
+     * @param bgra: Write blue first, for BGRA formats
+     * @param out: The 4 bytes of the pixel, alpha is opaque
+     */
+    void toneMapPixel(glm::vec3 radiance, float exposure, bool bgra, uint8_t* out);
+}
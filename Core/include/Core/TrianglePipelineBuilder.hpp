@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Core/RasterPipelineBuilder.hpp"
+#include "Core/VertexFormat.hpp"
 
 #include <vector>
 
@@ -30,11 +31,19 @@ namespace Core {
          */
         void addVertexInputAttributeDesc(const vk::VertexInputAttributeDescription& attributeDescription);
 
+        /**
+         * Add the binding and attribute descriptions of one of the mesh pipeline's vertex formats.
+         * Attributes are at locations 0 (position), 1 (normal) and 2 (uv).
+         * @param format: The layout of the vertex buffer
+         * @param binding: The binding the vertex buffer will be bound to
+         */
+        void addVertexFormat(VertexFormat format, uint32_t binding = 0);
+
         /// -- End members for configuration --
 
     protected:
-        void addVertexShader(Shader& shader) override;
-        void addFragmentShader(Shader& shader) override;
+        void addVertexShader(Shader& shader, const SpecializationConstants* specialization) override;
+        void addFragmentShader(Shader& shader, const SpecializationConstants* specialization) override;
 
         vk::PipelineInputAssemblyStateCreateInfo m_inputAssemblyState{
             vk::PipelineInputAssemblyStateCreateFlags(),
@@ -11,6 +11,7 @@ namespace Core {
         struct Parameters {
             int width;
             int height;
+            FramePacingProfile framePacing = FramePacingProfile::Balanced;
         };
 
         explicit V1AppBase(Renderer& renderer, Parameters& parameters);
@@ -36,6 +37,14 @@ namespace Core {
          */
         virtual void simulateFrame(Core::TimePoint now, Core::TimeDelta delta) = 0;
 
+        /**
+         * Called in place of renderFrame() when nothing will be rendered, eg. while the window is minimized.
+         * A place for housekeeping that would otherwise steal time from a render frame.
+         * @param now: The high-resolution time right now
+         * @param delta: The time since the last frame
+         */
+        virtual void idleFrame(Core::TimePoint now, Core::TimeDelta delta);
+
         /**
          * Regenerate vulkan objects that change when the swapchain must be recreated
          * @param viewport: The new viewport extents
@@ -40,6 +40,7 @@ namespace Core {
 
         /// Event handling overrides, only visible to subclasses
         bool windowResized(int width, int height) override;
+        bool keyPressed(int key, int mods) override;
 
     protected:
         Renderer& m_renderer;
@@ -51,19 +51,35 @@ namespace Core {
         virtual void cleanupDynamicRenderResources() = 0;
 
         /**
-         * Derived classes should implement this method to record command buffers once on startup.
-         * @param buffers: All configured command buffers, in the order that they will be executed
+         * Derived classes should implement this method to record command buffers once on startup, and again after
+         * the swapchain is recreated.
+         * @param buffers: All configured command buffers, one per swapchain image in the order of getSwapchainImages()
          */
         virtual void recordCommandBuffersInitial(std::vector<vk::CommandBuffer>& buffers) = 0;
 
         /**
          * Derived classes should implement this method for a place to re-record command buffers each frame.
          * Derived classes must reset the command buffers they will be recording first.
-         * @param buffers: All configured command buffers, in the order they will be executed
+         * The previous frame has completed, so nothing the GPU reads is still in use.
+         * @param buffers: The command buffers that will be executed this frame, for getSwapchainImageIndex()
          */
         virtual void recordCommandBuffersPerFrame(std::vector<vk::CommandBuffer>& buffers) = 0;
 
+        /// The swapchain image the current frame renders to, valid during recordCommandBuffersPerFrame()
+        [[nodiscard]] uint32_t getSwapchainImageIndex() const;
+
     private:
+        vk::Device m_device;
+        const QueueGroup& m_graphicsQueue;
+
+        /// Buffers may be re-recorded individually, so the pool allows resetting them
+        vk::CommandPool m_commandPool;
+        std::vector<vk::CommandBuffer> m_commandBuffers;
+
+        vk::Semaphore m_imageAvailableSemaphore;
+        vk::Semaphore m_renderCompletedSemaphore;
+        uint32_t m_swapchainImageIndex = 0;
+
         void createSwapchainResources(const ResourceParameters& parameters);
         void cleanupSwapchainResources();
     };
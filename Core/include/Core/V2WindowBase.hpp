@@ -21,7 +21,8 @@ namespace Core {
 
         /**
          * A run loop that is more complicated that V1WindowBase.
-         * Improvements include calling to the attached app for dynamic resource creation and cleanup.
+         * Improvements include calling to the attached app for dynamic resource creation and cleanup,
+         * around the frames of V1WindowBase::run().
          */
         void run() override;
 
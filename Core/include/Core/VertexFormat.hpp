@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace Core {
+
+    /// The vertex layouts understood by the mesh pipeline. Both carry a position, a normal and one UV set.
+    enum class VertexFormat {
+        Full,       // 32 bytes, every attribute as 32 bit floats
+        Compressed, // 16 bytes, see CompressedVertex
+    };
+    const char* to_string(VertexFormat format);
+
+    /// The uncompressed vertex, as produced by importers and generators
+    struct FullVertex {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 uv;
+    };
+    static_assert(sizeof(FullVertex) == 32);
+
+    /**
+     * The compressed vertex:
+     *  - position as unorm16x4 relative to the mesh bounding box, with w fixed at 1.0
+     *  - normal as snorm16x2 in octahedral encoding
+     *  - uv as half floats
+     */
+    struct CompressedVertex {
+        uint16_t position[4];
+        int16_t normal[2];
+        uint16_t uv[2];
+    };
+    static_assert(sizeof(CompressedVertex) == 16);
+
+    /**
+     * Maps compressed positions back to object space, position = offset + scale * unorm.
+     * Laid out as vec4s so it can be used as a push constant block directly.
+     */
+    struct VertexQuantization {
+        glm::vec4 offset;
+        glm::vec4 scale;
+    };
+
+    [[nodiscard]] uint32_t getVertexStride(VertexFormat format);
+
+    /**
+     * Get the vertex input state for a format. Attributes are at locations 0 (position), 1 (normal) and 2 (uv).
+     * @param format: The vertex format
+     * @param binding: The binding the vertex buffer will be bound to
+     * @param attributes: Receives the attribute descriptions
+     * @return The binding description
+     */
+    vk::VertexInputBindingDescription getVertexInputDescriptions(VertexFormat format,
+                                                                 uint32_t binding,
+                                                                 std::vector<vk::VertexInputAttributeDescription>& attributes);
+
+    /// The identity quantization, for vertices that are not compressed
+    [[nodiscard]] VertexQuantization getIdentityQuantization();
+
+    /// Compute the quantization covering the bounding box of a set of vertices
+    [[nodiscard]] VertexQuantization computeQuantization(const FullVertex* vertices, std::size_t vertexCount);
+
+    [[nodiscard]] CompressedVertex compressVertex(const FullVertex& vertex, const VertexQuantization& quantization);
+    [[nodiscard]] FullVertex decompressVertex(const CompressedVertex& vertex, const VertexQuantization& quantization);
+
+    /// Compress a whole vertex buffer
+    [[nodiscard]] std::vector<CompressedVertex> compressVertices(const FullVertex* vertices,
+                                                                 std::size_t vertexCount,
+                                                                 const VertexQuantization& quantization);
+
+    /// Map a unit vector onto the [-1, 1] square, folding the lower hemisphere over the upper one
+    [[nodiscard]] glm::vec2 octahedralEncode(glm::vec3 normal);
+    [[nodiscard]] glm::vec3 octahedralDecode(glm::vec2 encoded);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Core/ImageWriter.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace Core {
+
+    /// The layouts a video stream can be written in
+    enum class VideoStreamFormat {
+        Y4m,     // YUV4MPEG2 with 4:2:0 BT.709 limited range frames, which encoders such as ffmpeg and x264 read directly
+        RawRgba, // 8 bit RGBA frames back to back with no header, the size and rate must be given to the reader
+    };
+    const char* to_string(VideoStreamFormat format);
+
+    /**
+     * Streams frames into a single file or named pipe, for feeding an encoder without writing a file per frame.
+     *
+     * writeFrame() may be called from several threads at once: each call converts its frame in parallel with the
+     * others, then waits for the frames before it so the stream is written in order. Every frame number from zero up
+     * must be written exactly once, or the frames after a missing one wait forever.
+     */
+    class VideoStream {
+    public:
+        /**
+         * @param path: The file or named pipe (eg. made with mkfifo and read by an encoder) to write
+         * @param format: The layout of the stream
+         * @param frameRate: Frames per second, recorded in the Y4M header
+         */
+        VideoStream(const std::string& path, VideoStreamFormat format, uint32_t frameRate);
+
+        /// Flushes and closes the stream. Every writeFrame() must have returned.
+        ~VideoStream();
+
+        /// Disallowed operations
+        VideoStream(const VideoStream&) = delete;
+        VideoStream(VideoStream&&) = delete;
+        VideoStream& operator=(const VideoStream&) = delete;
+        VideoStream& operator=(VideoStream&&) = delete;
+
+        [[nodiscard]] VideoStreamFormat getFormat() const;
+
+        /**
+         * Convert a frame and append it to the stream once the frames before it are written.
+         * Throws a std::runtime_error if the frame cannot be written, which still lets the frames after it through.
+         * @param frameNumber: The frame's position in the stream, counting from zero
+         * @param image: The frame, which must be the same size as the first
+         * @return The bytes written for the frame
+         */
+        std::size_t writeFrame(uint64_t frameNumber, const ImageRGBA8& image);
+
+    private:
+        std::string m_path;
+        VideoStreamFormat m_format;
+        uint32_t m_frameRate;
+        std::FILE* m_file;
+
+        /// Guards everything below
+        std::mutex m_mutex;
+        std::condition_variable m_frameWritten;
+        uint64_t m_nextFrame = 0;
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+        bool m_failed = false; // A write failed, so the stream is cut short
+    };
+}
@@ -85,6 +85,8 @@ namespace Core {
         initSurface();
         initPhysicalDevice(deviceExtensionCount, deviceExtensions, features);
         initLogicalDevice();
+        // The profile decides how the swapchain is created
+        getFramePacer().setProfile(runtimeParameters.framePacing);
         initSwapchain();
         initApp(runtimeParameters);
 
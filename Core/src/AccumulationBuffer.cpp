@@ -0,0 +1,222 @@
+#include "Core/AccumulationBuffer.hpp"
+#include "Core/ToneMap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+    /// Keeps the relative error of dark pixels finite, so black regions converge once their noise is invisible
+    constexpr float ERROR_LUMINANCE_FLOOR = 0.05f;
+
+    float luminance(glm::vec3 colour) { return glm::dot(colour, glm::vec3(0.2126f, 0.7152f, 0.0722f)); }
+}
+
+namespace Core {
+
+    AccumulationBuffer::AccumulationBuffer(uint32_t width, uint32_t height, uint32_t tileSize)
+        : m_tileSize(std::max(tileSize, 1u)) {
+        resize(width, height);
+    }
+
+    AccumulationBuffer::~AccumulationBuffer() = default;
+
+    void AccumulationBuffer::resize(uint32_t width, uint32_t height) {
+        m_width = width;
+        m_height = height;
+        m_tilesX = (width + m_tileSize - 1) / m_tileSize;
+        m_tilesY = (height + m_tileSize - 1) / m_tileSize;
+
+        std::size_t pixelCount = std::size_t(width) * height;
+        m_sums.resize(pixelCount);
+        m_luminanceSquareSums.resize(pixelCount);
+        m_sampleCounts.resize(pixelCount);
+        m_tiles.resize(std::size_t(m_tilesX) * m_tilesY);
+        reset();
+    }
+
+    void AccumulationBuffer::setConvergence(float targetError, uint32_t minSamples, uint32_t maxSamplesPerPass) {
+        m_targetError = targetError;
+        // Variance needs two samples
+        m_minSamples = std::max(minSamples, 2u);
+        m_maxSamplesPerPass = std::max(maxSamplesPerPass, 1u);
+    }
+
+    void AccumulationBuffer::reset() {
+        std::fill(m_sums.begin(), m_sums.end(), glm::vec3(0.0f));
+        std::fill(m_luminanceSquareSums.begin(), m_luminanceSquareSums.end(), 0.0f);
+        std::fill(m_sampleCounts.begin(), m_sampleCounts.end(), 0u);
+        std::fill(m_tiles.begin(), m_tiles.end(), Tile{std::numeric_limits<float>::infinity(), 0, false});
+        m_passes = 0;
+        m_samples = 0;
+    }
+
+    void AccumulationBuffer::swap(AccumulationBuffer& other) {
+        std::swap(m_width, other.m_width);
+        std::swap(m_height, other.m_height);
+        std::swap(m_tileSize, other.m_tileSize);
+        std::swap(m_tilesX, other.m_tilesX);
+        std::swap(m_tilesY, other.m_tilesY);
+        std::swap(m_targetError, other.m_targetError);
+        std::swap(m_minSamples, other.m_minSamples);
+        std::swap(m_maxSamplesPerPass, other.m_maxSamplesPerPass);
+        m_sums.swap(other.m_sums);
+        m_luminanceSquareSums.swap(other.m_luminanceSquareSums);
+        m_sampleCounts.swap(other.m_sampleCounts);
+        m_tiles.swap(other.m_tiles);
+        std::swap(m_passes, other.m_passes);
+        std::swap(m_samples, other.m_samples);
+    }
+
+    uint32_t AccumulationBuffer::getWidth() const { return m_width; }
+
+    uint32_t AccumulationBuffer::getHeight() const { return m_height; }
+
+    uint32_t AccumulationBuffer::getTileCount() const { return static_cast<uint32_t>(m_tiles.size()); }
+
+    std::vector<AccumulationBuffer::TileWork> AccumulationBuffer::planPass(uint64_t sampleBudget) {
+        std::vector<TileWork> work;
+
+        bool warmingUp = false;
+        double totalWeight = 0.0;
+        for (uint32_t tile = 0; tile < m_tiles.size(); tile++) {
+            if (m_tiles[tile].converged) {
+                continue;
+            }
+            warmingUp |= m_tiles[tile].samplesPerPixel < m_minSamples;
+            TileWork bounds = getTileBounds(tile);
+            totalWeight += double(m_tiles[tile].error) * (bounds.x1 - bounds.x0) * (bounds.y1 - bounds.y0);
+            work.push_back(bounds);
+        }
+
+        for (TileWork& tileWork : work) {
+            if (warmingUp || !std::isfinite(totalWeight) || totalWeight <= 0.0) {
+                // Errors are not trusted yet, so every tile is sampled evenly
+                tileWork.samplesPerPixel = 1;
+            } else {
+                // Samples per pixel in proportion to the error, so the noisiest tiles converge first
+                double share = double(sampleBudget) * m_tiles[tileWork.tile].error / totalWeight;
+                tileWork.samplesPerPixel = std::clamp(static_cast<uint32_t>(std::lround(share)), 1u, m_maxSamplesPerPass);
+            }
+            m_samples += uint64_t(tileWork.samplesPerPixel) * (tileWork.x1 - tileWork.x0) * (tileWork.y1 - tileWork.y0);
+        }
+
+        if (!work.empty()) {
+            m_passes++;
+        }
+        return work;
+    }
+
+    void AccumulationBuffer::addSample(uint32_t x, uint32_t y, glm::vec3 radiance) {
+        std::size_t pixel = std::size_t(y) * m_width + x;
+        float sampleLuminance = luminance(radiance);
+        m_sums[pixel] += radiance;
+        m_luminanceSquareSums[pixel] += sampleLuminance * sampleLuminance;
+        m_sampleCounts[pixel]++;
+    }
+
+    void AccumulationBuffer::addSamples(uint32_t x, uint32_t y, glm::vec3 mean, float luminanceSquareMean, uint32_t count) {
+        std::size_t pixel = std::size_t(y) * m_width + x;
+        m_sums[pixel] += mean * static_cast<float>(count);
+        m_luminanceSquareSums[pixel] += luminanceSquareMean * count;
+        m_sampleCounts[pixel] += count;
+    }
+
+    uint32_t AccumulationBuffer::getSampleCount(uint32_t x, uint32_t y) const { return m_sampleCounts[std::size_t(y) * m_width + x]; }
+
+    void AccumulationBuffer::finishTile(uint32_t tile) {
+        TileWork bounds = getTileBounds(tile);
+        double errorSum = 0.0;
+        uint32_t minSamples = std::numeric_limits<uint32_t>::max();
+        for (uint32_t y = bounds.y0; y < bounds.y1; y++) {
+            for (uint32_t x = bounds.x0; x < bounds.x1; x++) {
+                std::size_t pixel = std::size_t(y) * m_width + x;
+                uint32_t count = m_sampleCounts[pixel];
+                minSamples = std::min(minSamples, count);
+                if (count < 2) {
+                    errorSum += std::numeric_limits<float>::infinity();
+                    continue;
+                }
+                // The standard error of the mean shrinks with the square root of the samples taken
+                float mean = luminance(m_sums[pixel]) / count;
+                float standardError = std::sqrt(getLuminanceVariance(x, y) / count);
+                errorSum += standardError / (mean + ERROR_LUMINANCE_FLOOR);
+            }
+        }
+
+        Tile& state = m_tiles[tile];
+        state.error = static_cast<float>(errorSum / ((bounds.x1 - bounds.x0) * (bounds.y1 - bounds.y0)));
+        state.samplesPerPixel = minSamples;
+        state.converged = minSamples >= m_minSamples && state.error <= m_targetError;
+    }
+
+    glm::vec3 AccumulationBuffer::getMean(uint32_t x, uint32_t y) const {
+        std::size_t pixel = std::size_t(y) * m_width + x;
+        uint32_t count = m_sampleCounts[pixel];
+        return count > 0 ? m_sums[pixel] / static_cast<float>(count) : glm::vec3(0.0f);
+    }
+
+    float AccumulationBuffer::getLuminanceVariance(uint32_t x, uint32_t y) const {
+        std::size_t pixel = std::size_t(y) * m_width + x;
+        uint32_t count = m_sampleCounts[pixel];
+        if (count < 2) {
+            return 0.0f;
+        }
+        float mean = luminance(m_sums[pixel]) / count;
+        float meanSquare = m_luminanceSquareSums[pixel] / count;
+        // Bessel's correction, and rounding can leave a tiny negative
+        return std::max(meanSquare - mean * mean, 0.0f) * count / (count - 1);
+    }
+
+    float AccumulationBuffer::getLuminanceSquareMean(uint32_t x, uint32_t y) const {
+        std::size_t pixel = std::size_t(y) * m_width + x;
+        uint32_t count = m_sampleCounts[pixel];
+        return count > 0 ? m_luminanceSquareSums[pixel] / count : 0.0f;
+    }
+
+    void AccumulationBuffer::resolveRows(uint32_t firstRow, uint32_t rowCount, uint8_t* out, std::size_t rowPitch, bool bgra, float exposure) const {
+        for (uint32_t y = firstRow; y < firstRow + rowCount; y++) {
+            uint8_t* row = out + std::size_t(y - firstRow) * rowPitch;
+            for (uint32_t x = 0; x < m_width; x++) {
+                toneMapPixel(getMean(x, y), exposure, bgra, row + x * 4);
+            }
+        }
+    }
+
+    AccumulationBuffer::Stats AccumulationBuffer::getStats() const {
+        Stats stats{};
+        stats.passes = m_passes;
+        stats.samples = m_samples;
+        stats.tileCount = getTileCount();
+        for (const Tile& tile : m_tiles) {
+            if (tile.converged) {
+                stats.convergedTiles++;
+            } else if (std::isfinite(tile.error)) {
+                stats.maxTileError = std::max(stats.maxTileError, tile.error);
+            }
+        }
+        std::size_t pixelCount = std::size_t(m_width) * m_height;
+        stats.averageSamplesPerPixel = pixelCount > 0 ? static_cast<float>(double(m_samples) / pixelCount) : 0.0f;
+        return stats;
+    }
+
+    void AccumulationBuffer::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        out << "Accumulation: " << stats.passes << " passes, " << stats.averageSamplesPerPixel << " samples per pixel, " << stats.convergedTiles << " of "
+            << stats.tileCount << " tiles converged, " << stats.maxTileError << " max error (target " << m_targetError << ")" << std::endl;
+    }
+
+    AccumulationBuffer::TileWork AccumulationBuffer::getTileBounds(uint32_t tile) const {
+        uint32_t x0 = (tile % m_tilesX) * m_tileSize;
+        uint32_t y0 = (tile / m_tilesX) * m_tileSize;
+        return TileWork{
+            tile,
+            x0,
+            y0,
+            std::min(x0 + m_tileSize, m_width),
+            std::min(y0 + m_tileSize, m_height),
+            0,
+        };
+    }
+}
@@ -0,0 +1,556 @@
+#include "Core/AsyncIO.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <atomic>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    /// Waiting on the ring may fail while the kernel is short of memory. Past this many failures in a row it is given up on.
+    constexpr int MAX_CONSECUTIVE_WAIT_FAILURES = 8;
+
+    std::exception_ptr makeReadError(const std::string& path, int error) {
+        return std::make_exception_ptr(std::runtime_error("Failed to read " + path + ": " + strerror(error)));
+    }
+
+    /// The fallback's blocking read
+    std::vector<char> readWholeFile(const std::string& path) {
+        std::ifstream file(path, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open " + path);
+        }
+
+        std::vector<char> data(static_cast<std::size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            throw std::runtime_error("Failed to read " + path);
+        }
+        return data;
+    }
+}
+
+namespace Core {
+
+#ifdef __linux__
+    /**
+     * An io_uring driven through the raw system calls, which avoids a dependency on liburing.
+     * The submission queue is written under m_mutex by whichever thread has reads to queue. The completion thread owns
+     * the completion queue, and is the only thread that blocks in io_uring_enter.
+     */
+    class AsyncIO::Ring {
+    public:
+        /// Throws std::runtime_error if the kernel refuses to create the ring
+        Ring(AsyncIO& owner, uint32_t queueDepth)
+            : m_owner(owner) {
+            io_uring_params params{};
+            m_ringFd = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+            if (m_ringFd < 0) {
+                throw std::runtime_error(std::string("io_uring_setup failed: ") + strerror(errno));
+            }
+
+            m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+            m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool singleMapping = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (singleMapping) {
+                m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+            }
+
+            m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+            m_cqRing = singleMapping ? m_sqRing
+                                     : mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_CQ_RING);
+            m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+            if (m_sqRing == MAP_FAILED || m_cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+                int error = errno;
+                unmap(sqes);
+                close(m_ringFd);
+                throw std::runtime_error(std::string("Failed to map the io_uring: ") + strerror(error));
+            }
+            m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+            auto* sq = static_cast<char*>(m_sqRing);
+            m_sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+            m_sqMask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+            m_sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+            m_sqEntries = params.sq_entries;
+
+            auto* cq = static_cast<char*>(m_cqRing);
+            m_cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+            m_cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+            m_cqMask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+            m_completionThread = std::thread(&Ring::completionLoop, this);
+        }
+
+        /// Expects no reads to be outstanding
+        ~Ring() {
+            {
+                // A no-op with no read attached tells the completion thread to exit, unless it already has after an error
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+                if (!m_error) {
+                    io_uring_sqe* sqe = getSqe();
+                    sqe->opcode = IORING_OP_NOP;
+                    sqe->user_data = 0;
+                    try {
+                        commitSqes(1);
+                    } catch (const std::runtime_error& error) {
+                        // The thread still uses the ring, so it is leaked rather than unmapped under it
+                        std::cerr << "Async I/O could not stop its completion thread: " << error.what() << std::endl;
+                        m_completionThread.detach();
+                        return;
+                    }
+                }
+            }
+            m_completionThread.join();
+
+            unmap(m_sqes);
+            close(m_ringFd);
+        }
+
+        void submit(std::vector<Request>& requests) {
+            std::vector<std::pair<ReadResult, Callback>> immediate;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (Request& request : requests) {
+                    auto read = std::make_unique<Read>();
+                    read->result.path = std::move(request.path);
+                    read->callback = std::move(request.callback);
+
+                    // Opening is a metadata operation, cheap next to the read itself
+                    read->fd = open(read->result.path.c_str(), O_RDONLY | O_CLOEXEC);
+                    struct stat status {};
+                    if (read->fd < 0 || fstat(read->fd, &status) != 0) {
+                        read->result.error = makeReadError(read->result.path, errno);
+                    } else {
+                        read->result.data.resize(static_cast<std::size_t>(status.st_size));
+                    }
+
+                    if (m_error && !read->result.error) {
+                        // The ring stopped while these reads were being handed over
+                        read->result.error = m_error;
+                    }
+                    if (read->result.error || read->result.data.empty()) {
+                        finish(*read);
+                        immediate.emplace_back(std::move(read->result), std::move(read->callback));
+                    } else {
+                        m_backlog.push_back(std::move(read));
+                    }
+                }
+                commitSqes(queueBacklog());
+            }
+
+            // Failed opens and empty files complete on the caller's thread
+            for (auto& [result, callback] : immediate) {
+                m_owner.complete(result, callback);
+            }
+        }
+
+    private:
+        /// One file being read, possibly across several short reads
+        struct Read {
+            ReadResult result;
+            Callback callback;
+            int fd = -1;
+            std::size_t bytesDone = 0;
+            iovec buffer{};
+        };
+
+        AsyncIO& m_owner;
+
+        int m_ringFd = -1;
+        void* m_sqRing = nullptr;
+        void* m_cqRing = nullptr;
+        std::size_t m_sqRingSize = 0;
+        std::size_t m_cqRingSize = 0;
+        io_uring_sqe* m_sqes = nullptr;
+        std::size_t m_sqesSize = 0;
+
+        uint32_t* m_sqTail;
+        uint32_t* m_sqArray;
+        uint32_t m_sqMask;
+        uint32_t m_sqEntries;
+        uint32_t* m_cqHead;
+        uint32_t* m_cqTail;
+        io_uring_cqe* m_cqes;
+        uint32_t m_cqMask;
+
+        std::mutex m_mutex;
+        std::deque<std::unique_ptr<Read>> m_backlog; // Reads waiting for room in the kernel's queue
+        uint32_t m_pendingSqes = 0; // Filled in by getSqe() but not yet visible to the kernel
+        std::unordered_set<Read*> m_readsInKernel; // Owned by the kernel until their completion comes back
+        bool m_stopping = false;
+        std::exception_ptr m_error; // Set once the completion thread has given up on the ring
+
+        std::thread m_completionThread;
+
+        void unmap(void* sqes) {
+            if (sqes && sqes != MAP_FAILED) {
+                munmap(sqes, m_sqesSize);
+            }
+            if (m_cqRing && m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) {
+                munmap(m_cqRing, m_cqRingSize);
+            }
+            if (m_sqRing && m_sqRing != MAP_FAILED) {
+                munmap(m_sqRing, m_sqRingSize);
+            }
+        }
+
+        /// The next free submission entry, cleared. Expects m_mutex to be held and the queue not to be full.
+        io_uring_sqe* getSqe() {
+            uint32_t tail = *m_sqTail + m_pendingSqes;
+            uint32_t index = tail & m_sqMask;
+            m_sqArray[index] = index;
+            m_pendingSqes++;
+
+            io_uring_sqe* sqe = &m_sqes[index];
+            memset(sqe, 0, sizeof(io_uring_sqe));
+            return sqe;
+        }
+
+        /// Publish the entries from getSqe() to the kernel and submit them. Expects m_mutex to be held.
+        void commitSqes(uint32_t count) {
+            if (count == 0) {
+                return;
+            }
+            std::atomic_ref<uint32_t>(*m_sqTail).store(*m_sqTail + m_pendingSqes, std::memory_order_release);
+            m_pendingSqes = 0;
+
+            while (syscall(__NR_io_uring_enter, m_ringFd, count, 0, 0, nullptr, 0) < 0) {
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                    throw std::runtime_error(std::string("io_uring_enter failed: ") + strerror(errno));
+                }
+            }
+        }
+
+        /// Queue the rest of a read. Expects m_mutex to be held.
+        void queueRead(Read& read) {
+            // A single read is capped by the kernel, just short of 2GiB, larger files take several
+            std::size_t remaining = std::min<std::size_t>(read.result.data.size() - read.bytesDone, 0x7FFFF000);
+            read.buffer.iov_base = read.result.data.data() + read.bytesDone;
+            read.buffer.iov_len = remaining;
+
+            io_uring_sqe* sqe = getSqe();
+            sqe->opcode = IORING_OP_READV;
+            sqe->fd = read.fd;
+            sqe->addr = reinterpret_cast<uint64_t>(&read.buffer);
+            sqe->len = 1;
+            sqe->off = read.bytesDone;
+            sqe->user_data = reinterpret_cast<uint64_t>(&read);
+            m_readsInKernel.insert(&read);
+        }
+
+        /// Move reads from the backlog while the kernel's queue has room. Expects m_mutex to be held.
+        uint32_t queueBacklog() {
+            uint32_t queued = 0;
+            while (!m_backlog.empty() && m_readsInKernel.size() < m_sqEntries) {
+                // Ownership passes to the kernel until the completion comes back
+                queueRead(*m_backlog.front().release());
+                m_backlog.pop_front();
+                queued++;
+            }
+            return queued;
+        }
+
+        void finish(Read& read) {
+            if (read.fd >= 0) {
+                close(read.fd);
+                read.fd = -1;
+            }
+            if (read.result.error) {
+                read.result.data.clear();
+            }
+        }
+
+        /**
+         * Fail every read after an error the ring cannot recover from, and report the error to the owner.
+         * Reads still in the kernel fail too, but their buffers are leaked rather than freed, as the kernel may yet write to them.
+         */
+        void abandon(std::exception_ptr error) {
+            std::vector<std::pair<ReadResult, Callback>> failed;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_error = error;
+                for (std::unique_ptr<Read>& read : m_backlog) {
+                    finish(*read);
+                    failed.emplace_back(ReadResult{std::move(read->result.path), {}, error}, std::move(read->callback));
+                }
+                m_backlog.clear();
+                for (Read* read : m_readsInKernel) {
+                    failed.emplace_back(ReadResult{read->result.path, {}, error}, std::move(read->callback));
+                }
+                m_readsInKernel.clear();
+            }
+
+            m_owner.fail(error);
+            for (auto& [result, callback] : failed) {
+                m_owner.complete(result, callback);
+            }
+        }
+
+        void completionLoop() {
+            std::vector<std::unique_ptr<Read>> finished;
+            bool stopping = false;
+            int waitFailures = 0;
+            while (!stopping) {
+                if (syscall(__NR_io_uring_enter, m_ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+                    int error = errno;
+                    if (error == EINTR) {
+                        continue;
+                    }
+                    if (++waitFailures == MAX_CONSECUTIVE_WAIT_FAILURES) {
+                        abandon(std::make_exception_ptr(std::runtime_error(std::string("io_uring_enter failed while waiting: ") + strerror(error))));
+                        return;
+                    }
+                    // Back off, so an error that lasts a while does not keep a core busy
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1 << waitFailures));
+                    continue;
+                }
+                waitFailures = 0;
+
+                std::exception_ptr submitError;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    uint32_t head = *m_cqHead;
+                    uint32_t tail = std::atomic_ref<uint32_t>(*m_cqTail).load(std::memory_order_acquire);
+                    uint32_t resubmitted = 0;
+                    for (; head != tail; head++) {
+                        const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+                        if (cqe.user_data == 0) {
+                            stopping = m_stopping;
+                            continue;
+                        }
+
+                        auto* read = reinterpret_cast<Read*>(cqe.user_data);
+                        m_readsInKernel.erase(read);
+                        if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                            queueRead(*read);
+                            resubmitted++;
+                            continue;
+                        } else if (cqe.res < 0) {
+                            read->result.error = makeReadError(read->result.path, -cqe.res);
+                        } else if (cqe.res == 0) {
+                            // The file shrank after it was opened
+                            read->result.error = makeReadError(read->result.path, EIO);
+                        } else {
+                            read->bytesDone += static_cast<std::size_t>(cqe.res);
+                            if (read->bytesDone < read->result.data.size()) {
+                                queueRead(*read);
+                                resubmitted++;
+                                continue;
+                            }
+                        }
+
+                        finish(*read);
+                        finished.emplace_back(read);
+                    }
+                    std::atomic_ref<uint32_t>(*m_cqHead).store(head, std::memory_order_release);
+
+                    // Thrown here, the error would end the program rather than reach anyone waiting for the reads
+                    try {
+                        commitSqes(resubmitted + queueBacklog());
+                    } catch (const std::runtime_error&) {
+                        submitError = std::current_exception();
+                    }
+                }
+
+                // Callbacks run without the lock, so they may queue further reads
+                for (std::unique_ptr<Read>& read : finished) {
+                    m_owner.complete(read->result, read->callback);
+                }
+                finished.clear();
+
+                if (submitError) {
+                    abandon(submitError);
+                    return;
+                }
+            }
+        }
+    };
+#else
+    /// Only the thread pool fallback is available
+    class AsyncIO::Ring {
+    public:
+        Ring(AsyncIO&, uint32_t) { throw std::runtime_error("io_uring is not available on this platform"); }
+        void submit(std::vector<Request>&) {}
+    };
+#endif
+
+    AsyncIO::AsyncIO(uint32_t queueDepth, std::size_t fallbackThreadCount) {
+        try {
+            m_ring = std::make_unique<Ring>(*this, queueDepth);
+        } catch (const std::runtime_error& error) {
+            std::cout << "Async I/O falling back to blocking reads on " << fallbackThreadCount << " threads (" << error.what() << ")" << std::endl;
+            m_fallbackPool = std::make_unique<ThreadPool>(fallbackThreadCount);
+        }
+    }
+
+    AsyncIO::~AsyncIO() {
+        try {
+            waitIdle();
+        } catch (const std::runtime_error& error) {
+            std::cerr << "Async I/O stopped after an error: " << error.what() << std::endl;
+        }
+        m_ring.reset();
+        m_fallbackPool.reset();
+    }
+
+    void AsyncIO::read(const std::string& path, Callback callback) {
+        std::vector<Request> requests;
+        requests.push_back(Request{path, std::move(callback)});
+        submit(std::move(requests));
+    }
+
+    std::future<std::vector<char>> AsyncIO::read(const std::string& path) {
+        return std::move(readBatch(std::vector<std::string>{path})[0]);
+    }
+
+    void AsyncIO::readBatch(const std::vector<std::string>& paths, const Callback& callback) {
+        std::vector<Request> requests;
+        requests.reserve(paths.size());
+        for (const std::string& path : paths) {
+            requests.push_back(Request{path, callback});
+        }
+        submit(std::move(requests));
+    }
+
+    std::vector<std::future<std::vector<char>>> AsyncIO::readBatch(const std::vector<std::string>& paths) {
+        std::vector<std::future<std::vector<char>>> futures;
+        std::vector<Request> requests;
+        futures.reserve(paths.size());
+        requests.reserve(paths.size());
+        for (const std::string& path : paths) {
+            // std::function needs a copyable callable, so the promise is shared
+            auto promise = std::make_shared<std::promise<std::vector<char>>>();
+            futures.push_back(promise->get_future());
+            requests.push_back(Request{path, [promise](ReadResult& result) {
+                                           if (result.error) {
+                                               promise->set_exception(result.error);
+                                           } else {
+                                               promise->set_value(std::move(result.data));
+                                           }
+                                       }});
+        }
+        submit(std::move(requests));
+        return futures;
+    }
+
+    void AsyncIO::waitIdle() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this]() { return m_outstandingReads == 0; });
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+    bool AsyncIO::isUsingIoUring() const { return m_ring != nullptr; }
+
+    AsyncIO::Stats AsyncIO::getStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stats stats = m_stats;
+        stats.averageQueueDepth = m_queueDepthSamples > 0 ? static_cast<float>(m_queueDepthSum) / static_cast<float>(m_queueDepthSamples) : 0.0f;
+        if (m_outstandingReads > 0) {
+            stats.busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_busyStart).count();
+        }
+        return stats;
+    }
+
+    void AsyncIO::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        double mebibytes = static_cast<double>(stats.bytesRead) / (1024.0 * 1024.0);
+        out << "Async I/O (" << (isUsingIoUring() ? "io_uring" : "thread pool") << "): " << stats.completedReads << " reads";
+        if (stats.failedReads > 0) {
+            out << " (" << stats.failedReads << " failed)";
+        }
+        out << ", " << mebibytes << " MiB";
+        if (stats.busySeconds > 0.0) {
+            out << " at " << mebibytes / stats.busySeconds << " MiB/s";
+        }
+        out << ", queue depth " << stats.averageQueueDepth << " average, " << stats.peakQueueDepth << " peak" << std::endl;
+    }
+
+    void AsyncIO::submit(std::vector<Request> requests) {
+        if (requests.empty()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_error) {
+                std::rethrow_exception(m_error);
+            }
+            if (m_outstandingReads == 0) {
+                m_busyStart = std::chrono::steady_clock::now();
+            }
+            for (std::size_t i = 0; i < requests.size(); i++) {
+                m_outstandingReads++;
+                m_queueDepthSum += m_outstandingReads;
+                m_queueDepthSamples++;
+            }
+            m_stats.peakQueueDepth = std::max(m_stats.peakQueueDepth, m_outstandingReads);
+        }
+
+        if (m_ring) {
+            m_ring->submit(requests);
+            return;
+        }
+
+        for (Request& request : requests) {
+            m_fallbackPool->submit([this, request = std::move(request)]() {
+                ReadResult result{request.path, {}, nullptr};
+                try {
+                    result.data = readWholeFile(request.path);
+                } catch (...) {
+                    result.error = std::current_exception();
+                }
+                complete(result, request.callback);
+            });
+        }
+    }
+
+    void AsyncIO::fail(std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = error;
+    }
+
+    void AsyncIO::complete(ReadResult& result, const Callback& callback) {
+        // The callback may take the data
+        bool failed = result.error != nullptr;
+        std::size_t size = result.data.size();
+        try {
+            callback(result);
+        } catch (const std::exception& exception) {
+            std::cerr << "Async I/O callback for " << result.path << " threw: " << exception.what() << std::endl;
+        }
+
+        // Only counted once the callback has returned, so waitIdle() also waits for callbacks
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (failed) {
+            m_stats.failedReads++;
+        } else {
+            m_stats.completedReads++;
+            m_stats.bytesRead += size;
+        }
+        if (--m_outstandingReads == 0) {
+            m_stats.busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_busyStart).count();
+            m_idle.notify_all();
+        }
+    }
+}
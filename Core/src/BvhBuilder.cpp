@@ -0,0 +1,194 @@
+#include "Core/BvhBuilder.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+    /// Relative to the cost of intersecting one triangle
+    constexpr float TRAVERSAL_COST = 1.0f;
+
+    struct Bounds {
+        glm::vec3 minimum{std::numeric_limits<float>::max()};
+        glm::vec3 maximum{std::numeric_limits<float>::lowest()};
+
+        void grow(const glm::vec3& point) {
+            minimum = glm::min(minimum, point);
+            maximum = glm::max(maximum, point);
+        }
+
+        void grow(const Bounds& other) {
+            minimum = glm::min(minimum, other.minimum);
+            maximum = glm::max(maximum, other.maximum);
+        }
+
+        [[nodiscard]] float surfaceArea() const {
+            if (minimum.x > maximum.x) {
+                return 0.0f;
+            }
+            glm::vec3 extent = maximum - minimum;
+            return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+        }
+    };
+
+    struct Bin {
+        Bounds bounds;
+        uint32_t triangleCount = 0;
+    };
+}
+
+namespace Core {
+
+    BvhBuilder::BvhBuilder(uint32_t maxLeafTriangles, uint32_t binCount)
+        : m_maxLeafTriangles(maxLeafTriangles)
+        , m_binCount(binCount) {
+        if (maxLeafTriangles == 0 || binCount < 2) {
+            throw std::runtime_error("BvhBuilder: leaves need at least one triangle and splits at least two bins");
+        }
+    }
+
+    BvhBuilder::~BvhBuilder() = default;
+
+    BvhBuilder::Result BvhBuilder::build(const glm::vec3* positions, const uint32_t* indices, std::size_t triangleCount) const {
+        Result result;
+        if (triangleCount == 0) {
+            return result;
+        }
+
+        std::vector<Bounds> triangleBounds(triangleCount);
+        std::vector<glm::vec3> centroids(triangleCount);
+        for (std::size_t triangle = 0; triangle < triangleCount; triangle++) {
+            for (int corner = 0; corner < 3; corner++) {
+                triangleBounds[triangle].grow(positions[indices[triangle * 3 + corner]]);
+            }
+            centroids[triangle] = (triangleBounds[triangle].minimum + triangleBounds[triangle].maximum) * 0.5f;
+        }
+
+        result.triangles.resize(triangleCount);
+        std::iota(result.triangles.begin(), result.triangles.end(), 0u);
+
+        // While a node waits to be split, its fields hold the range of the triangle list it covers
+        auto makeNode = [&](uint32_t first, uint32_t count) {
+            Bounds bounds;
+            for (uint32_t i = first; i < first + count; i++) {
+                bounds.grow(triangleBounds[result.triangles[i]]);
+            }
+            return SceneBvhNode{bounds.minimum, first, bounds.maximum, count};
+        };
+
+        result.nodes.reserve(triangleCount * 2 / m_maxLeafTriangles + 1);
+        result.nodes.push_back(makeNode(0, static_cast<uint32_t>(triangleCount)));
+
+        std::vector<Bin> bins(m_binCount);
+        std::vector<float> rightCosts(m_binCount);
+        std::vector<uint32_t> pending{0};
+        while (!pending.empty()) {
+            uint32_t nodeIndex = pending.back();
+            pending.pop_back();
+
+            uint32_t first = result.nodes[nodeIndex].firstChildOrTriangle;
+            uint32_t count = result.nodes[nodeIndex].triangleCount;
+            if (count <= m_maxLeafTriangles) {
+                continue;
+            }
+
+            Bounds centroidBounds;
+            for (uint32_t i = first; i < first + count; i++) {
+                centroidBounds.grow(centroids[result.triangles[i]]);
+            }
+
+            // Find the cheapest split over every axis
+            float bestCost = std::numeric_limits<float>::max();
+            int bestAxis = -1;
+            uint32_t bestBin = 0;
+            for (int axis = 0; axis < 3; axis++) {
+                float axisMinimum = centroidBounds.minimum[axis];
+                float axisExtent = centroidBounds.maximum[axis] - axisMinimum;
+                if (axisExtent <= 0.0f) {
+                    continue;
+                }
+                float binScale = m_binCount / axisExtent;
+
+                std::fill(bins.begin(), bins.end(), Bin{});
+                for (uint32_t i = first; i < first + count; i++) {
+                    uint32_t triangle = result.triangles[i];
+                    auto bin = std::min(m_binCount - 1, static_cast<uint32_t>((centroids[triangle][axis] - axisMinimum) * binScale));
+                    bins[bin].bounds.grow(triangleBounds[triangle]);
+                    bins[bin].triangleCount++;
+                }
+
+                // Sweep from the right, then from the left, to cost every split between bins
+                Bounds right;
+                uint32_t rightCount = 0;
+                for (uint32_t bin = m_binCount - 1; bin > 0; bin--) {
+                    right.grow(bins[bin].bounds);
+                    rightCount += bins[bin].triangleCount;
+                    rightCosts[bin] = right.surfaceArea() * rightCount;
+                }
+                Bounds left;
+                uint32_t leftCount = 0;
+                for (uint32_t bin = 1; bin < m_binCount; bin++) {
+                    left.grow(bins[bin - 1].bounds);
+                    leftCount += bins[bin - 1].triangleCount;
+                    float cost = left.surfaceArea() * leftCount + rightCosts[bin];
+                    if (leftCount > 0 && leftCount < count && cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = bin;
+                    }
+                }
+            }
+
+            uint32_t* triangles = result.triangles.data();
+            uint32_t* middle;
+            if (bestAxis >= 0) {
+                float axisMinimum = centroidBounds.minimum[bestAxis];
+                float binScale = m_binCount / (centroidBounds.maximum[bestAxis] - axisMinimum);
+                middle = std::partition(triangles + first, triangles + first + count, [&](uint32_t triangle) {
+                    return std::min(m_binCount - 1, static_cast<uint32_t>((centroids[triangle][bestAxis] - axisMinimum) * binScale)) < bestBin;
+                });
+            } else {
+                // Every centroid is in the same place, so no plane separates them. Split the list in half.
+                middle = triangles + first + count / 2;
+            }
+            auto leftCount = static_cast<uint32_t>(middle - (triangles + first));
+
+            auto leftIndex = static_cast<uint32_t>(result.nodes.size());
+            result.nodes.push_back(makeNode(first, leftCount));
+            result.nodes.push_back(makeNode(first + leftCount, count - leftCount));
+
+            result.nodes[nodeIndex].firstChildOrTriangle = leftIndex;
+            result.nodes[nodeIndex].triangleCount = 0;
+
+            pending.push_back(leftIndex + 1);
+            pending.push_back(leftIndex);
+        }
+
+        return result;
+    }
+
+    float BvhBuilder::computeSahCost(const Result& bvh) {
+        if (bvh.nodes.empty()) {
+            return 0.0f;
+        }
+
+        auto surfaceArea = [](const SceneBvhNode& node) {
+            Bounds bounds{node.minimum, node.maximum};
+            return bounds.surfaceArea();
+        };
+
+        float rootArea = surfaceArea(bvh.nodes[0]);
+        if (rootArea <= 0.0f) {
+            return static_cast<float>(bvh.triangles.size());
+        }
+
+        // Each node is weighted by the probability that a ray hitting the root also hits it
+        float cost = 0.0f;
+        for (const SceneBvhNode& node : bvh.nodes) {
+            float probability = surfaceArea(node) / rootArea;
+            cost += probability * (node.triangleCount > 0 ? static_cast<float>(node.triangleCount) : TRAVERSAL_COST);
+        }
+        return cost;
+    }
+}
@@ -0,0 +1,101 @@
+#include "Core/ContentHash.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    constexpr uint64_t SEED = 0x9E3779B97F4A7C15ull;
+    constexpr uint64_t MULTIPLIER = 0xFF51AFD7ED558CCDull;
+    constexpr std::size_t FILE_CHUNK_SIZE = 1 << 20;
+
+    /// MurmurHash3's 64 bit finalizer
+    uint64_t fmix(uint64_t value) {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDull;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ull;
+        value ^= value >> 33;
+        return value;
+    }
+}
+
+namespace Core {
+
+    ContentHash::ContentHash()
+        : m_state(SEED) {}
+
+    void ContentHash::add(const void* data, std::size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        m_length += size;
+
+        // Top up a partial word first
+        while (size > 0 && m_pendingSize > 0) {
+            m_pending |= static_cast<uint64_t>(*bytes++) << (8 * m_pendingSize);
+            size--;
+            if (++m_pendingSize == sizeof(uint64_t)) {
+                mixWord(m_pending);
+                m_pending = 0;
+                m_pendingSize = 0;
+            }
+        }
+
+        while (size >= sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, bytes, sizeof(word));
+            mixWord(word);
+            bytes += sizeof(word);
+            size -= sizeof(word);
+        }
+
+        while (size > 0) {
+            m_pending |= static_cast<uint64_t>(*bytes++) << (8 * m_pendingSize);
+            m_pendingSize++;
+            size--;
+        }
+    }
+
+    void ContentHash::addString(std::string_view text) {
+        // The length keeps ("ab", "c") and ("a", "bc") apart
+        addValue(static_cast<uint64_t>(text.size()));
+        add(text.data(), text.size());
+    }
+
+    void ContentHash::addFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Failed to open " + path);
+        }
+
+        std::vector<char> chunk(FILE_CHUNK_SIZE);
+        while (file) {
+            file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            add(chunk.data(), static_cast<std::size_t>(file.gcount()));
+        }
+    }
+
+    uint64_t ContentHash::get() const {
+        uint64_t state = m_state;
+        if (m_pendingSize > 0) {
+            state = (state ^ fmix(m_pending)) * MULTIPLIER;
+        }
+        return fmix(state ^ m_length);
+    }
+
+    std::string ContentHash::toHex() const {
+        static constexpr char DIGITS[] = "0123456789abcdef";
+        uint64_t hash = get();
+        std::string result(16, '0');
+        for (int i = 15; i >= 0; i--) {
+            result[i] = DIGITS[hash & 0xF];
+            hash >>= 4;
+        }
+        return result;
+    }
+
+    void ContentHash::mixWord(uint64_t word) {
+        m_state = (m_state ^ fmix(word)) * MULTIPLIER;
+        m_state = (m_state << 27) | (m_state >> 37);
+    }
+}
@@ -0,0 +1,331 @@
+#include "Core/Denoiser.hpp"
+#include "Core/ToneMap.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+namespace {
+    /// The B3 spline, the à-trous kernel in each direction
+    constexpr float KERNEL[5] = {1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+
+    /// Keeps the colour weight finite for pixels with no noise
+    constexpr float VARIANCE_EPSILON = 1e-6f;
+
+    /// Keeps the depth weight finite for pixels at the camera
+    constexpr float DEPTH_EPSILON = 1e-6f;
+
+    /// Rows filtered by one task
+    constexpr uint32_t ROWS_PER_TASK = 16;
+
+    /**
+     * e^-x for x >= 0, as 1 / (1 + x/1024)^1024. Its base is never below one, so it needs no clamp, and without a
+     * branch the loops using it vectorize where std::exp would not. denoise.comp computes it the same way. It is within
+     * 0.2% of e^-x up to 2, where weights still matter, and large x overflow to infinity and give zero.
+     */
+    float approximateExpNegative(float x) {
+        float base = 1.0f + x * (1.0f / 1024.0f);
+        for (int i = 0; i < 10; i++) {
+            base *= base;
+        }
+        return 1.0f / base;
+    }
+
+    /// The per-pixel sums of one output row, reused between rows of a task
+    struct RowSums {
+        std::vector<float> weights;
+        std::vector<float> colourR, colourG, colourB;
+        std::vector<float> variances; // Weighted by squared weights, as the variance of a weighted mean is
+        std::vector<float> colourScales;
+        std::vector<float> depthScales;
+
+        void reset(std::size_t width) {
+            for (std::vector<float>* sums : {&weights, &colourR, &colourG, &colourB, &variances}) {
+                sums->assign(width, 0.0f);
+            }
+            colourScales.resize(width);
+            depthScales.resize(width);
+        }
+    };
+
+    /// The planes of one row, offset to a column
+    struct RowPlanes {
+        const float* colourR;
+        const float* colourG;
+        const float* colourB;
+        const float* variance;
+        const float* albedoR;
+        const float* albedoG;
+        const float* albedoB;
+        const float* normalX;
+        const float* normalY;
+        const float* normalZ;
+        const float* depth;
+
+        RowPlanes(const float* source, const float* guides, std::size_t planeSize, std::size_t offset)
+            : colourR(source + offset)
+            , colourG(source + planeSize + offset)
+            , colourB(source + planeSize * 2 + offset)
+            , variance(source + planeSize * 3 + offset)
+            , albedoR(guides + planeSize * Core::Denoiser::AlbedoR + offset)
+            , albedoG(guides + planeSize * Core::Denoiser::AlbedoG + offset)
+            , albedoB(guides + planeSize * Core::Denoiser::AlbedoB + offset)
+            , normalX(guides + planeSize * Core::Denoiser::NormalX + offset)
+            , normalY(guides + planeSize * Core::Denoiser::NormalY + offset)
+            , normalZ(guides + planeSize * Core::Denoiser::NormalZ + offset)
+            , depth(guides + planeSize * Core::Denoiser::Depth + offset) {}
+    };
+
+    float luminance(float r, float g, float b) { return 0.2126f * r + 0.7152f * g + 0.0722f * b; }
+
+    /**
+     * Add one tap to count pixels of a row. p holds the pixels and q their taps, offset by the tap's spacing.
+     * The loop is branch free over plain arrays indexed by std::size_t, which is what lets the compiler vectorize it.
+     * The sums are __restrict parameters, otherwise the compiler would check each of them against every plane for
+     * overlap, which is too many checks to vectorize.
+     */
+    void accumulateTap(RowPlanes p,
+                       RowPlanes q,
+                       std::size_t count,
+                       float kernelWeight,
+                       float normalPhi,
+                       float albedoPhi,
+                       const float* colourScales,
+                       const float* depthScales,
+                       float* __restrict weights,
+                       float* __restrict sumR,
+                       float* __restrict sumG,
+                       float* __restrict sumB,
+                       float* __restrict sumVariance) {
+        for (std::size_t x = 0; x < count; x++) {
+            float luminanceDelta = luminance(p.colourR[x], p.colourG[x], p.colourB[x]) - luminance(q.colourR[x], q.colourG[x], q.colourB[x]);
+            float albedoR = p.albedoR[x] - q.albedoR[x];
+            float albedoG = p.albedoG[x] - q.albedoG[x];
+            float albedoB = p.albedoB[x] - q.albedoB[x];
+            float normalX = p.normalX[x] - q.normalX[x];
+            float normalY = p.normalY[x] - q.normalY[x];
+            float normalZ = p.normalZ[x] - q.normalZ[x];
+            float depthDelta = p.depth[x] - q.depth[x];
+
+            float exponent = luminanceDelta * luminanceDelta * colourScales[x] + depthDelta * depthDelta * depthScales[x]
+                             + (normalX * normalX + normalY * normalY + normalZ * normalZ) * normalPhi
+                             + (albedoR * albedoR + albedoG * albedoG + albedoB * albedoB) * albedoPhi;
+            float weight = kernelWeight * approximateExpNegative(exponent);
+
+            weights[x] += weight;
+            sumR[x] += weight * q.colourR[x];
+            sumG[x] += weight * q.colourG[x];
+            sumB[x] += weight * q.colourB[x];
+            sumVariance[x] += weight * weight * q.variance[x];
+        }
+    }
+
+    /**
+     * The 3x3 average of a row of the variance plane. Few samples can all happen to be alike, eg. every path of a
+     * pixel may miss the light, and the neighbours' estimates keep such a pixel from rejecting every tap as an edge.
+     */
+    void blurVariance(const float* variance, std::size_t width, std::size_t height, std::size_t y, float* out) {
+        const float* above = variance + (y > 0 ? y - 1 : y) * width;
+        const float* centre = variance + y * width;
+        const float* below = variance + (y + 1 < height ? y + 1 : y) * width;
+        for (std::size_t x = 0; x < width; x++) {
+            out[x] = above[x] + centre[x] + below[x];
+        }
+
+        // Edges repeat their outermost column, as the rows above repeat the first row
+        float previous = out[0];
+        for (std::size_t x = 0; x < width; x++) {
+            float current = out[x];
+            float next = x + 1 < width ? out[x + 1] : current;
+            out[x] = (previous + current + next) * (1.0f / 9.0f);
+            previous = current;
+        }
+    }
+
+    /// Divide a row's sums by their weights, which are never zero as the centre tap always has full weight
+    void normalizeRow(std::size_t width,
+                      const RowSums& sums,
+                      float* __restrict colourR,
+                      float* __restrict colourG,
+                      float* __restrict colourB,
+                      float* __restrict variance) {
+        for (std::size_t x = 0; x < width; x++) {
+            float inverseWeight = 1.0f / sums.weights[x];
+            colourR[x] = sums.colourR[x] * inverseWeight;
+            colourG[x] = sums.colourG[x] * inverseWeight;
+            colourB[x] = sums.colourB[x] * inverseWeight;
+            variance[x] = sums.variances[x] * inverseWeight * inverseWeight;
+        }
+    }
+
+    void waitForAll(std::vector<std::future<void>>& tasks) {
+        // Every task is waited for before the first failure is rethrown, since the others still reference the planes
+        for (std::future<void>& task : tasks) {
+            task.wait();
+        }
+        for (std::future<void>& task : tasks) {
+            task.get();
+        }
+    }
+}
+
+namespace Core {
+
+    Denoiser::Denoiser(uint32_t width, uint32_t height) { resize(width, height); }
+
+    Denoiser::~Denoiser() = default;
+
+    void Denoiser::resize(uint32_t width, uint32_t height) {
+        m_width = width;
+        m_height = height;
+        std::size_t planeSize = std::size_t(width) * height;
+        m_inputs.assign(planeSize * PlaneCount, 0.0f);
+        for (std::vector<float>& planes : m_iterationPlanes) {
+            planes.assign(planeSize * FILTERED_PLANE_COUNT, 0.0f);
+        }
+        m_output = m_inputs.data();
+    }
+
+    void Denoiser::setSettings(const DenoiserSettings& settings) { m_settings = settings; }
+
+    const DenoiserSettings& Denoiser::getSettings() const { return m_settings; }
+
+    uint32_t Denoiser::getWidth() const { return m_width; }
+
+    uint32_t Denoiser::getHeight() const { return m_height; }
+
+    void Denoiser::setPixel(uint32_t x, uint32_t y, glm::vec3 colour, float variance, glm::vec3 albedo, glm::vec3 normal, float depth) {
+        std::size_t planeSize = std::size_t(m_width) * m_height;
+        float* pixel = m_inputs.data() + std::size_t(y) * m_width + x;
+        const float values[PlaneCount] = {colour.r, colour.g, colour.b, variance, albedo.r, albedo.g, albedo.b, normal.x, normal.y, normal.z, depth};
+        for (uint32_t plane = 0; plane < PlaneCount; plane++) {
+            pixel[plane * planeSize] = values[plane];
+        }
+    }
+
+    std::span<const float> Denoiser::getInputs() const { return m_inputs; }
+
+    void Denoiser::denoise(ThreadPool& workers) {
+        auto start = std::chrono::steady_clock::now();
+
+        const float* source = m_inputs.data();
+        std::vector<std::future<void>> tasks;
+        for (uint32_t iteration = 0; iteration < m_settings.iterations; iteration++) {
+            float* destination = m_iterationPlanes[iteration % 2].data();
+            tasks.clear();
+            for (uint32_t row = 0; row < m_height; row += ROWS_PER_TASK) {
+                uint32_t lastRow = std::min(row + ROWS_PER_TASK, m_height);
+                tasks.push_back(workers.submit([this, row, lastRow, iteration, source, destination]() { filterRows(row, lastRow, iteration, source, destination); }));
+            }
+            // Each iteration reads the whole of the last
+            waitForAll(tasks);
+            source = destination;
+        }
+        m_output = source;
+
+        m_lastTime = std::chrono::steady_clock::now() - start;
+        m_timeSum += m_lastTime;
+        m_denoises++;
+    }
+
+    glm::vec3 Denoiser::getColour(uint32_t x, uint32_t y) const {
+        std::size_t planeSize = std::size_t(m_width) * m_height;
+        const float* pixel = m_output + std::size_t(y) * m_width + x;
+        return glm::vec3(pixel[0], pixel[planeSize], pixel[planeSize * 2]);
+    }
+
+    void Denoiser::resolveRows(uint32_t firstRow, uint32_t rowCount, uint8_t* out, std::size_t rowPitch, bool bgra, float exposure) const {
+        for (uint32_t y = firstRow; y < firstRow + rowCount; y++) {
+            uint8_t* row = out + std::size_t(y - firstRow) * rowPitch;
+            for (uint32_t x = 0; x < m_width; x++) {
+                toneMapPixel(getColour(x, y), exposure, bgra, row + x * 4);
+            }
+        }
+    }
+
+    Denoiser::Stats Denoiser::getStats() const {
+        Stats stats{};
+        stats.denoises = m_denoises;
+        stats.lastTime = m_lastTime;
+        if (m_denoises > 0) {
+            stats.averageTime = m_timeSum / static_cast<double>(m_denoises);
+        }
+        return stats;
+    }
+
+    void Denoiser::resetStats() {
+        m_denoises = 0;
+        m_timeSum = TimeDelta::zero();
+    }
+
+    void Denoiser::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        out << "CPU denoiser: " << m_settings.iterations << " iterations, " << stats.averageTime.count() * 1000.0 << " ms average over "
+            << stats.denoises << " denoises, " << stats.lastTime.count() * 1000.0 << " ms last" << std::endl;
+    }
+
+    void Denoiser::filterRows(uint32_t firstRow, uint32_t lastRow, uint32_t iteration, const float* source, float* destination) const {
+        thread_local RowSums sums;
+
+        std::size_t width = m_width;
+        std::size_t planeSize = width * m_height;
+        const float* guides = m_inputs.data();
+        int32_t step = 1 << iteration;
+
+        // The noise of the filtered colour falls each iteration, and the variance plane follows it
+        float colourScale = 1.0f / (m_settings.colourSigma * m_settings.colourSigma);
+        // Depth changes more between taps that are further apart, so its difference is taken per pixel of spacing
+        float depthPhi = m_settings.depthPhi / float(step * step);
+
+        for (uint32_t y = firstRow; y < lastRow; y++) {
+            std::size_t row = std::size_t(y) * width;
+            sums.reset(width);
+            blurVariance(source + planeSize * Variance, width, m_height, y, sums.colourScales.data());
+            const float* depth = guides + planeSize * Depth + row;
+            for (std::size_t x = 0; x < width; x++) {
+                sums.colourScales[x] = colourScale / (sums.colourScales[x] + VARIANCE_EPSILON);
+                // Relative, so that distant surfaces are not split apart by their larger depth steps
+                sums.depthScales[x] = depthPhi / (depth[x] * depth[x] + DEPTH_EPSILON);
+            }
+
+            for (int32_t tapY = -2; tapY <= 2; tapY++) {
+                int32_t sourceY = int32_t(y) + tapY * step;
+                if (sourceY < 0 || sourceY >= int32_t(m_height)) {
+                    continue; // Taps outside the image are left out, and the weights are normalized without them
+                }
+                for (int32_t tapX = -2; tapX <= 2; tapX++) {
+                    // Only the columns whose tap lands inside the image
+                    int32_t offset = tapX * step;
+                    std::size_t begin = std::size_t(std::max(-offset, 0));
+                    std::size_t end = std::size_t(std::clamp(int32_t(width) - offset, 0, int32_t(width)));
+                    if (begin >= end) {
+                        continue;
+                    }
+                    RowPlanes pixels(source, guides, planeSize, row + begin);
+                    RowPlanes taps(source, guides, planeSize, std::size_t(sourceY) * width + std::size_t(std::ptrdiff_t(begin) + offset));
+                    float kernelWeight = KERNEL[tapX + 2] * KERNEL[tapY + 2];
+                    accumulateTap(pixels,
+                                  taps,
+                                  end - begin,
+                                  kernelWeight,
+                                  m_settings.normalPhi,
+                                  m_settings.albedoPhi,
+                                  sums.colourScales.data() + begin,
+                                  sums.depthScales.data() + begin,
+                                  sums.weights.data() + begin,
+                                  sums.colourR.data() + begin,
+                                  sums.colourG.data() + begin,
+                                  sums.colourB.data() + begin,
+                                  sums.variances.data() + begin);
+                }
+            }
+
+            normalizeRow(width,
+                         sums,
+                         destination + row,
+                         destination + planeSize + row,
+                         destination + planeSize * 2 + row,
+                         destination + planeSize * 3 + row);
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#include "Core/DynamicRendering.hpp"
+
+#include <stdexcept>
+
+namespace Core {
+
+    DynamicRendering::DynamicRendering(vk::Device& device, bool enabled)
+        : m_enabled(enabled) {
+        if (m_enabled) {
+            m_cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(device.getProcAddr("vkCmdBeginRenderingKHR"));
+            m_cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(device.getProcAddr("vkCmdEndRenderingKHR"));
+            if (!m_cmdBeginRendering || !m_cmdEndRendering) {
+                throw std::runtime_error("Couldn't load the dynamic rendering commands");
+            }
+        }
+    }
+
+    DynamicRendering::~DynamicRendering() = default;
+
+    bool DynamicRendering::isEnabled() const { return m_enabled; }
+
+    void DynamicRendering::begin(vk::CommandBuffer& buffer, const vk::RenderingInfoKHR& renderingInfo) const {
+        if (!m_enabled) {
+            throw std::runtime_error("Dynamic rendering is not enabled on this device");
+        }
+        m_cmdBeginRendering(buffer, reinterpret_cast<const VkRenderingInfoKHR*>(&renderingInfo));
+    }
+
+    void DynamicRendering::end(vk::CommandBuffer& buffer) const {
+        if (!m_enabled) {
+            throw std::runtime_error("Dynamic rendering is not enabled on this device");
+        }
+        m_cmdEndRendering(buffer);
+    }
+}
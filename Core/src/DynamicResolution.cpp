@@ -0,0 +1,192 @@
+#include "Core/DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+    constexpr uint32_t TIMESTAMPS_PER_SLOT = 2;
+
+    /// Keeps a scale that is a multiple of the step from rounding down to the one below
+    constexpr float STEP_EPSILON = 1e-4f;
+
+    uint32_t scaleLength(uint32_t length, float scale) { return std::max(static_cast<uint32_t>(std::lround(length * scale)), 1u); }
+}
+
+namespace Core {
+
+    DynamicResolution::DynamicResolution(Renderer& renderer, const DynamicResolutionSettings& settings)
+        : m_device(renderer.getDevice()) {
+        setSettings(settings);
+
+        // Queues without valid timestamp bits cannot be timed, so the scale stays where it is and the stats say so
+        uint32_t family = renderer.getQueue(QueueType::Graphics).familyIndex;
+        m_timestampsSupported = renderer.getPhysicalDevice().getQueueFamilyProperties()[family].timestampValidBits > 0;
+        m_timestampPeriod = renderer.getPhysicalDevice().getProperties().limits.timestampPeriod;
+    }
+
+    DynamicResolution::~DynamicResolution() {
+        if (m_queryPool) {
+            m_device.destroyQueryPool(m_queryPool);
+        }
+    }
+
+    void DynamicResolution::setSettings(const DynamicResolutionSettings& settings) {
+        if (!(settings.minScale > 0.0f && settings.minScale <= settings.maxScale && settings.scaleStep > 0.0f && settings.fixedScale > 0.0f)) {
+            throw std::runtime_error("Dynamic resolution needs a positive step and fixed scale, and a minimum scale above zero and at most the maximum");
+        }
+        m_settings = settings;
+        m_scale = settings.maxScale;
+        m_framesWithRoom = 0;
+    }
+
+    const DynamicResolutionSettings& DynamicResolution::getSettings() const { return m_settings; }
+
+    void DynamicResolution::setEnabled(bool enabled) {
+        m_enabled = enabled;
+        m_framesWithRoom = 0;
+    }
+
+    bool DynamicResolution::isEnabled() const { return m_enabled; }
+
+    void DynamicResolution::resize(std::size_t slotCount) {
+        if (m_queryPool) {
+            m_device.destroyQueryPool(m_queryPool);
+        }
+        vk::QueryPoolCreateInfo queryInfo{
+            vk::QueryPoolCreateFlags(),
+            vk::QueryType::eTimestamp,
+            static_cast<uint32_t>(slotCount * TIMESTAMPS_PER_SLOT),
+            vk::QueryPipelineStatisticFlags(),
+        };
+        m_queryPool = m_device.createQueryPool(queryInfo);
+        m_submitted.assign(slotCount, false);
+    }
+
+    float DynamicResolution::getScale() const { return m_enabled ? m_scale : m_settings.fixedScale; }
+
+    vk::Extent2D DynamicResolution::getRenderExtent(vk::Extent2D outputExtent) const {
+        float scale = getScale();
+        return vk::Extent2D(scaleLength(outputExtent.width, scale), scaleLength(outputExtent.height, scale));
+    }
+
+    vk::Extent2D DynamicResolution::getTargetExtent(vk::Extent2D outputExtent) const {
+        // Rounding up, so the largest scale's rounded extent always fits
+        float scale = std::max({m_settings.maxScale, m_settings.fixedScale, 1.0f});
+        return vk::Extent2D(static_cast<uint32_t>(std::ceil(outputExtent.width * scale)), static_cast<uint32_t>(std::ceil(outputExtent.height * scale)));
+    }
+
+    void DynamicResolution::recordBegin(vk::CommandBuffer& buffer, std::size_t slot) const {
+        uint32_t firstQuery = static_cast<uint32_t>(slot * TIMESTAMPS_PER_SLOT);
+        buffer.resetQueryPool(m_queryPool, firstQuery, TIMESTAMPS_PER_SLOT);
+        buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_queryPool, firstQuery);
+    }
+
+    void DynamicResolution::recordEnd(vk::CommandBuffer& buffer, std::size_t slot) const {
+        buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_queryPool, static_cast<uint32_t>(slot * TIMESTAMPS_PER_SLOT + 1));
+    }
+
+    void DynamicResolution::frameSubmitted(std::size_t slot) { m_submitted[slot] = true; }
+
+    bool DynamicResolution::collectCompleted() {
+        float previousScale = getScale();
+        for (std::size_t slot = 0; slot < m_submitted.size(); slot++) {
+            if (!m_submitted[slot]) {
+                continue;
+            }
+            m_submitted[slot] = false;
+            if (!m_timestampsSupported) {
+                continue;
+            }
+
+            uint64_t timestamps[TIMESTAMPS_PER_SLOT];
+            vk::Result result = m_device.getQueryPoolResults(m_queryPool,
+                                                             static_cast<uint32_t>(slot * TIMESTAMPS_PER_SLOT),
+                                                             TIMESTAMPS_PER_SLOT,
+                                                             sizeof(timestamps),
+                                                             timestamps,
+                                                             sizeof(uint64_t),
+                                                             vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+            if (result != vk::Result::eSuccess) {
+                throw std::runtime_error("Failed to read the frame timestamps: " + vk::to_string(result));
+            }
+            update(TimeDelta((timestamps[1] - timestamps[0]) * m_timestampPeriod * 1e-9));
+        }
+        return getScale() != previousScale;
+    }
+
+    DynamicResolution::Stats DynamicResolution::getStats() const {
+        Stats stats = m_stats;
+        if (stats.frames > 0) {
+            stats.averageScale = static_cast<float>(m_scaleSum / static_cast<double>(stats.frames));
+            stats.averageGpuTime = m_gpuTimeSum / static_cast<double>(stats.frames);
+        }
+        return stats;
+    }
+
+    void DynamicResolution::resetStats() {
+        m_stats = Stats{};
+        m_scaleSum = 0.0;
+        m_gpuTimeSum = TimeDelta::zero();
+    }
+
+    void DynamicResolution::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        out << "Dynamic resolution (" << (m_enabled ? "" : "disabled, ") << m_settings.targetFrameTime.count() * 1000.0 << " ms budget): ";
+        if (!m_timestampsSupported) {
+            out << "the queue does not support timestamps, scale " << getScale() << std::endl;
+            return;
+        }
+        out << stats.frames << " frames, " << stats.framesOverBudget << " over budget, " << stats.averageGpuTime.count() * 1000.0 << " ms average GPU time, "
+            << stats.peakGpuTime.count() * 1000.0 << " ms peak, scale " << stats.lastScale << " (" << stats.averageScale << " average), "
+            << stats.scaleChanges << " changes" << std::endl;
+    }
+
+    float DynamicResolution::quantize(float scale) const {
+        float stepped = std::floor(scale / m_settings.scaleStep + STEP_EPSILON) * m_settings.scaleStep;
+        return std::clamp(stepped, m_settings.minScale, m_settings.maxScale);
+    }
+
+    void DynamicResolution::update(TimeDelta gpuTime) {
+        float scale = getScale();
+        m_stats.frames++;
+        m_stats.lastScale = scale;
+        m_stats.lastGpuTime = gpuTime;
+        m_stats.peakGpuTime = std::max(m_stats.peakGpuTime, gpuTime);
+        m_scaleSum += scale;
+        m_gpuTimeSum += gpuTime;
+        bool overBudget = gpuTime > m_settings.targetFrameTime;
+        if (overBudget) {
+            m_stats.framesOverBudget++;
+        }
+        if (!m_enabled || gpuTime <= TimeDelta::zero()) {
+            return;
+        }
+
+        // The cost of a frame mostly grows with its pixel count, the square of the scale
+        double budget = m_settings.targetFrameTime.count() * m_settings.headroom;
+        float fittingScale = scale * static_cast<float>(std::sqrt(budget / gpuTime.count()));
+
+        if (overBudget) {
+            // Rounded down, so the next frame is expected to fit
+            m_framesWithRoom = 0;
+            float lower = quantize(fittingScale);
+            if (lower < m_scale) {
+                m_scale = lower;
+                m_stats.scaleChanges++;
+            }
+            return;
+        }
+
+        float larger = quantize(scale + m_settings.scaleStep);
+        if (larger <= scale || fittingScale < larger) {
+            m_framesWithRoom = 0;
+            return;
+        }
+        if (++m_framesWithRoom >= m_settings.increaseDelay) {
+            m_scale = larger;
+            m_framesWithRoom = 0;
+            m_stats.scaleChanges++;
+        }
+    }
+}
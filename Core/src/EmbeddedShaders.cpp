@@ -0,0 +1,36 @@
+#include "Core/EmbeddedShaders.hpp"
+
+#include <unordered_map>
+
+namespace {
+    /// A function local static, so it exists before any registration runs, whatever the static initialization order
+    std::unordered_map<std::string_view, std::span<const uint32_t>>& getRegistry() {
+        static std::unordered_map<std::string_view, std::span<const uint32_t>> registry;
+        return registry;
+    }
+}
+
+namespace Core {
+
+    EmbeddedShaderRegistration::EmbeddedShaderRegistration(const char* name, std::span<const uint32_t> code) {
+        // Only written during static initialization, so lookups need no lock
+        getRegistry()[name] = code;
+    }
+
+    std::optional<std::span<const uint32_t>> findEmbeddedShader(std::string_view name) {
+        auto shader = getRegistry().find(name);
+        if (shader == getRegistry().end()) {
+            return std::nullopt;
+        }
+        return shader->second;
+    }
+
+    std::vector<std::string_view> getEmbeddedShaderNames() {
+        std::vector<std::string_view> names;
+        names.reserve(getRegistry().size());
+        for (const auto& [name, code] : getRegistry()) {
+            names.push_back(name);
+        }
+        return names;
+    }
+}
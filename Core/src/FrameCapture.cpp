@@ -0,0 +1,239 @@
+#include "Core/FrameCapture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace Core {
+
+    FrameCapture::FrameCapture(MemoryAllocator& allocator, std::string pathPrefix, ImageFileFormat format, std::size_t maxPendingFrames, std::size_t threadCount)
+        : FrameCapture(
+              allocator,
+              to_string(format),
+              [pathPrefix = std::move(pathPrefix), format](uint64_t frameNumber, ImageRGBA8& image) {
+                  std::ostringstream path;
+                  path << pathPrefix << std::setw(6) << std::setfill('0') << frameNumber << getFileExtension(format);
+                  return writeImage(path.str(), image, format);
+              },
+              true,
+              maxPendingFrames,
+              threadCount) {}
+
+    FrameCapture::FrameCapture(
+        MemoryAllocator& allocator, std::string description, FrameWriter writer, bool dropWhenBehind, std::size_t maxPendingFrames, std::size_t threadCount)
+        : m_allocator(allocator)
+        , m_description(std::move(description))
+        , m_writer(std::move(writer))
+        , m_dropWhenBehind(dropWhenBehind)
+        , m_maxPendingFrames(std::max<std::size_t>(maxPendingFrames, 1))
+        , m_workers(threadCount) {}
+
+    FrameCapture::~FrameCapture() {
+        collectCompleted();
+        m_workers.waitIdle();
+        destroySlots();
+    }
+
+    void FrameCapture::setEnabled(bool enabled) { m_enabled = enabled; }
+
+    bool FrameCapture::isEnabled() const { return m_enabled; }
+
+    void FrameCapture::resize(vk::Extent2D extent, vk::Format format, std::size_t slotCount) {
+        bool swizzleBgra;
+        switch (format) {
+        case vk::Format::eR8G8B8A8Unorm:
+        case vk::Format::eR8G8B8A8Srgb:
+            swizzleBgra = false;
+            break;
+        case vk::Format::eB8G8R8A8Unorm:
+        case vk::Format::eB8G8R8A8Srgb:
+            swizzleBgra = true;
+            break;
+        default:
+            throw std::runtime_error("Frame capture does not support the format " + vk::to_string(format));
+        }
+
+        // Frames still in the slots were copied from the old format, so are converted with its swizzle
+        collectCompleted();
+        destroySlots();
+        m_swizzleBgra = swizzleBgra;
+        m_extent = extent;
+
+        vk::BufferCreateInfo bufferInfo{
+            vk::BufferCreateFlags(),
+            vk::DeviceSize(extent.width) * extent.height * 4,
+            vk::BufferUsageFlagBits::eTransferDst,
+            vk::SharingMode::eExclusive,
+        };
+        vma::AllocationCreateInfo allocationInfo{
+            vma::AllocationCreateFlagBits::eMapped,
+            vma::MemoryUsage::eGpuToCpu, // Prefers cached memory, which the host reads back quickly
+        };
+        m_slots.resize(slotCount);
+        for (Slot& slot : m_slots) {
+            std::tie(slot.buffer, slot.allocation) = m_allocator.createBuffer(bufferInfo, allocationInfo, AllocationCategory::Staging);
+            slot.data = static_cast<const uint8_t*>(m_allocator.getHandle().getAllocationInfo(slot.allocation).pMappedData);
+        }
+
+        // Pixel storage is sized for the old extent
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_freePixels.clear();
+    }
+
+    void FrameCapture::recordCopy(vk::CommandBuffer& buffer, std::size_t slot, vk::Image source) const {
+        vk::BufferImageCopy region{
+            0,
+            0, // Rows are tightly packed
+            0,
+            vk::ImageSubresourceLayers{
+                vk::ImageAspectFlagBits::eColor,
+                0,
+                0,
+                1,
+            },
+            vk::Offset3D(0, 0, 0),
+            vk::Extent3D(m_extent, 1),
+        };
+        buffer.copyImageToBuffer(source, vk::ImageLayout::eTransferSrcOptimal, m_slots[slot].buffer, 1, &region);
+
+        // The host reads the slot once the frame's fence has signalled
+        vk::BufferMemoryBarrier hostReadBarrier{
+            vk::AccessFlagBits::eTransferWrite,
+            vk::AccessFlagBits::eHostRead,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            m_slots[slot].buffer,
+            0,
+            VK_WHOLE_SIZE,
+        };
+        buffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, vk::DependencyFlags(), 0, nullptr, 1, &hostReadBarrier, 0, nullptr);
+    }
+
+    void FrameCapture::frameSubmitted(std::size_t slot) {
+        m_slots[slot].submitted = true;
+        m_slots[slot].frameNumber = m_nextFrameNumber++;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.submittedFrames++;
+    }
+
+    void FrameCapture::collectCompleted() {
+        // Frames are handed over in the order they were submitted, which writers such as streams rely on
+        std::vector<Slot*> completed;
+        for (Slot& slot : m_slots) {
+            if (slot.submitted) {
+                completed.push_back(&slot);
+            }
+        }
+        std::sort(completed.begin(), completed.end(), [](const Slot* a, const Slot* b) { return a->frameNumber < b->frameNumber; });
+
+        std::size_t imageSize = std::size_t(m_extent.width) * m_extent.height * 4;
+        for (Slot* completedSlot : completed) {
+            Slot& slot = *completedSlot;
+            slot.submitted = false;
+
+            ImageRGBA8 image{m_extent.width, m_extent.height, {}};
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (m_pendingFrames >= m_maxPendingFrames) {
+                    // Waiting for the workers stalls the next frame, so by default the frame is dropped instead
+                    if (m_dropWhenBehind) {
+                        m_stats.droppedFrames++;
+                        continue;
+                    }
+                    auto start = std::chrono::steady_clock::now();
+                    m_frameWritten.wait(lock, [this]() { return m_pendingFrames < m_maxPendingFrames; });
+                    m_stats.blockedTime += std::chrono::steady_clock::now() - start;
+                }
+                m_pendingFrames++;
+                m_stats.peakPendingFrames = std::max(m_stats.peakPendingFrames, static_cast<uint32_t>(m_pendingFrames));
+                if (!m_freePixels.empty()) {
+                    image.pixels = std::move(m_freePixels.back());
+                    m_freePixels.pop_back();
+                }
+            }
+
+            // The slot is reused by the next frame that submits it, so its pixels are copied out now
+            m_allocator.getHandle().invalidateAllocation(slot.allocation, 0, VK_WHOLE_SIZE);
+            image.pixels.resize(imageSize);
+            std::memcpy(image.pixels.data(), slot.data, imageSize);
+
+            m_workers.submit([this, frameNumber = slot.frameNumber, swizzleBgra = m_swizzleBgra, image = std::move(image)]() mutable {
+                writeFrame(frameNumber, swizzleBgra, image);
+            });
+        }
+    }
+
+    void FrameCapture::waitIdle() { m_workers.waitIdle(); }
+
+    FrameCapture::Stats FrameCapture::getStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stats stats = m_stats;
+        if (stats.writtenFrames > 0) {
+            stats.averageWriteTime = m_writeTimeSum / static_cast<double>(stats.writtenFrames);
+        }
+        return stats;
+    }
+
+    void FrameCapture::resetStats() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats = Stats{};
+        m_writeTimeSum = TimeDelta::zero();
+    }
+
+    void FrameCapture::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        out << "Frame capture (" << m_description << "): " << stats.writtenFrames << " of " << stats.submittedFrames << " frames written, "
+            << stats.droppedFrames << " dropped, " << stats.failedFrames << " failed, " << stats.bytesWritten / (1024 * 1024) << " MiB, "
+            << stats.averageWriteTime.count() * 1000.0 << " ms average write, " << stats.peakPendingFrames << " peak pending, "
+            << stats.blockedTime.count() * 1000.0 << " ms blocked" << std::endl;
+    }
+
+    void FrameCapture::destroySlots() {
+        for (Slot& slot : m_slots) {
+            m_allocator.destroyBuffer(slot.buffer, slot.allocation);
+        }
+        m_slots.clear();
+    }
+
+    void FrameCapture::writeFrame(uint64_t frameNumber, bool swizzleBgra, ImageRGBA8& image) {
+        auto start = std::chrono::steady_clock::now();
+        std::size_t bytes = 0;
+        bool failed = false;
+        try {
+            if (swizzleBgra) {
+                for (std::size_t i = 0; i < image.pixels.size(); i += 4) {
+                    std::swap(image.pixels[i], image.pixels[i + 2]);
+                }
+            }
+            bytes = m_writer(frameNumber, image);
+        } catch (const std::exception& error) {
+            failed = true;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // A sequence that cannot be written usually fails on every frame, so only the first is reported
+            if (!m_reportedFailure) {
+                std::cerr << "Frame capture failed: " << error.what() << std::endl;
+                m_reportedFailure = true;
+            }
+        }
+        TimeDelta writeTime = std::chrono::steady_clock::now() - start;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingFrames--;
+        if (failed) {
+            m_stats.failedFrames++;
+        } else {
+            m_stats.writtenFrames++;
+            m_stats.bytesWritten += bytes;
+            m_writeTimeSum += writeTime;
+        }
+        m_freePixels.push_back(std::move(image.pixels));
+        m_frameWritten.notify_one();
+    }
+}
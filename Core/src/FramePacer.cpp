@@ -0,0 +1,202 @@
+#include "Core/FramePacer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    /// Mailbox displays the newest frame without tearing, which suits low latency too
+    const vk::PresentModeKHR BALANCED_PRESENT_MODES[] = {
+        vk::PresentModeKHR::eMailbox,
+        vk::PresentModeKHR::eImmediate,
+        vk::PresentModeKHR::eFifoRelaxed,
+    };
+
+    /// Immediate never holds a frame back, so the GPU is kept busiest
+    const vk::PresentModeKHR THROUGHPUT_PRESENT_MODES[] = {
+        vk::PresentModeKHR::eImmediate,
+        vk::PresentModeKHR::eMailbox,
+        vk::PresentModeKHR::eFifoRelaxed,
+    };
+
+    /// How long a low latency frame waits for the previous one to display, before giving up on it
+    constexpr uint64_t DISPLAY_TIMEOUT_NANOSECONDS = 100'000'000;
+
+    /// Frames may be presented faster than they are checked, so only so many are remembered
+    constexpr std::size_t MAX_PRESENTED_FRAMES = 16;
+
+    /// Slack left by CPU pacing for the frame's work to vary
+    constexpr Core::TimeDelta CPU_PACING_MARGIN = std::chrono::microseconds(1500);
+
+    void smooth(Core::TimeDelta& average, Core::TimeDelta sample) {
+        if (average == Core::TimeDelta::zero()) {
+            average = sample;
+        } else {
+            average += (sample - average) * 0.1;
+        }
+    }
+
+    double toMilliseconds(Core::TimeDelta delta) { return delta.count() * 1000.0; }
+}
+
+namespace Core {
+
+    const char* to_string(FramePacingProfile profile) {
+        switch (profile) {
+        case FramePacingProfile::Balanced:
+            return "Balanced";
+        case FramePacingProfile::LowLatency:
+            return "LowLatency";
+        case FramePacingProfile::Throughput:
+            return "Throughput";
+        }
+        return "Unknown";
+    }
+
+    FramePacer::FramePacer(vk::Device& device, bool presentWaitEnabled)
+        : m_device(device)
+        , m_presentWaitEnabled(presentWaitEnabled) {
+        if (m_presentWaitEnabled) {
+            m_waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(m_device.getProcAddr("vkWaitForPresentKHR"));
+            if (!m_waitForPresent) {
+                throw std::runtime_error("Couldn't load vkWaitForPresentKHR");
+            }
+        }
+    }
+
+    FramePacer::~FramePacer() = default;
+
+    bool FramePacer::isPresentWaitEnabled() const { return m_presentWaitEnabled; }
+
+    void FramePacer::setProfile(FramePacingProfile profile) { m_profile = profile; }
+
+    FramePacingProfile FramePacer::getProfile() const { return m_profile; }
+
+    std::span<const vk::PresentModeKHR> FramePacer::getPreferredPresentModes() const {
+        return m_profile == FramePacingProfile::Throughput ? std::span<const vk::PresentModeKHR>(THROUGHPUT_PRESENT_MODES)
+                                                           : std::span<const vk::PresentModeKHR>(BALANCED_PRESENT_MODES);
+    }
+
+    uint32_t FramePacer::getExtraImageCount() const { return m_profile == FramePacingProfile::Throughput ? 1 : 0; }
+
+    void FramePacer::beginFrame() {
+        if (m_presentWaitEnabled) {
+            // Low latency keeps no frame queued for display, so this frame's input is sampled as late as it can be
+            waitForDisplay(m_profile == FramePacingProfile::LowLatency ? DISPLAY_TIMEOUT_NANOSECONDS : 0);
+        } else if (m_profile == FramePacingProfile::LowLatency && m_presentInterval > TimeDelta::zero()) {
+            // Start late enough that the frame's work ends when the next present is due
+            auto target = m_lastPresent + std::chrono::duration_cast<TimePoint::duration>(m_presentInterval - m_frameWork - CPU_PACING_MARGIN);
+            if (target > std::chrono::high_resolution_clock::now()) {
+                std::this_thread::sleep_until(target);
+            }
+        }
+
+        TimePoint now = std::chrono::high_resolution_clock::now();
+        m_currentFrame = PendingFrame{0, now, now, now, now};
+    }
+
+    void FramePacer::acquireStarted() { m_currentFrame.acquireStarted = std::chrono::high_resolution_clock::now(); }
+
+    void FramePacer::imageAcquired() { m_currentFrame.acquired = std::chrono::high_resolution_clock::now(); }
+
+    vk::Result FramePacer::present(vk::Queue queue, const vk::PresentInfoKHR& presentInfo) {
+        vk::PresentInfoKHR taggedInfo = presentInfo;
+        vk::PresentIdKHR presentIdInfo;
+        uint64_t presentId = 0;
+        if (m_presentWaitEnabled) {
+            if (presentInfo.swapchainCount != 1) {
+                throw std::runtime_error("Frames can only be paced when presenting to a single swapchain");
+            }
+            presentId = m_nextPresentId++;
+            presentIdInfo = vk::PresentIdKHR{1, &presentId};
+            presentIdInfo.pNext = presentInfo.pNext;
+            taggedInfo.pNext = &presentIdInfo;
+        }
+        vk::Result result = queue.presentKHR(taggedInfo);
+
+        TimePoint now = std::chrono::high_resolution_clock::now();
+        if (m_lastPresent != TimePoint()) {
+            smooth(m_presentInterval, now - m_lastPresent);
+        }
+        // Pacing shortens the wait for an image, so planning from a work time that includes it would hardly delay the frame
+        smooth(m_frameWork, (now - m_currentFrame.start) - (m_currentFrame.acquired - m_currentFrame.acquireStarted));
+        m_lastPresent = now;
+
+        m_currentFrame.presentId = presentId;
+        m_currentFrame.presented = now;
+        if (m_presentWaitEnabled) {
+            m_presentedFrames.push_back(m_currentFrame);
+            if (m_presentedFrames.size() > MAX_PRESENTED_FRAMES) {
+                m_presentedFrames.pop_front();
+            }
+        } else {
+            // Most present modes queue a frame for about one interval before it is displayed
+            recordFrame(m_currentFrame, now + std::chrono::duration_cast<TimePoint::duration>(m_presentInterval), false);
+        }
+        return result;
+    }
+
+    void FramePacer::swapchainRecreated(vk::SwapchainKHR swapchain) {
+        m_swapchain = swapchain;
+        m_presentedFrames.clear();
+        // The time spent recreating is not a present interval
+        m_lastPresent = TimePoint();
+    }
+
+    FramePacer::FrameTiming FramePacer::getLastFrameTiming() const { return m_lastFrameTiming; }
+
+    FramePacer::Stats FramePacer::getStats() const {
+        Stats stats = m_stats;
+        if (stats.frames > 0) {
+            stats.averageAcquireToPresent = m_acquireToPresentSum / static_cast<double>(stats.frames);
+            stats.averageInputToDisplay = m_inputToDisplaySum / static_cast<double>(stats.frames);
+        }
+        stats.averagePresentInterval = m_presentInterval;
+        return stats;
+    }
+
+    void FramePacer::resetStats() {
+        m_stats = Stats{};
+        m_acquireToPresentSum = TimeDelta::zero();
+        m_inputToDisplaySum = TimeDelta::zero();
+    }
+
+    void FramePacer::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        out << "Frame pacing (" << to_string(m_profile) << "): " << stats.frames << " frames, acquire to present "
+            << toMilliseconds(stats.averageAcquireToPresent) << " ms, input to display " << toMilliseconds(stats.averageInputToDisplay) << " ms average "
+            << toMilliseconds(stats.maxInputToDisplay) << " ms max, present interval " << toMilliseconds(stats.averagePresentInterval) << " ms ("
+            << (stats.measuredFrames == stats.frames ? "measured" : "estimated") << ")" << std::endl;
+    }
+
+    void FramePacer::waitForDisplay(uint64_t timeout) {
+        while (!m_presentedFrames.empty()) {
+            const PendingFrame& frame = m_presentedFrames.front();
+            VkResult result = m_waitForPresent(m_device, m_swapchain, frame.presentId, timeout);
+            if (result == VK_TIMEOUT) {
+                return;
+            }
+            // Checked once a frame, so a frame found displayed was displayed at most a frame earlier
+            if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+                recordFrame(frame, std::chrono::high_resolution_clock::now(), true);
+            }
+            m_presentedFrames.pop_front();
+        }
+    }
+
+    void FramePacer::recordFrame(const PendingFrame& frame, TimePoint displayed, bool measured) {
+        m_lastFrameTiming = FrameTiming{
+            displayed - frame.acquired,
+            displayed - frame.start,
+            measured,
+        };
+
+        m_stats.frames++;
+        if (measured) {
+            m_stats.measuredFrames++;
+        }
+        m_acquireToPresentSum += m_lastFrameTiming.acquireToPresent;
+        m_inputToDisplaySum += m_lastFrameTiming.inputToDisplay;
+        m_stats.maxInputToDisplay = std::max(m_stats.maxInputToDisplay, m_lastFrameTiming.inputToDisplay);
+    }
+}
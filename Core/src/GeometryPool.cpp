@@ -0,0 +1,356 @@
+#include "Core/GeometryPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+namespace {
+    /// The staging buffer size. Many small meshes share one flush, and larger uploads are streamed through it in pieces.
+    constexpr vk::DeviceSize STAGING_SIZE = 16 * 1024 * 1024;
+}
+
+namespace Core {
+    GeometryPool::GeometryPool(Renderer& renderer, MemoryAllocator& allocator, uint32_t vertexStride, uint32_t verticesPerPage, uint32_t indicesPerPage)
+        : m_device(renderer.getDevice())
+        , m_graphicsQueue(renderer.getQueue(QueueType::Graphics))
+        , m_allocator(allocator)
+        , m_vertexStride(vertexStride)
+        , m_verticesPerPage(verticesPerPage)
+        , m_indicesPerPage(indicesPerPage) {
+        vk::CommandPoolCreateInfo commandPoolInfo{
+            vk::CommandPoolCreateFlagBits::eTransient,
+            m_graphicsQueue.familyIndex,
+        };
+        m_commandPool = m_device.createCommandPool(commandPoolInfo);
+    }
+
+    GeometryPool::~GeometryPool() {
+        // Anything still pending would reference buffers we are about to destroy
+        m_pendingCopies.clear();
+        destroyStaging();
+
+        for (std::unique_ptr<Page>& page : m_pages) {
+            destroyPage(*page);
+        }
+        m_device.destroyCommandPool(m_commandPool);
+    }
+
+    GeometryPool::Range GeometryPool::allocate(uint32_t vertexCount, uint32_t indexCount) {
+        for (uint32_t pageIndex = 0; pageIndex < m_pages.size(); pageIndex++) {
+            Page& page = *m_pages[pageIndex];
+
+            std::optional<RangeAllocator::Size> firstVertex = page.vertices.allocate(vertexCount);
+            if (!firstVertex) {
+                continue;
+            }
+
+            std::optional<RangeAllocator::Size> firstIndex = 0;
+            if (indexCount > 0) {
+                firstIndex = page.indices.allocate(indexCount);
+                if (!firstIndex) {
+                    page.vertices.free(*firstVertex);
+                    continue;
+                }
+            }
+
+            m_meshCount++;
+            return Range{
+                pageIndex,
+                static_cast<uint32_t>(*firstVertex),
+                vertexCount,
+                static_cast<uint32_t>(*firstIndex),
+                indexCount,
+            };
+        }
+
+        // Nothing has room, start a new page. It is sized so that the request is guaranteed to fit.
+        uint32_t pageIndex = m_pages.size();
+        Page& page = addPage(vertexCount, indexCount);
+        uint32_t firstVertex = page.vertices.allocate(vertexCount).value();
+        uint32_t firstIndex = indexCount > 0 ? page.indices.allocate(indexCount).value() : 0;
+
+        m_meshCount++;
+        return Range{
+            pageIndex,
+            firstVertex,
+            vertexCount,
+            firstIndex,
+            indexCount,
+        };
+    }
+
+    void GeometryPool::free(const Range& range) {
+        Page& page = *m_pages.at(range.page);
+        page.vertices.free(range.firstVertex);
+        if (range.indexCount > 0) {
+            page.indices.free(range.firstIndex);
+        }
+        m_meshCount--;
+    }
+
+    void GeometryPool::upload(const Range& range, const void* vertices, const uint32_t* indices) {
+        stage(range.page,
+              false,
+              static_cast<vk::DeviceSize>(range.firstVertex) * m_vertexStride,
+              vertices,
+              static_cast<vk::DeviceSize>(range.vertexCount) * m_vertexStride);
+
+        if (range.indexCount == 0) {
+            return;
+        }
+
+        stage(range.page,
+              true,
+              static_cast<vk::DeviceSize>(range.firstIndex) * sizeof(uint32_t),
+              indices,
+              static_cast<vk::DeviceSize>(range.indexCount) * sizeof(uint32_t));
+    }
+
+    void GeometryPool::flushUploads() {
+        if (m_pendingCopies.empty()) {
+            return;
+        }
+
+        m_allocator.getHandle().flushAllocation(m_stagingAllocation, 0, m_stagingUsed);
+
+        vk::CommandBufferAllocateInfo commandBufferInfo{
+            m_commandPool,
+            vk::CommandBufferLevel::ePrimary,
+            1,
+        };
+        vk::CommandBuffer commandBuffer = m_device.allocateCommandBuffers(commandBufferInfo)[0];
+        commandBuffer.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+        // Group the regions by destination so that each buffer gets a single copy command
+        std::sort(m_pendingCopies.begin(), m_pendingCopies.end(), [](const PendingCopy& a, const PendingCopy& b) {
+            return std::tie(a.page, a.index) < std::tie(b.page, b.index);
+        });
+        std::vector<vk::BufferCopy> regions;
+        for (std::size_t first = 0; first < m_pendingCopies.size();) {
+            std::size_t last = first;
+            regions.clear();
+            while (last < m_pendingCopies.size() && m_pendingCopies[last].page == m_pendingCopies[first].page &&
+                   m_pendingCopies[last].index == m_pendingCopies[first].index) {
+                regions.push_back(m_pendingCopies[last].region);
+                last++;
+            }
+
+            Page& page = *m_pages[m_pendingCopies[first].page];
+            vk::Buffer destination = m_pendingCopies[first].index ? page.indexBuffer : page.vertexBuffer;
+            commandBuffer.copyBuffer(m_stagingBuffer, destination, static_cast<uint32_t>(regions.size()), regions.data());
+
+            first = last;
+        }
+
+        // Make the new data visible to vertex input
+        vk::MemoryBarrier uploadBarrier{
+            vk::AccessFlagBits::eTransferWrite,
+            vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead,
+        };
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput, vk::DependencyFlags(), 1, &uploadBarrier, 0, nullptr, 0, nullptr);
+        commandBuffer.end();
+
+        vk::Fence fence = m_device.createFence(vk::FenceCreateInfo{});
+        vk::SubmitInfo submitInfo{
+            0,
+            nullptr,
+            nullptr,
+            1,
+            &commandBuffer,
+        };
+        m_graphicsQueue.queues[0].submit(1, &submitInfo, fence);
+        m_device.waitForFences(1, &fence, VK_TRUE, UINT64_MAX);
+        m_device.destroyFence(fence);
+        m_device.freeCommandBuffers(m_commandPool, 1, &commandBuffer);
+
+        m_pendingCopies.clear();
+        m_stagingUsed = 0;
+    }
+
+    void GeometryPool::bind(vk::CommandBuffer commandBuffer, uint32_t page, uint32_t vertexBinding) const {
+        const Page& boundPage = *m_pages.at(page);
+        vk::DeviceSize offset = 0;
+        commandBuffer.bindVertexBuffers(vertexBinding, 1, &boundPage.vertexBuffer, &offset);
+        if (boundPage.indexBuffer) {
+            commandBuffer.bindIndexBuffer(boundPage.indexBuffer, 0, vk::IndexType::eUint32);
+        }
+    }
+
+    void GeometryPool::draw(vk::CommandBuffer commandBuffer, const Range& range, uint32_t instanceCount, uint32_t firstInstance) const {
+        if (range.indexCount > 0) {
+            commandBuffer.drawIndexed(range.indexCount, instanceCount, range.firstIndex, static_cast<int32_t>(range.firstVertex), firstInstance);
+        } else {
+            commandBuffer.draw(range.vertexCount, instanceCount, range.firstVertex, firstInstance);
+        }
+    }
+
+    bool GeometryPool::bufferMoved(vma::Allocation allocation, vk::Buffer oldBuffer, vk::Buffer newBuffer) {
+        for (std::unique_ptr<Page>& page : m_pages) {
+            if (page->vertexAllocation == allocation && page->vertexBuffer == oldBuffer) {
+                page->vertexBuffer = newBuffer;
+                return true;
+            }
+            if (page->indexAllocation == allocation && page->indexBuffer == oldBuffer) {
+                page->indexBuffer = newBuffer;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t GeometryPool::getPageCount() const { return m_pages.size(); }
+    uint32_t GeometryPool::getVertexStride() const { return m_vertexStride; }
+
+    GeometryPool::Stats GeometryPool::getStats() const {
+        Stats stats{
+            static_cast<uint32_t>(m_pages.size()),
+            m_meshCount,
+            RangeAllocator::Stats{},
+            RangeAllocator::Stats{},
+        };
+
+        auto accumulate = [](RangeAllocator::Stats& total, const RangeAllocator::Stats& page) {
+            total.capacity += page.capacity;
+            total.usedUnits += page.usedUnits;
+            total.freeUnits += page.freeUnits;
+            total.largestFreeRange = std::max(total.largestFreeRange, page.largestFreeRange);
+            total.freeRangeCount += page.freeRangeCount;
+            total.allocationCount += page.allocationCount;
+        };
+        for (const std::unique_ptr<Page>& page : m_pages) {
+            accumulate(stats.vertices, page->vertices.getStats());
+            accumulate(stats.indices, page->indices.getStats());
+        }
+
+        return stats;
+    }
+
+    void GeometryPool::printStats(std::ostream& out) const {
+        auto printRange = [&out](const char* name, const RangeAllocator::Stats& stats) {
+            out << "        " << name << ": " << stats.usedUnits << " / " << stats.capacity;
+            out << " (" << stats.occupancy() * 100.0f << "% occupied, ";
+            out << stats.freeRangeCount << " free ranges, largest " << stats.largestFreeRange << ", ";
+            out << stats.fragmentation() * 100.0f << "% fragmented)" << std::endl;
+        };
+
+        Stats total = getStats();
+        out << "GeometryPool: " << total.meshCount << " meshes in " << total.pageCount << " pages" << std::endl;
+        for (std::size_t page = 0; page < m_pages.size(); page++) {
+            out << "    Page " << page << ":" << std::endl;
+            printRange("Vertices", m_pages[page]->vertices.getStats());
+            printRange("Indices", m_pages[page]->indices.getStats());
+        }
+    }
+
+    GeometryPool::Page& GeometryPool::addPage(uint32_t vertexCount, uint32_t indexCount) {
+        uint32_t vertexCapacity = std::max(m_verticesPerPage, vertexCount);
+        uint32_t indexCapacity = std::max(m_indicesPerPage, indexCount);
+
+        // Pages share blocks with other geometry, so that MemoryAllocator::defragment() can compact them, see bufferMoved()
+        vma::AllocationCreateInfo allocationInfo{
+            vma::AllocationCreateFlags(),
+            vma::MemoryUsage::eGpuOnly,
+        };
+
+        vk::BufferCreateInfo vertexBufferInfo{
+            vk::BufferCreateFlags(),
+            static_cast<vk::DeviceSize>(vertexCapacity) * m_vertexStride,
+            vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+            vk::SharingMode::eExclusive,
+        };
+        auto [vertexBuffer, vertexAllocation] = m_allocator.createBuffer(vertexBufferInfo, allocationInfo, AllocationCategory::Geometry);
+
+        vk::Buffer indexBuffer;
+        vma::Allocation indexAllocation;
+        if (indexCapacity > 0) {
+            vk::BufferCreateInfo indexBufferInfo{
+                vk::BufferCreateFlags(),
+                static_cast<vk::DeviceSize>(indexCapacity) * sizeof(uint32_t),
+                vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                vk::SharingMode::eExclusive,
+            };
+            std::tie(indexBuffer, indexAllocation) = m_allocator.createBuffer(indexBufferInfo, allocationInfo, AllocationCategory::Geometry);
+        }
+
+        m_pages.push_back(std::make_unique<Page>(Page{
+            vertexBuffer,
+            vertexAllocation,
+            RangeAllocator(vertexCapacity),
+            indexBuffer,
+            indexAllocation,
+            RangeAllocator(indexCapacity),
+        }));
+        return *m_pages.back();
+    }
+
+    void GeometryPool::destroyPage(Page& page) {
+        m_allocator.destroyBuffer(page.vertexBuffer, page.vertexAllocation);
+        if (page.indexBuffer) {
+            m_allocator.destroyBuffer(page.indexBuffer, page.indexAllocation);
+        }
+    }
+
+    void GeometryPool::stage(uint32_t page, bool index, vk::DeviceSize destinationOffset, const void* data, vk::DeviceSize size) {
+        const char* source = static_cast<const char*>(data);
+
+        // Chunks stay 4 byte aligned, as the staging offsets must be for index data
+        while (size > 0) {
+            vk::DeviceSize chunkSize = std::min(size, STAGING_SIZE);
+            vk::DeviceSize stagingOffset = reserveStaging(chunkSize);
+            memcpy(m_stagingData + stagingOffset, source, chunkSize);
+            m_pendingCopies.push_back(PendingCopy{
+                page,
+                index,
+                vk::BufferCopy{
+                    stagingOffset,
+                    destinationOffset,
+                    chunkSize,
+                },
+            });
+
+            source += chunkSize;
+            destinationOffset += chunkSize;
+            size -= chunkSize;
+        }
+    }
+
+    vk::DeviceSize GeometryPool::reserveStaging(vk::DeviceSize size) {
+        // Keep every region 4 byte aligned, as index data is copied as uint32_t
+        vk::DeviceSize offset = (m_stagingUsed + 3) & ~vk::DeviceSize(3);
+
+        if (offset + size > m_stagingCapacity) {
+            flushUploads();
+            offset = 0;
+
+            if (!m_stagingBuffer) {
+                m_stagingCapacity = STAGING_SIZE;
+                vk::BufferCreateInfo stagingBufferInfo{
+                    vk::BufferCreateFlags(),
+                    m_stagingCapacity,
+                    vk::BufferUsageFlagBits::eTransferSrc,
+                    vk::SharingMode::eExclusive,
+                };
+                vma::AllocationCreateInfo stagingAllocationInfo{
+                    vma::AllocationCreateFlagBits::eMapped,
+                    vma::MemoryUsage::eCpuOnly,
+                };
+                std::tie(m_stagingBuffer, m_stagingAllocation) =
+                    m_allocator.createBuffer(stagingBufferInfo, stagingAllocationInfo, AllocationCategory::Staging);
+                m_stagingData = static_cast<char*>(m_allocator.getHandle().getAllocationInfo(m_stagingAllocation).pMappedData);
+            }
+        }
+
+        m_stagingUsed = offset + size;
+        return offset;
+    }
+
+    void GeometryPool::destroyStaging() {
+        if (m_stagingBuffer) {
+            m_allocator.destroyBuffer(m_stagingBuffer, m_stagingAllocation);
+            m_stagingBuffer = vk::Buffer();
+            m_stagingData = nullptr;
+            m_stagingCapacity = 0;
+        }
+    }
+}
@@ -0,0 +1,311 @@
+#include "Core/ImageWriter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    /// Deflate's stored blocks hold at most this many bytes
+    constexpr std::size_t MAX_STORED_BLOCK = 65535;
+
+    /// Scanlines per EXR chunk without compression
+    constexpr uint32_t EXR_SCANLINES_PER_CHUNK = 1;
+
+    constexpr std::array<uint32_t, 256> makeCrcTable() {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+    constexpr std::array<uint32_t, 256> CRC_TABLE = makeCrcTable();
+
+    uint32_t crc32(const uint8_t* data, std::size_t size, uint32_t crc = 0) {
+        crc = ~crc;
+        for (std::size_t i = 0; i < size; i++) {
+            crc = CRC_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    template<typename T>
+    void appendLittleEndian(std::vector<uint8_t>& out, T value) {
+        for (std::size_t i = 0; i < sizeof(T); i++) {
+            out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8)));
+        }
+    }
+
+    void appendLittleEndian(std::vector<uint8_t>& out, float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        appendLittleEndian(out, bits);
+    }
+
+    void appendString(std::vector<uint8_t>& out, const char* text) {
+        out.insert(out.end(), text, text + std::strlen(text) + 1);
+    }
+
+    void appendPngChunk(std::vector<uint8_t>& out, const char type[4], const uint8_t* data, std::size_t size) {
+        appendBigEndian(out, static_cast<uint32_t>(size));
+        std::size_t crcStart = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data, data + size);
+        appendBigEndian(out, crc32(out.data() + crcStart, size + 4));
+    }
+
+    /// Round a float to half precision. Only normal values, zero and infinity are produced, which covers 8 bit colour.
+    uint16_t toHalf(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+        int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+        uint32_t mantissa = bits & 0x7FFFFF;
+
+        if (exponent <= 0) {
+            return sign;
+        }
+        if (exponent >= 31) {
+            return sign | 0x7C00;
+        }
+
+        // Round to nearest, a carry out of the mantissa correctly bumps the exponent
+        uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+        if (mantissa & 0x1000) {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | std::min<uint32_t>(half, 0x7C00));
+    }
+
+    /// Half precision linear values for each 8 bit sRGB value
+    std::array<uint16_t, 256> makeSrgbToHalfTable() {
+        std::array<uint16_t, 256> table{};
+        for (uint32_t i = 0; i < 256; i++) {
+            float encoded = static_cast<float>(i) / 255.0f;
+            float linear = encoded <= 0.04045f ? encoded / 12.92f : std::pow((encoded + 0.055f) / 1.055f, 2.4f);
+            table[i] = toHalf(linear);
+        }
+        return table;
+    }
+
+    std::size_t writeFile(const std::string& path, const std::vector<uint8_t>& contents) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Failed to create image " + path);
+        }
+        file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+        if (!file) {
+            throw std::runtime_error("Failed to write image " + path);
+        }
+        return contents.size();
+    }
+
+    void checkImage(const Core::ImageRGBA8& image) {
+        if (image.width == 0 || image.height == 0 || image.pixels.size() != std::size_t(image.width) * image.height * 4) {
+            throw std::runtime_error("Image pixels do not match its size");
+        }
+    }
+}
+
+namespace Core {
+
+    const char* to_string(ImageFileFormat format) {
+        switch (format) {
+        case ImageFileFormat::Png:
+            return "PNG";
+        case ImageFileFormat::Exr:
+            return "EXR";
+        }
+        return "Unknown";
+    }
+
+    const char* getFileExtension(ImageFileFormat format) {
+        switch (format) {
+        case ImageFileFormat::Png:
+            return ".png";
+        case ImageFileFormat::Exr:
+            return ".exr";
+        }
+        return "";
+    }
+
+    std::size_t writePng(const std::string& path, const ImageRGBA8& image) {
+        checkImage(image);
+
+        // Each row is prefixed by its filter type, none
+        std::size_t rowSize = std::size_t(image.width) * 4;
+        std::size_t rawSize = (rowSize + 1) * image.height;
+
+        // A zlib stream of stored deflate blocks, with no compression
+        std::vector<uint8_t> zlib;
+        zlib.reserve(2 + rawSize + (rawSize / MAX_STORED_BLOCK + 1) * 5 + 4);
+        zlib.push_back(0x78);
+        zlib.push_back(0x01);
+
+        uint32_t adlerA = 1;
+        uint32_t adlerB = 0;
+        std::size_t blockRemaining = 0;
+        std::size_t rawRemaining = rawSize;
+        auto appendRaw = [&](const uint8_t* data, std::size_t size) {
+            while (size > 0) {
+                if (blockRemaining == 0) {
+                    blockRemaining = std::min(rawRemaining, MAX_STORED_BLOCK);
+                    rawRemaining -= blockRemaining;
+                    zlib.push_back(rawRemaining == 0 ? 1 : 0);
+                    auto length = static_cast<uint16_t>(blockRemaining);
+                    appendLittleEndian(zlib, length);
+                    appendLittleEndian(zlib, static_cast<uint16_t>(~length));
+                }
+                std::size_t count = std::min(size, blockRemaining);
+                zlib.insert(zlib.end(), data, data + count);
+                for (std::size_t i = 0; i < count;) {
+                    // The most bytes that can be summed before the sums could overflow
+                    std::size_t end = std::min(count, i + 5552);
+                    for (; i < end; i++) {
+                        adlerA += data[i];
+                        adlerB += adlerA;
+                    }
+                    adlerA %= 65521;
+                    adlerB %= 65521;
+                }
+                data += count;
+                size -= count;
+                blockRemaining -= count;
+            }
+        };
+
+        const uint8_t filter = 0;
+        for (uint32_t y = 0; y < image.height; y++) {
+            appendRaw(&filter, 1);
+            appendRaw(image.pixels.data() + y * rowSize, rowSize);
+        }
+        appendBigEndian(zlib, (adlerB << 16) | adlerA);
+
+        std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        png.reserve(zlib.size() + 64);
+
+        std::vector<uint8_t> header;
+        appendBigEndian(header, image.width);
+        appendBigEndian(header, image.height);
+        header.push_back(8); // Bit depth
+        header.push_back(6); // RGBA
+        header.push_back(0); // Deflate
+        header.push_back(0); // Adaptive filtering
+        header.push_back(0); // Not interlaced
+        appendPngChunk(png, "IHDR", header.data(), header.size());
+
+        const uint8_t perceptualIntent = 0;
+        appendPngChunk(png, "sRGB", &perceptualIntent, 1);
+        appendPngChunk(png, "IDAT", zlib.data(), zlib.size());
+        appendPngChunk(png, "IEND", nullptr, 0);
+
+        return writeFile(path, png);
+    }
+
+    std::size_t writeExr(const std::string& path, const ImageRGBA8& image) {
+        checkImage(image);
+        static const std::array<uint16_t, 256> srgbToHalf = makeSrgbToHalfTable();
+
+        std::vector<uint8_t> exr;
+        appendLittleEndian(exr, uint32_t(20000630)); // Magic number
+        appendLittleEndian(exr, uint32_t(2));        // Version 2, single part scanline
+
+        // Channels are listed, and stored, in alphabetical order
+        const char* channelNames[] = {"A", "B", "G", "R"};
+        const uint32_t channelOffsets[] = {3, 2, 1, 0};
+        appendString(exr, "channels");
+        appendString(exr, "chlist");
+        appendLittleEndian(exr, uint32_t(4 * (2 + 16) + 1));
+        for (const char* name : channelNames) {
+            appendString(exr, name);
+            appendLittleEndian(exr, uint32_t(1)); // Half
+            appendLittleEndian(exr, uint32_t(0)); // Not perceptually linear, and reserved bytes
+            appendLittleEndian(exr, uint32_t(1)); // x sampling
+            appendLittleEndian(exr, uint32_t(1)); // y sampling
+        }
+        exr.push_back(0);
+
+        appendString(exr, "compression");
+        appendString(exr, "compression");
+        appendLittleEndian(exr, uint32_t(1));
+        exr.push_back(0); // None
+
+        for (const char* window : {"dataWindow", "displayWindow"}) {
+            appendString(exr, window);
+            appendString(exr, "box2i");
+            appendLittleEndian(exr, uint32_t(16));
+            appendLittleEndian(exr, uint32_t(0));
+            appendLittleEndian(exr, uint32_t(0));
+            appendLittleEndian(exr, image.width - 1);
+            appendLittleEndian(exr, image.height - 1);
+        }
+
+        appendString(exr, "lineOrder");
+        appendString(exr, "lineOrder");
+        appendLittleEndian(exr, uint32_t(1));
+        exr.push_back(0); // Increasing y
+
+        appendString(exr, "pixelAspectRatio");
+        appendString(exr, "float");
+        appendLittleEndian(exr, uint32_t(4));
+        appendLittleEndian(exr, 1.0f);
+
+        appendString(exr, "screenWindowCenter");
+        appendString(exr, "v2f");
+        appendLittleEndian(exr, uint32_t(8));
+        appendLittleEndian(exr, 0.0f);
+        appendLittleEndian(exr, 0.0f);
+
+        appendString(exr, "screenWindowWidth");
+        appendString(exr, "float");
+        appendLittleEndian(exr, uint32_t(4));
+        appendLittleEndian(exr, 1.0f);
+        exr.push_back(0); // End of header
+
+        // The offset table, then each scanline with its y and size
+        uint32_t chunkSize = image.width * 4 * sizeof(uint16_t) * EXR_SCANLINES_PER_CHUNK;
+        uint64_t chunkOffset = exr.size() + std::size_t(image.height) * sizeof(uint64_t);
+        exr.reserve(chunkOffset + std::size_t(image.height) * (8 + chunkSize));
+        for (uint32_t y = 0; y < image.height; y++) {
+            appendLittleEndian(exr, chunkOffset + uint64_t(y) * (8 + chunkSize));
+        }
+        for (uint32_t y = 0; y < image.height; y++) {
+            appendLittleEndian(exr, y);
+            appendLittleEndian(exr, chunkSize);
+            const uint8_t* row = image.pixels.data() + std::size_t(y) * image.width * 4;
+            for (uint32_t channel = 0; channel < 4; channel++) {
+                uint32_t offset = channelOffsets[channel];
+                for (uint32_t x = 0; x < image.width; x++) {
+                    uint8_t value = row[x * 4 + offset];
+                    // Alpha is not colour, so is stored without decoding
+                    appendLittleEndian(exr, offset == 3 ? toHalf(static_cast<float>(value) / 255.0f) : srgbToHalf[value]);
+                }
+            }
+        }
+
+        return writeFile(path, exr);
+    }
+
+    std::size_t writeImage(const std::string& path, const ImageRGBA8& image, ImageFileFormat format) {
+        switch (format) {
+        case ImageFileFormat::Png:
+            return writePng(path, image);
+        case ImageFileFormat::Exr:
+            return writeExr(path, image);
+        }
+        throw std::runtime_error("Unknown image file format");
+    }
+}
@@ -2,4 +2,5 @@
 
 namespace Core {
     bool InputReceiver::windowResized(int width, int height) { return false; }
+    bool InputReceiver::keyPressed(int key, int mods) { return false; }
 }
@@ -0,0 +1,337 @@
+#include "Core/MemoryAllocator.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace Core {
+
+    const char* to_string(AllocationCategory category) {
+        switch (category) {
+        case AllocationCategory::Framebuffer:
+            return "Framebuffer";
+        case AllocationCategory::Geometry:
+            return "Geometry";
+        case AllocationCategory::BVH:
+            return "BVH";
+        case AllocationCategory::Staging:
+            return "Staging";
+        }
+        return "Unknown";
+    }
+
+    MemoryAllocator::MemoryAllocator(Renderer& renderer)
+        : m_device(renderer.getDevice())
+        , m_graphicsQueue(renderer.getQueue(QueueType::Graphics))
+        , m_memoryBudgetEnabled(renderer.isDeviceExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+        vma::AllocatorCreateInfo allocatorInfo{};
+        allocatorInfo.physicalDevice = renderer.getPhysicalDevice();
+        allocatorInfo.device = m_device;
+        allocatorInfo.instance = renderer.getInstance();
+        if (m_memoryBudgetEnabled) {
+            allocatorInfo.flags |= vma::AllocatorCreateFlagBits::eExtMemoryBudget;
+        }
+        vma::createAllocator(&allocatorInfo, &m_allocator);
+
+        vk::CommandPoolCreateInfo commandPoolInfo{
+            vk::CommandPoolCreateFlagBits::eTransient,
+            m_graphicsQueue.familyIndex,
+        };
+        m_commandPool = m_device.createCommandPool(commandPoolInfo);
+    }
+
+    MemoryAllocator::~MemoryAllocator() {
+        if (!m_allocations.empty()) {
+            std::cout << "MemoryAllocator destroyed with " << m_allocations.size() << " live allocations" << std::endl;
+        }
+
+        m_device.destroyCommandPool(m_commandPool);
+        m_allocator.destroy();
+    }
+
+    vma::Allocator MemoryAllocator::getHandle() const { return m_allocator; }
+
+    // -- Allocation --
+
+    vma::AllocationCreateInfo MemoryAllocator::applyCategoryPolicy(const vma::AllocationCreateInfo& allocationInfo, AllocationCategory category) const {
+        vma::AllocationCreateInfo result = allocationInfo;
+
+        // The category name is copied into the allocation so that it is visible in the JSON dump
+        result.flags |= vma::AllocationCreateFlagBits::eUserDataCopyString;
+        result.pUserData = const_cast<char*>(to_string(category));
+
+        switch (category) {
+        case AllocationCategory::Framebuffer:
+            // Render targets are large and are freed and recreated together on every resize.
+            // Giving them their own memory means recreation never leaves holes in shared blocks.
+            result.flags |= vma::AllocationCreateFlagBits::eDedicatedMemory;
+            break;
+        case AllocationCategory::Geometry:
+        case AllocationCategory::BVH:
+            // Long-lived and movable, prefer placements that keep blocks dense
+            result.flags |= vma::AllocationCreateFlagBits::eStrategyMinFragmentation;
+            break;
+        case AllocationCategory::Staging:
+            // Short-lived, allocation speed matters more than placement
+            result.flags |= vma::AllocationCreateFlagBits::eStrategyMinTime;
+            break;
+        }
+
+        return result;
+    }
+
+    std::pair<vk::Buffer, vma::Allocation> MemoryAllocator::createBuffer(const vk::BufferCreateInfo& bufferInfo,
+                                                                         const vma::AllocationCreateInfo& allocationInfo,
+                                                                         AllocationCategory category) {
+        vma::AllocationCreateInfo categoryInfo = applyCategoryPolicy(allocationInfo, category);
+        auto [buffer, allocation] = m_allocator.createBuffer(bufferInfo, categoryInfo);
+
+        recordAllocation(allocation, category);
+
+        // Concurrent buffers reference queue family arrays that we do not own, so only exclusive buffers are moved.
+        // Persistently mapped buffers are also left alone, as their owners hold pointers into them,
+        // and dedicated allocations have nothing to be compacted with.
+        bool movable = (category == AllocationCategory::Geometry || category == AllocationCategory::BVH) &&
+                       bufferInfo.sharingMode == vk::SharingMode::eExclusive &&
+                       !(categoryInfo.flags & (vma::AllocationCreateFlagBits::eMapped | vma::AllocationCreateFlagBits::eDedicatedMemory));
+        if (movable) {
+            vk::BufferCreateInfo createInfo = bufferInfo;
+            createInfo.pNext = nullptr;
+            createInfo.queueFamilyIndexCount = 0;
+            createInfo.pQueueFamilyIndices = nullptr;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_movableBuffers.emplace(static_cast<VmaAllocation>(allocation), MovableBuffer{buffer, createInfo});
+        }
+
+        return {buffer, allocation};
+    }
+
+    std::pair<vk::Image, vma::Allocation> MemoryAllocator::createImage(const vk::ImageCreateInfo& imageInfo,
+                                                                       const vma::AllocationCreateInfo& allocationInfo,
+                                                                       AllocationCategory category) {
+        auto [image, allocation] = m_allocator.createImage(imageInfo, applyCategoryPolicy(allocationInfo, category));
+        recordAllocation(allocation, category);
+        return {image, allocation};
+    }
+
+    void MemoryAllocator::destroyBuffer(vk::Buffer buffer, vma::Allocation allocation) {
+        forgetAllocation(allocation);
+        m_allocator.destroyBuffer(buffer, allocation);
+    }
+
+    void MemoryAllocator::destroyImage(vk::Image image, vma::Allocation allocation) {
+        forgetAllocation(allocation);
+        m_allocator.destroyImage(image, allocation);
+    }
+
+    void MemoryAllocator::recordAllocation(vma::Allocation allocation, AllocationCategory category) {
+        vk::DeviceSize size = m_allocator.getAllocationInfo(allocation).size;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_allocations[static_cast<VmaAllocation>(allocation)] = AllocationRecord{category, size};
+
+        CategoryStats& stats = m_categoryStats[static_cast<std::size_t>(category)];
+        stats.allocationCount++;
+        stats.allocatedBytes += size;
+        stats.peakBytes = std::max(stats.peakBytes, stats.allocatedBytes);
+    }
+
+    void MemoryAllocator::forgetAllocation(vma::Allocation allocation) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_movableBuffers.erase(static_cast<VmaAllocation>(allocation));
+
+        auto search = m_allocations.find(static_cast<VmaAllocation>(allocation));
+        if (search == m_allocations.end()) {
+            return;
+        }
+
+        CategoryStats& stats = m_categoryStats[static_cast<std::size_t>(search->second.category)];
+        stats.allocationCount--;
+        stats.allocatedBytes -= search->second.size;
+        m_allocations.erase(search);
+    }
+
+    // -- End allocation --
+
+    // -- Budget and statistics --
+
+    void MemoryAllocator::beginFrame(uint32_t frameIndex) {
+        m_frameIndex = frameIndex;
+        m_allocator.setCurrentFrameIndex(frameIndex);
+    }
+
+    bool MemoryAllocator::hasMemoryBudget() const { return m_memoryBudgetEnabled; }
+
+    std::vector<MemoryAllocator::HeapBudget> MemoryAllocator::getHeapBudgets() const {
+        const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+        vmaGetMemoryProperties(static_cast<VmaAllocator>(m_allocator), &memoryProperties);
+
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS] = {};
+        vmaGetBudget(static_cast<VmaAllocator>(m_allocator), budgets);
+
+        std::vector<HeapBudget> result;
+        result.reserve(memoryProperties->memoryHeapCount);
+        for (uint32_t heap = 0; heap < memoryProperties->memoryHeapCount; heap++) {
+            result.push_back(HeapBudget{
+                budgets[heap].blockBytes,
+                budgets[heap].allocationBytes,
+                budgets[heap].usage,
+                budgets[heap].budget,
+                (memoryProperties->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+            });
+        }
+        return result;
+    }
+
+    bool MemoryAllocator::isOverBudget(float fraction) const {
+        for (const HeapBudget& heap : getHeapBudgets()) {
+            if (heap.deviceLocal && heap.usage > static_cast<vk::DeviceSize>(heap.budget * fraction)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    MemoryAllocator::CategoryStats MemoryAllocator::getCategoryStats(AllocationCategory category) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_categoryStats[static_cast<std::size_t>(category)];
+    }
+
+    std::string MemoryAllocator::buildStatsJson(bool detailedMap) const {
+        char* statsString = nullptr;
+        vmaBuildStatsString(static_cast<VmaAllocator>(m_allocator), &statsString, detailedMap ? VK_TRUE : VK_FALSE);
+        std::string result(statsString);
+        vmaFreeStatsString(static_cast<VmaAllocator>(m_allocator), statsString);
+        return result;
+    }
+
+    void MemoryAllocator::writeStatsJson(const std::string& filename, bool detailedMap) const {
+        std::ofstream file(filename, std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Can't write allocator statistics to file: " + filename);
+        }
+        file << buildStatsJson(detailedMap);
+    }
+
+    void MemoryAllocator::printSummary(std::ostream& out) const {
+        constexpr double mebibyte = 1024.0 * 1024.0;
+
+        out << "Memory heaps" << (m_memoryBudgetEnabled ? " (VK_EXT_memory_budget):" : " (estimated):") << std::endl;
+        std::vector<HeapBudget> heaps = getHeapBudgets();
+        for (std::size_t heap = 0; heap < heaps.size(); heap++) {
+            out << "    " << heap << (heaps[heap].deviceLocal ? " [Device]" : " [Host]  ");
+            out << " usage " << heaps[heap].usage / mebibyte << " / " << heaps[heap].budget / mebibyte << " MiB,";
+            out << " blocks " << heaps[heap].blockBytes / mebibyte << " MiB,";
+            out << " allocations " << heaps[heap].allocationBytes / mebibyte << " MiB" << std::endl;
+        }
+
+        out << "Allocation categories:" << std::endl;
+        for (std::size_t category = 0; category < AllocationCategoryCount; category++) {
+            CategoryStats stats = getCategoryStats(static_cast<AllocationCategory>(category));
+            out << "    " << to_string(static_cast<AllocationCategory>(category)) << ": " << stats.allocationCount << " allocations, ";
+            out << stats.allocatedBytes / mebibyte << " MiB (peak " << stats.peakBytes / mebibyte << " MiB)" << std::endl;
+        }
+    }
+
+    // -- End budget and statistics --
+
+    // -- Defragmentation --
+
+    void MemoryAllocator::setMoveCallback(MoveCallback callback) { m_moveCallback = std::move(callback); }
+
+    MemoryAllocator::DefragmentationResult MemoryAllocator::defragment(vk::DeviceSize maxBytesToMove, uint32_t maxAllocationsToMove) {
+        std::vector<vma::Allocation> allocations;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_movableBuffers.empty()) {
+                return DefragmentationResult{};
+            }
+
+            allocations.reserve(m_movableBuffers.size());
+            for (auto& [allocation, movableBuffer] : m_movableBuffers) {
+                allocations.emplace_back(allocation);
+            }
+        }
+        std::vector<vk::Bool32> allocationsChanged(allocations.size(), VK_FALSE);
+
+        vk::CommandBufferAllocateInfo commandBufferInfo{
+            m_commandPool,
+            vk::CommandBufferLevel::ePrimary,
+            1,
+        };
+        vk::CommandBuffer commandBuffer = m_device.allocateCommandBuffers(commandBufferInfo)[0];
+        commandBuffer.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+        // Only GPU moves are allowed: movable buffers live in device local memory that usually cannot be mapped
+        vma::DefragmentationInfo2 defragmentationInfo{
+            vma::DefragmentationFlags(),
+            static_cast<uint32_t>(allocations.size()),
+            allocations.data(),
+            allocationsChanged.data(),
+            0,
+            nullptr,
+            0,
+            0,
+            maxBytesToMove,
+            maxAllocationsToMove,
+            commandBuffer,
+        };
+        vma::DefragmentationStats defragmentationStats;
+        vma::DefragmentationContext context;
+        vk::Result result = m_allocator.defragmentationBegin(&defragmentationInfo, &defragmentationStats, &context);
+        commandBuffer.end();
+
+        if (result == vk::Result::eNotReady) {
+            // Copies were recorded, run them before the moves can be finalized
+            vk::Fence fence = m_device.createFence(vk::FenceCreateInfo{});
+            vk::SubmitInfo submitInfo{
+                0,
+                nullptr,
+                nullptr,
+                1,
+                &commandBuffer,
+            };
+            m_graphicsQueue.queues[0].submit(1, &submitInfo, fence);
+            m_device.waitForFences(1, &fence, VK_TRUE, UINT64_MAX);
+            m_device.destroyFence(fence);
+        } else {
+            REND_DEBUG(result);
+        }
+        m_allocator.defragmentationEnd(context);
+        m_device.freeCommandBuffers(m_commandPool, 1, &commandBuffer);
+
+        // Moved allocations now refer to new memory, so their buffers have to be recreated and rebound
+        for (std::size_t i = 0; i < allocations.size(); i++) {
+            if (!allocationsChanged[i]) {
+                continue;
+            }
+
+            vk::Buffer oldBuffer;
+            vk::Buffer newBuffer;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                MovableBuffer& movableBuffer = m_movableBuffers.at(static_cast<VmaAllocation>(allocations[i]));
+                oldBuffer = movableBuffer.buffer;
+                newBuffer = m_device.createBuffer(movableBuffer.createInfo);
+                movableBuffer.buffer = newBuffer;
+            }
+
+            m_device.destroyBuffer(oldBuffer);
+            m_allocator.bindBufferMemory(allocations[i], newBuffer);
+
+            if (m_moveCallback) {
+                m_moveCallback(allocations[i], oldBuffer, newBuffer);
+            }
+        }
+
+        return DefragmentationResult{
+            defragmentationStats.bytesMoved,
+            defragmentationStats.bytesFreed,
+            defragmentationStats.allocationsMoved,
+            defragmentationStats.deviceMemoryBlocksFreed,
+        };
+    }
+
+    // -- End defragmentation --
+}
@@ -0,0 +1,471 @@
+#include "Core/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    /// Tuning constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+    constexpr int FORSYTH_CACHE_SIZE = 32;
+    constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+    constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+    float forsythVertexScore(int cachePosition, uint32_t remainingValence) {
+        if (remainingValence == 0) {
+            // Nothing left to draw with this vertex
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                // Used by the last triangle. A fixed score stops the optimizer from favouring strips.
+                score = FORSYTH_LAST_TRIANGLE_SCORE;
+            } else {
+                float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+            }
+        }
+
+        // Vertices with few triangles left get priority, so they are finished and do not linger as lone triangles
+        score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingValence), -FORSYTH_VALENCE_BOOST_POWER);
+        return score;
+    }
+
+    /// Vertex to triangle adjacency, stored as one list of triangles with per-vertex offsets
+    struct Adjacency {
+        std::vector<uint32_t> counts;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        Adjacency(const std::vector<uint32_t>& indices, uint32_t vertexCount)
+            : counts(vertexCount, 0)
+            , offsets(vertexCount, 0)
+            , triangles(indices.size()) {
+            for (uint32_t index : indices) {
+                counts[index]++;
+            }
+            uint32_t offset = 0;
+            for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+                offsets[vertex] = offset;
+                offset += counts[vertex];
+            }
+
+            std::vector<uint32_t> fill(offsets);
+            for (uint32_t i = 0; i < indices.size(); i++) {
+                triangles[fill[indices[i]]++] = i / 3;
+            }
+        }
+    };
+
+    struct Float3 {
+        float x, y, z;
+    };
+
+    Float3 operator-(const Float3& a, const Float3& b) { return Float3{a.x - b.x, a.y - b.y, a.z - b.z}; }
+    Float3 cross(const Float3& a, const Float3& b) { return Float3{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+    float dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+}
+
+namespace Core {
+
+    uint32_t IndexedMesh::getVertexCount() const { return vertexStride ? static_cast<uint32_t>(vertices.size() / vertexStride) : 0; }
+    uint32_t IndexedMesh::getTriangleCount() const { return static_cast<uint32_t>(indices.size() / 3); }
+
+    MeshOptimizer::MeshOptimizer(uint32_t vertexStride, uint32_t positionOffset)
+        : m_vertexStride(vertexStride)
+        , m_positionOffset(positionOffset) {
+        if (positionOffset + sizeof(Float3) > vertexStride) {
+            throw std::runtime_error("MeshOptimizer: vertex position does not fit within the vertex stride");
+        }
+    }
+
+    MeshOptimizer::~MeshOptimizer() = default;
+
+    void MeshOptimizer::setAnalysisCacheSize(uint32_t cacheSize) { m_analysisCacheSize = cacheSize; }
+    void MeshOptimizer::setOverdrawThreshold(float threshold) { m_overdrawThreshold = threshold; }
+
+    IndexedMesh MeshOptimizer::ingest(const void* vertices, std::size_t vertexCount) {
+        if (vertexCount % 3 != 0) {
+            throw std::runtime_error("MeshOptimizer: a triangle list must have a multiple of three vertices");
+        }
+
+        IndexedMesh mesh = weld(vertices, vertexCount);
+        optimize(mesh);
+
+        // optimize() counted the welded vertices, the input here is the soup
+        m_report.inputVertices = static_cast<uint32_t>(vertexCount);
+        return mesh;
+    }
+
+    void MeshOptimizer::optimize(IndexedMesh& mesh) {
+        if (mesh.vertexStride != m_vertexStride) {
+            throw std::runtime_error("MeshOptimizer: mesh vertex stride does not match the optimizer");
+        }
+        // The stages index their per-vertex and per-triangle tables without bounds checks
+        if (mesh.indices.size() % 3 != 0) {
+            throw std::runtime_error("MeshOptimizer: " + std::to_string(mesh.indices.size()) + " indices is not a whole number of triangles");
+        }
+        uint32_t vertexCount = mesh.getVertexCount();
+        for (uint32_t index : mesh.indices) {
+            if (index >= vertexCount) {
+                throw std::runtime_error("MeshOptimizer: index " + std::to_string(index) + " is out of bounds for " + std::to_string(vertexCount) +
+                                         " vertices");
+            }
+        }
+
+        // A non-indexed soup transforms every vertex of every triangle, which is also the worst case for an indexed
+        // mesh, so "before" is measured on the mesh as given rather than on the soup.
+        m_report.inputVertices = vertexCount;
+        m_report.before = analyzeVertexCache(mesh.indices, mesh.getVertexCount());
+
+        optimizeVertexCache(mesh);
+        optimizeOverdraw(mesh);
+        optimizeVertexFetch(mesh);
+
+        m_report.outputVertices = mesh.getVertexCount();
+        m_report.triangles = mesh.getTriangleCount();
+        m_report.after = analyzeVertexCache(mesh.indices, mesh.getVertexCount());
+    }
+
+    const MeshOptimizer::Report& MeshOptimizer::getReport() const { return m_report; }
+
+    void MeshOptimizer::printReport(std::ostream& out) const {
+        out << "Mesh ingestion: " << m_report.triangles << " triangles, " << m_report.inputVertices << " -> " << m_report.outputVertices
+            << " vertices" << std::endl;
+        out << "    ACMR " << m_report.before.acmr << " -> " << m_report.after.acmr;
+        out << ", ATVR " << m_report.before.atvr << " -> " << m_report.after.atvr;
+        out << " (FIFO " << m_analysisCacheSize << ")" << std::endl;
+    }
+
+    // -- Individual stages --
+
+    IndexedMesh MeshOptimizer::weld(const void* vertices, std::size_t vertexCount) const {
+        const uint8_t* source = static_cast<const uint8_t*>(vertices);
+
+        IndexedMesh mesh;
+        mesh.vertexStride = m_vertexStride;
+        mesh.indices.resize(vertexCount);
+        mesh.vertices.reserve(vertexCount * m_vertexStride);
+
+        // Open addressing table of output vertex indices, at most half full
+        std::size_t tableSize = 1;
+        while (tableSize < vertexCount * 2) {
+            tableSize *= 2;
+        }
+        constexpr uint32_t empty = ~0u;
+        std::vector<uint32_t> table(tableSize, empty);
+
+        uint32_t outputCount = 0;
+        for (std::size_t vertex = 0; vertex < vertexCount; vertex++) {
+            const uint8_t* data = source + vertex * m_vertexStride;
+
+            // FNV-1a over the vertex bytes
+            uint64_t hash = 14695981039346656037ull;
+            for (uint32_t byte = 0; byte < m_vertexStride; byte++) {
+                hash = (hash ^ data[byte]) * 1099511628211ull;
+            }
+
+            std::size_t slot = hash & (tableSize - 1);
+            while (table[slot] != empty && memcmp(&mesh.vertices[table[slot] * m_vertexStride], data, m_vertexStride) != 0) {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+
+            if (table[slot] == empty) {
+                table[slot] = outputCount++;
+                mesh.vertices.insert(mesh.vertices.end(), data, data + m_vertexStride);
+            }
+            mesh.indices[vertex] = table[slot];
+        }
+
+        mesh.vertices.shrink_to_fit();
+        return mesh;
+    }
+
+    void MeshOptimizer::optimizeVertexCache(IndexedMesh& mesh) const {
+        const std::vector<uint32_t>& indices = mesh.indices;
+        uint32_t vertexCount = mesh.getVertexCount();
+        uint32_t triangleCount = mesh.getTriangleCount();
+        if (triangleCount == 0) {
+            return;
+        }
+
+        Adjacency adjacency(indices, vertexCount);
+        std::vector<uint32_t> remainingValence(adjacency.counts);
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+            vertexScore[vertex] = forsythVertexScore(-1, remainingValence[vertex]);
+        }
+
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+            triangleScore[triangle] =
+                vertexScore[indices[triangle * 3]] + vertexScore[indices[triangle * 3 + 1]] + vertexScore[indices[triangle * 3 + 2]];
+        }
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        // The cache holds up to three vertices beyond its size while a new triangle is pushed in
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> nextCache;
+        cache.reserve(FORSYTH_CACHE_SIZE + 3);
+        nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+        uint32_t inputCursor = 0;
+        uint32_t bestTriangle = ~0u;
+        for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+            if (bestTriangle == ~0u) {
+                // Nothing in the cache has triangles left, continue from the next unemitted triangle in input order.
+                // This avoids a full scan, and keeps the input order for disconnected pieces.
+                while (emitted[inputCursor]) {
+                    inputCursor++;
+                }
+                bestTriangle = inputCursor;
+            }
+
+            const uint32_t* triangleVertices = &indices[bestTriangle * 3];
+            output.insert(output.end(), triangleVertices, triangleVertices + 3);
+            emitted[bestTriangle] = true;
+
+            // Remove the triangle from its vertices' adjacency, and push them to the front of the cache
+            nextCache.clear();
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t vertex = triangleVertices[corner];
+                uint32_t* adjacent = &adjacency.triangles[adjacency.offsets[vertex]];
+                uint32_t* adjacentEnd = adjacent + remainingValence[vertex];
+                *std::find(adjacent, adjacentEnd, bestTriangle) = *(adjacentEnd - 1);
+                remainingValence[vertex]--;
+
+                nextCache.push_back(vertex);
+            }
+            for (uint32_t vertex : cache) {
+                if (vertex != triangleVertices[0] && vertex != triangleVertices[1] && vertex != triangleVertices[2]) {
+                    nextCache.push_back(vertex);
+                }
+            }
+            std::swap(cache, nextCache);
+
+            // Rescore everything that moved in the cache, along with the triangles that use them
+            for (std::size_t position = 0; position < cache.size(); position++) {
+                uint32_t vertex = cache[position];
+                int newPosition = position < FORSYTH_CACHE_SIZE ? static_cast<int>(position) : -1;
+                cachePosition[vertex] = newPosition;
+
+                float newScore = forsythVertexScore(newPosition, remainingValence[vertex]);
+                float scoreDelta = newScore - vertexScore[vertex];
+                vertexScore[vertex] = newScore;
+
+                const uint32_t* adjacent = &adjacency.triangles[adjacency.offsets[vertex]];
+                for (uint32_t i = 0; i < remainingValence[vertex]; i++) {
+                    triangleScore[adjacent[i]] += scoreDelta;
+                }
+            }
+
+            // Only once every delta is applied, as a triangle shares up to three vertices that each change its score
+            bestTriangle = ~0u;
+            float bestScore = -1.0f;
+            for (uint32_t vertex : cache) {
+                const uint32_t* adjacent = &adjacency.triangles[adjacency.offsets[vertex]];
+                for (uint32_t i = 0; i < remainingValence[vertex]; i++) {
+                    uint32_t triangle = adjacent[i];
+                    if (triangleScore[triangle] > bestScore) {
+                        bestScore = triangleScore[triangle];
+                        bestTriangle = triangle;
+                    }
+                }
+            }
+            if (cache.size() > FORSYTH_CACHE_SIZE) {
+                cache.resize(FORSYTH_CACHE_SIZE);
+            }
+        }
+
+        mesh.indices = std::move(output);
+    }
+
+    void MeshOptimizer::optimizeOverdraw(IndexedMesh& mesh) const {
+        const std::vector<uint32_t>& indices = mesh.indices;
+        uint32_t vertexCount = mesh.getVertexCount();
+        uint32_t triangleCount = mesh.getTriangleCount();
+        if (triangleCount == 0 || m_overdrawThreshold < 1.0f) {
+            return;
+        }
+
+        // Hard boundaries: a triangle that misses on all three vertices does not benefit from the order before it,
+        // so the cache-optimized order can be split there for free
+        std::vector<uint32_t> hardClusters;
+        {
+            std::vector<uint32_t> timestamps(vertexCount, 0);
+            uint32_t time = m_analysisCacheSize + 1;
+            for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+                int misses = 0;
+                for (int corner = 0; corner < 3; corner++) {
+                    uint32_t vertex = indices[triangle * 3 + corner];
+                    if (time - timestamps[vertex] > m_analysisCacheSize) {
+                        timestamps[vertex] = time++;
+                        misses++;
+                    }
+                }
+                if (triangle == 0 || misses == 3) {
+                    hardClusters.push_back(triangle);
+                }
+            }
+        }
+        hardClusters.push_back(triangleCount);
+
+        // Soft boundaries: split each hard cluster further while the pieces stay within the threshold of its ACMR
+        std::vector<uint32_t> clusters;
+        for (std::size_t cluster = 0; cluster + 1 < hardClusters.size(); cluster++) {
+            uint32_t start = hardClusters[cluster];
+            uint32_t end = hardClusters[cluster + 1];
+
+            uint32_t clusterMisses = countCacheMisses(&indices[start * 3], (end - start) * 3, vertexCount);
+            float limit = m_overdrawThreshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+            uint32_t pieceStart = start;
+            clusters.push_back(pieceStart);
+            std::vector<uint32_t> timestamps(vertexCount, 0);
+            uint32_t time = m_analysisCacheSize + 1;
+            uint32_t pieceMisses = 0;
+            for (uint32_t triangle = start; triangle < end; triangle++) {
+                for (int corner = 0; corner < 3; corner++) {
+                    uint32_t vertex = indices[triangle * 3 + corner];
+                    if (time - timestamps[vertex] > m_analysisCacheSize) {
+                        timestamps[vertex] = time++;
+                        pieceMisses++;
+                    }
+                }
+
+                float pieceAcmr = static_cast<float>(pieceMisses) / static_cast<float>(triangle - pieceStart + 1);
+                if (pieceAcmr <= limit && triangle + 1 < end) {
+                    // Starting a new piece flushes the simulated cache, as the pieces will be reordered
+                    pieceStart = triangle + 1;
+                    clusters.push_back(pieceStart);
+                    time += m_analysisCacheSize + 1;
+                    pieceMisses = 0;
+                }
+            }
+        }
+        clusters.push_back(triangleCount);
+
+        auto position = [&mesh, this](uint32_t vertex) {
+            Float3 result;
+            memcpy(&result, &mesh.vertices[vertex * m_vertexStride + m_positionOffset], sizeof(Float3));
+            return result;
+        };
+
+        // Clusters facing away from the mesh centre are likely to occlude the rest, so they are drawn first
+        Float3 meshCentroid{0.0f, 0.0f, 0.0f};
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+            Float3 p = position(vertex);
+            meshCentroid = Float3{meshCentroid.x + p.x, meshCentroid.y + p.y, meshCentroid.z + p.z};
+        }
+        meshCentroid = Float3{meshCentroid.x / vertexCount, meshCentroid.y / vertexCount, meshCentroid.z / vertexCount};
+
+        std::vector<float> clusterSortKeys(clusters.size() - 1);
+        for (std::size_t cluster = 0; cluster + 1 < clusters.size(); cluster++) {
+            Float3 centroid{0.0f, 0.0f, 0.0f};
+            Float3 normal{0.0f, 0.0f, 0.0f};
+            float area = 0.0f;
+
+            for (uint32_t triangle = clusters[cluster]; triangle < clusters[cluster + 1]; triangle++) {
+                Float3 a = position(indices[triangle * 3]);
+                Float3 b = position(indices[triangle * 3 + 1]);
+                Float3 c = position(indices[triangle * 3 + 2]);
+
+                // The cross product is the area weighted normal
+                Float3 triangleNormal = cross(b - a, c - a);
+                float triangleArea = std::sqrt(dot(triangleNormal, triangleNormal));
+
+                centroid.x += (a.x + b.x + c.x) / 3.0f * triangleArea;
+                centroid.y += (a.y + b.y + c.y) / 3.0f * triangleArea;
+                centroid.z += (a.z + b.z + c.z) / 3.0f * triangleArea;
+                normal = Float3{normal.x + triangleNormal.x, normal.y + triangleNormal.y, normal.z + triangleNormal.z};
+                area += triangleArea;
+            }
+
+            float normalLength = std::sqrt(dot(normal, normal));
+            if (area == 0.0f || normalLength == 0.0f) {
+                clusterSortKeys[cluster] = 0.0f;
+                continue;
+            }
+            centroid = Float3{centroid.x / area, centroid.y / area, centroid.z / area};
+            normal = Float3{normal.x / normalLength, normal.y / normalLength, normal.z / normalLength};
+
+            clusterSortKeys[cluster] = dot(centroid - meshCentroid, normal);
+        }
+
+        std::vector<uint32_t> clusterOrder(clusters.size() - 1);
+        std::iota(clusterOrder.begin(), clusterOrder.end(), 0u);
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&clusterSortKeys](uint32_t a, uint32_t b) {
+            return clusterSortKeys[a] > clusterSortKeys[b];
+        });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        for (uint32_t cluster : clusterOrder) {
+            output.insert(output.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + clusters[cluster + 1] * 3);
+        }
+        mesh.indices = std::move(output);
+    }
+
+    void MeshOptimizer::optimizeVertexFetch(IndexedMesh& mesh) const {
+        uint32_t vertexCount = mesh.getVertexCount();
+
+        constexpr uint32_t unused = ~0u;
+        std::vector<uint32_t> remap(vertexCount, unused);
+        std::vector<uint8_t> vertices(mesh.vertices.size());
+
+        uint32_t nextVertex = 0;
+        for (uint32_t& index : mesh.indices) {
+            if (remap[index] == unused) {
+                memcpy(&vertices[nextVertex * m_vertexStride], &mesh.vertices[index * m_vertexStride], m_vertexStride);
+                remap[index] = nextVertex++;
+            }
+            index = remap[index];
+        }
+
+        // Vertices that no triangle uses are dropped
+        vertices.resize(nextVertex * m_vertexStride);
+        mesh.vertices = std::move(vertices);
+    }
+
+    MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount) const {
+        if (indices.empty() || vertexCount == 0) {
+            return CacheStats{0.0f, 0.0f};
+        }
+
+        uint32_t misses = countCacheMisses(indices.data(), indices.size(), vertexCount);
+        return CacheStats{
+            static_cast<float>(misses) / static_cast<float>(indices.size() / 3),
+            static_cast<float>(misses) / static_cast<float>(vertexCount),
+        };
+    }
+
+    // -- End individual stages --
+
+    uint32_t MeshOptimizer::countCacheMisses(const uint32_t* indices, std::size_t indexCount, uint32_t vertexCount) const {
+        // A vertex is in the FIFO if fewer than cacheSize vertices were loaded since it was
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        uint32_t time = m_analysisCacheSize + 1;
+        uint32_t misses = 0;
+
+        for (std::size_t i = 0; i < indexCount; i++) {
+            uint32_t vertex = indices[i];
+            if (time - timestamps[vertex] > m_analysisCacheSize) {
+                timestamps[vertex] = time++;
+                misses++;
+            }
+        }
+
+        return misses;
+    }
+}
@@ -5,24 +5,36 @@ namespace Core {
     PipelineBuilder::~PipelineBuilder() = default;
 
     void PipelineBuilder::addShader(Shader &shader) {
+        // Replacing a stage also drops the constants it was added with
+        m_specializations.erase(shader.getType());
+        addStage(shader, nullptr);
+    }
+
+    void PipelineBuilder::addShader(Shader& shader, const SpecializationConstants& specialization) {
+        SpecializationConstants& stored = m_specializations[shader.getType()];
+        stored = specialization;
+        addStage(shader, &stored);
+    }
+
+    void PipelineBuilder::addStage(Shader& shader, const SpecializationConstants* specialization) {
         ShaderType type = shader.getType();
         switch(type) {
         case ShaderType::eVertex:
-            addVertexShader(shader);
+            addVertexShader(shader, specialization);
             break;
         case ShaderType::eFragment:
-            addFragmentShader(shader);
+            addFragmentShader(shader, specialization);
             break;
         default:
             throw std::runtime_error(std::string("Shader type not yet supported: ") + vk::to_string(type));
         }
     }
 
-    void PipelineBuilder::addVertexShader(Core::Shader& shader) {
+    void PipelineBuilder::addVertexShader(Core::Shader& shader, const SpecializationConstants* specialization) {
         throw std::runtime_error(std::string("This pipeline does not support shader type: ") + vk::to_string(shader.getType()));
     }
 
-    void PipelineBuilder::addFragmentShader(Core::Shader& shader) {
+    void PipelineBuilder::addFragmentShader(Core::Shader& shader, const SpecializationConstants* specialization) {
         throw std::runtime_error(std::string("This pipeline does not support shader type: ") + vk::to_string(shader.getType()));
     }
 
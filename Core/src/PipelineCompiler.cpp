@@ -0,0 +1,109 @@
+#include "Core/PipelineCompiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+    uint32_t getWorkerCount(uint32_t threadCount) {
+        if (threadCount != 0) {
+            return threadCount;
+        }
+        // Leave the main thread to keep rendering
+        return std::max(1u, std::thread::hardware_concurrency() - 1);
+    }
+}
+
+namespace Core {
+
+    PipelineCompiler::PipelineCompiler(vk::Device& device, uint32_t threadCount)
+        : m_device(device)
+        , m_workers(getWorkerCount(threadCount)) {}
+
+    PipelineCompiler::~PipelineCompiler() = default;
+
+    std::future<std::unique_ptr<GraphicsPipeline>> PipelineCompiler::compile(std::shared_ptr<RasterPipelineBuilder> builder) {
+        vk::GraphicsPipelineCreateInfo createInfo;
+        builder->getPipelineCreateInfo(createInfo);
+        return compile(std::move(builder), createInfo);
+    }
+
+    std::vector<std::future<std::unique_ptr<GraphicsPipeline>>> PipelineCompiler::compilePermutations(std::shared_ptr<RasterPipelineBuilder> builder,
+                                                                                                     ShaderType stage,
+                                                                                                     std::span<const SpecializationConstants> permutations) {
+        // Gathered here, since the builder is not safe to use from several workers
+        std::vector<vk::GraphicsPipelineCreateInfo> createInfos;
+        builder->getPermutationCreateInfos(stage, permutations, createInfos);
+
+        std::vector<std::future<std::unique_ptr<GraphicsPipeline>>> pipelines;
+        pipelines.reserve(createInfos.size());
+        for (std::size_t i = 0; i < createInfos.size(); i++) {
+            vk::GraphicsPipelineCreateInfo& createInfo = createInfos[i];
+            if (i != 0) {
+                // Created alone, so there is no base in the same call to derive from
+                createInfo.flags &= ~vk::PipelineCreateFlags(vk::PipelineCreateFlagBits::eDerivative);
+                createInfo.basePipelineIndex = -1;
+            }
+            pipelines.push_back(compile(builder, createInfo));
+        }
+        return pipelines;
+    }
+
+    void PipelineCompiler::waitIdle() { m_workers.waitIdle(); }
+
+    PipelineCompiler::Stats PipelineCompiler::getStats() const {
+        return Stats{
+            m_queued.load(),
+            m_compiled.load(),
+            m_failed.load(),
+            static_cast<double>(m_compileNanoseconds.load()) / 1e9,
+        };
+    }
+
+    void PipelineCompiler::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        out << "Pipeline compiler: " << stats.compiled << " compiled, " << stats.failed << " failed, " << stats.queued << " queued, "
+            << stats.compileSeconds << "s compiling" << std::endl;
+    }
+
+    std::future<std::unique_ptr<GraphicsPipeline>> PipelineCompiler::compile(std::shared_ptr<const void> owner,
+                                                                             const vk::GraphicsPipelineCreateInfo& createInfo) {
+        m_queued++;
+        return m_workers.submit([this, owner = std::move(owner), createInfo]() {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<vk::Pipeline> createdPipelines;
+            try {
+                createdPipelines = m_device.createGraphicsPipelines(vk::PipelineCache(), createInfo);
+            } catch (...) {
+                m_queued--;
+                m_failed++;
+                throw;
+            }
+            auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+            m_compileNanoseconds += duration.count();
+            m_queued--;
+            m_compiled++;
+            return std::make_unique<GraphicsPipeline>(m_device, createdPipelines[0]);
+        });
+    }
+
+    AsyncPipeline::AsyncPipeline(std::shared_ptr<GraphicsPipeline> pipeline)
+        : m_current(std::move(pipeline)) {}
+
+    AsyncPipeline::AsyncPipeline(std::shared_ptr<GraphicsPipeline> fallback, std::future<std::unique_ptr<GraphicsPipeline>> compiled)
+        : m_current(std::move(fallback))
+        , m_pending(std::move(compiled)) {}
+
+    bool AsyncPipeline::update() {
+        if (!m_pending.valid() || m_pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        m_current = m_pending.get();
+        return true;
+    }
+
+    bool AsyncPipeline::isReady() const { return !m_pending.valid(); }
+
+    const GraphicsPipeline& AsyncPipeline::get() const { return *m_current; }
+}
@@ -0,0 +1,111 @@
+#include "Core/PipelineLibraryCache.hpp"
+
+#include "Core/PipelineState.hpp"
+
+#include <array>
+#include <vector>
+
+namespace {
+    /// The libraries of one pipeline and the structure that lists them, kept together for an optimized link
+    struct LinkInfo {
+        std::array<std::shared_ptr<Core::GraphicsPipeline>, Core::RasterPipelineBuilder::s_libraryPartCount> libraries;
+        std::array<vk::Pipeline, Core::RasterPipelineBuilder::s_libraryPartCount> handles;
+        vk::PipelineLibraryCreateInfoKHR libraryCreateInfo;
+    };
+}
+
+namespace Core {
+
+    PipelineLibraryCache::PipelineLibraryCache(vk::Device& device, PipelineCompiler& compiler, bool enabled)
+        : m_device(device)
+        , m_compiler(compiler)
+        , m_enabled(enabled) {}
+
+    PipelineLibraryCache::~PipelineLibraryCache() = default;
+
+    bool PipelineLibraryCache::isEnabled() const { return m_enabled; }
+
+    AsyncPipeline PipelineLibraryCache::getPipeline(RasterPipelineBuilder& builder) {
+        if (!m_enabled) {
+            vk::GraphicsPipelineCreateInfo createInfo;
+            builder.getPipelineCreateInfo(createInfo);
+            std::vector<vk::Pipeline> createdPipelines = m_device.createGraphicsPipelines(vk::PipelineCache(), createInfo);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stats.monolithicPipelines++;
+            }
+            return AsyncPipeline(std::make_shared<GraphicsPipeline>(m_device, createdPipelines[0]));
+        }
+
+        auto linkInfo = std::make_shared<LinkInfo>();
+        vk::PipelineLayout layout;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (std::size_t part = 0; part < RasterPipelineBuilder::s_libraryPartCount; part++) {
+                vk::GraphicsPipelineCreateInfo createInfo;
+                builder.getLibraryCreateInfo(RasterPipelineBuilder::s_libraryParts[part], createInfo);
+                if (createInfo.layout) {
+                    layout = createInfo.layout;
+                }
+                linkInfo->libraries[part] = findOrCreateLibrary(createInfo);
+                linkInfo->handles[part] = *linkInfo->libraries[part];
+            }
+            m_stats.fastLinks++;
+        }
+        linkInfo->libraryCreateInfo = vk::PipelineLibraryCreateInfoKHR{static_cast<uint32_t>(linkInfo->handles.size()), linkInfo->handles.data()};
+
+        vk::GraphicsPipelineCreateInfo linkCreateInfo;
+        linkCreateInfo.pNext = &linkInfo->libraryCreateInfo;
+        linkCreateInfo.layout = layout;
+
+        // A fast link only stitches the compiled libraries together
+        std::vector<vk::Pipeline> linkedPipelines = m_device.createGraphicsPipelines(vk::PipelineCache(), linkCreateInfo);
+        auto fastLinked = std::make_shared<GraphicsPipeline>(m_device, linkedPipelines[0]);
+
+        // An optimized link compiles across the parts, which takes about as long as a monolithic pipeline
+        linkCreateInfo.flags = vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT;
+        return AsyncPipeline(fastLinked, m_compiler.compile(linkInfo, linkCreateInfo));
+    }
+
+    void PipelineLibraryCache::clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_libraries.clear();
+    }
+
+    std::size_t PipelineLibraryCache::releaseReferencing(uint64_t handleKey) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return std::erase_if(m_libraries, [handleKey](const auto& entry) { return entry.first.references(handleKey); });
+    }
+
+    PipelineLibraryCache::Stats PipelineLibraryCache::getStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stats stats = m_stats;
+        stats.libraryCount = m_libraries.size();
+        return stats;
+    }
+
+    void PipelineLibraryCache::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        if (!m_enabled) {
+            out << "Pipeline libraries: unsupported, " << stats.monolithicPipelines << " monolithic pipelines" << std::endl;
+            return;
+        }
+        out << "Pipeline libraries: " << stats.libraryCount << " libraries, " << stats.libraryHits << " hits, " << stats.libraryMisses << " misses, "
+            << stats.fastLinks << " fast links" << std::endl;
+    }
+
+    std::shared_ptr<GraphicsPipeline> PipelineLibraryCache::findOrCreateLibrary(const vk::GraphicsPipelineCreateInfo& createInfo) {
+        PipelineState state(createInfo);
+        auto library = m_libraries.find(state);
+        if (library != m_libraries.end()) {
+            m_stats.libraryHits++;
+            return library->second;
+        }
+
+        m_stats.libraryMisses++;
+        std::vector<vk::Pipeline> createdLibraries = m_device.createGraphicsPipelines(vk::PipelineCache(), createInfo);
+        auto created = std::make_shared<GraphicsPipeline>(m_device, createdLibraries[0]);
+        m_libraries.emplace(std::move(state), created);
+        return created;
+    }
+}
@@ -0,0 +1,203 @@
+#include "Core/PipelineState.hpp"
+
+#include "Core/ContentHash.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    /// Appends values to a state, in the manner of ContentHash
+    class StateWriter {
+    public:
+        StateWriter(std::vector<std::byte>& state, std::vector<uint64_t>& handles)
+            : m_state(state)
+            , m_handles(handles) {}
+
+        void add(const void* data, std::size_t size) {
+            const auto* bytes = static_cast<const std::byte*>(data);
+            m_state.insert(m_state.end(), bytes, bytes + size);
+        }
+
+        void addString(const char* text) {
+            // With the terminator, so that consecutive strings cannot run together
+            add(text, strlen(text) + 1);
+        }
+
+        template<typename T>
+        void addValue(const T& value) {
+            add(&value, sizeof(value));
+        }
+
+        /// Add a handle by value, remembering it so the state can be forgotten when it is destroyed
+        template<typename Handle>
+        void addHandle(Handle handle) {
+            uint64_t key = Core::PipelineState::getHandleKey(handle);
+            addValue(key);
+            if (handle) {
+                m_handles.push_back(key);
+            }
+        }
+
+    private:
+        std::vector<std::byte>& m_state;
+        std::vector<uint64_t>& m_handles;
+    };
+
+    /// Write every state a createInfo sets, along with whether each optional state is set at all
+    void writeCreateInfo(StateWriter& writer, const vk::GraphicsPipelineCreateInfo& createInfo) {
+        // Derivatives are created the same as any other pipeline
+        writer.addValue(static_cast<uint32_t>(createInfo.flags & ~vk::PipelineCreateFlags(vk::PipelineCreateFlagBits::eDerivative)));
+
+        for (auto next = static_cast<const vk::BaseInStructure*>(createInfo.pNext); next; next = next->pNext) {
+            writer.addValue(next->sType);
+            switch (next->sType) {
+            case vk::StructureType::eGraphicsPipelineLibraryCreateInfoEXT: {
+                auto libraryInfo = reinterpret_cast<const vk::GraphicsPipelineLibraryCreateInfoEXT*>(next);
+                writer.addValue(static_cast<uint32_t>(libraryInfo->flags));
+                break;
+            }
+            case vk::StructureType::ePipelineLibraryCreateInfoKHR: {
+                auto linkInfo = reinterpret_cast<const vk::PipelineLibraryCreateInfoKHR*>(next);
+                writer.addValue(linkInfo->libraryCount);
+                writer.add(linkInfo->pLibraries, linkInfo->libraryCount * sizeof(vk::Pipeline));
+                break;
+            }
+            case vk::StructureType::ePipelineRenderingCreateInfoKHR: {
+                auto renderingInfo = reinterpret_cast<const vk::PipelineRenderingCreateInfoKHR*>(next);
+                writer.addValue(renderingInfo->viewMask);
+                writer.addValue(renderingInfo->colorAttachmentCount);
+                writer.add(renderingInfo->pColorAttachmentFormats, renderingInfo->colorAttachmentCount * sizeof(vk::Format));
+                writer.addValue(renderingInfo->depthAttachmentFormat);
+                writer.addValue(renderingInfo->stencilAttachmentFormat);
+                break;
+            }
+            default:
+                throw std::runtime_error("Can't describe a pipeline created with a " + vk::to_string(next->sType));
+            }
+        }
+
+        writer.addValue(createInfo.stageCount);
+        for (uint32_t i = 0; i < createInfo.stageCount; i++) {
+            const vk::PipelineShaderStageCreateInfo& stage = createInfo.pStages[i];
+            writer.addValue(static_cast<uint32_t>(stage.stage));
+            writer.addHandle(stage.module);
+            writer.addString(stage.pName);
+            writer.addValue(stage.pSpecializationInfo != nullptr);
+            if (const vk::SpecializationInfo* specialization = stage.pSpecializationInfo) {
+                writer.addValue(specialization->mapEntryCount);
+                for (uint32_t entry = 0; entry < specialization->mapEntryCount; entry++) {
+                    writer.addValue(specialization->pMapEntries[entry].constantID);
+                    writer.addValue(specialization->pMapEntries[entry].offset);
+                    writer.addValue(specialization->pMapEntries[entry].size);
+                }
+                writer.add(specialization->pData, specialization->dataSize);
+            }
+        }
+
+        writer.addValue(createInfo.pVertexInputState != nullptr);
+        if (const vk::PipelineVertexInputStateCreateInfo* vertexInput = createInfo.pVertexInputState) {
+            writer.addValue(vertexInput->vertexBindingDescriptionCount);
+            writer.add(vertexInput->pVertexBindingDescriptions, vertexInput->vertexBindingDescriptionCount * sizeof(vk::VertexInputBindingDescription));
+            writer.addValue(vertexInput->vertexAttributeDescriptionCount);
+            writer.add(vertexInput->pVertexAttributeDescriptions, vertexInput->vertexAttributeDescriptionCount * sizeof(vk::VertexInputAttributeDescription));
+        }
+
+        writer.addValue(createInfo.pInputAssemblyState != nullptr);
+        if (const vk::PipelineInputAssemblyStateCreateInfo* inputAssembly = createInfo.pInputAssemblyState) {
+            writer.addValue(inputAssembly->topology);
+            writer.addValue(inputAssembly->primitiveRestartEnable);
+        }
+
+        writer.addValue(createInfo.pTessellationState != nullptr);
+        if (const vk::PipelineTessellationStateCreateInfo* tessellation = createInfo.pTessellationState) {
+            writer.addValue(tessellation->patchControlPoints);
+        }
+
+        writer.addValue(createInfo.pViewportState != nullptr);
+        if (const vk::PipelineViewportStateCreateInfo* viewport = createInfo.pViewportState) {
+            writer.addValue(viewport->viewportCount);
+            writer.add(viewport->pViewports, viewport->pViewports ? viewport->viewportCount * sizeof(vk::Viewport) : 0);
+            writer.addValue(viewport->scissorCount);
+            writer.add(viewport->pScissors, viewport->pScissors ? viewport->scissorCount * sizeof(vk::Rect2D) : 0);
+        }
+
+        writer.addValue(createInfo.pRasterizationState != nullptr);
+        if (const vk::PipelineRasterizationStateCreateInfo* rasterization = createInfo.pRasterizationState) {
+            writer.addValue(rasterization->depthClampEnable);
+            writer.addValue(rasterization->rasterizerDiscardEnable);
+            writer.addValue(rasterization->polygonMode);
+            writer.addValue(static_cast<uint32_t>(rasterization->cullMode));
+            writer.addValue(rasterization->frontFace);
+            writer.addValue(rasterization->depthBiasEnable);
+            writer.addValue(rasterization->depthBiasConstantFactor);
+            writer.addValue(rasterization->depthBiasClamp);
+            writer.addValue(rasterization->depthBiasSlopeFactor);
+            writer.addValue(rasterization->lineWidth);
+        }
+
+        writer.addValue(createInfo.pMultisampleState != nullptr);
+        if (const vk::PipelineMultisampleStateCreateInfo* multisample = createInfo.pMultisampleState) {
+            writer.addValue(multisample->rasterizationSamples);
+            writer.addValue(multisample->sampleShadingEnable);
+            writer.addValue(multisample->minSampleShading);
+            writer.addValue(multisample->pSampleMask != nullptr);
+            if (multisample->pSampleMask) {
+                // One word per 32 samples
+                writer.add(multisample->pSampleMask, (static_cast<uint32_t>(multisample->rasterizationSamples) + 31) / 32 * sizeof(vk::SampleMask));
+            }
+            writer.addValue(multisample->alphaToCoverageEnable);
+            writer.addValue(multisample->alphaToOneEnable);
+        }
+
+        writer.addValue(createInfo.pDepthStencilState != nullptr);
+        if (const vk::PipelineDepthStencilStateCreateInfo* depthStencil = createInfo.pDepthStencilState) {
+            writer.addValue(depthStencil->depthTestEnable);
+            writer.addValue(depthStencil->depthWriteEnable);
+            writer.addValue(depthStencil->depthCompareOp);
+            writer.addValue(depthStencil->depthBoundsTestEnable);
+            writer.addValue(depthStencil->stencilTestEnable);
+            writer.addValue(depthStencil->front);
+            writer.addValue(depthStencil->back);
+            writer.addValue(depthStencil->minDepthBounds);
+            writer.addValue(depthStencil->maxDepthBounds);
+        }
+
+        writer.addValue(createInfo.pColorBlendState != nullptr);
+        if (const vk::PipelineColorBlendStateCreateInfo* colourBlend = createInfo.pColorBlendState) {
+            writer.addValue(colourBlend->logicOpEnable);
+            writer.addValue(colourBlend->logicOp);
+            writer.addValue(colourBlend->attachmentCount);
+            writer.add(colourBlend->pAttachments, colourBlend->attachmentCount * sizeof(vk::PipelineColorBlendAttachmentState));
+            writer.addValue(colourBlend->blendConstants);
+        }
+
+        writer.addValue(createInfo.pDynamicState != nullptr);
+        if (const vk::PipelineDynamicStateCreateInfo* dynamic = createInfo.pDynamicState) {
+            writer.addValue(dynamic->dynamicStateCount);
+            writer.add(dynamic->pDynamicStates, dynamic->dynamicStateCount * sizeof(vk::DynamicState));
+        }
+
+        writer.addHandle(createInfo.layout);
+        writer.addHandle(createInfo.renderPass);
+        writer.addValue(createInfo.subpass);
+    }
+}
+
+namespace Core {
+
+    PipelineState::PipelineState(const vk::GraphicsPipelineCreateInfo& createInfo) {
+        StateWriter writer(m_state, m_handles);
+        writeCreateInfo(writer, createInfo);
+
+        ContentHash hash;
+        hash.add(m_state.data(), m_state.size());
+        m_hash = hash.get();
+    }
+
+    uint64_t PipelineState::getHash() const { return m_hash; }
+
+    bool PipelineState::references(uint64_t handleKey) const { return std::find(m_handles.begin(), m_handles.end(), handleKey) != m_handles.end(); }
+
+    bool PipelineState::operator==(const PipelineState& other) const { return m_hash == other.m_hash && m_state == other.m_state; }
+}
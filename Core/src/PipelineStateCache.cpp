@@ -0,0 +1,68 @@
+#include "Core/PipelineStateCache.hpp"
+
+#include <vector>
+
+namespace Core {
+
+    PipelineStateCache::PipelineStateCache(vk::Device& device)
+        : m_device(device) {}
+
+    PipelineStateCache::~PipelineStateCache() = default;
+
+    std::shared_ptr<GraphicsPipeline> PipelineStateCache::get(const vk::GraphicsPipelineCreateInfo& createInfo) {
+        PipelineState state(createInfo);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto pipeline = m_pipelines.find(state);
+        if (pipeline != m_pipelines.end()) {
+            m_stats.hits++;
+            return pipeline->second;
+        }
+
+        // Created on its own, so there is no base in the same call to derive from by index
+        vk::GraphicsPipelineCreateInfo singleCreateInfo = createInfo;
+        if (singleCreateInfo.basePipelineIndex != -1) {
+            singleCreateInfo.flags &= ~vk::PipelineCreateFlags(vk::PipelineCreateFlagBits::eDerivative);
+            singleCreateInfo.basePipelineIndex = -1;
+        }
+        std::vector<vk::Pipeline> createdPipelines = m_device.createGraphicsPipelines(vk::PipelineCache(), singleCreateInfo);
+        auto created = std::make_shared<GraphicsPipeline>(m_device, createdPipelines[0]);
+        m_pipelines.emplace(std::move(state), created);
+
+        m_stats.misses++;
+        m_stats.pipelineCount = m_pipelines.size();
+        return created;
+    }
+
+    std::shared_ptr<GraphicsPipeline> PipelineStateCache::get(RasterPipelineBuilder& builder) {
+        vk::GraphicsPipelineCreateInfo createInfo;
+        builder.getPipelineCreateInfo(createInfo);
+        return get(createInfo);
+    }
+
+    std::size_t PipelineStateCache::releaseUnused() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::size_t released = std::erase_if(m_pipelines, [](const auto& entry) { return entry.second.use_count() == 1; });
+        m_stats.pipelineCount = m_pipelines.size();
+        return released;
+    }
+
+    std::size_t PipelineStateCache::releaseReferencing(uint64_t handleKey) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::size_t released = std::erase_if(m_pipelines, [handleKey](const auto& entry) { return entry.first.references(handleKey); });
+        m_stats.pipelineCount = m_pipelines.size();
+        return released;
+    }
+
+    PipelineStateCache::Stats PipelineStateCache::getStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    void PipelineStateCache::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        out << "Pipeline state cache: " << stats.pipelineCount << " pipelines, " << stats.hits << " hits, " << stats.misses << " misses" << std::endl;
+    }
+}
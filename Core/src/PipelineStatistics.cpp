@@ -0,0 +1,118 @@
+#include "Core/PipelineStatistics.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    /// The only statistic counted, so each query has a single result
+    constexpr vk::QueryPipelineStatisticFlags COUNTED_STATISTICS = vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
+}
+
+namespace Core {
+
+    PipelineStatistics::PipelineStatistics(Renderer& renderer)
+        : m_device(renderer.getDevice())
+        , m_supported(renderer.getEnabledFeatures().pipelineStatisticsQuery) {}
+
+    PipelineStatistics::~PipelineStatistics() {
+        if (m_queryPool) {
+            m_device.destroyQueryPool(m_queryPool);
+        }
+    }
+
+    void PipelineStatistics::resize(std::size_t slotCount) {
+        m_submittedPixels.assign(slotCount, 0);
+        if (!m_supported) {
+            return;
+        }
+
+        if (m_queryPool) {
+            m_device.destroyQueryPool(m_queryPool);
+        }
+        vk::QueryPoolCreateInfo queryInfo{
+            vk::QueryPoolCreateFlags(),
+            vk::QueryType::ePipelineStatistics,
+            static_cast<uint32_t>(slotCount),
+            COUNTED_STATISTICS,
+        };
+        m_queryPool = m_device.createQueryPool(queryInfo);
+    }
+
+    bool PipelineStatistics::isSupported() const { return m_supported; }
+
+    void PipelineStatistics::recordBegin(vk::CommandBuffer& buffer, std::size_t slot) const {
+        if (!m_supported) {
+            return;
+        }
+        buffer.resetQueryPool(m_queryPool, static_cast<uint32_t>(slot), 1);
+        buffer.beginQuery(m_queryPool, static_cast<uint32_t>(slot), vk::QueryControlFlags());
+    }
+
+    void PipelineStatistics::recordEnd(vk::CommandBuffer& buffer, std::size_t slot) const {
+        if (!m_supported) {
+            return;
+        }
+        buffer.endQuery(m_queryPool, static_cast<uint32_t>(slot));
+    }
+
+    void PipelineStatistics::frameSubmitted(std::size_t slot, uint64_t pixelCount) { m_submittedPixels[slot] = std::max<uint64_t>(pixelCount, 1); }
+
+    void PipelineStatistics::collectCompleted() {
+        for (std::size_t slot = 0; slot < m_submittedPixels.size(); slot++) {
+            uint64_t pixelCount = m_submittedPixels[slot];
+            if (pixelCount == 0) {
+                continue;
+            }
+            m_submittedPixels[slot] = 0;
+            if (!m_supported) {
+                continue;
+            }
+
+            uint64_t invocations = 0;
+            vk::Result result = m_device.getQueryPoolResults(m_queryPool,
+                                                             static_cast<uint32_t>(slot),
+                                                             1,
+                                                             sizeof(invocations),
+                                                             &invocations,
+                                                             sizeof(uint64_t),
+                                                             vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+            if (result != vk::Result::eSuccess) {
+                throw std::runtime_error("Failed to read the frame's pipeline statistics: " + vk::to_string(result));
+            }
+
+            float invocationsPerPixel = static_cast<float>(static_cast<double>(invocations) / static_cast<double>(pixelCount));
+            m_stats.frames++;
+            m_stats.lastFragmentInvocations = invocations;
+            m_stats.lastInvocationsPerPixel = invocationsPerPixel;
+            m_invocationSum += invocations;
+            m_invocationsPerPixelSum += invocationsPerPixel;
+        }
+    }
+
+    PipelineStatistics::Stats PipelineStatistics::getStats() const {
+        Stats stats = m_stats;
+        if (stats.frames > 0) {
+            stats.averageFragmentInvocations = m_invocationSum / stats.frames;
+            stats.averageInvocationsPerPixel = static_cast<float>(m_invocationsPerPixelSum / static_cast<double>(stats.frames));
+        }
+        return stats;
+    }
+
+    void PipelineStatistics::resetStats() {
+        m_stats = Stats{};
+        m_invocationSum = 0;
+        m_invocationsPerPixelSum = 0.0;
+    }
+
+    void PipelineStatistics::printStats(std::ostream& out) const {
+        out << "Pipeline statistics: ";
+        if (!m_supported) {
+            out << "the device does not support pipeline statistics queries" << std::endl;
+            return;
+        }
+        Stats stats = getStats();
+        out << stats.frames << " frames, " << stats.averageFragmentInvocations << " fragment shader invocations average ("
+            << stats.averageInvocationsPerPixel << " per pixel), " << stats.lastFragmentInvocations << " last (" << stats.lastInvocationsPerPixel
+            << " per pixel)" << std::endl;
+    }
+}
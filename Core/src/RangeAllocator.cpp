@@ -0,0 +1,125 @@
+#include "Core/RangeAllocator.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace Core {
+    RangeAllocator::RangeAllocator(Size capacity)
+        : m_capacity(capacity) {
+        if (capacity > 0) {
+            insertFreeRange(0, capacity);
+        }
+    }
+
+    RangeAllocator::~RangeAllocator() = default;
+
+    std::optional<RangeAllocator::Size> RangeAllocator::allocate(Size size, Size alignment) {
+        if (size == 0 || alignment == 0) {
+            throw std::runtime_error("RangeAllocator: size and alignment must be non-zero");
+        }
+
+        // Best fit: walk up from the smallest free range that could possibly hold the request.
+        // Only misaligned ranges need to be skipped, so this usually succeeds on the first candidate.
+        for (auto candidate = m_freeBySize.lower_bound(size); candidate != m_freeBySize.end(); candidate++) {
+            Size rangeOffset = candidate->second;
+            Size rangeSize = candidate->first;
+
+            Size alignedOffset = (rangeOffset + alignment - 1) / alignment * alignment;
+            Size padding = alignedOffset - rangeOffset;
+            if (padding + size > rangeSize) {
+                continue;
+            }
+
+            eraseFreeRange(m_freeByOffset.find(rangeOffset));
+
+            // Padding before the allocation stays free, so alignment does not leak space
+            if (padding > 0) {
+                insertFreeRange(rangeOffset, padding);
+            }
+            Size remainder = rangeSize - padding - size;
+            if (remainder > 0) {
+                insertFreeRange(alignedOffset + size, remainder);
+            }
+
+            m_allocations.emplace(alignedOffset, size);
+            m_usedUnits += size;
+            return alignedOffset;
+        }
+
+        return std::nullopt;
+    }
+
+    void RangeAllocator::free(Size offset) {
+        auto allocation = m_allocations.find(offset);
+        if (allocation == m_allocations.end()) {
+            throw std::runtime_error("RangeAllocator: freeing unknown offset " + std::to_string(offset));
+        }
+
+        Size size = allocation->second;
+        m_allocations.erase(allocation);
+        m_usedUnits -= size;
+
+        // Coalesce with the free range directly after this one
+        auto next = m_freeByOffset.find(offset + size);
+        if (next != m_freeByOffset.end()) {
+            size += next->second;
+            eraseFreeRange(next);
+        }
+
+        // And the free range directly before
+        auto previous = m_freeByOffset.lower_bound(offset);
+        if (previous != m_freeByOffset.begin()) {
+            previous--;
+            if (previous->first + previous->second == offset) {
+                offset = previous->first;
+                size += previous->second;
+                eraseFreeRange(previous);
+            }
+        }
+
+        insertFreeRange(offset, size);
+    }
+
+    RangeAllocator::Stats RangeAllocator::getStats() const {
+        return Stats{
+            m_capacity,
+            m_usedUnits,
+            m_capacity - m_usedUnits,
+            m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first,
+            m_freeByOffset.size(),
+            m_allocations.size(),
+        };
+    }
+
+    RangeAllocator::Size RangeAllocator::getCapacity() const { return m_capacity; }
+
+    float RangeAllocator::Stats::fragmentation() const {
+        if (freeUnits == 0) {
+            return 0.0f;
+        }
+        return 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(freeUnits);
+    }
+
+    float RangeAllocator::Stats::occupancy() const {
+        if (capacity == 0) {
+            return 0.0f;
+        }
+        return static_cast<float>(usedUnits) / static_cast<float>(capacity);
+    }
+
+    void RangeAllocator::insertFreeRange(Size offset, Size size) {
+        m_freeByOffset.emplace(offset, size);
+        m_freeBySize.emplace(size, offset);
+    }
+
+    void RangeAllocator::eraseFreeRange(std::map<Size, Size>::iterator range) {
+        auto [first, last] = m_freeBySize.equal_range(range->second);
+        for (auto bySize = first; bySize != last; bySize++) {
+            if (bySize->second == range->first) {
+                m_freeBySize.erase(bySize);
+                break;
+            }
+        }
+        m_freeByOffset.erase(range);
+    }
+}
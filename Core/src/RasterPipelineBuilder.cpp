@@ -1,5 +1,7 @@
 #include "Core/RasterPipelineBuilder.hpp"
 
+#include <algorithm>
+
 namespace Core {
     RasterPipelineBuilder::RasterPipelineBuilder() = default;
     RasterPipelineBuilder::~RasterPipelineBuilder() = default;
@@ -8,6 +10,9 @@ namespace Core {
         // Member from PipelineBuilder
         createInfo.flags = m_pipelineCreateFlags;
 
+        // Attachment formats take the place of the render pass with dynamic rendering
+        createInfo.pNext = m_dynamicRendering ? &m_renderingCreateInfo : nullptr;
+
         // Must be overriden by a subclass
         createInfo.stageCount = 0;
         createInfo.pStages = nullptr;
@@ -16,7 +21,7 @@ namespace Core {
         // Can be overriden without reconciliation by subclass
         createInfo.pInputAssemblyState = nullptr;
         createInfo.pTessellationState = nullptr;
-        createInfo.pDepthStencilState = nullptr; // TODO
+        createInfo.pDepthStencilState = m_hasDepthStencilState ? &m_depthStencilState : nullptr;
 
         // A subclass may have to merge these with their own settings
         createInfo.pViewportState = &m_viewportState;
@@ -25,6 +30,15 @@ namespace Core {
         createInfo.pDynamicState = &m_dynamicState;
         createInfo.pColorBlendState = &m_colourBlendState;
 
+        if (m_fixedFunctionState) {
+            createInfo.pInputAssemblyState = m_fixedFunctionState->getInputAssemblyState();
+            createInfo.pDepthStencilState = m_fixedFunctionState->getDepthStencilState();
+            createInfo.pRasterizationState = m_fixedFunctionState->getRasterizationState();
+            createInfo.pMultisampleState = m_fixedFunctionState->getMultisampleState();
+            createInfo.pDynamicState = m_fixedFunctionState->getDynamicState();
+            createInfo.pColorBlendState = m_fixedFunctionState->getColourBlendState();
+        }
+
             // Previously created object handles that cannot be merged with another
         createInfo.layout = m_pipelineLayout;
 
@@ -36,12 +50,122 @@ namespace Core {
         createInfo.basePipelineIndex = m_basePipelineIndex;
     }
 
+    PipelineState RasterPipelineBuilder::getPipelineState() {
+        vk::GraphicsPipelineCreateInfo createInfo;
+        getPipelineCreateInfo(createInfo);
+        return PipelineState(createInfo);
+    }
+
+    void RasterPipelineBuilder::getPermutationCreateInfos(ShaderType stage,
+                                                          std::span<const SpecializationConstants> permutations,
+                                                          std::vector<vk::GraphicsPipelineCreateInfo>& createInfos) {
+        vk::GraphicsPipelineCreateInfo baseCreateInfo;
+        getPipelineCreateInfo(baseCreateInfo);
+
+        // Filled completely before any pointer into them is taken
+        m_permutationConstants.assign(permutations.begin(), permutations.end());
+        m_permutationStages.assign(permutations.size(),
+                                   std::vector<vk::PipelineShaderStageCreateInfo>(baseCreateInfo.pStages, baseCreateInfo.pStages + baseCreateInfo.stageCount));
+
+        createInfos.clear();
+        createInfos.reserve(permutations.size());
+        for (std::size_t i = 0; i < permutations.size(); i++) {
+            std::vector<vk::PipelineShaderStageCreateInfo>& stages = m_permutationStages[i];
+            auto specialized = std::find_if(stages.begin(), stages.end(), [&](const vk::PipelineShaderStageCreateInfo& s) { return s.stage == stage; });
+            if (specialized == stages.end()) {
+                throw std::runtime_error(std::string("Can't specialize a stage without a shader: ") + vk::to_string(stage));
+            }
+            specialized->pSpecializationInfo = m_permutationConstants[i].getInfo();
+
+            vk::GraphicsPipelineCreateInfo& createInfo = createInfos.emplace_back(baseCreateInfo);
+            createInfo.pStages = stages.data();
+            if (i == 0) {
+                // Keeps any base set with setBasePipeline()
+                createInfo.flags |= vk::PipelineCreateFlagBits::eAllowDerivatives;
+            } else {
+                createInfo.flags |= vk::PipelineCreateFlagBits::eDerivative;
+                createInfo.basePipelineHandle = vk::Pipeline(); // Null handle
+                createInfo.basePipelineIndex = 0;
+            }
+        }
+    }
+
+    void RasterPipelineBuilder::getLibraryCreateInfo(vk::GraphicsPipelineLibraryFlagBitsEXT part, vk::GraphicsPipelineCreateInfo& createInfo) {
+        auto partIndex = static_cast<std::size_t>(std::find(std::begin(s_libraryParts), std::end(s_libraryParts), part) - std::begin(s_libraryParts));
+        if (partIndex == s_libraryPartCount) {
+            throw std::runtime_error("Not a single pipeline library part: " + vk::to_string(part));
+        }
+
+        vk::GraphicsPipelineCreateInfo pipelineCreateInfo;
+        getPipelineCreateInfo(pipelineCreateInfo);
+
+        m_libraryCreateInfos[partIndex] = vk::GraphicsPipelineLibraryCreateInfoEXT{vk::GraphicsPipelineLibraryFlagsEXT(part)};
+        if (m_dynamicRendering && part != vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface) {
+            // Every part that would take the render pass takes the attachment formats instead
+            m_libraryCreateInfos[partIndex].pNext = &m_renderingCreateInfo;
+        }
+        std::vector<vk::PipelineShaderStageCreateInfo>& stages = m_libraryStages[partIndex];
+        stages.clear();
+
+        // Derivatives do not apply to libraries, and the libraries keep what an optimized link needs
+        createInfo = vk::GraphicsPipelineCreateInfo();
+        createInfo.pNext = &m_libraryCreateInfos[partIndex];
+        createInfo.flags = vk::PipelineCreateFlagBits::eLibraryKHR | vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT;
+        createInfo.pDynamicState = pipelineCreateInfo.pDynamicState;
+
+        switch (part) {
+        case vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface:
+            createInfo.pVertexInputState = pipelineCreateInfo.pVertexInputState;
+            createInfo.pInputAssemblyState = pipelineCreateInfo.pInputAssemblyState;
+            break;
+        case vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders:
+            for (uint32_t i = 0; i < pipelineCreateInfo.stageCount; i++) {
+                if (pipelineCreateInfo.pStages[i].stage != vk::ShaderStageFlagBits::eFragment) {
+                    stages.push_back(pipelineCreateInfo.pStages[i]);
+                }
+            }
+            createInfo.pTessellationState = pipelineCreateInfo.pTessellationState;
+            createInfo.pViewportState = pipelineCreateInfo.pViewportState;
+            createInfo.pRasterizationState = pipelineCreateInfo.pRasterizationState;
+            createInfo.layout = pipelineCreateInfo.layout;
+            createInfo.renderPass = pipelineCreateInfo.renderPass;
+            createInfo.subpass = pipelineCreateInfo.subpass;
+            break;
+        case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader:
+            for (uint32_t i = 0; i < pipelineCreateInfo.stageCount; i++) {
+                if (pipelineCreateInfo.pStages[i].stage == vk::ShaderStageFlagBits::eFragment) {
+                    stages.push_back(pipelineCreateInfo.pStages[i]);
+                }
+            }
+            createInfo.pMultisampleState = pipelineCreateInfo.pMultisampleState;
+            createInfo.pDepthStencilState = pipelineCreateInfo.pDepthStencilState;
+            createInfo.layout = pipelineCreateInfo.layout;
+            createInfo.renderPass = pipelineCreateInfo.renderPass;
+            createInfo.subpass = pipelineCreateInfo.subpass;
+            break;
+        case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface:
+            createInfo.pColorBlendState = pipelineCreateInfo.pColorBlendState;
+            createInfo.pMultisampleState = pipelineCreateInfo.pMultisampleState;
+            createInfo.renderPass = pipelineCreateInfo.renderPass;
+            createInfo.subpass = pipelineCreateInfo.subpass;
+            break;
+        }
+
+        createInfo.stageCount = static_cast<uint32_t>(stages.size());
+        createInfo.pStages = stages.empty() ? nullptr : stages.data();
+    }
+
     void RasterPipelineBuilder::setWindowSize(uint32_t width, uint32_t height) {
         m_viewport.width = width;
         m_viewport.height = height;
         m_scissors.extent = vk::Extent2D(width, height);
     }
 
+    void RasterPipelineBuilder::setDepthStencilState(const vk::PipelineDepthStencilStateCreateInfo& state) {
+        m_depthStencilState = state;
+        m_hasDepthStencilState = true;
+    }
+
     void RasterPipelineBuilder::setPipelineLayout(const PipelineLayout& layout) {
         m_pipelineLayout = layout.getHandle();
     }
@@ -49,6 +173,26 @@ namespace Core {
     void RasterPipelineBuilder::setRenderPass(const RenderPass& renderPass, uint32_t subpass) {
         m_renderPass = renderPass.getHandle();
         m_subpass = subpass;
+        m_dynamicRendering = false;
+    }
+
+    void RasterPipelineBuilder::setRenderingFormats(std::span<const vk::Format> colourFormats, vk::Format depthFormat, vk::Format stencilFormat) {
+        m_colourFormats.assign(colourFormats.begin(), colourFormats.end());
+        m_renderingCreateInfo = vk::PipelineRenderingCreateInfoKHR{
+            0, // View mask
+            static_cast<uint32_t>(m_colourFormats.size()),
+            m_colourFormats.data(),
+            depthFormat,
+            stencilFormat,
+        };
+        m_dynamicRendering = true;
+
+        m_renderPass = vk::RenderPass();
+        m_subpass = 0;
+    }
+
+    void RasterPipelineBuilder::setFixedFunctionState(const FixedFunctionState& state) {
+        m_fixedFunctionState = &state;
     }
 
     void RasterPipelineBuilder::addColourAttachmentBlendState(const vk::PipelineColorBlendAttachmentState &state) {
@@ -1,10 +1,49 @@
 #include "Core/RenderPass.hpp"
 
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    vk::RenderPass createRenderPass(vk::Device& device, const Core::RenderPassDescription& description, std::span<const vk::Format> runtimeFormats) {
+        if (runtimeFormats.size() != description.getRuntimeFormatCount()) {
+            throw std::runtime_error("Render pass needs " + std::to_string(description.getRuntimeFormatCount()) +
+                                     " runtime attachment formats, but was given " + std::to_string(runtimeFormats.size()));
+        }
+        if (runtimeFormats.empty()) {
+            return device.createRenderPass(description.getCreateInfo());
+        }
+        if (description.getAttachments().size() > Core::RenderPassDescription::s_maxAttachments) {
+            throw std::runtime_error("Render pass has more attachments than runtime formats can be given for");
+        }
+
+        // Copied to the stack to fill in the formats, the description itself is constant
+        std::array<vk::AttachmentDescription, Core::RenderPassDescription::s_maxAttachments> attachments;
+        std::span<const vk::AttachmentDescription> describedAttachments = description.getAttachments();
+        std::copy(describedAttachments.begin(), describedAttachments.end(), attachments.begin());
+        auto runtimeFormat = runtimeFormats.begin();
+        for (std::size_t i = 0; i < describedAttachments.size(); i++) {
+            if (attachments[i].format == vk::Format::eUndefined) {
+                attachments[i].format = *runtimeFormat++;
+            }
+        }
+
+        vk::RenderPassCreateInfo createInfo = description.getCreateInfo();
+        createInfo.pAttachments = attachments.data();
+        return device.createRenderPass(createInfo);
+    }
+}
+
 namespace Core {
     RenderPass::RenderPass(vk::Device& device, const vk::RenderPassCreateInfo& createInfo)
         : m_device(device)
         , m_handle(m_device.createRenderPass(createInfo)) {}
 
+    RenderPass::RenderPass(vk::Device& device, const RenderPassDescription& description, std::span<const vk::Format> runtimeFormats)
+        : m_device(device)
+        , m_handle(createRenderPass(device, description, runtimeFormats)) {}
+
     RenderPass::~RenderPass() { m_device.destroyRenderPass(m_handle); }
 
     const vk::RenderPass& RenderPass::getHandle() const { return m_handle; }
@@ -1,5 +1,6 @@
 #include "Core/Renderer.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <set>
 #include <string>
@@ -7,6 +8,23 @@
 
 #define DESIRED_PRESENT_QUEUES 1
 
+namespace {
+    /// Device extensions that Core can make use of, but does not require.
+    /// These are enabled whenever the chosen device supports them.
+    const char* OPTIONAL_DEVICE_EXTENSIONS[] = {
+        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+        VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+        VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME,
+        VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+        VK_KHR_PRESENT_ID_EXTENSION_NAME,
+        VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+    };
+
+    void eraseExtension(std::vector<vk::ExtensionProperties>& extensions, const char* extensionName) {
+        std::erase_if(extensions, [extensionName](const vk::ExtensionProperties& extension) { return std::string(extensionName) == extension.extensionName; });
+    }
+}
+
 namespace Core {
 
     // -- ctor and helpers --
@@ -174,17 +192,33 @@ namespace Core {
 
     bool Renderer::addDeviceFeatures(vk::PhysicalDeviceFeatures features) {
         m_features = features;
+
+        // Optional features are enabled when supported, like optional extensions, so apps can measure with them where they can
+        vk::PhysicalDeviceFeatures supported = m_physicalDevice.getFeatures();
+        if (supported.pipelineStatisticsQuery) {
+            m_features.pipelineStatisticsQuery = VK_TRUE;
+        }
         return true;
     }
 
     bool Renderer::addDeviceExtensions(uint32_t deviceExtensionCount, const char** deviceExtensions) {
-        m_deviceExtensions.reserve(deviceExtensionCount);
+        // Clear anything left behind by a previously rejected device
+        m_deviceExtensions.clear();
+        m_deviceExtensions.reserve(deviceExtensionCount + std::size(OPTIONAL_DEVICE_EXTENSIONS));
 
         std::unordered_set<std::string> requiredExtensions;
         for (uint32_t i = 0; i < deviceExtensionCount; i++) {
             requiredExtensions.emplace(deviceExtensions[i]);
         }
 
+        // Optional extensions are enabled when found, but their absence does not make a device unsuitable
+        std::unordered_set<std::string> optionalExtensions;
+        for (const char* extension : OPTIONAL_DEVICE_EXTENSIONS) {
+            if (!requiredExtensions.count(extension)) {
+                optionalExtensions.emplace(extension);
+            }
+        }
+
         std::vector<vk::ExtensionProperties> extensionProperties = m_physicalDevice.enumerateDeviceExtensionProperties();
         std::cout << "    Supported Device Extensions:" << std::endl;
         for (auto& extension : extensionProperties) {
@@ -195,6 +229,9 @@ namespace Core {
                 m_deviceExtensions.push_back(extension);
                 requiredExtensions.erase(search);
                 std::cout << "[Enabled] ";
+            } else if (optionalExtensions.erase(std::string(extension.extensionName))) {
+                m_deviceExtensions.push_back(extension);
+                std::cout << "[Optional] ";
             }
 
             std::cout << extension.extensionName << std::endl;
@@ -326,6 +363,44 @@ namespace Core {
             }
         }
 
+        // Some extensions are only usable with their feature, which not every driver exposing the extension supports
+        vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryFeatures;
+        if (isDeviceExtensionEnabled(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+            vk::PhysicalDeviceFeatures2 features;
+            features.pNext = &graphicsPipelineLibraryFeatures;
+            m_physicalDevice.getFeatures2(&features);
+            if (!graphicsPipelineLibraryFeatures.graphicsPipelineLibrary) {
+                eraseExtension(m_deviceExtensions, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+            }
+        }
+        bool graphicsPipelineLibraryEnabled = isDeviceExtensionEnabled(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+
+        vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures;
+        if (isDeviceExtensionEnabled(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+            vk::PhysicalDeviceFeatures2 features;
+            features.pNext = &dynamicRenderingFeatures;
+            m_physicalDevice.getFeatures2(&features);
+            if (!dynamicRenderingFeatures.dynamicRendering) {
+                eraseExtension(m_deviceExtensions, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+            }
+        }
+        bool dynamicRenderingEnabled = isDeviceExtensionEnabled(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+
+        // Present wait needs present ids to wait on, so they are only used together
+        vk::PhysicalDevicePresentIdFeaturesKHR presentIdFeatures;
+        vk::PhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures;
+        if (isDeviceExtensionEnabled(VK_KHR_PRESENT_ID_EXTENSION_NAME) && isDeviceExtensionEnabled(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+            presentIdFeatures.pNext = &presentWaitFeatures;
+            vk::PhysicalDeviceFeatures2 features;
+            features.pNext = &presentIdFeatures;
+            m_physicalDevice.getFeatures2(&features);
+        }
+        bool presentWaitEnabled = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+        if (!presentWaitEnabled) {
+            eraseExtension(m_deviceExtensions, VK_KHR_PRESENT_ID_EXTENSION_NAME);
+            eraseExtension(m_deviceExtensions, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        }
+
         std::vector<const char*> deviceExtensionNames;
         for (auto& extension : m_deviceExtensions) {
             deviceExtensionNames.push_back(extension.extensionName);
@@ -341,6 +416,22 @@ namespace Core {
             deviceExtensionNames.data(),
             &m_features,
         };
+        // The queried features of each enabled extension are chained to enable them
+        void* enabledFeatures = nullptr;
+        if (graphicsPipelineLibraryEnabled) {
+            graphicsPipelineLibraryFeatures.pNext = enabledFeatures;
+            enabledFeatures = &graphicsPipelineLibraryFeatures;
+        }
+        if (dynamicRenderingEnabled) {
+            dynamicRenderingFeatures.pNext = enabledFeatures;
+            enabledFeatures = &dynamicRenderingFeatures;
+        }
+        if (presentWaitEnabled) {
+            presentWaitFeatures.pNext = enabledFeatures;
+            presentIdFeatures.pNext = &presentWaitFeatures;
+            enabledFeatures = &presentIdFeatures;
+        }
+        deviceCreateInfo.pNext = enabledFeatures;
 
         m_device = m_physicalDevice.createDevice(deviceCreateInfo);
 
@@ -370,6 +461,14 @@ namespace Core {
             vk::FenceCreateFlagBits::eSignaled,
         };
         m_renderSyncFence = m_device.createFence(fenceCreateInfo);
+
+        m_shaderLibrary = std::make_unique<ShaderLibrary>(m_device);
+        m_pipelineCompiler = std::make_unique<PipelineCompiler>(m_device);
+        m_pipelineLibraryCache = std::make_unique<PipelineLibraryCache>(m_device, *m_pipelineCompiler, graphicsPipelineLibraryEnabled);
+        m_pipelineStateCache = std::make_unique<PipelineStateCache>(m_device);
+        m_shaderLibrary->setReleaseCallback([this](vk::ShaderModule module) { releaseCachedPipelines(PipelineState::getHandleKey(module)); });
+        m_dynamicRendering = std::make_unique<DynamicRendering>(m_device, dynamicRenderingEnabled);
+        m_framePacer = std::make_unique<FramePacer>(m_device, presentWaitEnabled);
     }
 
     bool Renderer::chooseSwapchainSettings() {
@@ -396,30 +495,13 @@ namespace Core {
             return false;
         }
 
+        // The present mode is chosen for the frame pacing profile when the swapchain is created
         std::vector<vk::PresentModeKHR> supportedPresentModes = m_physicalDevice.getSurfacePresentModesKHR(m_surface);
-        std::set<vk::PresentModeKHR> presentModeSet(supportedPresentModes.begin(), supportedPresentModes.end());
-        m_presentMode = vk::PresentModeKHR::eFifo; // Guaranteed to be supported
-        std::vector<vk::PresentModeKHR> desiredPresentModes{
-            vk::PresentModeKHR::eMailbox,
-            vk::PresentModeKHR::eImmediate,
-            vk::PresentModeKHR::eFifoRelaxed,
-        };
-
-        for (auto& mode : desiredPresentModes) {
-            if (presentModeSet.count(mode)) {
-                m_presentMode = mode;
-                break;
-            }
-        }
+        m_supportedPresentModes = std::set<vk::PresentModeKHR>(supportedPresentModes.begin(), supportedPresentModes.end());
 
         std::cout << "    Swapchain Present Modes:" << std::endl;
         for (auto& mode : supportedPresentModes) {
-            std::cout << "        ";
-            if (mode == m_presentMode) {
-                std::cout << "[Selected] ";
-            }
-
-            std::cout << vk::to_string(mode) << std::endl;
+            std::cout << "        " << vk::to_string(mode) << std::endl;
         }
 
         return true;
@@ -428,6 +510,11 @@ namespace Core {
     // -- end ctor and helpers --
 
     Renderer::~Renderer() noexcept {
+        // Compilations in flight still use shader modules, and optimized links use cached libraries
+        m_pipelineCompiler.reset();
+        m_pipelineLibraryCache.reset();
+        m_pipelineStateCache.reset();
+        m_shaderLibrary.reset();
         m_device.destroyFence(m_renderSyncFence);
         cleanupOldSwapchain();
         m_instance.destroySurfaceKHR(m_surface);
@@ -445,8 +532,10 @@ namespace Core {
     std::size_t Renderer::getNumSwapchainImages() const { return m_swapchainImages.size(); }
 
     uint32_t Renderer::getNextSwapchainImage(vk::Semaphore semaphore) {
+        m_framePacer->acquireStarted();
         auto [result, value] = m_device.acquireNextImageKHR(m_swapchain, UINT64_MAX, semaphore, vk::Fence());
         REND_DEBUG(result);
+        m_framePacer->imageAcquired();
         return value;
     }
 
@@ -461,11 +550,31 @@ namespace Core {
 
     const QueueGroup& Renderer::getQueue(QueueType type) { return m_queues[type]; }
 
+    const vk::PhysicalDeviceFeatures& Renderer::getEnabledFeatures() const { return m_features; }
+
+    bool Renderer::isDeviceExtensionEnabled(const std::string& extensionName) const {
+        for (const vk::ExtensionProperties& extension : m_deviceExtensions) {
+            if (extensionName == extension.extensionName) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     void Renderer::recreateSwapChain(vk::Extent2D windowExtents) {
         vk::SurfaceCapabilitiesKHR surfaceCapabilities = m_physicalDevice.getSurfaceCapabilitiesKHR(m_surface);
 
-        // TODO Decide on min image count
-        uint32_t minImageCount = surfaceCapabilities.minImageCount;
+        // The frame pacing profile decides how many images may be queued, unless the app has, within what the surface allows
+        uint32_t minImageCount = m_requestedImageCount > 0 ? m_requestedImageCount : surfaceCapabilities.minImageCount + m_framePacer->getExtraImageCount();
+        minImageCount = std::max(minImageCount, surfaceCapabilities.minImageCount);
+        if (surfaceCapabilities.maxImageCount > 0) {
+            minImageCount = std::min(minImageCount, surfaceCapabilities.maxImageCount);
+        }
+
+        vk::PresentModeKHR presentMode = m_requestedPresentMode.value_or(choosePresentMode());
+        bool settingsChanged = presentMode != m_presentMode || minImageCount != m_minImageCount;
+        m_presentMode = presentMode;
+        m_minImageCount = minImageCount;
 
         // TODO Decide on extents
         m_swapchainExtents = windowExtents;
@@ -516,6 +625,43 @@ namespace Core {
         cleanupOldSwapchain();
         m_swapchain = newSwapchain;
         initializeNewSwapchain();
+        m_framePacer->swapchainRecreated(m_swapchain);
+
+        // The implementation may create more images than the minimum asked for
+        if (settingsChanged) {
+            std::cout << "Swapchain: " << vk::to_string(m_presentMode) << ", " << m_swapchainImages.size() << " images";
+            if (m_swapchainImages.size() != minImageCount) {
+                std::cout << " (" << minImageCount << " requested)";
+            }
+            if (!m_requestedPresentMode || !m_requestedImageCount) {
+                std::cout << " for " << to_string(m_framePacer->getProfile()) << " frame pacing";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    void Renderer::setPresentMode(std::optional<vk::PresentModeKHR> presentMode) {
+        if (presentMode && !m_supportedPresentModes.count(*presentMode)) {
+            throw std::runtime_error("Present mode is not supported by the surface: " + vk::to_string(*presentMode));
+        }
+        m_requestedPresentMode = presentMode;
+    }
+
+    void Renderer::setSwapchainImageCount(uint32_t imageCount) { m_requestedImageCount = imageCount; }
+
+    const std::set<vk::PresentModeKHR>& Renderer::getSupportedPresentModes() const { return m_supportedPresentModes; }
+
+    vk::PresentModeKHR Renderer::getPresentMode() const { return m_presentMode; }
+
+    vk::SurfaceCapabilitiesKHR Renderer::getSurfaceCapabilities() const { return m_physicalDevice.getSurfaceCapabilitiesKHR(m_surface); }
+
+    vk::PresentModeKHR Renderer::choosePresentMode() const {
+        for (vk::PresentModeKHR mode : m_framePacer->getPreferredPresentModes()) {
+            if (m_supportedPresentModes.count(mode)) {
+                return mode;
+            }
+        }
+        return vk::PresentModeKHR::eFifo; // Guaranteed to be supported
     }
     void Renderer::cleanupOldSwapchain() {
         m_swapchainImages.clear();
@@ -543,4 +689,21 @@ namespace Core {
 
         return pipelineObjects;
     }
+
+    ShaderLibrary& Renderer::getShaderLibrary() { return *m_shaderLibrary; }
+
+    PipelineCompiler& Renderer::getPipelineCompiler() { return *m_pipelineCompiler; }
+
+    PipelineLibraryCache& Renderer::getPipelineLibraryCache() { return *m_pipelineLibraryCache; }
+
+    PipelineStateCache& Renderer::getPipelineStateCache() { return *m_pipelineStateCache; }
+
+    void Renderer::releaseCachedPipelines(uint64_t handleKey) {
+        m_pipelineLibraryCache->releaseReferencing(handleKey);
+        m_pipelineStateCache->releaseReferencing(handleKey);
+    }
+
+    const DynamicRendering& Renderer::getDynamicRendering() const { return *m_dynamicRendering; }
+
+    FramePacer& Renderer::getFramePacer() { return *m_framePacer; }
 }
@@ -0,0 +1,244 @@
+#include "Core/SceneFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    /// The record size each section must declare. Vertices depend on the vertex format, and are checked separately.
+    constexpr uint32_t expectedElementSize(Core::SceneSectionType type) {
+        switch (type) {
+        case Core::SceneSectionType::Meshes:
+            return sizeof(Core::SceneMesh);
+        case Core::SceneSectionType::Vertices:
+            return 0;
+        case Core::SceneSectionType::Indices:
+            return sizeof(uint32_t);
+        case Core::SceneSectionType::BvhNodes:
+            return sizeof(Core::SceneBvhNode);
+        case Core::SceneSectionType::Materials:
+            return sizeof(Core::SceneMaterial);
+        case Core::SceneSectionType::Instances:
+            return sizeof(Core::SceneInstance);
+        case Core::SceneSectionType::BvhTriangles:
+            return sizeof(uint32_t);
+        }
+        return 0;
+    }
+}
+
+namespace Core {
+
+    const char* to_string(SceneSectionType type) {
+        switch (type) {
+        case SceneSectionType::Meshes:
+            return "Meshes";
+        case SceneSectionType::Vertices:
+            return "Vertices";
+        case SceneSectionType::Indices:
+            return "Indices";
+        case SceneSectionType::BvhNodes:
+            return "BvhNodes";
+        case SceneSectionType::Materials:
+            return "Materials";
+        case SceneSectionType::Instances:
+            return "Instances";
+        case SceneSectionType::BvhTriangles:
+            return "BvhTriangles";
+        }
+        return "Unknown";
+    }
+
+    SceneFile::SceneFile(const std::string& filename)
+        : m_filename(filename) {
+        int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open scene " + filename + ": " + strerror(errno));
+        }
+
+        struct stat fileStat {};
+        if (fstat(fd, &fileStat) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error("Failed to stat scene " + filename + ": " + strerror(error));
+        }
+        m_fileSize = static_cast<std::size_t>(fileStat.st_size);
+        if (m_fileSize < sizeof(SceneHeader)) {
+            close(fd);
+            throw std::runtime_error("Scene " + filename + " is too small to be a scene file");
+        }
+
+        // The mapping keeps the file referenced, so the descriptor is not needed past this point
+        m_mapping = mmap(nullptr, m_fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        int error = errno;
+        close(fd);
+        if (m_mapping == MAP_FAILED) {
+            m_mapping = nullptr;
+            throw std::runtime_error("Failed to map scene " + filename + ": " + strerror(error));
+        }
+        m_data = static_cast<const std::byte*>(m_mapping);
+
+        try {
+            validate();
+        } catch (...) {
+            munmap(m_mapping, m_fileSize);
+            throw;
+        }
+    }
+
+    SceneFile::SceneFile(const std::string& filename, std::vector<char> contents)
+        : m_filename(filename)
+        , m_contents(std::move(contents))
+        , m_data(reinterpret_cast<const std::byte*>(m_contents.data()))
+        , m_fileSize(m_contents.size()) {
+        if (m_fileSize < sizeof(SceneHeader)) {
+            throw std::runtime_error("Scene " + filename + " is too small to be a scene file");
+        }
+        validate();
+    }
+
+    SceneFile::~SceneFile() {
+        if (m_mapping) {
+            munmap(m_mapping, m_fileSize);
+        }
+    }
+
+    VertexFormat SceneFile::getVertexFormat() const { return m_vertexFormat; }
+    std::size_t SceneFile::getFileSize() const { return m_fileSize; }
+
+    std::span<const SceneMesh> SceneFile::getMeshes() const { return getSection<SceneMesh>(SceneSectionType::Meshes); }
+
+    std::span<const std::byte> SceneFile::getVertexData() const {
+        const MappedSection& section = m_sections[static_cast<uint32_t>(SceneSectionType::Vertices)];
+        return std::span<const std::byte>(section.data, section.size);
+    }
+
+    std::size_t SceneFile::getVertexCount() const { return m_sections[static_cast<uint32_t>(SceneSectionType::Vertices)].elementCount; }
+
+    std::span<const uint32_t> SceneFile::getIndices() const { return getSection<uint32_t>(SceneSectionType::Indices); }
+    std::span<const SceneBvhNode> SceneFile::getBvhNodes() const { return getSection<SceneBvhNode>(SceneSectionType::BvhNodes); }
+    std::span<const SceneMaterial> SceneFile::getMaterials() const { return getSection<SceneMaterial>(SceneSectionType::Materials); }
+    std::span<const SceneInstance> SceneFile::getInstances() const { return getSection<SceneInstance>(SceneSectionType::Instances); }
+    std::span<const uint32_t> SceneFile::getBvhTriangles() const { return getSection<uint32_t>(SceneSectionType::BvhTriangles); }
+
+    void SceneFile::prefetch(SceneSectionType type) const {
+        const MappedSection& section = m_sections[static_cast<uint32_t>(type)];
+        if (!m_mapping || section.size == 0) {
+            return;
+        }
+
+        // Sections are page aligned, as madvise requires. Failure only loses the read-ahead, so it is ignored.
+        madvise(const_cast<std::byte*>(section.data), section.size, MADV_SEQUENTIAL);
+        madvise(const_cast<std::byte*>(section.data), section.size, MADV_WILLNEED);
+    }
+
+    void SceneFile::validate() {
+        auto fail = [this](const std::string& reason) { throw std::runtime_error("Invalid scene " + m_filename + ": " + reason); };
+
+        const std::byte* base = m_data;
+        const auto* header = reinterpret_cast<const SceneHeader*>(base);
+
+        if (memcmp(header->magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0) {
+            fail("not a scene file");
+        }
+        if (header->version != SCENE_VERSION) {
+            fail("version " + std::to_string(header->version) + ", expected " + std::to_string(SCENE_VERSION));
+        }
+        if (header->fileSize != m_fileSize) {
+            fail("truncated, expected " + std::to_string(header->fileSize) + " bytes");
+        }
+        if (header->vertexFormat > static_cast<uint32_t>(VertexFormat::Compressed)) {
+            fail("unknown vertex format " + std::to_string(header->vertexFormat));
+        }
+        m_vertexFormat = static_cast<VertexFormat>(header->vertexFormat);
+
+        uint64_t tableEnd = sizeof(SceneHeader) + static_cast<uint64_t>(header->sectionCount) * sizeof(SceneSection);
+        if (tableEnd > m_fileSize) {
+            fail("section table is out of bounds");
+        }
+
+        const auto* sections = reinterpret_cast<const SceneSection*>(base + sizeof(SceneHeader));
+        for (uint32_t i = 0; i < header->sectionCount; i++) {
+            const SceneSection& section = sections[i];
+            if (section.type >= SceneSectionTypeCount) {
+                // Sections from newer writers are skipped
+                continue;
+            }
+            auto type = static_cast<SceneSectionType>(section.type);
+
+            uint32_t elementSize = type == SceneSectionType::Vertices ? getVertexStride(m_vertexFormat) : expectedElementSize(type);
+            if (section.elementSize != elementSize) {
+                fail(std::string(to_string(type)) + " records are " + std::to_string(section.elementSize) + " bytes, expected " +
+                     std::to_string(elementSize));
+            }
+            if (section.offset % SCENE_SECTION_ALIGNMENT != 0) {
+                fail(std::string(to_string(type)) + " section is misaligned");
+            }
+            if (section.elementCount > m_fileSize / elementSize || section.offset > m_fileSize - section.elementCount * elementSize) {
+                fail(std::string(to_string(type)) + " section is out of bounds");
+            }
+
+            m_sections[section.type] = MappedSection{
+                base + section.offset,
+                static_cast<std::size_t>(section.elementCount),
+                static_cast<std::size_t>(section.elementCount * elementSize),
+            };
+        }
+
+        // Mesh records are few, checking them keeps a corrupt file from causing out of bounds copies and draws
+        std::size_t vertexCount = getVertexCount();
+        std::size_t indexCount = getIndices().size();
+        std::size_t bvhNodeCount = getBvhNodes().size();
+        std::size_t bvhTriangleCount = getBvhTriangles().size();
+        for (const SceneMesh& mesh : getMeshes()) {
+            if (static_cast<uint64_t>(mesh.firstVertex) + mesh.vertexCount > vertexCount ||
+                static_cast<uint64_t>(mesh.firstIndex) + mesh.indexCount > indexCount ||
+                static_cast<uint64_t>(mesh.firstBvhNode) + mesh.bvhNodeCount > bvhNodeCount) {
+                fail("mesh ranges are out of bounds");
+            }
+            if (mesh.bvhNodeCount > 0 && (mesh.firstIndex % 3 != 0 || (static_cast<uint64_t>(mesh.firstIndex) + mesh.indexCount) / 3 > bvhTriangleCount)) {
+                fail("mesh BVH triangles are out of bounds");
+            }
+        }
+
+        // Indices and BVH records are read by the GPU and by traversal without bounds checks, so every one is checked
+        for (std::size_t meshIndex = 0; meshIndex < getMeshes().size(); meshIndex++) {
+            const SceneMesh& mesh = getMeshes()[meshIndex];
+            std::string meshName = "mesh " + std::to_string(meshIndex);
+            for (uint32_t index : getIndices().subspan(mesh.firstIndex, mesh.indexCount)) {
+                if (index >= mesh.vertexCount) {
+                    fail(meshName + " has index " + std::to_string(index) + " past its " + std::to_string(mesh.vertexCount) + " vertices");
+                }
+            }
+            if (mesh.bvhNodeCount == 0) {
+                continue;
+            }
+
+            uint32_t triangleCount = mesh.indexCount / 3;
+            for (const SceneBvhNode& node : getBvhNodes().subspan(mesh.firstBvhNode, mesh.bvhNodeCount)) {
+                if (node.triangleCount == 0 && static_cast<uint64_t>(node.firstChildOrTriangle) + 2 > mesh.bvhNodeCount) {
+                    fail(meshName + " has BVH child " + std::to_string(node.firstChildOrTriangle) + " past its " + std::to_string(mesh.bvhNodeCount) +
+                         " nodes");
+                }
+                if (node.triangleCount > 0 && static_cast<uint64_t>(node.firstChildOrTriangle) + node.triangleCount > triangleCount) {
+                    fail(meshName + " has a BVH leaf past its " + std::to_string(triangleCount) + " triangles");
+                }
+            }
+            for (uint32_t triangle : getBvhTriangles().subspan(mesh.firstIndex / 3, triangleCount)) {
+                if (triangle >= triangleCount) {
+                    fail(meshName + " has BVH triangle " + std::to_string(triangle) + " past its " + std::to_string(triangleCount) + " triangles");
+                }
+            }
+        }
+        for (const SceneInstance& instance : getInstances()) {
+            if (instance.mesh >= getMeshes().size()) {
+                fail("instance of mesh " + std::to_string(instance.mesh) + " which does not exist");
+            }
+        }
+    }
+}
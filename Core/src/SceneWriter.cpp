@@ -0,0 +1,159 @@
+#include "Core/SceneWriter.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace Core {
+
+    SceneWriter::SceneWriter(VertexFormat vertexFormat)
+        : m_vertexFormat(vertexFormat) {}
+
+    SceneWriter::~SceneWriter() = default;
+
+    uint32_t SceneWriter::addMesh(const IndexedMesh& mesh,
+                                  const VertexQuantization& quantization,
+                                  uint32_t material,
+                                  const std::vector<SceneBvhNode>& bvhNodes,
+                                  const std::vector<uint32_t>& bvhTriangles) {
+        if (mesh.vertexStride != getVertexStride(m_vertexFormat)) {
+            throw std::runtime_error("SceneWriter: mesh vertices are not in the scene's vertex format");
+        }
+        if (mesh.indices.size() % 3 != 0) {
+            throw std::runtime_error("SceneWriter: mesh indices are not a triangle list");
+        }
+        if (!bvhNodes.empty() && bvhTriangles.size() != mesh.getTriangleCount()) {
+            throw std::runtime_error("SceneWriter: mesh BVH does not list every triangle");
+        }
+
+        SceneMesh record{};
+        record.quantization = quantization;
+        record.firstVertex = static_cast<uint32_t>(m_vertices.size() / mesh.vertexStride);
+        record.vertexCount = mesh.getVertexCount();
+        record.firstIndex = static_cast<uint32_t>(m_indices.size());
+        record.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        record.firstBvhNode = static_cast<uint32_t>(m_bvhNodes.size());
+        record.bvhNodeCount = static_cast<uint32_t>(bvhNodes.size());
+        record.material = material;
+
+        m_vertices.insert(m_vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+        m_indices.insert(m_indices.end(), mesh.indices.begin(), mesh.indices.end());
+        m_bvhNodes.insert(m_bvhNodes.end(), bvhNodes.begin(), bvhNodes.end());
+        if (!bvhNodes.empty()) {
+            m_bvhTriangles.insert(m_bvhTriangles.end(), bvhTriangles.begin(), bvhTriangles.end());
+        } else {
+            // Keep the list parallel to the index buffer
+            for (uint32_t triangle = 0; triangle < mesh.getTriangleCount(); triangle++) {
+                m_bvhTriangles.push_back(triangle);
+            }
+        }
+
+        m_meshes.push_back(record);
+        return static_cast<uint32_t>(m_meshes.size() - 1);
+    }
+
+    uint32_t SceneWriter::addMaterial(const SceneMaterial& material) {
+        m_materials.push_back(material);
+        return static_cast<uint32_t>(m_materials.size() - 1);
+    }
+
+    uint32_t SceneWriter::addInstance(const SceneInstance& instance) {
+        if (instance.mesh >= m_meshes.size()) {
+            throw std::runtime_error("SceneWriter: instance of a mesh that has not been added");
+        }
+        m_instances.push_back(instance);
+        return static_cast<uint32_t>(m_instances.size() - 1);
+    }
+
+    void SceneWriter::addScene(const SceneFile& scene) {
+        if (scene.getVertexFormat() != m_vertexFormat) {
+            throw std::runtime_error("SceneWriter: appended scene has a different vertex format");
+        }
+
+        auto firstVertex = static_cast<uint32_t>(m_vertices.size() / getVertexStride(m_vertexFormat));
+        auto firstIndex = static_cast<uint32_t>(m_indices.size());
+        auto firstBvhNode = static_cast<uint32_t>(m_bvhNodes.size());
+        auto firstMaterial = static_cast<uint32_t>(m_materials.size());
+        auto firstMesh = static_cast<uint32_t>(m_meshes.size());
+
+        // Everything is relative to its mesh, so only the mesh and instance records need rebasing
+        std::span<const std::byte> vertexData = scene.getVertexData();
+        const auto* vertexBytes = reinterpret_cast<const uint8_t*>(vertexData.data());
+        m_vertices.insert(m_vertices.end(), vertexBytes, vertexBytes + vertexData.size());
+        m_indices.insert(m_indices.end(), scene.getIndices().begin(), scene.getIndices().end());
+        m_bvhNodes.insert(m_bvhNodes.end(), scene.getBvhNodes().begin(), scene.getBvhNodes().end());
+        m_bvhTriangles.insert(m_bvhTriangles.end(), scene.getBvhTriangles().begin(), scene.getBvhTriangles().end());
+        m_materials.insert(m_materials.end(), scene.getMaterials().begin(), scene.getMaterials().end());
+
+        for (SceneMesh mesh : scene.getMeshes()) {
+            mesh.firstVertex += firstVertex;
+            mesh.firstIndex += firstIndex;
+            mesh.firstBvhNode += firstBvhNode;
+            mesh.material += firstMaterial;
+            m_meshes.push_back(mesh);
+        }
+        for (SceneInstance instance : scene.getInstances()) {
+            instance.mesh += firstMesh;
+            if (instance.material != SCENE_MESH_MATERIAL) {
+                instance.material += firstMaterial;
+            }
+            m_instances.push_back(instance);
+        }
+    }
+
+    void SceneWriter::write(const std::string& filename) const {
+        struct SectionData {
+            SceneSectionType type;
+            uint32_t elementSize;
+            uint64_t elementCount;
+            const void* data;
+        };
+        uint32_t vertexStride = getVertexStride(m_vertexFormat);
+        const SectionData sectionData[] = {
+            {SceneSectionType::Meshes, sizeof(SceneMesh), m_meshes.size(), m_meshes.data()},
+            {SceneSectionType::Vertices, vertexStride, m_vertices.size() / vertexStride, m_vertices.data()},
+            {SceneSectionType::Indices, sizeof(uint32_t), m_indices.size(), m_indices.data()},
+            {SceneSectionType::BvhNodes, sizeof(SceneBvhNode), m_bvhNodes.size(), m_bvhNodes.data()},
+            {SceneSectionType::Materials, sizeof(SceneMaterial), m_materials.size(), m_materials.data()},
+            {SceneSectionType::Instances, sizeof(SceneInstance), m_instances.size(), m_instances.data()},
+            {SceneSectionType::BvhTriangles, sizeof(uint32_t), m_bvhTriangles.size(), m_bvhTriangles.data()},
+        };
+
+        auto align = [](uint64_t offset) { return (offset + SCENE_SECTION_ALIGNMENT - 1) / SCENE_SECTION_ALIGNMENT * SCENE_SECTION_ALIGNMENT; };
+
+        // Lay out the sections after the header and table
+        std::vector<SceneSection> sections;
+        uint64_t offset = sizeof(SceneHeader) + std::size(sectionData) * sizeof(SceneSection);
+        for (const SectionData& data : sectionData) {
+            offset = align(offset);
+            sections.push_back(SceneSection{static_cast<uint32_t>(data.type), data.elementSize, offset, data.elementCount});
+            offset += data.elementCount * data.elementSize;
+        }
+
+        SceneHeader header{};
+        memcpy(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+        header.version = SCENE_VERSION;
+        header.vertexFormat = static_cast<uint32_t>(m_vertexFormat);
+        header.fileSize = offset;
+        header.sectionCount = static_cast<uint32_t>(sections.size());
+
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Failed to create scene " + filename);
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(sections.data()), static_cast<std::streamsize>(sections.size() * sizeof(SceneSection)));
+
+        const char padding[SCENE_SECTION_ALIGNMENT] = {};
+        for (std::size_t i = 0; i < sections.size(); i++) {
+            auto position = static_cast<uint64_t>(file.tellp());
+            file.write(padding, static_cast<std::streamsize>(sections[i].offset - position));
+            file.write(static_cast<const char*>(sectionData[i].data), static_cast<std::streamsize>(sections[i].elementCount * sections[i].elementSize));
+        }
+
+        if (!file) {
+            throw std::runtime_error("Failed to write scene " + filename);
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include "Core/Shader.hpp"
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -24,26 +25,53 @@ namespace Core {
         file.read(shaderData.data(), shaderByteLength);
         file.close();
 
-        vk::ShaderModuleCreateInfo shaderModuleCreateInfo{
-            vk::ShaderModuleCreateFlags(),
-            shaderByteLength,
-            reinterpret_cast<uint32_t*>(shaderData.data()),
-        };
+        createShaderModule(shaderData.data(), shaderByteLength);
+    }
 
-        m_shaderModule = device.createShaderModule(shaderModuleCreateInfo);
+    Shader::Shader(const std::string& name, const void* code, std::size_t size, Core::ShaderType type, vk::Device device)
+        : m_name(name)
+        , m_type(type)
+        , m_device(device) {
+        createShaderModule(code, size);
     }
 
+    Shader::Shader(const std::string& name, std::span<const uint32_t> code, Core::ShaderType type, vk::Device device)
+        : Shader(name, code.data(), code.size_bytes(), type, device) {}
+
     Shader::~Shader() { m_device.destroyShaderModule(m_shaderModule); }
 
-    vk::PipelineShaderStageCreateInfo Shader::getPipelineStageCreateInfo() {
+    vk::PipelineShaderStageCreateInfo Shader::getPipelineStageCreateInfo(const SpecializationConstants* specialization) {
         return vk::PipelineShaderStageCreateInfo{
             vk::PipelineShaderStageCreateFlags(),
             m_type, // Just a direct translation for now
             m_shaderModule,
             "main", // Simple classic
-            nullptr,
+            specialization ? specialization->getInfo() : nullptr,
         };
     }
 
     ShaderType Shader::getType() { return m_type; }
+
+    void Shader::createShaderModule(const void* code, std::size_t size) {
+        if (size == 0 || size % sizeof(uint32_t) != 0) {
+            throw std::runtime_error("Shader " + m_name + " is not valid SPIR-V, its size is not a whole number of words");
+        }
+
+        // Vulkan reads the code as words, so copy it if the caller's buffer is not aligned for that
+        std::vector<uint32_t> alignedCode;
+        const auto* words = static_cast<const uint32_t*>(code);
+        if (reinterpret_cast<uintptr_t>(code) % alignof(uint32_t) != 0) {
+            alignedCode.resize(size / sizeof(uint32_t));
+            memcpy(alignedCode.data(), code, size);
+            words = alignedCode.data();
+        }
+
+        vk::ShaderModuleCreateInfo shaderModuleCreateInfo{
+            vk::ShaderModuleCreateFlags(),
+            size,
+            words,
+        };
+
+        m_shaderModule = m_device.createShaderModule(shaderModuleCreateInfo);
+    }
 }
@@ -0,0 +1,136 @@
+#include "Core/ShaderLibrary.hpp"
+
+#include "Core/ContentHash.hpp"
+#include "Core/EmbeddedShaders.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace Core {
+
+    ShaderLibrary::ShaderLibrary(vk::Device device)
+        : m_device(device) {}
+
+    ShaderLibrary::~ShaderLibrary() = default;
+
+    std::shared_ptr<Shader> ShaderLibrary::load(const std::string& filename, ShaderType type) {
+        std::string nameKey = getNameKey(filename, type);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto named = m_namedShaders.find(nameKey);
+            if (named != m_namedShaders.end()) {
+                if (std::shared_ptr<Shader> shader = named->second.lock()) {
+                    m_stats.hits++;
+                    return shader;
+                }
+            }
+        }
+
+        if (std::optional<std::span<const uint32_t>> embedded = findEmbeddedShader(filename)) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.embeddedLoads++;
+            return findOrCreate(filename, embedded->data(), embedded->size_bytes(), type);
+        }
+
+        // Read without the lock, so other threads are not held up by the disk
+        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Can't load shader from file: " + filename);
+        }
+        std::vector<char> code(static_cast<std::size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(code.data(), static_cast<std::streamsize>(code.size()));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.fileReads++;
+        return findOrCreate(filename, code.data(), code.size(), type);
+    }
+
+    std::shared_ptr<Shader> ShaderLibrary::get(const std::string& name, const void* code, std::size_t size, ShaderType type) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return findOrCreate(name, code, size, type);
+    }
+
+    std::size_t ShaderLibrary::releaseUnused() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::size_t released = 0;
+        for (auto entry = m_entries.begin(); entry != m_entries.end();) {
+            if (entry->second.shader.use_count() == 1) {
+                if (m_releaseCallback) {
+                    m_releaseCallback(entry->second.shader->getPipelineStageCreateInfo().module);
+                }
+                m_stats.codeBytes -= entry->second.code.size() * sizeof(uint32_t);
+                entry = m_entries.erase(entry);
+                released++;
+            } else {
+                ++entry;
+            }
+        }
+
+        for (auto named = m_namedShaders.begin(); named != m_namedShaders.end();) {
+            named = named->second.expired() ? m_namedShaders.erase(named) : std::next(named);
+        }
+
+        m_stats.moduleCount = m_entries.size();
+        return released;
+    }
+
+    void ShaderLibrary::setReleaseCallback(ReleaseCallback callback) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_releaseCallback = std::move(callback);
+    }
+
+    ShaderLibrary::Stats ShaderLibrary::getStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    void ShaderLibrary::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        out << "Shader library: " << stats.moduleCount << " modules (" << stats.codeBytes / 1024 << " KiB of SPIR-V), " << stats.hits << " hits, "
+            << stats.misses << " misses, " << stats.fileReads << " file reads, " << stats.embeddedLoads << " embedded" << std::endl;
+    }
+
+    std::string ShaderLibrary::getNameKey(const std::string& name, ShaderType type) {
+        return name + "#" + std::to_string(static_cast<uint32_t>(type));
+    }
+
+    std::shared_ptr<Shader> ShaderLibrary::findOrCreate(const std::string& name, const void* code, std::size_t size, ShaderType type) {
+        if (size == 0 || size % sizeof(uint32_t) != 0) {
+            throw std::runtime_error("Shader " + name + " is not valid SPIR-V, its size is not a whole number of words");
+        }
+
+        ContentHash hash;
+        hash.addValue(static_cast<uint32_t>(type));
+        hash.add(code, size);
+        uint64_t key = hash.get();
+
+        std::shared_ptr<Shader> shader;
+        auto [first, last] = m_entries.equal_range(key);
+        for (auto entry = first; entry != last; ++entry) {
+            if (entry->second.type == type && entry->second.code.size() * sizeof(uint32_t) == size && memcmp(entry->second.code.data(), code, size) == 0) {
+                shader = entry->second.shader;
+                break;
+            }
+        }
+
+        if (shader) {
+            m_stats.hits++;
+        } else {
+            Entry entry{std::vector<uint32_t>(size / sizeof(uint32_t)), type, nullptr};
+            memcpy(entry.code.data(), code, size);
+            entry.shader = std::make_shared<Shader>(name, entry.code.data(), size, type, m_device);
+            shader = entry.shader;
+            m_entries.emplace(key, std::move(entry));
+
+            m_stats.misses++;
+            m_stats.moduleCount = m_entries.size();
+            m_stats.codeBytes += size;
+        }
+
+        m_namedShaders[getNameKey(name, type)] = shader;
+        return shader;
+    }
+}
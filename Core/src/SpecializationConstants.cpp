@@ -0,0 +1,68 @@
+#include "Core/SpecializationConstants.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Core {
+    SpecializationConstants::SpecializationConstants() = default;
+    SpecializationConstants::~SpecializationConstants() = default;
+
+    SpecializationConstants::SpecializationConstants(const SpecializationConstants& other)
+        : m_entries(other.m_entries)
+        , m_data(other.m_data) {
+        updateInfo();
+    }
+
+    SpecializationConstants& SpecializationConstants::operator=(const SpecializationConstants& other) {
+        m_entries = other.m_entries;
+        m_data = other.m_data;
+        updateInfo();
+        return *this;
+    }
+
+    bool SpecializationConstants::empty() const { return m_entries.empty(); }
+
+    const vk::SpecializationInfo* SpecializationConstants::getInfo() const { return empty() ? nullptr : &m_info; }
+
+    bool SpecializationConstants::operator==(const SpecializationConstants& other) const {
+        return m_entries == other.m_entries && m_data == other.m_data;
+    }
+
+    void SpecializationConstants::setBytes(uint32_t constantId, const void* value, std::size_t size) {
+        auto entry = std::find_if(m_entries.begin(), m_entries.end(), [&](const vk::SpecializationMapEntry& e) { return e.constantID == constantId; });
+
+        if (entry != m_entries.end() && entry->size == size) {
+            memcpy(m_data.data() + entry->offset, value, size);
+            return;
+        }
+
+        if (entry != m_entries.end()) {
+            // Set again with a different type, so its bytes are removed and everything after moves down
+            const uint32_t removedOffset = entry->offset;
+            const std::size_t removedSize = entry->size;
+            m_data.erase(m_data.begin() + removedOffset, m_data.begin() + removedOffset + removedSize);
+            m_entries.erase(entry);
+            for (vk::SpecializationMapEntry& later : m_entries) {
+                if (later.offset > removedOffset) {
+                    later.offset -= static_cast<uint32_t>(removedSize);
+                }
+            }
+        }
+
+        const std::size_t offset = m_data.size();
+        m_data.resize(offset + size);
+        memcpy(m_data.data() + offset, value, size);
+        m_entries.push_back(vk::SpecializationMapEntry{constantId, static_cast<uint32_t>(offset), size});
+
+        updateInfo();
+    }
+
+    void SpecializationConstants::updateInfo() {
+        m_info = vk::SpecializationInfo{
+            static_cast<uint32_t>(m_entries.size()),
+            m_entries.data(),
+            m_data.size(),
+            m_data.data(),
+        };
+    }
+}
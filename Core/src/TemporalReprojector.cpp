@@ -0,0 +1,225 @@
+#include "Core/TemporalReprojector.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <stdexcept>
+
+namespace {
+    /// Rows reprojected by one task
+    constexpr uint32_t ROWS_PER_TASK = 32;
+
+    /// Tiles re-estimated by one task
+    constexpr uint32_t TILES_PER_TASK = 64;
+
+    /// History whose valid taps have less bilinear weight than this is too far from any valid pixel to trust
+    constexpr float MIN_HISTORY_WEIGHT = 0.01f;
+
+    float luminance(glm::vec3 colour) { return glm::dot(colour, glm::vec3(0.2126f, 0.7152f, 0.0722f)); }
+
+    void waitForAll(std::vector<std::future<void>>& tasks) {
+        // Every task is waited for before the first failure is rethrown, since the others still reference the buffers
+        for (std::future<void>& task : tasks) {
+            task.wait();
+        }
+        for (std::future<void>& task : tasks) {
+            task.get();
+        }
+    }
+}
+
+namespace Core {
+
+    TemporalReprojector::TemporalReprojector(const TemporalSettings& settings)
+        : m_settings(settings) {}
+
+    TemporalReprojector::~TemporalReprojector() = default;
+
+    void TemporalReprojector::setSettings(const TemporalSettings& settings) { m_settings = settings; }
+
+    const TemporalSettings& TemporalReprojector::getSettings() const { return m_settings; }
+
+    void TemporalReprojector::reproject(const AccumulationBuffer& history,
+                                        std::span<const float> historyDepths,
+                                        std::span<const PixelReprojection> reprojections,
+                                        AccumulationBuffer& current,
+                                        ThreadPool& workers) {
+        uint32_t width = current.getWidth();
+        uint32_t height = current.getHeight();
+        std::size_t pixelCount = std::size_t(width) * height;
+        if (history.getWidth() != width || history.getHeight() != height || historyDepths.size() != pixelCount || reprojections.size() != pixelCount) {
+            throw std::runtime_error("Temporal reprojection needs the history and the new view to be the same size");
+        }
+        auto start = std::chrono::steady_clock::now();
+
+        // Clamping reads the new samples around each pixel, so nothing is added until every pixel's history is found
+        m_carried.resize(pixelCount);
+        std::vector<RowCounts> rowCounts((height + ROWS_PER_TASK - 1) / ROWS_PER_TASK);
+        std::vector<std::future<void>> tasks;
+        for (uint32_t row = 0; row < height; row += ROWS_PER_TASK) {
+            uint32_t lastRow = std::min(row + ROWS_PER_TASK, height);
+            RowCounts& counts = rowCounts[row / ROWS_PER_TASK];
+            tasks.push_back(workers.submit([&, row, lastRow]() { counts = reprojectRows(row, lastRow, history, historyDepths, reprojections, current); }));
+        }
+        waitForAll(tasks);
+
+        tasks.clear();
+        for (uint32_t row = 0; row < height; row += ROWS_PER_TASK) {
+            uint32_t lastRow = std::min(row + ROWS_PER_TASK, height);
+            tasks.push_back(workers.submit([this, &current, width, row, lastRow]() {
+                for (uint32_t y = row; y < lastRow; y++) {
+                    for (uint32_t x = 0; x < width; x++) {
+                        const CarriedSamples& carried = m_carried[std::size_t(y) * width + x];
+                        if (carried.count > 0) {
+                            current.addSamples(x, y, carried.mean, carried.luminanceSquareMean, carried.count);
+                        }
+                    }
+                }
+            }));
+        }
+        waitForAll(tasks);
+
+        // The carried samples lower the error of the tiles that kept their history
+        tasks.clear();
+        for (uint32_t tile = 0; tile < current.getTileCount(); tile += TILES_PER_TASK) {
+            uint32_t lastTile = std::min(tile + TILES_PER_TASK, current.getTileCount());
+            tasks.push_back(workers.submit([&current, tile, lastTile]() {
+                for (uint32_t i = tile; i < lastTile; i++) {
+                    current.finishTile(i);
+                }
+            }));
+        }
+        waitForAll(tasks);
+
+        m_stats.reprojections++;
+        m_stats.pixels += pixelCount;
+        for (const RowCounts& counts : rowCounts) {
+            m_stats.offscreenPixels += counts.offscreen;
+            m_stats.disoccludedPixels += counts.disoccluded;
+            m_stats.clampedPixels += counts.clamped;
+            m_historyPixels += counts.historyPixels;
+            m_historySamples += counts.historySamples;
+        }
+        m_stats.lastTime = std::chrono::steady_clock::now() - start;
+        m_timeSum += m_stats.lastTime;
+    }
+
+    TemporalReprojector::Stats TemporalReprojector::getStats() const {
+        Stats stats = m_stats;
+        if (m_historyPixels > 0) {
+            stats.averageHistorySamples = static_cast<float>(double(m_historySamples) / m_historyPixels);
+        }
+        if (stats.reprojections > 0) {
+            stats.averageTime = m_timeSum / static_cast<double>(stats.reprojections);
+        }
+        return stats;
+    }
+
+    void TemporalReprojector::resetStats() {
+        m_stats = Stats{};
+        m_historyPixels = 0;
+        m_historySamples = 0;
+        m_timeSum = TimeDelta::zero();
+    }
+
+    void TemporalReprojector::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        double pixels = std::max<double>(double(stats.pixels), 1.0);
+        out << "Temporal reprojection: " << stats.reprojections << " reprojections, " << stats.averageHistorySamples << " samples carried per pixel, "
+            << 100.0 * stats.offscreenPixels / pixels << "% offscreen, " << 100.0 * stats.disoccludedPixels / pixels << "% disoccluded, "
+            << 100.0 * stats.clampedPixels / pixels << "% clamped, " << stats.averageTime.count() * 1000.0 << " ms average" << std::endl;
+    }
+
+    TemporalReprojector::RowCounts TemporalReprojector::reprojectRows(uint32_t firstRow,
+                                                                      uint32_t lastRow,
+                                                                      const AccumulationBuffer& history,
+                                                                      std::span<const float> historyDepths,
+                                                                      std::span<const PixelReprojection> reprojections,
+                                                                      const AccumulationBuffer& current) {
+        RowCounts counts;
+        int32_t width = static_cast<int32_t>(current.getWidth());
+        int32_t height = static_cast<int32_t>(current.getHeight());
+        for (int32_t y = static_cast<int32_t>(firstRow); y < static_cast<int32_t>(lastRow); y++) {
+            for (int32_t x = 0; x < width; x++) {
+                std::size_t pixel = std::size_t(y) * width + x;
+                CarriedSamples& carried = m_carried[pixel];
+                carried.count = 0;
+
+                // The pixel's centre in the history, in the coordinates of the history's pixel centres
+                const PixelReprojection& reprojection = reprojections[pixel];
+                glm::vec2 previous = glm::vec2(x, y) - reprojection.motion;
+                // Compared as floats, as points close to the previous camera's plane can be too far away for an int
+                if (reprojection.previousDepth <= 0.0f || !(previous.x > -1.0f && previous.y > -1.0f && previous.x < width && previous.y < height)) {
+                    counts.offscreen++;
+                    continue;
+                }
+                // The taps are the four pixels whose centres surround it
+                glm::vec2 corner = glm::floor(previous);
+                glm::vec2 fraction = previous - corner;
+                int32_t x0 = static_cast<int32_t>(corner.x);
+                int32_t y0 = static_cast<int32_t>(corner.y);
+
+                float weightSum = 0.0f;
+                glm::vec3 mean(0.0f);
+                float luminanceSquareMean = 0.0f;
+                float count = 0.0f;
+                for (int32_t tap = 0; tap < 4; tap++) {
+                    int32_t tapX = x0 + (tap & 1);
+                    int32_t tapY = y0 + (tap >> 1);
+                    if (tapX < 0 || tapY < 0 || tapX >= width || tapY >= height) {
+                        continue;
+                    }
+                    uint32_t tapCount = history.getSampleCount(tapX, tapY);
+                    float tapDepth = historyDepths[std::size_t(tapY) * width + tapX];
+                    if (tapCount == 0 || std::abs(tapDepth - reprojection.previousDepth) > m_settings.depthTolerance * reprojection.previousDepth) {
+                        continue;
+                    }
+                    float weight = ((tap & 1) ? fraction.x : 1.0f - fraction.x) * ((tap >> 1) ? fraction.y : 1.0f - fraction.y);
+                    weightSum += weight;
+                    mean += history.getMean(tapX, tapY) * weight;
+                    luminanceSquareMean += history.getLuminanceSquareMean(tapX, tapY) * weight;
+                    count += static_cast<float>(tapCount) * weight;
+                }
+                if (weightSum < MIN_HISTORY_WEIGHT) {
+                    counts.disoccluded++;
+                    continue;
+                }
+                mean /= weightSum;
+                luminanceSquareMean /= weightSum;
+                count /= weightSum;
+
+                // The spread of the new samples around the pixel, which the history is expected to fall within
+                glm::vec3 neighbourhoodSum(0.0f);
+                glm::vec3 neighbourhoodSquareSum(0.0f);
+                float neighbours = 0.0f;
+                for (int32_t ny = std::max(y - 1, 0); ny <= std::min(y + 1, height - 1); ny++) {
+                    for (int32_t nx = std::max(x - 1, 0); nx <= std::min(x + 1, width - 1); nx++) {
+                        glm::vec3 colour = current.getMean(nx, ny);
+                        neighbourhoodSum += colour;
+                        neighbourhoodSquareSum += colour * colour;
+                        neighbours += 1.0f;
+                    }
+                }
+                glm::vec3 neighbourhoodMean = neighbourhoodSum / neighbours;
+                glm::vec3 deviation = glm::sqrt(glm::max(neighbourhoodSquareSum / neighbours - neighbourhoodMean * neighbourhoodMean, glm::vec3(0.0f)));
+                glm::vec3 clamped = glm::clamp(mean, neighbourhoodMean - deviation * m_settings.clampSigma, neighbourhoodMean + deviation * m_settings.clampSigma);
+                if (clamped != mean) {
+                    // The history's spread is kept about its new mean
+                    float oldLuminance = luminance(mean);
+                    float newLuminance = luminance(clamped);
+                    luminanceSquareMean = std::max(luminanceSquareMean - oldLuminance * oldLuminance + newLuminance * newLuminance, newLuminance * newLuminance);
+                    mean = clamped;
+                    counts.clamped++;
+                }
+
+                carried.mean = mean;
+                carried.luminanceSquareMean = luminanceSquareMean;
+                carried.count = std::min(static_cast<uint32_t>(std::lround(count)), m_settings.maxHistorySamples);
+                counts.historyPixels++;
+                counts.historySamples += carried.count;
+            }
+        }
+        return counts;
+    }
+}
@@ -0,0 +1,73 @@
+#include "Core/ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace Core {
+
+    ThreadPool::ThreadPool(std::size_t threadCount) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        m_workers.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; i++) {
+            m_workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_taskAvailable.notify_all();
+
+        for (std::thread& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::waitIdle() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this]() { return m_tasks.empty() && m_runningTasks == 0; });
+    }
+
+    std::size_t ThreadPool::getThreadCount() const { return m_workers.size(); }
+
+    void ThreadPool::enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push(std::move(task));
+        }
+        m_taskAvailable.notify_one();
+    }
+
+    void ThreadPool::workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_taskAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+                // Stopping still drains the queue, so no submitted future is left without a result
+                if (m_tasks.empty()) {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+                m_runningTasks++;
+            }
+
+            // Exceptions are captured by the packaged task
+            task();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_runningTasks--;
+                if (m_tasks.empty() && m_runningTasks == 0) {
+                    m_idle.notify_all();
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#include "Core/ToneMap.hpp"
+
+#include <array>
+#include <cmath>
+
+namespace {
+    /// Linear values are quantized to this many steps before the sRGB curve, enough that no 8 bit code is skipped
+    constexpr uint32_t SRGB_TABLE_SIZE = 4096;
+
+    std::array<uint8_t, SRGB_TABLE_SIZE + 1> makeSrgbTable() {
+        std::array<uint8_t, SRGB_TABLE_SIZE + 1> table{};
+        for (uint32_t i = 0; i <= SRGB_TABLE_SIZE; i++) {
+            float linear = static_cast<float>(i) / SRGB_TABLE_SIZE;
+            float encoded = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            table[i] = static_cast<uint8_t>(std::lround(encoded * 255.0f));
+        }
+        return table;
+    }
+
+    const std::array<uint8_t, SRGB_TABLE_SIZE + 1> SRGB_TABLE = makeSrgbTable();
+}
+
+namespace Core {
+
+    void toneMapPixel(glm::vec3 radiance, float exposure, bool bgra, uint8_t* out) {
+        glm::vec3 colour = radiance * exposure;
+        colour = colour / (colour + 1.0f);
+        glm::uvec3 index = glm::uvec3(glm::clamp(colour, 0.0f, 1.0f) * float(SRGB_TABLE_SIZE) + 0.5f);
+        out[bgra ? 2 : 0] = SRGB_TABLE[index.r];
+        out[1] = SRGB_TABLE[index.g];
+        out[bgra ? 0 : 2] = SRGB_TABLE[index.b];
+        out[3] = 255;
+    }
+}
@@ -12,17 +12,26 @@ namespace Core {
     void TrianglePipelineBuilder::getPipelineCreateInfo(vk::GraphicsPipelineCreateInfo& createInfo) {
         RasterPipelineBuilder::getPipelineCreateInfo(createInfo);
 
-        createInfo.pInputAssemblyState = &m_inputAssemblyState;
-
-        createInfo.stageCount = m_shaderStageCreateInfos.size();
+        // Unless it came from a FixedFunctionState
+        if (!createInfo.pInputAssemblyState) {
+            createInfo.pInputAssemblyState = &m_inputAssemblyState;
+        }
+
+        // Depth-only pipelines leave out the fragment shader, so rasterization only runs the depth test
+        bool hasFragmentShader = static_cast<bool>(m_shaderStageCreateInfos[1].module);
+        createInfo.stageCount = hasFragmentShader ? m_shaderStageCreateInfos.size() : 1;
         createInfo.pStages = m_shaderStageCreateInfos.data();
 
         createInfo.pVertexInputState = &m_vertexInputStateCreateInfo;
     }
 
-    void TrianglePipelineBuilder::addVertexShader(Core::Shader& shader) { m_shaderStageCreateInfos[0] = shader.getPipelineStageCreateInfo(); }
+    void TrianglePipelineBuilder::addVertexShader(Core::Shader& shader, const SpecializationConstants* specialization) {
+        m_shaderStageCreateInfos[0] = shader.getPipelineStageCreateInfo(specialization);
+    }
 
-    void TrianglePipelineBuilder::addFragmentShader(Shader& shader) { m_shaderStageCreateInfos[1] = shader.getPipelineStageCreateInfo(); }
+    void TrianglePipelineBuilder::addFragmentShader(Shader& shader, const SpecializationConstants* specialization) {
+        m_shaderStageCreateInfos[1] = shader.getPipelineStageCreateInfo(specialization);
+    }
 
     void TrianglePipelineBuilder::addVertexInputBindingDesc(const vk::VertexInputBindingDescription& bindingDescription) {
         m_vertexBindingDescriptions.push_back(bindingDescription);
@@ -35,4 +44,12 @@ namespace Core {
         m_vertexInputStateCreateInfo.vertexAttributeDescriptionCount = m_vertexAttributeDescriptions.size();
         m_vertexInputStateCreateInfo.pVertexAttributeDescriptions = m_vertexAttributeDescriptions.data();
     }
+
+    void TrianglePipelineBuilder::addVertexFormat(VertexFormat format, uint32_t binding) {
+        std::vector<vk::VertexInputAttributeDescription> attributes;
+        addVertexInputBindingDesc(getVertexInputDescriptions(format, binding, attributes));
+        for (const vk::VertexInputAttributeDescription& attribute : attributes) {
+            addVertexInputAttributeDesc(attribute);
+        }
+    }
 }
@@ -2,4 +2,6 @@
 
 namespace Core {
     V1AppBase::V1AppBase(Renderer& renderer, V1AppBase::Parameters& parameters) {}
+
+    void V1AppBase::idleFrame(Core::TimePoint now, Core::TimeDelta delta) {}
 }
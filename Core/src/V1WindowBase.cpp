@@ -1,5 +1,11 @@
 #include "Core/V1WindowBase.hpp"
 #include <iostream>
+
+namespace {
+    /// How often a minimized window wakes without events, so the app still gets idle frames for its housekeeping
+    constexpr double IDLE_FRAME_INTERVAL_SECONDS = 0.1;
+}
+
 namespace Core {
 
     V1WindowBase::V1WindowBase(Renderer& renderer, int width, int height)
@@ -68,6 +74,14 @@ namespace Core {
             V1WindowBase* userptr = reinterpret_cast<V1WindowBase*>(glfwGetWindowUserPointer(window));
             userptr->windowResized(width, height);
         });
+
+        glfwSetKeyCallback(m_nativeWindow, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+            if (action != GLFW_PRESS) {
+                return;
+            }
+            V1WindowBase* userptr = reinterpret_cast<V1WindowBase*>(glfwGetWindowUserPointer(window));
+            userptr->keyPressed(key, mods);
+        });
     }
 
     void V1WindowBase::setApp(const std::shared_ptr<V1AppBase>& app) { m_mainApp = app; }
@@ -89,13 +103,31 @@ namespace Core {
         return true;
     }
 
+    bool V1WindowBase::keyPressed(int key, int mods) { return m_mainApp->keyPressed(key, mods); }
+
     void V1WindowBase::run() {
         TimePoint thisFrame = std::chrono::high_resolution_clock::now();
         TimePoint lastFrame;
+        // Whether the next frame has been waited for, which outlasts a minimize between waiting and rendering
+        bool frameBegun = false;
 
         while (!glfwWindowShouldClose(m_nativeWindow)) {
-            glfwPollEvents();
-            m_renderer.waitForNextRenderFrame();
+            // Nothing is submitted while minimized, so the frame fence would never be signalled again.
+            // Skip waiting on it and give the time to the app instead.
+            if (!m_minimized && !frameBegun) {
+                m_renderer.waitForNextRenderFrame();
+                // Held back here, so the frame's input is sampled as late as the pacing allows
+                m_renderer.getFramePacer().beginFrame();
+                frameBegun = true;
+            }
+
+            if (m_minimized) {
+                // Sleep rather than spin until the window is restored
+                glfwWaitEventsTimeout(IDLE_FRAME_INTERVAL_SECONDS);
+            } else {
+                // Only after the pacing, which would otherwise delay input already sampled
+                glfwPollEvents();
+            }
 
             lastFrame = thisFrame;
             thisFrame = std::chrono::high_resolution_clock::now();
@@ -103,8 +135,12 @@ namespace Core {
 
             m_mainApp->simulateFrame(thisFrame, delta);
 
-            if (!m_minimized) {
+            // A frame restored by the events above is waited for on the next iteration
+            if (frameBegun && !m_minimized) {
                 m_mainApp->renderFrame(thisFrame, delta);
+                frameBegun = false;
+            } else {
+                m_mainApp->idleFrame(thisFrame, delta);
             }
         }
     }
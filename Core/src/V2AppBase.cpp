@@ -3,16 +3,62 @@
 namespace Core {
     V2AppBase::V2AppBase(Renderer& renderer, Parameters& parameters)
         : V1AppBase(renderer, parameters)
-        , m_renderer(renderer) {}
+        , m_renderer(renderer)
+        , m_device(renderer.getDevice())
+        , m_graphicsQueue(renderer.getQueue(QueueType::Graphics)) {
+        vk::CommandPoolCreateInfo poolInfo{
+            vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+            m_graphicsQueue.familyIndex,
+        };
+        m_commandPool = m_device.createCommandPool(poolInfo);
+
+        vk::SemaphoreCreateInfo semaphoreInfo{};
+        m_imageAvailableSemaphore = m_device.createSemaphore(semaphoreInfo);
+        m_renderCompletedSemaphore = m_device.createSemaphore(semaphoreInfo);
+    }
 
     // Shutdown should be called before destruction to avoid leaks.
-    V2AppBase::~V2AppBase() noexcept = default;
+    V2AppBase::~V2AppBase() noexcept {
+        m_device.destroySemaphore(m_renderCompletedSemaphore);
+        m_device.destroySemaphore(m_imageAvailableSemaphore);
+        m_device.destroyCommandPool(m_commandPool);
+    }
 
     void V2AppBase::renderFrame(Core::TimePoint now, Core::TimeDelta delta) {
-        // TODO Render frame
+        m_swapchainImageIndex = m_renderer.getNextSwapchainImage(m_imageAvailableSemaphore);
+
+        std::vector<vk::CommandBuffer> frameBuffers{m_commandBuffers[m_swapchainImageIndex]};
+        recordCommandBuffersPerFrame(frameBuffers);
+
+        // Every stage that touches the swapchain image waits for it, the app decides which that is
+        vk::PipelineStageFlags waitStageFlags = vk::PipelineStageFlagBits::eAllCommands;
+        vk::SubmitInfo submitInfo{
+            1,
+            &m_imageAvailableSemaphore,
+            &waitStageFlags,
+            static_cast<uint32_t>(frameBuffers.size()),
+            frameBuffers.data(),
+            1,
+            &m_renderCompletedSemaphore,
+        };
+        m_graphicsQueue.queues[0].submit(1, &submitInfo, m_renderer.getFrameEndFence());
+
+        vk::SwapchainKHR swapchain = m_renderer.getSwapchain();
+        vk::PresentInfoKHR presentInfo{
+            1,
+            &m_renderCompletedSemaphore,
+            1,
+            &swapchain,
+            &m_swapchainImageIndex,
+            nullptr,
+        };
+        m_renderer.getFramePacer().present(m_graphicsQueue.queues[0], presentInfo); // TODO We assume graphics can present
     }
 
     void V2AppBase::regenerateSwapchainResources(vk::Extent2D viewport) {
+        // Nothing in flight may still use the old resources
+        m_device.waitIdle();
+
         cleanupDynamicRenderResources();
         cleanupSwapchainResources();
         m_renderer.recreateSwapChain(viewport);
@@ -22,11 +68,13 @@ namespace Core {
         };
         createSwapchainResources(parameters);
         createDynamicRenderResources(parameters);
+        recordCommandBuffersInitial(m_commandBuffers);
     }
 
     void V2AppBase::startup(const ResourceParameters &parameters) {
         createSwapchainResources(parameters);
         createDynamicRenderResources(parameters);
+        recordCommandBuffersInitial(m_commandBuffers);
     }
 
     void V2AppBase::shutdown() {
@@ -34,11 +82,21 @@ namespace Core {
         cleanupSwapchainResources();
     }
 
+    uint32_t V2AppBase::getSwapchainImageIndex() const { return m_swapchainImageIndex; }
+
     void V2AppBase::createSwapchainResources(const V2AppBase::ResourceParameters& parameters) {
-        // TODO Init resources
+        vk::CommandBufferAllocateInfo allocateInfo{
+            m_commandPool,
+            vk::CommandBufferLevel::ePrimary,
+            static_cast<uint32_t>(m_renderer.getNumSwapchainImages()),
+        };
+        m_commandBuffers = m_device.allocateCommandBuffers(allocateInfo);
     }
 
     void V2AppBase::cleanupSwapchainResources() {
-        // TODO Cleanup resources
+        if (!m_commandBuffers.empty()) {
+            m_device.freeCommandBuffers(m_commandPool, static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
+            m_commandBuffers.clear();
+        }
     }
 }
@@ -21,8 +21,10 @@ namespace Core {
         };
         m_mainApp->startup(appParameters);
 
-        // TODO a real run loop
+        V1WindowBase::run();
 
+        // The app's resources may still be in use by the last frame
+        m_renderer.getDevice().waitIdle();
         m_mainApp->shutdown();
     }
 }
@@ -0,0 +1,141 @@
+#include "Core/VertexFormat.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include <cstddef>
+#include <limits>
+
+namespace {
+    /// Like glm::sign, but never zero, so points on the octahedron's edges fold consistently
+    glm::vec2 signNotZero(glm::vec2 value) { return glm::vec2(value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f); }
+}
+
+namespace Core {
+
+    const char* to_string(VertexFormat format) {
+        switch (format) {
+        case VertexFormat::Full:
+            return "Full";
+        case VertexFormat::Compressed:
+            return "Compressed";
+        }
+        return "Unknown";
+    }
+
+    uint32_t getVertexStride(VertexFormat format) {
+        switch (format) {
+        case VertexFormat::Full:
+            return sizeof(FullVertex);
+        case VertexFormat::Compressed:
+            return sizeof(CompressedVertex);
+        }
+        return 0;
+    }
+
+    vk::VertexInputBindingDescription getVertexInputDescriptions(VertexFormat format,
+                                                                 uint32_t binding,
+                                                                 std::vector<vk::VertexInputAttributeDescription>& attributes) {
+        switch (format) {
+        case VertexFormat::Full:
+            attributes.emplace_back(0, binding, vk::Format::eR32G32B32Sfloat, offsetof(FullVertex, position));
+            attributes.emplace_back(1, binding, vk::Format::eR32G32B32Sfloat, offsetof(FullVertex, normal));
+            attributes.emplace_back(2, binding, vk::Format::eR32G32Sfloat, offsetof(FullVertex, uv));
+            break;
+        case VertexFormat::Compressed:
+            attributes.emplace_back(0, binding, vk::Format::eR16G16B16A16Unorm, offsetof(CompressedVertex, position));
+            attributes.emplace_back(1, binding, vk::Format::eR16G16Snorm, offsetof(CompressedVertex, normal));
+            attributes.emplace_back(2, binding, vk::Format::eR16G16Sfloat, offsetof(CompressedVertex, uv));
+            break;
+        }
+
+        return vk::VertexInputBindingDescription{
+            binding,
+            getVertexStride(format),
+            vk::VertexInputRate::eVertex,
+        };
+    }
+
+    VertexQuantization getIdentityQuantization() { return VertexQuantization{glm::vec4(0.0f), glm::vec4(1.0f)}; }
+
+    VertexQuantization computeQuantization(const FullVertex* vertices, std::size_t vertexCount) {
+        if (vertexCount == 0) {
+            return getIdentityQuantization();
+        }
+
+        glm::vec3 minimum(std::numeric_limits<float>::max());
+        glm::vec3 maximum(std::numeric_limits<float>::lowest());
+        for (std::size_t vertex = 0; vertex < vertexCount; vertex++) {
+            minimum = glm::min(minimum, vertices[vertex].position);
+            maximum = glm::max(maximum, vertices[vertex].position);
+        }
+
+        // A flat axis gets a scale of zero, every vertex decodes to exactly the offset
+        return VertexQuantization{glm::vec4(minimum, 0.0f), glm::vec4(maximum - minimum, 1.0f)};
+    }
+
+    CompressedVertex compressVertex(const FullVertex& vertex, const VertexQuantization& quantization) {
+        CompressedVertex result{};
+
+        for (int axis = 0; axis < 3; axis++) {
+            float scale = quantization.scale[axis];
+            float normalized = scale > 0.0f ? (vertex.position[axis] - quantization.offset[axis]) / scale : 0.0f;
+            result.position[axis] = glm::packUnorm1x16(normalized);
+        }
+        result.position[3] = std::numeric_limits<uint16_t>::max();
+
+        glm::vec2 normal = octahedralEncode(vertex.normal);
+        result.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(normal.x));
+        result.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(normal.y));
+
+        result.uv[0] = glm::packHalf1x16(vertex.uv.x);
+        result.uv[1] = glm::packHalf1x16(vertex.uv.y);
+
+        return result;
+    }
+
+    FullVertex decompressVertex(const CompressedVertex& vertex, const VertexQuantization& quantization) {
+        FullVertex result{};
+
+        for (int axis = 0; axis < 3; axis++) {
+            result.position[axis] = quantization.offset[axis] + quantization.scale[axis] * glm::unpackUnorm1x16(vertex.position[axis]);
+        }
+
+        glm::vec2 normal(glm::unpackSnorm1x16(static_cast<uint16_t>(vertex.normal[0])), glm::unpackSnorm1x16(static_cast<uint16_t>(vertex.normal[1])));
+        result.normal = octahedralDecode(normal);
+
+        result.uv = glm::vec2(glm::unpackHalf1x16(vertex.uv[0]), glm::unpackHalf1x16(vertex.uv[1]));
+
+        return result;
+    }
+
+    std::vector<CompressedVertex> compressVertices(const FullVertex* vertices, std::size_t vertexCount, const VertexQuantization& quantization) {
+        std::vector<CompressedVertex> result(vertexCount);
+        for (std::size_t vertex = 0; vertex < vertexCount; vertex++) {
+            result[vertex] = compressVertex(vertices[vertex], quantization);
+        }
+        return result;
+    }
+
+    glm::vec2 octahedralEncode(glm::vec3 normal) {
+        float length = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+        if (length == 0.0f) {
+            return glm::vec2(0.0f);
+        }
+
+        glm::vec2 encoded = glm::vec2(normal) / length;
+        if (normal.z < 0.0f) {
+            encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signNotZero(encoded);
+        }
+        return encoded;
+    }
+
+    glm::vec3 octahedralDecode(glm::vec2 encoded) {
+        glm::vec3 normal(encoded, 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y));
+        if (normal.z < 0.0f) {
+            glm::vec2 folded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) * signNotZero(glm::vec2(normal));
+            normal.x = folded.x;
+            normal.y = folded.y;
+        }
+        return glm::normalize(normal);
+    }
+}
@@ -0,0 +1,168 @@
+#include "Core/VideoStream.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    /*
+     * BT.709 limited range, in 8 bit fixed point. Luma rows sum to 220, the nearest to 219 * 256 / 255, so 255 shifts
+     * down to 219 and white is 235. Chroma rows sum to 0, so greys have no chroma.
+     */
+    constexpr int32_t LUMA_R = 47, LUMA_G = 157, LUMA_B = 16;
+    constexpr int32_t CB_R = -26, CB_G = -87, CB_B = 113;
+    constexpr int32_t CR_R = 112, CR_G = -102, CR_B = -10;
+
+    /*
+     * The loops below are branch free over plain arrays so the compiler vectorizes them, indexed by std::size_t so
+     * that their addresses cannot wrap. Luma is one pass per row, chroma one pass per pair of rows over the sums of
+     * each 2x2 block, which places chroma between the luma samples as the Y4M C420jpeg layout says.
+     */
+    void convertLumaRow(const uint8_t* rgba, std::size_t width, uint8_t* luma) {
+        for (std::size_t x = 0; x < width; x++) {
+            int32_t r = rgba[x * 4], g = rgba[x * 4 + 1], b = rgba[x * 4 + 2];
+            luma[x] = static_cast<uint8_t>(16 + ((LUMA_R * r + LUMA_G * g + LUMA_B * b + 128) >> 8));
+        }
+    }
+
+    void storeChroma(int32_t r, int32_t g, int32_t b, uint8_t* cb, uint8_t* cr) {
+        // The sums are of 4 pixels, so the shift divides by 4 as well as 256
+        *cb = static_cast<uint8_t>(128 + ((CB_R * r + CB_G * g + CB_B * b + 512) >> 10));
+        *cr = static_cast<uint8_t>(128 + ((CR_R * r + CR_G * g + CR_B * b + 512) >> 10));
+    }
+
+    void convertChromaRow(const uint8_t* row0, const uint8_t* row1, std::size_t width, uint8_t* cb, uint8_t* cr) {
+        std::size_t pairs = width / 2;
+        for (std::size_t x = 0; x < pairs; x++) {
+            const uint8_t* a = row0 + x * 8;
+            const uint8_t* b = row1 + x * 8;
+            int32_t red = a[0] + a[4] + b[0] + b[4];
+            int32_t green = a[1] + a[5] + b[1] + b[5];
+            int32_t blue = a[2] + a[6] + b[2] + b[6];
+            storeChroma(red, green, blue, cb + x, cr + x);
+        }
+        // An odd last column covers only itself
+        if (width % 2) {
+            const uint8_t* a = row0 + pairs * 8;
+            const uint8_t* b = row1 + pairs * 8;
+            storeChroma((a[0] + b[0]) * 2, (a[1] + b[1]) * 2, (a[2] + b[2]) * 2, cb + pairs, cr + pairs);
+        }
+    }
+
+    /// Convert to planar 4:2:0, Y then Cb then Cr
+    void convertToYuv420(const Core::ImageRGBA8& image, std::vector<uint8_t>& yuv) {
+        uint32_t chromaWidth = (image.width + 1) / 2;
+        uint32_t chromaHeight = (image.height + 1) / 2;
+        std::size_t lumaSize = std::size_t(image.width) * image.height;
+        std::size_t chromaSize = std::size_t(chromaWidth) * chromaHeight;
+        yuv.resize(lumaSize + chromaSize * 2);
+
+        uint8_t* luma = yuv.data();
+        uint8_t* cb = luma + lumaSize;
+        uint8_t* cr = cb + chromaSize;
+        std::size_t rowSize = std::size_t(image.width) * 4;
+        for (uint32_t y = 0; y < image.height; y++) {
+            convertLumaRow(image.pixels.data() + y * rowSize, image.width, luma + std::size_t(y) * image.width);
+        }
+        for (uint32_t y = 0; y < chromaHeight; y++) {
+            // An odd last row pairs with itself
+            const uint8_t* row0 = image.pixels.data() + std::size_t(y) * 2 * rowSize;
+            const uint8_t* row1 = y * 2 + 1 < image.height ? row0 + rowSize : row0;
+            convertChromaRow(row0, row1, image.width, cb + std::size_t(y) * chromaWidth, cr + std::size_t(y) * chromaWidth);
+        }
+    }
+}
+
+namespace Core {
+
+    const char* to_string(VideoStreamFormat format) {
+        switch (format) {
+        case VideoStreamFormat::Y4m:
+            return "Y4M";
+        case VideoStreamFormat::RawRgba:
+            return "RawRGBA";
+        }
+        return "Unknown";
+    }
+
+    VideoStream::VideoStream(const std::string& path, VideoStreamFormat format, uint32_t frameRate)
+        : m_path(path)
+        , m_format(format)
+        , m_frameRate(frameRate)
+        , m_file(std::fopen(path.c_str(), "wb")) {
+        if (!m_file) {
+            throw std::runtime_error("Failed to open video stream " + path);
+        }
+    }
+
+    VideoStream::~VideoStream() { std::fclose(m_file); }
+
+    VideoStreamFormat VideoStream::getFormat() const { return m_format; }
+
+    std::size_t VideoStream::writeFrame(uint64_t frameNumber, const ImageRGBA8& image) {
+        // Conversion is the expensive part, and runs before waiting for the frames ahead
+        thread_local std::vector<uint8_t> converted;
+        const uint8_t* data = image.pixels.data();
+        std::size_t size = image.pixels.size();
+        std::exception_ptr error;
+        try {
+            if (image.pixels.size() != std::size_t(image.width) * image.height * 4) {
+                throw std::runtime_error("Video frame pixels do not match its size");
+            }
+            if (m_format == VideoStreamFormat::Y4m) {
+                convertToYuv420(image, converted);
+                data = converted.data();
+                size = converted.size();
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_frameWritten.wait(lock, [this, frameNumber]() { return m_nextFrame == frameNumber; });
+
+        std::size_t written = 0;
+        try {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            if (m_failed) {
+                throw std::runtime_error("Video stream " + m_path + " failed on an earlier frame");
+            }
+            if (m_width == 0) {
+                m_width = image.width;
+                m_height = image.height;
+                if (m_format == VideoStreamFormat::Y4m) {
+                    // Chroma is sited between luma samples, and the 'X' tag is a comment that ffmpeg reads the range from
+                    int headerSize = std::fprintf(m_file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", m_width, m_height, m_frameRate);
+                    written += static_cast<std::size_t>(std::max(headerSize, 0));
+                }
+            } else if (image.width != m_width || image.height != m_height) {
+                throw std::runtime_error("Video frames must all be the same size");
+            }
+
+            if (m_format == VideoStreamFormat::Y4m) {
+                written += std::fwrite("FRAME\n", 1, 6, m_file);
+            }
+            written += std::fwrite(data, 1, size, m_file);
+            if (std::ferror(m_file)) {
+                // A closed pipe fails every later write too, so the rest of the stream is given up on
+                m_failed = true;
+                throw std::runtime_error("Failed to write video stream " + m_path);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        // The next frame goes however this one ended
+        m_nextFrame++;
+        lock.unlock();
+        m_frameWritten.notify_all();
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return written;
+    }
+}
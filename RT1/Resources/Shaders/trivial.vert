@@ -1,9 +1,25 @@
 #version 450
 
-layout(location = 0) in vec4 vertex;
+layout(push_constant) uniform MeshConstants {
+    vec4 offset; // Dequantization
+    vec4 scale;
+    layout(row_major) mat4x3 transform;
+} mesh;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUv;
+
 layout(location = 0) out vec3 position;
+layout(location = 1) out vec3 normal;
+layout(location = 2) out vec2 uv;
+
+// The depth prepass and the mesh pass compute positions in different pipelines, whose depths must match exactly
+invariant gl_Position;
 
 void main() {
-    gl_Position = vertex;
-    position = vertex.xyz / vertex.w;
+    position = mesh.transform * vec4(mesh.offset.xyz + mesh.scale.xyz * inPosition, 1.0);
+    gl_Position = vec4(position, 1.0);
+    normal = inNormal;
+    uv = inUv;
 }
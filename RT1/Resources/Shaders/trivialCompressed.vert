@@ -0,0 +1,39 @@
+#version 450
+
+// Decodes Core::VertexFormat::Compressed: unorm16 positions in the mesh bounding box, octahedral normals and half float uvs
+
+layout(push_constant) uniform MeshConstants {
+    vec4 offset; // Dequantization
+    vec4 scale;
+    layout(row_major) mat4x3 transform;
+} mesh;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inUv;
+
+layout(location = 0) out vec3 position;
+layout(location = 1) out vec3 normal;
+layout(location = 2) out vec2 uv;
+
+// The depth prepass and the mesh pass compute positions in different pipelines, whose depths must match exactly
+invariant gl_Position;
+
+vec2 signNotZero(vec2 value) {
+    return vec2(value.x >= 0.0 ? 1.0 : -1.0, value.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 octahedralDecode(vec2 encoded) {
+    vec3 result = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (result.z < 0.0) {
+        result.xy = (1.0 - abs(result.yx)) * signNotZero(result.xy);
+    }
+    return normalize(result);
+}
+
+void main() {
+    position = mesh.transform * vec4(mesh.offset.xyz + mesh.scale.xyz * inPosition, 1.0);
+    gl_Position = vec4(position, 1.0);
+    normal = octahedralDecode(inNormal);
+    uv = inUv;
+}
@@ -1,9 +1,27 @@
 #version 450
 
+// Chosen per pipeline, so the unused views are removed when the pipeline is created
+layout(constant_id = 0) const uint VIEW = 0;
+const uint VIEW_BLENDED = 0;
+const uint VIEW_POSITION = 1;
+const uint VIEW_NORMAL = 2;
+const uint VIEW_UV = 3;
+
 layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 uv;
 
 layout(location = 0) out vec4 colour;
 
 void main() {
-    colour = vec4(abs(position), 1.0);
+    if (VIEW == VIEW_POSITION) {
+        colour = vec4(abs(position), 1.0);
+    } else if (VIEW == VIEW_NORMAL) {
+        colour = vec4(normal * 0.5 + 0.5, 1.0);
+    } else if (VIEW == VIEW_UV) {
+        colour = vec4(uv, 0.0, 1.0);
+    } else {
+        // Every attribute contributes, so that none of them are optimized out of the vertex fetch
+        colour = vec4(abs(position) * 0.5 + abs(normal) * 0.25 + vec3(uv, 0.0) * 0.25, 1.0);
+    }
 }
@@ -1,22 +1,66 @@
 #pragma once
 
+#include "RT1/SpatialUpscaler.hpp"
+
+#include <Core/AsyncIO.hpp>
 #include <Core/DescriptorSetLayout.hpp>
+#include <Core/DynamicResolution.hpp>
+#include <Core/FrameCapture.hpp>
+#include <Core/GeometryPool.hpp>
+#include <Core/MemoryAllocator.hpp>
+#include <Core/PipelineCompiler.hpp>
 #include <Core/PipelineLayout.hpp>
+#include <Core/PipelineLibraryCache.hpp>
+#include <Core/PipelineStatistics.hpp>
 #include <Core/RenderPass.hpp>
+#include <Core/Shader.hpp>
 #include <Core/V1AppBase.hpp>
+#include <Core/VertexFormat.hpp>
+#include <Core/VideoStream.hpp>
 
-#include <vk_mem_alloc.hpp>
-
+#include <future>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace RT1 {
 
+    /// How the rendered image is scaled to the swapchain image
+    enum class UpscaleMode {
+        Blit,    // A blit, filtered linearly when the render scale is not one
+        Spatial, // SpatialUpscaler's passes, whose output is then blitted
+    };
+
+    const char* to_string(UpscaleMode mode);
+
     class RT1App final : public Core::V1AppBase {
     public:
+        /// The window parameters along with options for the mesh path
+        struct Parameters : Core::V1AppBase::Parameters {
+            Core::VertexFormat vertexFormat = Core::VertexFormat::Full;
+            uint32_t meshDetail = 0;              // Quads along each side of a screen covering grid, zero for a single triangle
+            uint32_t frameTimeReportInterval = 0; // Frames between average frame time reports, zero for none
+            std::string scenePath;                // A scene file to draw in place of generated geometry
+            uint32_t swapchainSweepFrames = 0;    // Frames to measure each present mode and image count for, zero for no sweep
+            std::string capturePath;              // Capture every frame to files starting with this, empty to not capture at startup
+            Core::ImageFileFormat captureFormat = Core::ImageFileFormat::Png;
+            std::string streamPath;               // Stream every frame into this file or named pipe, in place of capturing files
+            Core::VideoStreamFormat streamFormat = Core::VideoStreamFormat::Y4m;
+            uint32_t streamFrameRate = 60;
+            float dynamicResolutionBudget = 0.0f; // GPU milliseconds per frame to scale the resolution for, zero to render at full resolution
+            float minRenderScale = 0.5f;          // The range dynamic resolution scales the output's width and height within
+            float maxRenderScale = 1.0f;
+            float renderScale = 1.0f; // Of the output's width and height, while dynamic resolution is off
+            UpscaleMode upscaleMode = UpscaleMode::Blit;
+            float sharpness = 0.5f; // Of the spatial upscaler, from 0 for none to 1 for the strongest
+            bool depthPrepass = false; // Draw every mesh's depth before shading, so each pixel is shaded once
+        };
+
         /**
          * @param renderer: The renderer to use for graphics
+         * @param parameters: The window size and mesh options
          */
-        explicit RT1App(Core::Renderer& renderer, Core::V1AppBase::Parameters& parameters);
+        explicit RT1App(Core::Renderer& renderer, Parameters& parameters);
         ~RT1App() noexcept final;
 
         /// Disallowed operations
@@ -40,30 +84,87 @@ namespace RT1 {
          */
         void simulateFrame(Core::TimePoint now, Core::TimeDelta delta) final;
 
+        /**
+         * Perform housekeeping while nothing is being rendered.
+         * Used to incrementally defragment device memory, which may move the GeometryPool's pages.
+         * @param now: The high-resolution time right now
+         * @param delta: The time since the last frame
+         */
+        void idleFrame(Core::TimePoint now, Core::TimeDelta delta) final;
+
         /**
          * Regenerate vulkan objects that change when the swapchain must be recreated
          * @param viewport: The new viewport extents
          */
         void regenerateSwapchainResources(vk::Extent2D viewport) final;
 
+        /**
+         * Handle key presses.
+         * F2 writes the allocator statistics to RT1_memory.json and prints geometry pool usage.
+         * F3 cycles the fragment shader's debug views.
+         * F4 cycles the present mode, and F5 the swapchain image count.
+         * F6 starts or stops capturing frames to files.
+         * F7 turns dynamic resolution on or off.
+         * F8 switches between the blit and the spatial upscaler.
+         * F9 turns the depth prepass on or off.
+         */
+        bool keyPressed(int key, int mods) final;
+
     private:
-        Core::V1AppBase::Parameters& m_runtimeParameters;
+        Parameters& m_runtimeParameters;
         Core::Renderer& m_renderer;
         vk::Device m_device;
-        vma::Allocator m_allocator;
+        Core::MemoryAllocator m_allocator;
+        uint32_t m_frameIndex = 0;
+
+        /// Copies each frame into a readback buffer per command buffer while enabled, and writes files or a stream on its workers
+        std::unique_ptr<Core::FrameCapture> m_frameCapture;
+
+        /// Times each command buffer on the GPU and chooses the scale of the rendered region of the framebuffers
+        Core::DynamicResolution m_dynamicResolution;
+        bool m_dynamicResolutionRequested; // With F7. Captured frames are rendered at full resolution, as captures are the output's size.
+        bool m_linearBlit;                 // Whether the framebuffer format can be blitted with linear filtering, to scale it to the output
+
+        /// With UpscaleMode::Spatial, has a slot per command buffer, and captures copy its output
+        SpatialUpscaler m_upscaler;
+        UpscaleMode m_upscaleMode;
 
+        /// Counts the fragment shader invocations of each command buffer, to show the overdraw the depth prepass saves
+        Core::PipelineStatistics m_pipelineStatistics;
+
+        /// The first of the depth formats the device can render to, see chooseDepthFormat()
+        vk::Format m_depthFormat;
+        bool m_depthPrepass; // With F9
+
+        /// Only created when dynamic rendering is unsupported, along with a framebuffer per swapchain image
         std::unique_ptr<Core::RenderPass> m_basicRenderPass;
         std::unique_ptr<Core::DescriptorSetLayout> m_emptyDescriptorSetLayout;
-        std::unique_ptr<Core::PipelineLayout> m_emptyPipelineLayout;
-        std::unique_ptr<Core::GraphicsPipeline> m_simpleTrianglePipeline;
+        std::unique_ptr<Core::PipelineLayout> m_meshPipelineLayout;
+        /// One pipeline per debug view of the fragment shader, which differ only by a specialization constant
+        std::vector<Core::AsyncPipeline> m_meshPipelines;
+        uint32_t m_meshView = 0;
+        /// Writes only depth, with no fragment shader, so the mesh pipelines' depth test passes just the nearest fragments
+        std::shared_ptr<Core::GraphicsPipeline> m_depthPrepassPipeline;
+
+        /// The scene is read in the background while the app is set up, and shaders that are not embedded while the geometry is prepared
+        Core::AsyncIO m_asyncIO;
+        std::future<std::vector<char>> m_sceneRead;
+        std::future<std::vector<char>> m_vertexShaderRead;
+        std::future<std::vector<char>> m_fragmentShaderRead;
+        std::shared_ptr<Core::Shader> m_vertexShader;
+        std::shared_ptr<Core::Shader> m_fragmentShader;
 
-        /// Members recreated on swapchain recreation
+        /// Members recreated on swapchain recreation. The images fit every render scale, and are rendered to at the current one.
         struct FramebufferData {
             vk::Image colourAttachment0Image;
             vma::Allocation colourAttachment0ImageAllocation;
             vk::ImageView colourAttachment0ImageView;
 
-            vk::Framebuffer framebuffer;
+            vk::Image depthImage;
+            vma::Allocation depthImageAllocation;
+            vk::ImageView depthImageView;
+
+            vk::Framebuffer framebuffer; // Null with dynamic rendering
         };
         std::vector<FramebufferData> m_framebufferData;
 
@@ -73,7 +174,13 @@ namespace RT1 {
         const Core::QueueGroup& m_transferQueue;
         const Core::QueueGroup& m_presentQueue;
         std::vector<vk::CommandBuffer> m_graphicsCommandBuffers;
-        std::vector<vk::Fence> m_commandBufferFences; // To signal when it is safe to modify command buffers
+        /// Keys are handled while the last frame may still be running, so they only ask for the command buffers to be
+        /// recorded again, which renderFrame() does once the frame has completed. Idle frames that move the geometry also ask.
+        bool m_recordRequested = false;
+        bool m_captureToggleRequested = false; // With F6, applied by renderFrame() once the last frame's readback is collected
+        bool m_dynamicResolutionToggleRequested = false; // With F7, applied by renderFrame() once the last frame's timestamps are read
+        bool m_upscaleModeToggleRequested = false;        // With F8, applied by renderFrame() once nothing uses the framebuffers
+        bool m_depthPrepassToggleRequested = false;       // With F9, applied by renderFrame() once the last frame's statistics are read
 
         // Semaphores for render signalling
         vk::Semaphore m_swapchainImageSemaphore;
@@ -81,14 +188,51 @@ namespace RT1 {
         vk::Semaphore m_copyCompletedSemaphore;
 
         // Renderable data
-        vk::Buffer m_vertexBuffer;
-        vma::Allocation m_vertexBufferAllocation;
+        std::unique_ptr<Core::GeometryPool> m_geometryPool;
+        Core::VertexFormat m_vertexFormat;
+        Core::GeometryPool::Range m_meshGeometry; // All meshes share this range
+
+        /// The vertex shader's push constants
+        struct MeshConstants {
+            Core::VertexQuantization quantization;
+            float transform[3][4]; // Row major affine object to clip space transform
+        };
+        struct MeshDraw {
+            Core::GeometryPool::Range range;
+            MeshConstants constants;
+        };
+        std::vector<MeshDraw> m_meshDraws;
+
+        // Frame time benchmarking
+        Core::TimeDelta m_reportedFrameTime = Core::TimeDelta::zero();
+        uint32_t m_reportedFrameCount = 0;
+
+        /// The swapchain settings measured in turn, see Parameters::swapchainSweepFrames. Empty once the sweep is done.
+        struct SwapchainSweepResult {
+            vk::PresentModeKHR presentMode;
+            uint32_t requestedImageCount;
+            std::size_t imageCount = 0; // Created by the swapchain, which may be more than requested
+            Core::TimeDelta frameTime = Core::TimeDelta::zero();
+            Core::TimeDelta acquireToPresent = Core::TimeDelta::zero();
+            Core::TimeDelta inputToDisplay = Core::TimeDelta::zero();
+        };
+        std::vector<SwapchainSweepResult> m_swapchainSweep;
+        std::size_t m_swapchainSweepIndex = 0;
+        uint32_t m_swapchainSweepFrame = 0;
+        Core::TimeDelta m_swapchainSweepTime = Core::TimeDelta::zero();
 
         // -- Begin ctor helpers --
 
+        /// The first depth format of the candidates the device supports as a depth attachment
+        [[nodiscard]] vk::Format chooseDepthFormat() const;
         void initRenderPass();
         void initPipeline();
         void initRenderData();
+        void requestShaders();
+        /// Take a shader from the library, using the result of requestShaders()'s read if there was one
+        std::shared_ptr<Core::Shader> getShader(const std::string& path, std::future<std::vector<char>>& read, Core::ShaderType type);
+        void initGeneratedData();
+        void initSceneData();
         void initSemaphores();
         void initCommandPools();
 
@@ -105,6 +249,18 @@ namespace RT1 {
 
         // -- Helpers for swapchain recreation --
 
+        /// Create the mesh and depth prepass pipelines from the shaders loaded by initPipeline(). They do not depend on the framebuffer size.
+        void createPipeline();
+
+        /// Whether captures copy the rendered image rather than the upscaler's output, so it must be rendered at the output's size
+        [[nodiscard]] bool capturesRenderedImage() const;
+
+        /// The size to render at for the output's size, at the current render scale
+        [[nodiscard]] vk::Extent2D getRenderExtent(vk::Extent2D outputExtent) const;
+
+        /// Turn dynamic resolution on when requested, unless captures copy the rendered image. Record the command buffers after.
+        void updateDynamicResolution();
+
         /// Create resources that are specific to each swapchain.
         /// Also used by the ctor
         void createSwapchainResources(int width, int height);
@@ -112,7 +268,7 @@ namespace RT1 {
         /// Destroy only resources that are specific to each swapchain.
         void destroySwapchainResources();
 
-        /// Create and record command buffers used for drawing
+        /// Create and record command buffers used for drawing. None of them may still be pending.
         void createCommandBuffers(int width, int height);
 
         /// Record into the current set of command buffers. Expects the command buffers to be ready for recording
@@ -121,6 +277,15 @@ namespace RT1 {
         /// Delete the current set of command buffers
         void destroyCommandBuffers();
 
+        /// Recreate the swapchain with a present mode and image count, see Core::Renderer::setPresentMode()
+        void applySwapchainSetting(std::optional<vk::PresentModeKHR> presentMode, uint32_t imageCount);
+
+        /// Start measuring each supported present mode with 2, 3 and 4 images
+        void initSwapchainSweep();
+
+        /// Count a frame of the sweep, moving on to the next setting once the current one is measured
+        void advanceSwapchainSweep(Core::TimeDelta delta);
+
         // -- End swapchain recreation helpers --
     };
 }
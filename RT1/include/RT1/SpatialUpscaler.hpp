@@ -0,0 +1,142 @@
+#pragma once
+
+#include <Core/DescriptorSetLayout.hpp>
+#include <Core/MemoryAllocator.hpp>
+#include <Core/PipelineLayout.hpp>
+#include <Core/RenderTypes.hpp>
+#include <Core/Renderer.hpp>
+#include <Core/Shader.hpp>
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace RT1 {
+
+    /// How strongly the upscaled image is sharpened
+    struct UpscalerSettings {
+        float sharpness = 0.5f; // From 0 for none to 1 for the strongest
+    };
+
+    /**
+     * Reconstructs the output from an image rendered at a lower resolution, in two compute passes recorded into the
+     * frame's command buffer: an edge-adaptive upscale (upscale.comp), then a contrast-adaptive sharpen (sharpen.comp)
+     * that restores the detail the upscale's filtering softens. The two follow the passes of AMD's FidelityFX Super
+     * Resolution 1, so most of the quality of the output's resolution comes at the cost of the rendered one.
+     *
+     * Each command buffer has a slot, with its rendered image, the upscaled image between the passes and the output,
+     * so a frame's passes never write images a frame still in flight reads. Timestamps around each pass time them on
+     * the GPU separately from the rest of the frame.
+     *
+     * Used only from the thread that renders.
+     */
+    class SpatialUpscaler {
+    public:
+        SpatialUpscaler(Core::Renderer& renderer, Core::MemoryAllocator& allocator);
+        /// Frames submitted with its passes must have completed
+        ~SpatialUpscaler();
+
+        /// Disallowed operations
+        SpatialUpscaler(const SpatialUpscaler&) = delete;
+        SpatialUpscaler(SpatialUpscaler&&) = delete;
+        SpatialUpscaler& operator=(const SpatialUpscaler&) = delete;
+        SpatialUpscaler& operator=(SpatialUpscaler&&) = delete;
+
+        /// -- Members for configuration --
+
+        /**
+         * Recreate the slots for an output size. Nothing recorded with the old slots may still be in use.
+         * @param outputExtent: The size of the output images
+         * @param renderedViews: The image rendered to in each slot, read through a sampler. Empty to only free the slots.
+         */
+        void resize(vk::Extent2D outputExtent, std::span<const vk::ImageView> renderedViews);
+
+        /// Sharpness is a push constant, so only applies to passes recorded after the change
+        void setSettings(const UpscalerSettings& settings);
+        [[nodiscard]] const UpscalerSettings& getSettings() const;
+
+        /// -- End members for configuration --
+
+        /// The format of the output images, which is 8 bit RGBA
+        [[nodiscard]] vk::Format getOutputFormat() const;
+
+        /**
+         * Record the passes upscaling a region of a slot's rendered image to its output.
+         * The output is in the transfer source layout, with its writes available to transfers, once the commands complete.
+         * @param buffer: The frame's command buffer
+         * @param slot: The slot to upscale, which must not be used by a frame still in flight
+         * @param renderExtent: The region rendered to, from the image's origin. Its writes must be visible to compute
+         *                      shaders, in the shader read-only layout.
+         */
+        void recordUpscale(vk::CommandBuffer& buffer, std::size_t slot, vk::Extent2D renderExtent) const;
+
+        /// The output image of a slot
+        [[nodiscard]] vk::Image getOutput(std::size_t slot) const;
+
+        /// Note that a command buffer with recordUpscale() for the slot has been submitted
+        void frameSubmitted(std::size_t slot);
+
+        /// Read the timestamps of every submitted frame. Call once they have completed, and before their slots are submitted again.
+        void collectCompleted();
+
+        struct Stats {
+            uint64_t upscales;
+            Core::TimeDelta lastUpscaleTime; // GPU time of the upscale pass
+            Core::TimeDelta lastSharpenTime; // GPU time of the sharpen pass
+            Core::TimeDelta averageUpscaleTime;
+            Core::TimeDelta averageSharpenTime;
+        };
+
+        /// Counts since construction or the last resetStats()
+        [[nodiscard]] Stats getStats() const;
+        void resetStats();
+        void printStats(std::ostream& out) const;
+
+    private:
+        vk::Device m_device;
+        Core::MemoryAllocator& m_allocator;
+        vk::Extent2D m_outputExtent;
+        UpscalerSettings m_settings;
+
+        std::shared_ptr<Core::Shader> m_upscaleShader;
+        std::shared_ptr<Core::Shader> m_sharpenShader;
+        std::unique_ptr<Core::DescriptorSetLayout> m_descriptorSetLayout;
+        std::unique_ptr<Core::PipelineLayout> m_pipelineLayout;
+        vk::Pipeline m_upscalePipeline;
+        vk::Pipeline m_sharpenPipeline;
+        vk::Sampler m_sampler; // Unfiltered, as the rendered image is read with texelFetch()
+        vk::DescriptorPool m_descriptorPool;
+
+        struct Image {
+            vk::Image image;
+            vma::Allocation allocation;
+            vk::ImageView view;
+        };
+        struct Slot {
+            Image upscaled; // Half float, written by the upscale and read by the sharpen
+            Image output;
+            vk::DescriptorSet descriptorSet;
+            bool submitted = false;
+        };
+        std::vector<Slot> m_slots;
+
+        /// Before the upscale, between the passes and after the sharpen, for each slot
+        vk::QueryPool m_queryPool;
+        bool m_timestampsSupported;
+        double m_timestampPeriod; // Nanoseconds per tick
+
+        uint64_t m_upscales = 0;
+        Core::TimeDelta m_lastUpscaleTime = Core::TimeDelta::zero();
+        Core::TimeDelta m_lastSharpenTime = Core::TimeDelta::zero();
+        Core::TimeDelta m_upscaleTimeSum = Core::TimeDelta::zero();
+        Core::TimeDelta m_sharpenTimeSum = Core::TimeDelta::zero();
+
+        Image createImage(vk::Format format, vk::ImageUsageFlags usage);
+        void destroyImage(Image& image);
+        void destroySlots();
+    };
+}
@@ -1,171 +1,506 @@
 #include "RT1/RT1App.hpp"
 
-#include <Core/RenderPassBuilder.hpp>
-#include <Core/Shader.hpp>
+#include <Core/EmbeddedShaders.hpp>
+#include <Core/FixedFunctionState.hpp>
+#include <Core/MeshOptimizer.hpp>
+#include <Core/PipelineStateCache.hpp>
+#include <Core/RenderPassDescription.hpp>
+#include <Core/SceneFile.hpp>
+#include <Core/ShaderLibrary.hpp>
+#include <Core/SpecializationConstants.hpp>
 #include <Core/TrianglePipelineBuilder.hpp>
+#include <Core/VertexFormat.hpp>
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
 
 namespace {
-    struct Vertex {
-        float x, y, z, w;
+    Core::FullVertex screenSpaceTriangle[] = {
+        {{-1, 1, 0.5}, {0, 0, -1}, {0, 0}},
+        {{0, -1, 0.5}, {0, 0, -1}, {0.5, 1}},
+        {{1, 1, 0.5}, {0, 0, -1}, {1, 0}},
     };
 
-    Vertex screenSpaceTriangle[] = {
-        {-1, 1, 0.5, 1.0},
-        {0, -1, 0.5, 1.0},
-        {1, 1, 0.5, 1.0},
+    constexpr const char* FRAGMENT_SHADER_PATH = "Resources/Shaders/xyzToRgb.frag.spv";
+
+    /// The format of the images rendered to, which are blitted to the swapchain
+    constexpr vk::Format FRAMEBUFFER_FORMAT = vk::Format::eB8G8R8A8Unorm;
+
+    /// The values of the fragment shader's VIEW constant
+    constexpr uint32_t MESH_VIEW_COUNT = 4;
+    constexpr const char* MESH_VIEW_NAMES[MESH_VIEW_COUNT] = {"blended", "position", "normal", "uv"};
+
+    /// Depth formats in order of preference. Devices support one of the first two as a depth attachment, and all of them the last.
+    constexpr vk::Format DEPTH_FORMATS[] = {
+        vk::Format::eD32Sfloat,
+        vk::Format::eX8D24UnormPack32,
+        vk::Format::eD16Unorm,
+    };
+
+    /// The colour attachment takes the swapchain's format and the depth attachment the chosen depth format, given when the render pass is created
+    constexpr vk::AttachmentDescription MESH_PASS_ATTACHMENTS[] = {
+        {
+            vk::AttachmentDescriptionFlags(),
+            vk::Format::eUndefined,
+            vk::SampleCountFlagBits::e1,
+            vk::AttachmentLoadOp::eClear,
+            vk::AttachmentStoreOp::eStore,
+            vk::AttachmentLoadOp::eDontCare,
+            vk::AttachmentStoreOp::eDontCare,
+            vk::ImageLayout::eUndefined,
+            vk::ImageLayout::eTransferSrcOptimal,
+        },
+        {
+            vk::AttachmentDescriptionFlags(),
+            vk::Format::eUndefined,
+            vk::SampleCountFlagBits::e1,
+            vk::AttachmentLoadOp::eClear,
+            vk::AttachmentStoreOp::eDontCare, // Depth is only needed within the pass
+            vk::AttachmentLoadOp::eDontCare,
+            vk::AttachmentStoreOp::eDontCare,
+            vk::ImageLayout::eUndefined,
+            vk::ImageLayout::eDepthStencilAttachmentOptimal,
+        },
+    };
+    constexpr vk::AttachmentReference MESH_PASS_COLOUR_REFERENCES[] = {{
+        0,
+        vk::ImageLayout::eColorAttachmentOptimal,
+    }};
+    constexpr vk::AttachmentReference MESH_PASS_DEPTH_REFERENCE{
+        1,
+        vk::ImageLayout::eDepthStencilAttachmentOptimal,
+    };
+    constexpr vk::SubpassDescription MESH_PASS_SUBPASSES[] = {{
+        vk::SubpassDescriptionFlags(),
+        vk::PipelineBindPoint::eGraphics,
+        0,
+        nullptr,
+        1,
+        MESH_PASS_COLOUR_REFERENCES,
+        nullptr,
+        &MESH_PASS_DEPTH_REFERENCE,
+        0,
+        nullptr,
+    }};
+    constexpr Core::RenderPassDescription MESH_PASS(MESH_PASS_ATTACHMENTS, MESH_PASS_SUBPASSES);
+    static_assert(MESH_PASS.isValid());
+
+    constexpr vk::PipelineColorBlendAttachmentState MESH_BLEND_STATES[] = {{
+        VK_FALSE,
+        vk::BlendFactor::eOne,
+        vk::BlendFactor::eZero,
+        vk::BlendOp::eAdd,
+        vk::BlendFactor::eOne,
+        vk::BlendFactor::eZero,
+        vk::BlendOp::eAdd,
+        vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA,
+    }};
+    /// Depth is cleared to the far plane. Equal depths pass, so after the prepass the mesh pass shades exactly the fragments
+    /// it left in the buffer, and the same pipelines draw with or without it.
+    constexpr vk::PipelineDepthStencilStateCreateInfo MESH_DEPTH_STATE{
+        vk::PipelineDepthStencilStateCreateFlags(),
+        VK_TRUE, // Depth test
+        VK_TRUE, // Depth write
+        vk::CompareOp::eLessOrEqual,
+        VK_FALSE, // Depth bounds
+        VK_FALSE, // Stencil
+        vk::StencilOpState(),
+        vk::StencilOpState(),
+        0.0f,
+        1.0f,
     };
+    /// Both are set to the render scale's region when recording, so the pipelines do not depend on the framebuffer size
+    constexpr vk::DynamicState MESH_DYNAMIC_STATES[] = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor,
+    };
+    constexpr Core::FixedFunctionState MESH_STATE = Core::FixedFunctionState()
+                                                        .withColourBlendAttachments(MESH_BLEND_STATES)
+                                                        .withDepthStencil(MESH_DEPTH_STATE)
+                                                        .withDynamicStates(MESH_DYNAMIC_STATES);
+    static_assert(MESH_STATE.isValid() && MESH_STATE.isCompatible(MESH_PASS, 0));
+
+    /// The depth prepass writes no colour, and has no fragment shader
+    constexpr vk::PipelineColorBlendAttachmentState DEPTH_PREPASS_BLEND_STATES[] = {{
+        VK_FALSE,
+        vk::BlendFactor::eOne,
+        vk::BlendFactor::eZero,
+        vk::BlendOp::eAdd,
+        vk::BlendFactor::eOne,
+        vk::BlendFactor::eZero,
+        vk::BlendOp::eAdd,
+        vk::ColorComponentFlags(),
+    }};
+    constexpr Core::FixedFunctionState DEPTH_PREPASS_STATE = Core::FixedFunctionState()
+                                                                 .withColourBlendAttachments(DEPTH_PREPASS_BLEND_STATES)
+                                                                 .withDepthStencil(MESH_DEPTH_STATE)
+                                                                 .withDynamicStates(MESH_DYNAMIC_STATES);
+    static_assert(DEPTH_PREPASS_STATE.isValid() && DEPTH_PREPASS_STATE.isCompatible(MESH_PASS, 0));
+
+    const char* getVertexShaderPath(Core::VertexFormat format) {
+        return format == Core::VertexFormat::Compressed ? "Resources/Shaders/trivialCompressed.vert.spv" : "Resources/Shaders/trivial.vert.spv";
+    }
+
+    /// Room for plenty of meshes in the first page
+    constexpr uint32_t VERTICES_PER_PAGE = 1024 * 1024;
+    constexpr uint32_t INDICES_PER_PAGE = 3 * 1024 * 1024;
+
+    /// Set a row-major 3x4 transform to the identity
+    void setIdentityTransform(float transform[3][4]) {
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 4; column++) {
+                transform[row][column] = row == column ? 1.0f : 0.0f;
+            }
+        }
+    }
+
+    /**
+     * Generate a screen covering grid of detail x detail quads as a triangle soup.
+     * The normals bulge outward like a dome, so that they exercise the whole octahedral encoding.
+     * Triangles wind clockwise on screen to match the pipeline's front face.
+     */
+    std::vector<Core::FullVertex> generateGrid(uint32_t detail) {
+        auto gridVertex = [detail](uint32_t x, uint32_t y) {
+            glm::vec2 uv(static_cast<float>(x) / detail, static_cast<float>(y) / detail);
+            glm::vec2 centred = uv * 2.0f - 1.0f;
+            glm::vec3 normal = glm::normalize(glm::vec3(centred, -1.0f));
+            return Core::FullVertex{glm::vec3(centred, 0.5f), normal, uv};
+        };
+
+        std::vector<Core::FullVertex> soup;
+        soup.reserve(static_cast<std::size_t>(detail) * detail * 6);
+        for (uint32_t y = 0; y < detail; y++) {
+            for (uint32_t x = 0; x < detail; x++) {
+                Core::FullVertex topLeft = gridVertex(x, y);
+                Core::FullVertex topRight = gridVertex(x + 1, y);
+                Core::FullVertex bottomLeft = gridVertex(x, y + 1);
+                Core::FullVertex bottomRight = gridVertex(x + 1, y + 1);
+                soup.insert(soup.end(), {topLeft, topRight, bottomLeft, topRight, bottomRight, bottomLeft});
+            }
+        }
+        return soup;
+    }
 }
 
 namespace RT1 {
 
-    RT1App::RT1App(Core::Renderer& renderer, Core::V1AppBase::Parameters& parameters)
+    const char* to_string(UpscaleMode mode) {
+        switch (mode) {
+        case UpscaleMode::Blit:
+            return "Blit";
+        case UpscaleMode::Spatial:
+            return "Spatial";
+        }
+        return "Unknown";
+    }
+
+    RT1App::RT1App(Core::Renderer& renderer, Parameters& parameters)
         : Core::V1AppBase(renderer, parameters)
         , m_runtimeParameters(parameters)
         , m_renderer(renderer)
         , m_device(renderer.getDevice())
+        , m_allocator(renderer)
+        , m_dynamicResolution(renderer)
+        , m_upscaler(renderer, m_allocator)
+        , m_upscaleMode(parameters.upscaleMode)
+        , m_pipelineStatistics(renderer)
+        , m_depthFormat(chooseDepthFormat())
+        , m_depthPrepass(parameters.depthPrepass)
         , m_graphicsQueue(renderer.getQueue(Core::QueueType::Graphics))
         , m_transferQueue(renderer.getQueue(Core::QueueType::Transfer))
         , m_presentQueue(renderer.getQueue(Core::QueueType::Present)) {
 
-        vma::AllocatorCreateInfo allocatorInfo{};
-        allocatorInfo.physicalDevice = renderer.getPhysicalDevice();
-        allocatorInfo.device = m_device;
-        allocatorInfo.instance = renderer.getInstance();
-        vma::createAllocator(&allocatorInfo, &m_allocator);
+        // Started first, so the read overlaps the rest of the setup up to initRenderData()
+        if (!m_runtimeParameters.scenePath.empty()) {
+            m_sceneRead = m_asyncIO.read(m_runtimeParameters.scenePath);
+        }
 
+        if (!m_runtimeParameters.streamPath.empty()) {
+            // An offline render keeps every frame, so rendering waits for the stream rather than dropping frames
+            auto stream = std::make_shared<Core::VideoStream>(
+                m_runtimeParameters.streamPath, m_runtimeParameters.streamFormat, m_runtimeParameters.streamFrameRate);
+            m_frameCapture = std::make_unique<Core::FrameCapture>(
+                m_allocator,
+                std::string(Core::to_string(m_runtimeParameters.streamFormat)) + " stream",
+                [stream](uint64_t frameNumber, Core::ImageRGBA8& image) { return stream->writeFrame(frameNumber, image); },
+                false);
+            m_frameCapture->setEnabled(true);
+        } else {
+            // Files are only written once capture is enabled, with F6 if not from the start
+            std::string capturePath = m_runtimeParameters.capturePath.empty() ? "RT1_capture_" : m_runtimeParameters.capturePath;
+            m_frameCapture = std::make_unique<Core::FrameCapture>(m_allocator, capturePath, m_runtimeParameters.captureFormat);
+            m_frameCapture->setEnabled(!m_runtimeParameters.capturePath.empty());
+        }
+
+        // A budget turns dynamic resolution on from the start, otherwise F7 turns it on with the default budget
+        Core::DynamicResolutionSettings resolutionSettings;
+        if (m_runtimeParameters.dynamicResolutionBudget > 0.0f) {
+            resolutionSettings.targetFrameTime = Core::TimeDelta(m_runtimeParameters.dynamicResolutionBudget / 1000.0);
+        }
+        resolutionSettings.minScale = m_runtimeParameters.minRenderScale;
+        resolutionSettings.maxScale = m_runtimeParameters.maxRenderScale;
+        resolutionSettings.fixedScale = m_runtimeParameters.renderScale;
+        m_dynamicResolution.setSettings(resolutionSettings);
+        m_dynamicResolutionRequested = m_runtimeParameters.dynamicResolutionBudget > 0.0f;
+        m_dynamicResolution.setEnabled(m_dynamicResolutionRequested && !capturesRenderedImage());
+        // Scaled regions are blitted with linear filtering where the format allows it, nearest otherwise
+        vk::FormatProperties framebufferFormatProperties = m_renderer.getPhysicalDevice().getFormatProperties(FRAMEBUFFER_FORMAT);
+        m_linearBlit = static_cast<bool>(framebufferFormatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
+        m_upscaler.setSettings(UpscalerSettings{m_runtimeParameters.sharpness});
+
+        // The vertex format, and so the pipeline, can come from the scene file
+        initRenderData();
+        // Idle frames may move the pool's pages, and the command buffers bind them
+        m_allocator.setMoveCallback([this](vma::Allocation allocation, vk::Buffer oldBuffer, vk::Buffer newBuffer) {
+            if (m_geometryPool && m_geometryPool->bufferMoved(allocation, oldBuffer, newBuffer)) {
+                m_recordRequested = true;
+            }
+        });
         initRenderPass();
         initPipeline();
-        initRenderData();
         initSemaphores();
         initCommandPools();
 
         vk::Extent2D windowSize = m_renderer.getSwapchainExtents();
         createSwapchainResources(windowSize.width, windowSize.height);
+
+        if (m_runtimeParameters.swapchainSweepFrames > 0) {
+            initSwapchainSweep();
+        }
     }
 
     RT1App::~RT1App() noexcept {
+        // Pipelines still compiling use the layout and render pass
+        m_renderer.getPipelineCompiler().waitIdle();
+        // Both are destroyed with the app, and a later layout or render pass may be given the same handle value
+        m_renderer.releaseCachedPipelines(Core::PipelineState::getHandleKey(m_meshPipelineLayout->getHandle()));
+        if (m_basicRenderPass) {
+            m_renderer.releaseCachedPipelines(Core::PipelineState::getHandleKey(m_basicRenderPass->getHandle()));
+        }
         destroySwapchainResources();
 
         cleanupCommandPools();
         cleanupSemaphores();
         cleanupRenderData();
+    }
 
-        m_allocator.destroy();
+    vk::Format RT1App::chooseDepthFormat() const {
+        for (vk::Format format : DEPTH_FORMATS) {
+            vk::FormatProperties properties = m_renderer.getPhysicalDevice().getFormatProperties(format);
+            if (properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment) {
+                return format;
+            }
+        }
+        throw std::runtime_error("No depth format can be rendered to");
     }
 
     void RT1App::initRenderPass() {
-        Core::RenderPassBuilder builder;
+        // Pipelines and command buffers name the attachments themselves
+        if (m_renderer.getDynamicRendering().isEnabled()) {
+            return;
+        }
 
-        builder.addAttachment(vk::AttachmentDescription{
-            vk::AttachmentDescriptionFlags(),
-            m_renderer.getOutputFormat(),
-            VULKAN_HPP_NAMESPACE::SampleCountFlagBits::e1,
-            vk::AttachmentLoadOp::eClear,
-            vk::AttachmentStoreOp::eStore,
-            vk::AttachmentLoadOp::eDontCare,
-            vk::AttachmentStoreOp::eDontCare,
-            vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eTransferSrcOptimal,
-        });
+        const vk::Format runtimeFormats[] = {m_renderer.getOutputFormat(), m_depthFormat};
+        m_basicRenderPass = std::make_unique<Core::RenderPass>(m_device, MESH_PASS, runtimeFormats);
+    }
 
-        vk::AttachmentReference colourInputAttachment{
+    void RT1App::initPipeline() {
+        // Create a pipeline layout
+        m_emptyDescriptorSetLayout = std::make_unique<Core::DescriptorSetLayout>(m_device, 0, nullptr);
+        vk::PushConstantRange quantizationRange{
+            vk::ShaderStageFlagBits::eVertex,
             0,
-            vk::ImageLayout::eColorAttachmentOptimal,
+            sizeof(MeshConstants),
         };
-        builder.addSubpass(vk::SubpassDescription{
-            vk::SubpassDescriptionFlags(),
-            vk::PipelineBindPoint::eGraphics,
-            0,
-            nullptr,
-            1,
-            &colourInputAttachment,
-            nullptr,
-            nullptr,
-            0,
-            nullptr,
-        });
+        m_meshPipelineLayout = std::make_unique<Core::PipelineLayout>(m_device, 1, &m_emptyDescriptorSetLayout->getHandle(), 1, &quantizationRange);
 
-        vk::RenderPassCreateInfo createInfo;
-        builder.getRenderPassCreateInfo(createInfo);
+        // The library keeps the modules for rebuilds
+        m_vertexShader = getShader(getVertexShaderPath(m_vertexFormat), m_vertexShaderRead, Core::ShaderType::eVertex);
+        m_fragmentShader = getShader(FRAGMENT_SHADER_PATH, m_fragmentShaderRead, Core::ShaderType::eFragment);
+        m_renderer.getShaderLibrary().printStats(std::cout);
 
-        m_basicRenderPass = std::make_unique<Core::RenderPass>(m_device, createInfo);
+        createPipeline();
+        m_renderer.getPipelineLibraryCache().printStats(std::cout);
+        m_renderer.getPipelineStateCache().printStats(std::cout);
     }
 
-    void RT1App::initPipeline() {
-        // Create a pipeline layout
-        m_emptyDescriptorSetLayout = std::make_unique<Core::DescriptorSetLayout>(m_device, 0, nullptr);
-        m_emptyPipelineLayout = std::make_unique<Core::PipelineLayout>(m_device, 1, &m_emptyDescriptorSetLayout->getHandle(), 0, nullptr);
+    void RT1App::createPipeline() {
+        // The mesh and depth prepass pipelines draw the same vertices to the same attachments
+        auto setSharedState = [&](Core::TrianglePipelineBuilder& builder) {
+            builder.setPipelineLayout(*m_meshPipelineLayout);
+            if (m_basicRenderPass) {
+                builder.setRenderPass(*m_basicRenderPass, 0);
+            } else {
+                vk::Format outputFormat = m_renderer.getOutputFormat();
+                builder.setRenderingFormats(std::span<const vk::Format>(&outputFormat, 1), m_depthFormat);
+            }
+            builder.addShader(*m_vertexShader);
+            builder.addVertexFormat(m_vertexFormat);
+        };
 
-        // Create a pipeline
-        Core::TrianglePipelineBuilder pipelineBuilder;
-        pipelineBuilder.setPipelineLayout(*m_emptyPipelineLayout);
-        pipelineBuilder.setRenderPass(*m_basicRenderPass, 0);
+        // Without a fragment shader there is little to compile, so the prepass is created now whether or not it is on
+        Core::TrianglePipelineBuilder depthPrepassBuilder;
+        setSharedState(depthPrepassBuilder);
+        depthPrepassBuilder.setFixedFunctionState(DEPTH_PREPASS_STATE);
+        m_depthPrepassPipeline = m_renderer.getPipelineStateCache().get(depthPrepassBuilder);
+
+        // Shared with the compiler, which keeps it until every view is compiled
+        auto pipelineBuilder = std::make_shared<Core::TrianglePipelineBuilder>();
+        setSharedState(*pipelineBuilder);
+        pipelineBuilder->setFixedFunctionState(MESH_STATE);
+        pipelineBuilder->addShader(*m_fragmentShader);
+
+        m_meshPipelines.clear();
+
+        // With pipeline libraries, the views share every part but the fragment shader, and each is usable at once
+        Core::PipelineLibraryCache& libraryCache = m_renderer.getPipelineLibraryCache();
+        if (libraryCache.isEnabled()) {
+            for (uint32_t view = 0; view < MESH_VIEW_COUNT; view++) {
+                Core::SpecializationConstants viewConstants;
+                viewConstants.set(0, view);
+                pipelineBuilder->addShader(*m_fragmentShader, viewConstants);
+                m_meshPipelines.push_back(libraryCache.getPipeline(*pipelineBuilder));
+            }
+            return;
+        }
 
-        // There is only one colour attachment
-        pipelineBuilder.addColourAttachmentBlendState();
+        // The unspecialized shader is the blended view, which is created now so rendering can start with it
+        std::shared_ptr<Core::GraphicsPipeline> blendedPipeline = m_renderer.getPipelineStateCache().get(*pipelineBuilder);
 
-        Core::Shader vertShader("Resources/Shaders/trivial.vert.spv", Core::ShaderType::eVertex, m_renderer.getDevice());
-        pipelineBuilder.addShader(vertShader);
-        Core::Shader fragShader("Resources/Shaders/xyzToRgb.frag.spv", Core::ShaderType::eFragment, m_renderer.getDevice());
-        pipelineBuilder.addShader(fragShader);
+        // The other views are compiled in the background, and drawn as blended until they are ready
+        std::vector<Core::SpecializationConstants> views(MESH_VIEW_COUNT - 1);
+        for (uint32_t view = 1; view < MESH_VIEW_COUNT; view++) {
+            views[view - 1].set(0, view);
+        }
+        std::vector<std::future<std::unique_ptr<Core::GraphicsPipeline>>> compiledViews =
+            m_renderer.getPipelineCompiler().compilePermutations(pipelineBuilder, Core::ShaderType::eFragment, views);
 
-        vk::Extent2D windowSize = m_renderer.getSwapchainExtents();
-        pipelineBuilder.setWindowSize(windowSize.width, windowSize.height);
+        m_meshPipelines.emplace_back(blendedPipeline);
+        for (std::future<std::unique_ptr<Core::GraphicsPipeline>>& compiledView : compiledViews) {
+            m_meshPipelines.emplace_back(blendedPipeline, std::move(compiledView));
+        }
+    }
 
-        pipelineBuilder.addVertexInputBindingDesc(vk::VertexInputBindingDescription{
-            0,
-            sizeof(Vertex),
-            vk::VertexInputRate::eVertex,
-        });
-        pipelineBuilder.addVertexInputAttributeDesc(vk::VertexInputAttributeDescription{
-            0,
-            0,
-            vk::Format::eR32G32B32A32Sfloat,
-            0,
-        });
+    void RT1App::initRenderData() {
+        if (!m_runtimeParameters.scenePath.empty()) {
+            initSceneData();
+        } else {
+            initGeneratedData();
+        }
+    }
 
-        vk::GraphicsPipelineCreateInfo pipelineCreateInfo;
-        pipelineBuilder.getPipelineCreateInfo(pipelineCreateInfo);
+    void RT1App::requestShaders() {
+        // Embedded shaders are already in memory, anything else is read while the geometry is prepared
+        if (!Core::findEmbeddedShader(getVertexShaderPath(m_vertexFormat))) {
+            m_vertexShaderRead = m_asyncIO.read(getVertexShaderPath(m_vertexFormat));
+        }
+        if (!Core::findEmbeddedShader(FRAGMENT_SHADER_PATH)) {
+            m_fragmentShaderRead = m_asyncIO.read(FRAGMENT_SHADER_PATH);
+        }
+    }
 
-        std::vector<std::unique_ptr<Core::GraphicsPipeline>> createdPipelines = m_renderer.createGraphicsPipelines(1, &pipelineCreateInfo);
+    std::shared_ptr<Core::Shader> RT1App::getShader(const std::string& path, std::future<std::vector<char>>& read, Core::ShaderType type) {
+        if (!read.valid()) {
+            return m_renderer.getShaderLibrary().load(path, type);
+        }
 
-        m_simpleTrianglePipeline = std::move(createdPipelines[0]);
+        // Requested by initRenderData(), by now it has most likely arrived
+        std::vector<char> code = read.get();
+        m_asyncIO.printStats(std::cout);
+        return m_renderer.getShaderLibrary().get(path, code.data(), code.size(), type);
     }
 
-    void RT1App::initRenderData() {
-        std::size_t vertexDataSize = sizeof(Vertex) * std::size(screenSpaceTriangle);
+    void RT1App::initGeneratedData() {
+        m_vertexFormat = m_runtimeParameters.vertexFormat;
+        requestShaders();
+        m_geometryPool =
+            std::make_unique<Core::GeometryPool>(m_renderer, m_allocator, Core::getVertexStride(m_vertexFormat), VERTICES_PER_PAGE, INDICES_PER_PAGE);
 
-        vk::BufferCreateInfo vertexBufferInfo{
-            vk::BufferCreateFlags(),
-            vertexDataSize,
-            vk::BufferUsageFlagBits::eVertexBuffer,
-            vk::SharingMode::eExclusive,
-            1,
-            &m_graphicsQueue.familyIndex,
-        };
-        vma::AllocationCreateInfo vertexAllocationInfo{
-            vma::AllocationCreateFlags(),
-            vma::MemoryUsage::eGpuOnly,
-            // TODO Use device local memory and update with a one-off command buffer
-//            vk::MemoryPropertyFlagBits::eDeviceLocal |
-            vk::MemoryPropertyFlagBits::eHostVisible,
-            vk::MemoryPropertyFlagBits::eHostCoherent,
-            0,
-            vma::Pool(),
-            nullptr,
-        };
-        std::tie(m_vertexBuffer, m_vertexBufferAllocation) = m_allocator.createBuffer(vertexBufferInfo, vertexAllocationInfo);
+        std::vector<Core::FullVertex> soup;
+        if (m_runtimeParameters.meshDetail > 0) {
+            soup = generateGrid(m_runtimeParameters.meshDetail);
+        } else {
+            soup.assign(std::begin(screenSpaceTriangle), std::end(screenSpaceTriangle));
+        }
+
+        // Optimize at full precision, the overdraw stage reads float positions
+        Core::MeshOptimizer optimizer(sizeof(Core::FullVertex), offsetof(Core::FullVertex, position));
+        Core::IndexedMesh mesh = optimizer.ingest(soup.data(), soup.size());
+        optimizer.printReport(std::cout);
+
+        const auto* vertices = reinterpret_cast<const Core::FullVertex*>(mesh.vertices.data());
+        uint32_t vertexCount = mesh.getVertexCount();
+
+        MeshDraw draw{};
+        setIdentityTransform(draw.constants.transform);
+
+        std::vector<Core::CompressedVertex> compressedVertices;
+        const void* vertexData = vertices;
+        if (m_vertexFormat == Core::VertexFormat::Compressed) {
+            draw.constants.quantization = Core::computeQuantization(vertices, vertexCount);
+            compressedVertices = Core::compressVertices(vertices, vertexCount, draw.constants.quantization);
+            vertexData = compressedVertices.data();
+        } else {
+            draw.constants.quantization = Core::getIdentityQuantization();
+        }
 
-        // Map this new memory and upload our buffer
-        void* mappedBuffer = m_allocator.mapMemory(m_vertexBufferAllocation);
-        memcpy(mappedBuffer, screenSpaceTriangle, vertexDataSize);
-        m_allocator.flushAllocation(m_vertexBufferAllocation, 0, vertexDataSize);
-        m_allocator.invalidateAllocation(m_vertexBufferAllocation, 0, vertexDataSize);
-        m_allocator.unmapMemory(m_vertexBufferAllocation);
+        std::cout << "Vertex format: " << Core::to_string(m_vertexFormat) << ", " << vertexCount << " vertices in ";
+        std::cout << static_cast<std::size_t>(vertexCount) * Core::getVertexStride(m_vertexFormat) / 1024 << " KiB (";
+        std::cout << static_cast<std::size_t>(vertexCount) * sizeof(Core::FullVertex) / 1024 << " KiB uncompressed)" << std::endl;
+
+        m_meshGeometry = m_geometryPool->allocate(vertexCount, static_cast<uint32_t>(mesh.indices.size()));
+        m_geometryPool->upload(m_meshGeometry, vertexData, mesh.indices.data());
+        m_geometryPool->flushUploads();
+
+        draw.range = m_meshGeometry;
+        m_meshDraws.push_back(draw);
+    }
+
+    void RT1App::initSceneData() {
+        Core::TimePoint start = std::chrono::high_resolution_clock::now();
+
+        Core::SceneFile scene(m_runtimeParameters.scenePath, m_sceneRead.get());
+        m_vertexFormat = scene.getVertexFormat();
+        requestShaders();
+        m_geometryPool =
+            std::make_unique<Core::GeometryPool>(m_renderer, m_allocator, Core::getVertexStride(m_vertexFormat), VERTICES_PER_PAGE, INDICES_PER_PAGE);
+
+        // The whole scene shares one range, uploaded straight from the file's contents. Meshes are sub-ranges of it.
+        m_meshGeometry = m_geometryPool->allocate(static_cast<uint32_t>(scene.getVertexCount()), static_cast<uint32_t>(scene.getIndices().size()));
+        m_geometryPool->upload(m_meshGeometry, scene.getVertexData().data(), scene.getIndices().data());
+        m_geometryPool->flushUploads();
+
+        std::span<const Core::SceneMesh> meshes = scene.getMeshes();
+        for (const Core::SceneInstance& instance : scene.getInstances()) {
+            const Core::SceneMesh& mesh = meshes[instance.mesh];
+
+            MeshDraw draw{};
+            draw.range = Core::GeometryPool::Range{
+                m_meshGeometry.page,
+                m_meshGeometry.firstVertex + mesh.firstVertex,
+                mesh.vertexCount,
+                m_meshGeometry.firstIndex + mesh.firstIndex,
+                mesh.indexCount,
+            };
+            draw.constants.quantization = mesh.quantization;
+            memcpy(draw.constants.transform, instance.transform, sizeof(instance.transform));
+            m_meshDraws.push_back(draw);
+        }
+
+        Core::TimeDelta loadTime = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "Loaded " << m_runtimeParameters.scenePath << ": " << scene.getFileSize() / (1024 * 1024) << " MiB, " << meshes.size()
+                  << " meshes, " << m_meshDraws.size() << " instances in " << loadTime.count() << " s" << std::endl;
+        m_asyncIO.printStats(std::cout);
     }
 
     void RT1App::cleanupRenderData() {
-        m_allocator.destroyBuffer(m_vertexBuffer, m_vertexBufferAllocation);
+        m_geometryPool->free(m_meshGeometry);
+        m_geometryPool.reset();
     }
 
     void RT1App::initSemaphores() {
@@ -208,26 +543,33 @@ namespace RT1 {
 
         std::size_t numSwapchainImages = m_renderer.getNumSwapchainImages();
 
-        vk::Format imageFormat = vk::Format::eB8G8R8A8Unorm;
+        // Large enough for every render scale, so changing the scale only records the command buffers again
+        vk::Extent2D framebufferExtent = m_dynamicResolution.getTargetExtent(vk::Extent2D(width, height));
+        vk::Format imageFormat = FRAMEBUFFER_FORMAT;
         vk::ImageCreateInfo framebufferImageInfo{
             vk::ImageCreateFlags(),
             vk::ImageType::e2D,
             imageFormat,
-            vk::Extent3D(width, height, 1),
+            vk::Extent3D(framebufferExtent.width, framebufferExtent.height, 1),
             1,
             1,
             vk::SampleCountFlagBits::e1,
             vk::ImageTiling::eOptimal,
-            vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eColorAttachment,
+            // Sampled by the spatial upscaler
+            vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled,
             vk::SharingMode::eExclusive,
             0,
             nullptr, // Ignored when sharing mode is not eConcurrent
             vk::ImageLayout::eUndefined,
         };
+        vk::ImageCreateInfo depthImageInfo = framebufferImageInfo;
+        depthImageInfo.format = m_depthFormat;
+        depthImageInfo.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
         vma::AllocationCreateInfo imageAllocationInfo{};
+        imageAllocationInfo.usage = vma::MemoryUsage::eGpuOnly;
 
         for (std::size_t i = 0; i < numSwapchainImages; i++) {
-            auto [image, allocation] = m_allocator.createImage(framebufferImageInfo, imageAllocationInfo);
+            auto [image, allocation] = m_allocator.createImage(framebufferImageInfo, imageAllocationInfo, Core::AllocationCategory::Framebuffer);
 
             vk::ImageViewCreateInfo imageViewCreateInfo{
                 vk::ImageViewCreateFlags(),
@@ -246,50 +588,84 @@ namespace RT1 {
 
             vk::ImageView imageView = m_device.createImageView(imageViewCreateInfo);
 
-            vk::FramebufferCreateInfo framebufferCreateInfo{
-                vk::FramebufferCreateFlags(),
-                m_basicRenderPass->getHandle(),
-                1,
-                &imageView,
-                static_cast<uint32_t>(width),
-                static_cast<uint32_t>(height),
-                1,
+            auto [depthImage, depthAllocation] = m_allocator.createImage(depthImageInfo, imageAllocationInfo, Core::AllocationCategory::Framebuffer);
+            vk::ImageViewCreateInfo depthViewCreateInfo{
+                vk::ImageViewCreateFlags(),
+                depthImage,
+                vk::ImageViewType::e2D,
+                m_depthFormat,
+                vk::ComponentMapping(),
+                vk::ImageSubresourceRange{
+                    vk::ImageAspectFlagBits::eDepth,
+                    0,
+                    1,
+                    0,
+                    1,
+                },
             };
-
-            vk::Framebuffer framebuffer = m_device.createFramebuffer(framebufferCreateInfo);
+            vk::ImageView depthImageView = m_device.createImageView(depthViewCreateInfo);
+
+            // Dynamic rendering renders straight to the image views
+            vk::Framebuffer framebuffer;
+            if (m_basicRenderPass) {
+                vk::ImageView attachments[] = {imageView, depthImageView};
+                vk::FramebufferCreateInfo framebufferCreateInfo{
+                    vk::FramebufferCreateFlags(),
+                    m_basicRenderPass->getHandle(),
+                    static_cast<uint32_t>(std::size(attachments)),
+                    attachments,
+                    framebufferExtent.width,
+                    framebufferExtent.height,
+                    1,
+                };
+                framebuffer = m_device.createFramebuffer(framebufferCreateInfo);
+            }
             m_framebufferData.push_back(FramebufferData{
                 image,
                 allocation,
                 imageView,
+                depthImage,
+                depthAllocation,
+                depthImageView,
                 framebuffer,
             });
         }
 
+        // A readback buffer per command buffer, so a frame's copy never overwrites one still being read
+        bool spatial = m_upscaleMode == UpscaleMode::Spatial;
+        m_frameCapture->resize(vk::Extent2D(width, height), spatial ? m_upscaler.getOutputFormat() : imageFormat, numSwapchainImages);
+        m_dynamicResolution.resize(numSwapchainImages);
+        m_pipelineStatistics.resize(numSwapchainImages);
+        std::vector<vk::ImageView> renderedViews;
+        if (spatial) {
+            for (const FramebufferData& framebufferData : m_framebufferData) {
+                renderedViews.push_back(framebufferData.colourAttachment0ImageView);
+            }
+        }
+        m_upscaler.resize(vk::Extent2D(width, height), renderedViews);
+
         createCommandBuffers(width, height);
     }
 
     void RT1App::destroySwapchainResources() {
         for (FramebufferData framebufferData : m_framebufferData) {
-            m_device.destroyFramebuffer(framebufferData.framebuffer);
+            if (framebufferData.framebuffer) {
+                m_device.destroyFramebuffer(framebufferData.framebuffer);
+            }
             m_device.destroyImageView(framebufferData.colourAttachment0ImageView);
             m_allocator.destroyImage(framebufferData.colourAttachment0Image, framebufferData.colourAttachment0ImageAllocation);
+            m_device.destroyImageView(framebufferData.depthImageView);
+            m_allocator.destroyImage(framebufferData.depthImage, framebufferData.depthImageAllocation);
         }
         m_framebufferData.clear();
     }
 
     void RT1App::createCommandBuffers(int width, int height) {
-        if (!m_commandBufferFences.empty()) {
-            // Wait until all our command buffers are not in a pending state
-            // Note we only wait on the first few fences, if there are more fences than buffers
-            m_device.waitForFences(static_cast<uint32_t>(m_graphicsCommandBuffers.size()), m_commandBufferFences.data(), VK_TRUE, UINT64_MAX);
-        }
-
         std::size_t neededCommandBuffers = m_renderer.getNumSwapchainImages();
         if (m_graphicsCommandBuffers.size() != neededCommandBuffers) {
             // Resize
             destroyCommandBuffers();
             m_graphicsCommandBuffers.resize(neededCommandBuffers);
-            m_commandBufferFences.resize(neededCommandBuffers);
 
             vk::CommandBufferAllocateInfo allocInfo{
                 m_renderCommandPool,
@@ -298,19 +674,9 @@ namespace RT1 {
             };
 
             m_device.allocateCommandBuffers(&allocInfo, m_graphicsCommandBuffers.data());
-
-            vk::FenceCreateInfo fenceCreateInfo{
-                vk::FenceCreateFlagBits::eSignaled,
-            };
-
-            while (m_commandBufferFences.size() < m_graphicsCommandBuffers.size()) {
-                m_commandBufferFences.push_back(m_device.createFence(fenceCreateInfo));
-            }
         } else {
-            // Reset for reuse
-            for (vk::CommandBuffer buffer : m_graphicsCommandBuffers) {
-                buffer.reset(vk::CommandBufferResetFlags());
-            }
+            // Reset for reuse. The pool holds only these buffers, so it is reset whole, as its buffers cannot be reset one by one.
+            m_device.resetCommandPool(m_renderCommandPool, vk::CommandPoolResetFlags());
         }
 
         recordCommandBuffers(width, height);
@@ -324,30 +690,142 @@ namespace RT1 {
         vk::ClearValue clearValue = {
             std::array<float, 4>{1.0, 0.0, 1.0, 1.0},
         };
+        vk::ClearValue depthClearValue = {
+            vk::ClearDepthStencilValue{1.0f, 0}, // The far plane
+        };
+        // In the order of the render pass's attachments
+        std::array<vk::ClearValue, 2> clearValues{clearValue, depthClearValue};
+        // Only the region of the framebuffer at the current scale is rendered, then scaled to the output by the blit or the upscaler
+        vk::Extent2D renderExtent = getRenderExtent(vk::Extent2D(width, height));
+        vk::Rect2D renderArea{
+            vk::Offset2D{0, 0},
+            renderExtent,
+        };
         vk::RenderPassBeginInfo renderPassInfo{
-            *m_basicRenderPass,
+            m_basicRenderPass ? m_basicRenderPass->getHandle() : vk::RenderPass(),
             vk::Framebuffer(), // Replaced each iteration
-            vk::Rect2D{
-                vk::Offset2D{0, 0},
-                vk::Extent2D(width, height),
-            },
+            renderArea,
+            static_cast<uint32_t>(clearValues.size()),
+            clearValues.data(),
+        };
+
+        // Info needed to render without a render pass
+        const Core::DynamicRendering& dynamicRendering = m_renderer.getDynamicRendering();
+        vk::RenderingAttachmentInfoKHR colourAttachmentInfo{
+            vk::ImageView(), // Replaced each iteration
+            vk::ImageLayout::eColorAttachmentOptimal,
+            vk::ResolveModeFlagBits::eNone,
+            vk::ImageView(),
+            vk::ImageLayout::eUndefined,
+            vk::AttachmentLoadOp::eClear,
+            vk::AttachmentStoreOp::eStore,
+            clearValue,
+        };
+        vk::RenderingAttachmentInfoKHR depthAttachmentInfo{
+            vk::ImageView(), // Replaced each iteration
+            vk::ImageLayout::eDepthStencilAttachmentOptimal,
+            vk::ResolveModeFlagBits::eNone,
+            vk::ImageView(),
+            vk::ImageLayout::eUndefined,
+            vk::AttachmentLoadOp::eClear,
+            vk::AttachmentStoreOp::eDontCare,
+            depthClearValue,
+        };
+        vk::RenderingInfoKHR renderingInfo{
+            vk::RenderingFlagsKHR(),
+            renderArea,
+            1,
+            0, // View mask
             1,
-            &clearValue,
+            &colourAttachmentInfo,
+            &depthAttachmentInfo,
+            nullptr,
+        };
+
+        // The layout transitions a render pass would make, from the previous frame's blit to rendering and back
+        vk::ImageMemoryBarrier preRenderBarrier{
+            vk::AccessFlags(),
+            vk::AccessFlagBits::eColorAttachmentWrite,
+            vk::ImageLayout::eUndefined,
+            vk::ImageLayout::eColorAttachmentOptimal,
+            m_graphicsQueue.familyIndex,
+            m_graphicsQueue.familyIndex,
+            vk::Image(), // Will be replaced later on use
+            vk::ImageSubresourceRange{
+                vk::ImageAspectFlagBits::eColor,
+                0,
+                1,
+                0,
+                1,
+            },
+        };
+        vk::ImageMemoryBarrier preRenderDepthBarrier{
+            vk::AccessFlagBits::eDepthStencilAttachmentWrite, // The previous frame's depth tests, before the image is cleared again
+            vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+            vk::ImageLayout::eUndefined,
+            vk::ImageLayout::eDepthStencilAttachmentOptimal,
+            m_graphicsQueue.familyIndex,
+            m_graphicsQueue.familyIndex,
+            vk::Image(), // Will be replaced later on use
+            vk::ImageSubresourceRange{
+                vk::ImageAspectFlagBits::eDepth,
+                0,
+                1,
+                0,
+                1,
+            },
+        };
+        vk::ImageMemoryBarrier postRenderBarrier{
+            vk::AccessFlagBits::eColorAttachmentWrite,
+            vk::AccessFlagBits::eTransferRead, // The blit reads it
+            vk::ImageLayout::eColorAttachmentOptimal,
+            vk::ImageLayout::eTransferSrcOptimal,
+            m_graphicsQueue.familyIndex,
+            m_graphicsQueue.familyIndex,
+            vk::Image(), // Will be replaced later on use
+            vk::ImageSubresourceRange{
+                vk::ImageAspectFlagBits::eColor,
+                0,
+                1,
+                0,
+                1,
+            },
+        };
+
+        // The spatial upscaler samples the rendered image in place of the blit. Without a render pass it is transitioned straight from
+        // rendering. The render pass's final layout is for the blit, so the barrier must also follow that transition's transfer scope.
+        bool spatial = m_upscaleMode == UpscaleMode::Spatial;
+        vk::PipelineStageFlags preUpscaleSourceStages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        if (m_basicRenderPass) {
+            preUpscaleSourceStages |= vk::PipelineStageFlagBits::eTransfer;
+        }
+        vk::ImageMemoryBarrier preUpscaleBarrier{
+            vk::AccessFlagBits::eColorAttachmentWrite,
+            vk::AccessFlagBits::eShaderRead,
+            m_basicRenderPass ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::eColorAttachmentOptimal,
+            vk::ImageLayout::eShaderReadOnlyOptimal,
+            m_graphicsQueue.familyIndex,
+            m_graphicsQueue.familyIndex,
+            vk::Image(), // Will be replaced later on use
+            vk::ImageSubresourceRange{
+                vk::ImageAspectFlagBits::eColor,
+                0,
+                1,
+                0,
+                1,
+            },
         };
 
         // Viewport info
         vk::Viewport viewport{
             0,
             0,
-            static_cast<float>(width),
-            static_cast<float>(height),
+            static_cast<float>(renderExtent.width),
+            static_cast<float>(renderExtent.height),
             0.0f,
             1.0f,
         };
 
-        // Offset of vertex data in the vertex buffer
-        vk::DeviceSize vertexBufferOffset = 0;
-
         // Info needed to transfer swapchain to transfer dst layout
         vk::ImageMemoryBarrier preTransferSwapchainBarrier{
             vk::AccessFlags(),
@@ -366,7 +844,12 @@ namespace RT1 {
             },
         };
 
-        // Info needed for blit operation
+        // Info needed for blit operation. The upscaler's output is already the swapchain's size.
+        vk::Extent2D blitSourceExtent = spatial ? vk::Extent2D(width, height) : renderExtent;
+        std::array<vk::Offset3D, 2> renderedBlitOffsets{
+            vk::Offset3D(0, 0, 0),
+            vk::Offset3D(static_cast<int32_t>(blitSourceExtent.width), static_cast<int32_t>(blitSourceExtent.height), 1),
+        };
         std::array<vk::Offset3D, 2> swapchainBlitOffsets{
             vk::Offset3D(0, 0, 0),
             vk::Offset3D(width, height, 1),
@@ -378,7 +861,7 @@ namespace RT1 {
                 0,
                 1,
             },
-            swapchainBlitOffsets,
+            renderedBlitOffsets,
             vk::ImageSubresourceLayers{
                 vk::ImageAspectFlagBits::eColor,
                 0,
@@ -387,6 +870,8 @@ namespace RT1 {
             },
             swapchainBlitOffsets,
         };
+        bool scaled = blitSourceExtent != vk::Extent2D(width, height);
+        vk::Filter blitFilter = scaled && m_linearBlit ? vk::Filter::eLinear : vk::Filter::eNearest;
         const std::vector<vk::Image>& swapchainImages = m_renderer.getSwapchainImages();
 
         // Info needed to transfer swapchain image to present layout
@@ -412,17 +897,87 @@ namespace RT1 {
         for (std::size_t cmdBufferIndex = 0; cmdBufferIndex < numCmdBuffers; cmdBufferIndex++) {
             vk::CommandBuffer& buffer = m_graphicsCommandBuffers[cmdBufferIndex];
             buffer.begin(beginInfo);
+            m_dynamicResolution.recordBegin(buffer, cmdBufferIndex);
+            m_pipelineStatistics.recordBegin(buffer, cmdBufferIndex);
 
             FramebufferData& framebufferData = m_framebufferData[cmdBufferIndex];
-            renderPassInfo.framebuffer = framebufferData.framebuffer;
 
             // Render
-            buffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-            buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *m_simpleTrianglePipeline);
+            if (m_basicRenderPass) {
+                renderPassInfo.framebuffer = framebufferData.framebuffer;
+                buffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+            } else {
+                preRenderBarrier.image = framebufferData.colourAttachment0Image;
+                preRenderDepthBarrier.image = framebufferData.depthImage;
+                std::array<vk::ImageMemoryBarrier, 2> preRenderBarriers{preRenderBarrier, preRenderDepthBarrier};
+                buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eLateFragmentTests,
+                                       vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
+                                       vk::DependencyFlags(),
+                                       0,
+                                       nullptr,
+                                       0,
+                                       nullptr,
+                                       static_cast<uint32_t>(preRenderBarriers.size()),
+                                       preRenderBarriers.data());
+                colourAttachmentInfo.imageView = framebufferData.colourAttachment0ImageView;
+                depthAttachmentInfo.imageView = framebufferData.depthImageView;
+                dynamicRendering.begin(buffer, renderingInfo);
+            }
+            // Dynamic in every pipeline drawn with, so set once for all of them
             buffer.setViewport(0, 1, &viewport);
-            buffer.bindVertexBuffers(0, 1, &m_vertexBuffer, &vertexBufferOffset);
-            buffer.draw(3, 1, 0, 0);
-            buffer.endRenderPass();
+            buffer.setScissor(0, 1, &renderArea);
+            m_geometryPool->bind(buffer, m_meshGeometry.page);
+            if (m_depthPrepass) {
+                // Depth testing is in primitive order within the pass, so the mesh draws below see every depth written here
+                buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *m_depthPrepassPipeline);
+                for (const MeshDraw& draw : m_meshDraws) {
+                    buffer.pushConstants(
+                        m_meshPipelineLayout->getHandle(), vk::ShaderStageFlagBits::eVertex, 0, sizeof(MeshConstants), &draw.constants);
+                    m_geometryPool->draw(buffer, draw.range);
+                }
+            }
+            buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_meshPipelines[m_meshView].get());
+            for (const MeshDraw& draw : m_meshDraws) {
+                buffer.pushConstants(
+                    m_meshPipelineLayout->getHandle(), vk::ShaderStageFlagBits::eVertex, 0, sizeof(MeshConstants), &draw.constants);
+                m_geometryPool->draw(buffer, draw.range);
+            }
+            if (m_basicRenderPass) {
+                buffer.endRenderPass();
+            } else {
+                dynamicRendering.end(buffer);
+                // The upscaler's own barrier takes it straight to shader reads
+                if (!spatial) {
+                    postRenderBarrier.image = framebufferData.colourAttachment0Image;
+                    buffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                                           vk::PipelineStageFlagBits::eTransfer,
+                                           vk::DependencyFlags(),
+                                           0,
+                                           nullptr,
+                                           0,
+                                           nullptr,
+                                           1,
+                                           &postRenderBarrier);
+                }
+            }
+            m_pipelineStatistics.recordEnd(buffer, cmdBufferIndex);
+
+            // The image that is blitted to the swapchain and captured
+            vk::Image outputImage = framebufferData.colourAttachment0Image;
+            if (spatial) {
+                preUpscaleBarrier.image = framebufferData.colourAttachment0Image;
+                buffer.pipelineBarrier(preUpscaleSourceStages,
+                                       vk::PipelineStageFlagBits::eComputeShader,
+                                       vk::DependencyFlags(),
+                                       0,
+                                       nullptr,
+                                       0,
+                                       nullptr,
+                                       1,
+                                       &preUpscaleBarrier);
+                m_upscaler.recordUpscale(buffer, cmdBufferIndex, renderExtent);
+                outputImage = m_upscaler.getOutput(cmdBufferIndex);
+            }
 
             // Get the swapchain image ready for the transfer
             preTransferSwapchainBarrier.image = swapchainImages[cmdBufferIndex];
@@ -437,13 +992,18 @@ namespace RT1 {
                                    &preTransferSwapchainBarrier);
 
             // Transfer
-            buffer.blitImage(framebufferData.colourAttachment0Image,
+            buffer.blitImage(outputImage,
                              vk::ImageLayout::eTransferSrcOptimal,
                              swapchainImages[cmdBufferIndex],
                              vk::ImageLayout::eTransferDstOptimal,
                              1,
                              &blitToSwapchain,
-                             vk::Filter::eNearest);
+                             blitFilter);
+
+            // The capture copy also reads the blitted image, so needs no barrier of its own
+            if (m_frameCapture->isEnabled()) {
+                m_frameCapture->recordCopy(buffer, cmdBufferIndex, outputImage);
+            }
 
             // Get the swapchain image ready for presentation
             postTransferSwapchainBarrier.image = swapchainImages[cmdBufferIndex];
@@ -457,6 +1017,7 @@ namespace RT1 {
                                    1,
                                    &postTransferSwapchainBarrier);
 
+            m_dynamicResolution.recordEnd(buffer, cmdBufferIndex);
             buffer.end();
         }
     }
@@ -467,12 +1028,167 @@ namespace RT1 {
     }
 
     void RT1App::regenerateSwapchainResources(vk::Extent2D viewport) {
+        // Nothing in flight may still use the old framebuffers
+        m_device.waitIdle();
+
+        // The pipelines' viewport and scissor are dynamic, so they are kept at any size
         destroySwapchainResources();
         m_renderer.recreateSwapChain(viewport);
         createSwapchainResources(viewport.width, viewport.height);
     }
 
+    bool RT1App::capturesRenderedImage() const { return m_frameCapture->isEnabled() && m_upscaleMode == UpscaleMode::Blit; }
+
+    vk::Extent2D RT1App::getRenderExtent(vk::Extent2D outputExtent) const {
+        return capturesRenderedImage() ? outputExtent : m_dynamicResolution.getRenderExtent(outputExtent);
+    }
+
+    void RT1App::updateDynamicResolution() { m_dynamicResolution.setEnabled(m_dynamicResolutionRequested && !capturesRenderedImage()); }
+
+    void RT1App::applySwapchainSetting(std::optional<vk::PresentModeKHR> presentMode, uint32_t imageCount) {
+        m_renderer.setPresentMode(presentMode);
+        m_renderer.setSwapchainImageCount(imageCount);
+        regenerateSwapchainResources(m_renderer.getSwapchainExtents());
+        m_renderer.getFramePacer().resetStats();
+    }
+
+    void RT1App::initSwapchainSweep() {
+        // Vsync first, then the modes that present sooner
+        const vk::PresentModeKHR sweptModes[] = {
+            vk::PresentModeKHR::eFifo,
+            vk::PresentModeKHR::eFifoRelaxed,
+            vk::PresentModeKHR::eMailbox,
+            vk::PresentModeKHR::eImmediate,
+        };
+        vk::SurfaceCapabilitiesKHR capabilities = m_renderer.getSurfaceCapabilities();
+        for (vk::PresentModeKHR mode : sweptModes) {
+            if (!m_renderer.getSupportedPresentModes().count(mode)) {
+                continue;
+            }
+            for (uint32_t imageCount = 2; imageCount <= 4; imageCount++) {
+                if (imageCount >= capabilities.minImageCount && (capabilities.maxImageCount == 0 || imageCount <= capabilities.maxImageCount)) {
+                    m_swapchainSweep.push_back(SwapchainSweepResult{mode, imageCount});
+                }
+            }
+        }
+
+        std::cout << "Sweeping " << m_swapchainSweep.size() << " swapchain settings, " << m_runtimeParameters.swapchainSweepFrames << " frames each"
+                  << std::endl;
+        applySwapchainSetting(m_swapchainSweep[0].presentMode, m_swapchainSweep[0].requestedImageCount);
+    }
+
+    void RT1App::advanceSwapchainSweep(Core::TimeDelta delta) {
+        // Frames right after a switch run while the new swapchain settles, so are not measured
+        constexpr uint32_t warmupFrames = 30;
+        uint32_t frame = m_swapchainSweepFrame++;
+        if (frame < warmupFrames) {
+            return;
+        }
+        if (frame == warmupFrames) {
+            m_swapchainSweepTime = Core::TimeDelta::zero();
+            m_renderer.getFramePacer().resetStats();
+            return;
+        }
+        m_swapchainSweepTime += delta;
+        if (frame < warmupFrames + m_runtimeParameters.swapchainSweepFrames) {
+            return;
+        }
+
+        SwapchainSweepResult& result = m_swapchainSweep[m_swapchainSweepIndex];
+        Core::FramePacer::Stats latency = m_renderer.getFramePacer().getStats();
+        result.imageCount = m_renderer.getNumSwapchainImages();
+        result.frameTime = m_swapchainSweepTime / m_runtimeParameters.swapchainSweepFrames;
+        result.acquireToPresent = latency.averageAcquireToPresent;
+        result.inputToDisplay = latency.averageInputToDisplay;
+        std::cout << "Swapchain " << vk::to_string(result.presentMode) << ", " << result.imageCount << " images (" << result.requestedImageCount
+                  << " requested): " << result.frameTime.count() * 1000.0 << " ms frame time (" << 1.0 / result.frameTime.count() << " fps)" << std::endl;
+        m_renderer.getFramePacer().printStats(std::cout);
+
+        m_swapchainSweepFrame = 0;
+        if (++m_swapchainSweepIndex < m_swapchainSweep.size()) {
+            applySwapchainSetting(m_swapchainSweep[m_swapchainSweepIndex].presentMode, m_swapchainSweep[m_swapchainSweepIndex].requestedImageCount);
+            return;
+        }
+
+        std::cout << "Swapchain sweep results (present mode, images, images requested, frame time, fps, acquire to present, input to display):" << std::endl;
+        for (const SwapchainSweepResult& swept : m_swapchainSweep) {
+            std::cout << "    " << vk::to_string(swept.presentMode) << ", " << swept.imageCount << ", " << swept.requestedImageCount << ", "
+                      << swept.frameTime.count() * 1000.0 << " ms, "
+                      << 1.0 / swept.frameTime.count() << ", " << swept.acquireToPresent.count() * 1000.0 << " ms, "
+                      << swept.inputToDisplay.count() * 1000.0 << " ms" << std::endl;
+        }
+        m_swapchainSweep.clear();
+        applySwapchainSetting(std::nullopt, 0);
+    }
+
     void RT1App::renderFrame(Core::TimePoint now, Core::TimeDelta delta) {
+        m_allocator.beginFrame(m_frameIndex++);
+
+        // The run loop has waited for the previous frame, so its capture can be read back
+        m_frameCapture->collectCompleted();
+        m_upscaler.collectCompleted();
+        m_pipelineStatistics.collectCompleted();
+
+        // Compiled views replace their fallback between frames, and the command buffers only care about the current one
+        bool currentViewChanged = false;
+        for (uint32_t view = 0; view < MESH_VIEW_COUNT; view++) {
+            if (m_meshPipelines[view].update() && view == m_meshView) {
+                currentViewChanged = true;
+            }
+        }
+        // The previous frame's GPU time chooses the scale of this one
+        bool rescaled = m_dynamicResolution.collectCompleted();
+        // Only once the last frame's timestamps are read, as they were taken at the scale it was recorded with
+        if (m_dynamicResolutionToggleRequested) {
+            m_dynamicResolutionToggleRequested = false;
+            m_dynamicResolutionRequested = !m_dynamicResolutionRequested;
+            updateDynamicResolution();
+            m_recordRequested = true;
+            m_dynamicResolution.printStats(std::cout);
+        }
+
+        // With the last frame's readback collected, capture can start or stop without a slot being read while it is written
+        if (m_captureToggleRequested) {
+            m_captureToggleRequested = false;
+            m_frameCapture->setEnabled(!m_frameCapture->isEnabled());
+            updateDynamicResolution();
+            m_recordRequested = true;
+            if (m_frameCapture->isEnabled()) {
+                std::cout << "Frame capture started" << std::endl;
+            } else {
+                m_frameCapture->printStats(std::cout);
+            }
+        }
+
+        // With the last frame's counts read, those for the previous setting are printed for comparison
+        if (m_depthPrepassToggleRequested) {
+            m_depthPrepassToggleRequested = false;
+            m_pipelineStatistics.printStats(std::cout);
+            m_pipelineStatistics.resetStats();
+            // The prepass is recorded into the command buffers, with the pipeline createPipeline() already made
+            m_depthPrepass = !m_depthPrepass;
+            m_recordRequested = true;
+            std::cout << "Depth prepass: " << (m_depthPrepass ? "on" : "off") << std::endl;
+        }
+
+        // The last frame has completed, so its framebuffers can be recreated without waiting for the device
+        if (m_upscaleModeToggleRequested) {
+            m_upscaleModeToggleRequested = false;
+            // Captures take the upscaler's output format, and the upscaler needs its images, so the framebuffers are recreated
+            m_upscaleMode = m_upscaleMode == UpscaleMode::Blit ? UpscaleMode::Spatial : UpscaleMode::Blit;
+            updateDynamicResolution();
+            destroySwapchainResources();
+            vk::Extent2D extent = m_renderer.getSwapchainExtents();
+            createSwapchainResources(static_cast<int>(extent.width), static_cast<int>(extent.height));
+            std::cout << "Upscaling: " << to_string(m_upscaleMode) << std::endl;
+        }
+
+        if (currentViewChanged || rescaled || m_recordRequested) {
+            m_recordRequested = false;
+            vk::Extent2D extent = m_renderer.getSwapchainExtents();
+            createCommandBuffers(static_cast<int>(extent.width), static_cast<int>(extent.height));
+        }
+
         uint32_t imageIndex = m_renderer.getNextSwapchainImage(m_swapchainImageSemaphore);
 
         // The main draw pass (including the image transfer)
@@ -487,6 +1203,15 @@ namespace RT1 {
             &m_copyCompletedSemaphore,
         };
         m_graphicsQueue.queues[0].submit(1, &drawPassSubmitInfo, m_renderer.getFrameEndFence());
+        if (m_frameCapture->isEnabled()) {
+            m_frameCapture->frameSubmitted(imageIndex);
+        }
+        m_dynamicResolution.frameSubmitted(imageIndex);
+        vk::Extent2D renderExtent = getRenderExtent(m_renderer.getSwapchainExtents());
+        m_pipelineStatistics.frameSubmitted(imageIndex, static_cast<uint64_t>(renderExtent.width) * renderExtent.height);
+        if (m_upscaleMode == UpscaleMode::Spatial) {
+            m_upscaler.frameSubmitted(imageIndex);
+        }
 
         // Present
         vk::SwapchainKHR swapchain = m_renderer.getSwapchain();
@@ -498,8 +1223,106 @@ namespace RT1 {
             &imageIndex,
             nullptr,
         };
-        m_graphicsQueue.queues[0].presentKHR(presentInfo); // TODO We assume graphics can present
+        m_renderer.getFramePacer().present(m_graphicsQueue.queues[0], presentInfo); // TODO We assume graphics can present
+
+        if (!m_swapchainSweep.empty()) {
+            advanceSwapchainSweep(delta);
+        }
+
+        if (m_runtimeParameters.frameTimeReportInterval > 0) {
+            m_reportedFrameTime += delta;
+            if (++m_reportedFrameCount == m_runtimeParameters.frameTimeReportInterval) {
+                double averageMilliseconds = m_reportedFrameTime.count() * 1000.0 / m_reportedFrameCount;
+                std::cout << "Frame time (" << Core::to_string(m_vertexFormat) << " vertices): ";
+                std::cout << averageMilliseconds << " ms average over " << m_reportedFrameCount << " frames" << std::endl;
+                m_renderer.getFramePacer().printStats(std::cout);
+                if (m_frameCapture->isEnabled()) {
+                    m_frameCapture->printStats(std::cout);
+                }
+                m_dynamicResolution.printStats(std::cout);
+                m_dynamicResolution.resetStats();
+                if (m_upscaleMode == UpscaleMode::Spatial) {
+                    m_upscaler.printStats(std::cout);
+                    m_upscaler.resetStats();
+                }
+                m_pipelineStatistics.printStats(std::cout);
+                m_pipelineStatistics.resetStats();
+                if (m_swapchainSweep.empty()) {
+                    // A sweep measures latency over each of its settings instead
+                    m_renderer.getFramePacer().resetStats();
+                }
+                m_reportedFrameTime = Core::TimeDelta::zero();
+                m_reportedFrameCount = 0;
+            }
+        }
     }
 
     void RT1App::simulateFrame(Core::TimePoint now, Core::TimeDelta delta) {}
+
+    void RT1App::idleFrame(Core::TimePoint now, Core::TimeDelta delta) {
+        // The last submitted frame may still be running, and it references the buffers we would move.
+        // The frame fence may already have been waited for and reset by the run loop, so the queue is waited on instead.
+        m_graphicsQueue.queues[0].waitIdle();
+
+        // Small steps keep the return to rendering quick, but must fit a whole page, which is moved as one allocation
+        constexpr vk::DeviceSize maxBytesPerIdleFrame = 64 * 1024 * 1024;
+        constexpr uint32_t maxAllocationsPerIdleFrame = 16;
+        m_allocator.defragment(maxBytesPerIdleFrame, maxAllocationsPerIdleFrame);
+    }
+
+    bool RT1App::keyPressed(int key, int mods) {
+        if (key == GLFW_KEY_F2) {
+            m_allocator.printSummary(std::cout);
+            m_geometryPool->printStats(std::cout);
+            m_allocator.writeStatsJson("RT1_memory.json", true);
+            std::cout << "Wrote allocator statistics to RT1_memory.json" << std::endl;
+            return true;
+        }
+        if (key == GLFW_KEY_F3) {
+            // Command buffers are recorded up front, so they are recorded again with the next view's pipeline
+            m_meshView = (m_meshView + 1) % MESH_VIEW_COUNT;
+            m_recordRequested = true;
+            std::cout << "Mesh view: " << MESH_VIEW_NAMES[m_meshView] << (m_meshPipelines[m_meshView].isReady() ? "" : " (still compiling)") << std::endl;
+            return true;
+        }
+        if (key == GLFW_KEY_F6) {
+            // The copies are recorded into the command buffers, so capture is toggled by renderFrame() along with recording them again
+            m_captureToggleRequested = !m_captureToggleRequested;
+            return true;
+        }
+        if (key == GLFW_KEY_F7) {
+            // The command buffers are recorded at the scale, so renderFrame() toggles it along with recording them again
+            m_dynamicResolutionToggleRequested = !m_dynamicResolutionToggleRequested;
+            return true;
+        }
+        if (key == GLFW_KEY_F8) {
+            // The framebuffers are recreated for the new mode, so renderFrame() switches it once the last frame has completed
+            m_upscaleModeToggleRequested = !m_upscaleModeToggleRequested;
+            return true;
+        }
+        if (key == GLFW_KEY_F9) {
+            // Counts from here on are for the new setting, so renderFrame() toggles it once the last frame's are read
+            m_depthPrepassToggleRequested = !m_depthPrepassToggleRequested;
+            return true;
+        }
+        if (key == GLFW_KEY_F4) {
+            // The next supported present mode, in the order Vulkan numbers them
+            const std::set<vk::PresentModeKHR>& presentModes = m_renderer.getSupportedPresentModes();
+            auto next = presentModes.upper_bound(m_renderer.getPresentMode());
+            applySwapchainSetting(next != presentModes.end() ? *next : *presentModes.begin(), static_cast<uint32_t>(m_renderer.getNumSwapchainImages()));
+            return true;
+        }
+        if (key == GLFW_KEY_F5) {
+            // Up to two more images than the surface needs, then back to the fewest
+            vk::SurfaceCapabilitiesKHR capabilities = m_renderer.getSurfaceCapabilities();
+            uint32_t maxImageCount = capabilities.minImageCount + 2;
+            if (capabilities.maxImageCount > 0) {
+                maxImageCount = std::min(maxImageCount, capabilities.maxImageCount);
+            }
+            uint32_t imageCount = static_cast<uint32_t>(m_renderer.getNumSwapchainImages()) + 1;
+            applySwapchainSetting(m_renderer.getPresentMode(), imageCount > maxImageCount ? capabilities.minImageCount : imageCount);
+            return true;
+        }
+        return false;
+    }
 }
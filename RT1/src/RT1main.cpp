@@ -8,6 +8,7 @@
 #include <vulkan/vulkan.hpp>
 
 #include <iostream>
+#include <string>
 #include <vector>
 
 const char* DESIRED_INSTANCE_EXTENSIONS[] = {
@@ -24,8 +25,107 @@ const char* DESIRED_DEVICE_EXTENSIONS[] = {
     VK_NV_RAY_TRACING_EXTENSION_NAME,
 };
 
+/**
+ * Read the mesh options from the command line:
+ *  --compressed-vertices    Use the 16 byte compressed vertex format
+ *  --mesh-detail N          Draw a screen covering grid of N x N quads instead of the triangle
+ *  --report-frame-time N    Print the average frame time every N frames
+ *  --scene FILE             Draw a packed binary scene file
+ *  --frame-pacing PROFILE   Pace frames for balanced, latency or throughput
+ *  --sweep-swapchain N      Measure N frames with each supported present mode and 2, 3 and 4 swapchain images
+ *  --capture PREFIX         Write every frame to files named PREFIX followed by the frame number
+ *  --capture-format FORMAT  Write captured frames as png or exr
+ *  --stream PATH            Stream every frame into a file or named pipe, waiting for it rather than dropping frames
+ *  --stream-format FORMAT   Stream y4m (the default) or raw rgba frames
+ *  --stream-fps N           The frame rate recorded in a Y4M stream
+ *  --dynamic-resolution MS  Scale the render resolution to keep the GPU time of a frame within MS milliseconds
+ *  --min-render-scale S     The smallest scale of the output's width and height dynamic resolution renders at
+ *  --max-render-scale S     The largest scale, above one to render more pixels than are shown when there is time
+ *  --render-scale S         The scale of the output's width and height to render at without dynamic resolution
+ *  --upscaler MODE          Scale the rendered image to the window with a blit (the default) or the spatial upscaler
+ *  --sharpness S            How strongly the spatial upscaler sharpens, from 0 to 1
+ *  --depth-prepass          Draw every mesh's depth before shading, so each pixel is shaded once
+ */
+void parseArguments(int argc, char** argv, RT1::RT1App::Parameters& parameters) {
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--compressed-vertices") {
+            parameters.vertexFormat = Core::VertexFormat::Compressed;
+        } else if (argument == "--mesh-detail" && i + 1 < argc) {
+            parameters.meshDetail = std::stoul(argv[++i]);
+        } else if (argument == "--report-frame-time" && i + 1 < argc) {
+            parameters.frameTimeReportInterval = std::stoul(argv[++i]);
+        } else if (argument == "--scene" && i + 1 < argc) {
+            parameters.scenePath = argv[++i];
+        } else if (argument == "--frame-pacing" && i + 1 < argc) {
+            std::string profile = argv[++i];
+            if (profile == "balanced") {
+                parameters.framePacing = Core::FramePacingProfile::Balanced;
+            } else if (profile == "latency") {
+                parameters.framePacing = Core::FramePacingProfile::LowLatency;
+            } else if (profile == "throughput") {
+                parameters.framePacing = Core::FramePacingProfile::Throughput;
+            } else {
+                throw std::runtime_error("Unknown frame pacing profile: " + profile);
+            }
+        } else if (argument == "--sweep-swapchain" && i + 1 < argc) {
+            parameters.swapchainSweepFrames = std::stoul(argv[++i]);
+        } else if (argument == "--capture" && i + 1 < argc) {
+            parameters.capturePath = argv[++i];
+        } else if (argument == "--capture-format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "png") {
+                parameters.captureFormat = Core::ImageFileFormat::Png;
+            } else if (format == "exr") {
+                parameters.captureFormat = Core::ImageFileFormat::Exr;
+            } else {
+                throw std::runtime_error("Unknown capture format: " + format);
+            }
+        } else if (argument == "--stream" && i + 1 < argc) {
+            parameters.streamPath = argv[++i];
+        } else if (argument == "--stream-format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "y4m") {
+                parameters.streamFormat = Core::VideoStreamFormat::Y4m;
+            } else if (format == "rgba") {
+                parameters.streamFormat = Core::VideoStreamFormat::RawRgba;
+            } else {
+                throw std::runtime_error("Unknown stream format: " + format);
+            }
+        } else if (argument == "--stream-fps" && i + 1 < argc) {
+            parameters.streamFrameRate = std::stoul(argv[++i]);
+        } else if (argument == "--dynamic-resolution" && i + 1 < argc) {
+            parameters.dynamicResolutionBudget = std::stof(argv[++i]);
+        } else if (argument == "--min-render-scale" && i + 1 < argc) {
+            parameters.minRenderScale = std::stof(argv[++i]);
+        } else if (argument == "--max-render-scale" && i + 1 < argc) {
+            parameters.maxRenderScale = std::stof(argv[++i]);
+        } else if (argument == "--render-scale" && i + 1 < argc) {
+            parameters.renderScale = std::stof(argv[++i]);
+        } else if (argument == "--upscaler" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "blit") {
+                parameters.upscaleMode = RT1::UpscaleMode::Blit;
+            } else if (mode == "spatial") {
+                parameters.upscaleMode = RT1::UpscaleMode::Spatial;
+            } else {
+                throw std::runtime_error("Unknown upscaler: " + mode);
+            }
+        } else if (argument == "--sharpness" && i + 1 < argc) {
+            parameters.sharpness = std::stof(argv[++i]);
+        } else if (argument == "--depth-prepass") {
+            parameters.depthPrepass = true;
+        } else {
+            throw std::runtime_error("Unknown argument: " + argument);
+        }
+    }
+    if (!parameters.capturePath.empty() && !parameters.streamPath.empty()) {
+        throw std::runtime_error("Frames can be captured to files or streamed, not both");
+    }
+}
+
 int
-main() {
+main(int argc, char** argv) {
     if (!glfwInit()) {
         throw std::runtime_error("Failed to initialize glfw!");
     }
@@ -40,10 +140,10 @@ main() {
     // No features required
     vk::PhysicalDeviceFeatures features{};
 
-    Core::V1AppBase::Parameters parameters{
-        .width = 1920,
-        .height = 1080,
-    };
+    RT1::RT1App::Parameters parameters;
+    parameters.width = 1920;
+    parameters.height = 1080;
+    parseArguments(argc, argv, parameters);
 
     Core::WindowedRenderer<Core::V1WindowBase, RT1::RT1App> renderer(glfwExtensionCount,
                                                                glfwExtensions,
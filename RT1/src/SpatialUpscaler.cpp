@@ -0,0 +1,383 @@
+#include "RT1/SpatialUpscaler.hpp"
+
+#include <Core/ShaderLibrary.hpp>
+
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+    /// Must match the workgroup size of upscale.comp and sharpen.comp
+    constexpr uint32_t WORKGROUP_SIZE = 8;
+
+    constexpr uint32_t TIMESTAMPS_PER_SLOT = 3;
+
+    constexpr vk::Format UPSCALED_FORMAT = vk::Format::eR16G16B16A16Sfloat;
+    /// Storage images of these formats are supported everywhere, unlike the BGRA formats swapchains tend to use
+    constexpr vk::Format OUTPUT_FORMAT = vk::Format::eR8G8B8A8Unorm;
+
+    /// Must match the push constants of upscale.comp and sharpen.comp
+    struct PushConstants {
+        int32_t renderWidth;
+        int32_t renderHeight;
+        int32_t outputWidth;
+        int32_t outputHeight;
+        float sharpness;
+    };
+
+    constexpr vk::ImageSubresourceRange COLOUR_RANGE{
+        vk::ImageAspectFlagBits::eColor,
+        0,
+        1,
+        0,
+        1,
+    };
+}
+
+namespace RT1 {
+
+    SpatialUpscaler::SpatialUpscaler(Core::Renderer& renderer, Core::MemoryAllocator& allocator)
+        : m_device(renderer.getDevice())
+        , m_allocator(allocator) {
+        vk::DescriptorSetLayoutBinding bindings[] = {
+            {0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute, nullptr},
+            {1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute, nullptr},
+            {2, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute, nullptr},
+        };
+        m_descriptorSetLayout = std::make_unique<Core::DescriptorSetLayout>(m_device, static_cast<uint32_t>(std::size(bindings)), bindings);
+
+        // Both passes share the layout, and each reads the parts of it it needs
+        vk::PushConstantRange pushConstantRange{
+            vk::ShaderStageFlagBits::eCompute,
+            0,
+            sizeof(PushConstants),
+        };
+        m_pipelineLayout = std::make_unique<Core::PipelineLayout>(m_device, 1, &m_descriptorSetLayout->getHandle(), 1, &pushConstantRange);
+
+        m_upscaleShader = renderer.getShaderLibrary().load("Resources/Shaders/upscale.comp.spv", vk::ShaderStageFlagBits::eCompute);
+        m_sharpenShader = renderer.getShaderLibrary().load("Resources/Shaders/sharpen.comp.spv", vk::ShaderStageFlagBits::eCompute);
+        vk::ComputePipelineCreateInfo upscaleInfo{
+            vk::PipelineCreateFlags(),
+            m_upscaleShader->getPipelineStageCreateInfo(),
+            m_pipelineLayout->getHandle(),
+        };
+        m_upscalePipeline = m_device.createComputePipelines(vk::PipelineCache(), upscaleInfo)[0];
+        vk::ComputePipelineCreateInfo sharpenInfo{
+            vk::PipelineCreateFlags(),
+            m_sharpenShader->getPipelineStageCreateInfo(),
+            m_pipelineLayout->getHandle(),
+        };
+        m_sharpenPipeline = m_device.createComputePipelines(vk::PipelineCache(), sharpenInfo)[0];
+
+        vk::SamplerCreateInfo samplerInfo{
+            vk::SamplerCreateFlags(),
+            vk::Filter::eNearest,
+            vk::Filter::eNearest,
+            vk::SamplerMipmapMode::eNearest,
+            vk::SamplerAddressMode::eClampToEdge,
+            vk::SamplerAddressMode::eClampToEdge,
+            vk::SamplerAddressMode::eClampToEdge,
+        };
+        m_sampler = m_device.createSampler(samplerInfo);
+
+        // Queues without valid timestamp bits cannot be timed, and the stats say so instead
+        uint32_t family = renderer.getQueue(Core::QueueType::Graphics).familyIndex;
+        m_timestampsSupported = renderer.getPhysicalDevice().getQueueFamilyProperties()[family].timestampValidBits > 0;
+        m_timestampPeriod = renderer.getPhysicalDevice().getProperties().limits.timestampPeriod;
+    }
+
+    SpatialUpscaler::~SpatialUpscaler() {
+        destroySlots();
+        m_device.destroySampler(m_sampler);
+        m_device.destroyPipeline(m_sharpenPipeline);
+        m_device.destroyPipeline(m_upscalePipeline);
+    }
+
+    void SpatialUpscaler::resize(vk::Extent2D outputExtent, std::span<const vk::ImageView> renderedViews) {
+        destroySlots();
+        m_outputExtent = outputExtent;
+        if (renderedViews.empty()) {
+            return;
+        }
+        uint32_t slotCount = static_cast<uint32_t>(renderedViews.size());
+
+        vk::DescriptorPoolSize poolSizes[] = {
+            {vk::DescriptorType::eCombinedImageSampler, slotCount},
+            {vk::DescriptorType::eStorageImage, 2 * slotCount},
+        };
+        vk::DescriptorPoolCreateInfo poolInfo{
+            vk::DescriptorPoolCreateFlags(),
+            slotCount,
+            static_cast<uint32_t>(std::size(poolSizes)),
+            poolSizes,
+        };
+        m_descriptorPool = m_device.createDescriptorPool(poolInfo);
+
+        vk::QueryPoolCreateInfo queryInfo{
+            vk::QueryPoolCreateFlags(),
+            vk::QueryType::eTimestamp,
+            slotCount * TIMESTAMPS_PER_SLOT,
+            vk::QueryPipelineStatisticFlags(),
+        };
+        m_queryPool = m_device.createQueryPool(queryInfo);
+
+        m_slots.resize(slotCount);
+        for (uint32_t i = 0; i < slotCount; i++) {
+            Slot& slot = m_slots[i];
+            slot.upscaled = createImage(UPSCALED_FORMAT, vk::ImageUsageFlagBits::eStorage);
+            slot.output = createImage(OUTPUT_FORMAT, vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc);
+
+            vk::DescriptorSetAllocateInfo setInfo{
+                m_descriptorPool,
+                1,
+                &m_descriptorSetLayout->getHandle(),
+            };
+            slot.descriptorSet = m_device.allocateDescriptorSets(setInfo)[0];
+
+            vk::DescriptorImageInfo imageInfos[] = {
+                {m_sampler, renderedViews[i], vk::ImageLayout::eShaderReadOnlyOptimal},
+                {vk::Sampler(), slot.upscaled.view, vk::ImageLayout::eGeneral},
+                {vk::Sampler(), slot.output.view, vk::ImageLayout::eGeneral},
+            };
+            vk::WriteDescriptorSet writes[std::size(imageInfos)];
+            for (uint32_t binding = 0; binding < std::size(imageInfos); binding++) {
+                writes[binding] = vk::WriteDescriptorSet{
+                    slot.descriptorSet,
+                    binding,
+                    0,
+                    1,
+                    binding == 0 ? vk::DescriptorType::eCombinedImageSampler : vk::DescriptorType::eStorageImage,
+                    &imageInfos[binding],
+                    nullptr,
+                    nullptr,
+                };
+            }
+            m_device.updateDescriptorSets(static_cast<uint32_t>(std::size(writes)), writes, 0, nullptr);
+        }
+    }
+
+    void SpatialUpscaler::setSettings(const UpscalerSettings& settings) { m_settings = settings; }
+
+    const UpscalerSettings& SpatialUpscaler::getSettings() const { return m_settings; }
+
+    vk::Format SpatialUpscaler::getOutputFormat() const { return OUTPUT_FORMAT; }
+
+    void SpatialUpscaler::recordUpscale(vk::CommandBuffer& buffer, std::size_t slot, vk::Extent2D renderExtent) const {
+        const Slot& images = m_slots[slot];
+        uint32_t firstQuery = static_cast<uint32_t>(slot * TIMESTAMPS_PER_SLOT);
+        buffer.resetQueryPool(m_queryPool, firstQuery, TIMESTAMPS_PER_SLOT);
+        // Bottom of pipe waits for the commands before, so the rendering is not counted as part of the upscale
+        buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_queryPool, firstQuery);
+
+        // The last frame's contents are not needed, only its reads must be finished
+        vk::ImageMemoryBarrier writeBarriers[] = {
+            {
+                vk::AccessFlags(),
+                vk::AccessFlagBits::eShaderWrite,
+                vk::ImageLayout::eUndefined,
+                vk::ImageLayout::eGeneral,
+                VK_QUEUE_FAMILY_IGNORED,
+                VK_QUEUE_FAMILY_IGNORED,
+                images.upscaled.image,
+                COLOUR_RANGE,
+            },
+            {
+                vk::AccessFlags(),
+                vk::AccessFlagBits::eShaderWrite,
+                vk::ImageLayout::eUndefined,
+                vk::ImageLayout::eGeneral,
+                VK_QUEUE_FAMILY_IGNORED,
+                VK_QUEUE_FAMILY_IGNORED,
+                images.output.image,
+                COLOUR_RANGE,
+            },
+        };
+        buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+                               vk::PipelineStageFlagBits::eComputeShader,
+                               vk::DependencyFlags(),
+                               0,
+                               nullptr,
+                               0,
+                               nullptr,
+                               static_cast<uint32_t>(std::size(writeBarriers)),
+                               writeBarriers);
+
+        PushConstants constants{
+            static_cast<int32_t>(renderExtent.width),
+            static_cast<int32_t>(renderExtent.height),
+            static_cast<int32_t>(m_outputExtent.width),
+            static_cast<int32_t>(m_outputExtent.height),
+            m_settings.sharpness,
+        };
+        uint32_t groupsX = (m_outputExtent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+        uint32_t groupsY = (m_outputExtent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+        buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_pipelineLayout->getHandle(), 0, 1, &images.descriptorSet, 0, nullptr);
+        buffer.pushConstants(m_pipelineLayout->getHandle(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+
+        buffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_upscalePipeline);
+        buffer.dispatch(groupsX, groupsY, 1);
+        buffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, m_queryPool, firstQuery + 1);
+
+        // The sharpen reads the neighbours of each pixel, which other workgroups upscaled
+        vk::ImageMemoryBarrier upscaledBarrier{
+            vk::AccessFlagBits::eShaderWrite,
+            vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eGeneral,
+            vk::ImageLayout::eGeneral,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            images.upscaled.image,
+            COLOUR_RANGE,
+        };
+        buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                               vk::PipelineStageFlagBits::eComputeShader,
+                               vk::DependencyFlags(),
+                               0,
+                               nullptr,
+                               0,
+                               nullptr,
+                               1,
+                               &upscaledBarrier);
+
+        buffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_sharpenPipeline);
+        buffer.dispatch(groupsX, groupsY, 1);
+        buffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, m_queryPool, firstQuery + 2);
+
+        vk::ImageMemoryBarrier outputBarrier{
+            vk::AccessFlagBits::eShaderWrite,
+            vk::AccessFlagBits::eTransferRead,
+            vk::ImageLayout::eGeneral,
+            vk::ImageLayout::eTransferSrcOptimal,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            images.output.image,
+            COLOUR_RANGE,
+        };
+        buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                               vk::PipelineStageFlagBits::eTransfer,
+                               vk::DependencyFlags(),
+                               0,
+                               nullptr,
+                               0,
+                               nullptr,
+                               1,
+                               &outputBarrier);
+    }
+
+    vk::Image SpatialUpscaler::getOutput(std::size_t slot) const { return m_slots[slot].output.image; }
+
+    void SpatialUpscaler::frameSubmitted(std::size_t slot) { m_slots[slot].submitted = true; }
+
+    void SpatialUpscaler::collectCompleted() {
+        for (std::size_t i = 0; i < m_slots.size(); i++) {
+            Slot& slot = m_slots[i];
+            if (!slot.submitted) {
+                continue;
+            }
+            slot.submitted = false;
+            m_upscales++;
+            if (!m_timestampsSupported) {
+                continue;
+            }
+
+            uint64_t timestamps[TIMESTAMPS_PER_SLOT];
+            vk::Result result = m_device.getQueryPoolResults(m_queryPool,
+                                                             static_cast<uint32_t>(i * TIMESTAMPS_PER_SLOT),
+                                                             TIMESTAMPS_PER_SLOT,
+                                                             sizeof(timestamps),
+                                                             timestamps,
+                                                             sizeof(uint64_t),
+                                                             vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+            if (result != vk::Result::eSuccess) {
+                throw std::runtime_error("Failed to read the spatial upscaler's timestamps: " + vk::to_string(result));
+            }
+            m_lastUpscaleTime = Core::TimeDelta((timestamps[1] - timestamps[0]) * m_timestampPeriod * 1e-9);
+            m_lastSharpenTime = Core::TimeDelta((timestamps[2] - timestamps[1]) * m_timestampPeriod * 1e-9);
+            m_upscaleTimeSum += m_lastUpscaleTime;
+            m_sharpenTimeSum += m_lastSharpenTime;
+        }
+    }
+
+    SpatialUpscaler::Stats SpatialUpscaler::getStats() const {
+        Stats stats{};
+        stats.upscales = m_upscales;
+        stats.lastUpscaleTime = m_lastUpscaleTime;
+        stats.lastSharpenTime = m_lastSharpenTime;
+        if (m_upscales > 0) {
+            stats.averageUpscaleTime = m_upscaleTimeSum / static_cast<double>(m_upscales);
+            stats.averageSharpenTime = m_sharpenTimeSum / static_cast<double>(m_upscales);
+        }
+        return stats;
+    }
+
+    void SpatialUpscaler::resetStats() {
+        m_upscales = 0;
+        m_upscaleTimeSum = Core::TimeDelta::zero();
+        m_sharpenTimeSum = Core::TimeDelta::zero();
+    }
+
+    void SpatialUpscaler::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        out << "Spatial upscaler: " << m_outputExtent.width << "x" << m_outputExtent.height << " output, sharpness " << m_settings.sharpness << ", ";
+        if (!m_timestampsSupported) {
+            out << stats.upscales << " upscales, the queue does not support timestamps" << std::endl;
+            return;
+        }
+        out << stats.averageUpscaleTime.count() * 1000.0 << " ms average upscale and " << stats.averageSharpenTime.count() * 1000.0
+            << " ms average sharpen over " << stats.upscales << " upscales" << std::endl;
+    }
+
+    SpatialUpscaler::Image SpatialUpscaler::createImage(vk::Format format, vk::ImageUsageFlags usage) {
+        vk::ImageCreateInfo imageInfo{
+            vk::ImageCreateFlags(),
+            vk::ImageType::e2D,
+            format,
+            vk::Extent3D(m_outputExtent.width, m_outputExtent.height, 1),
+            1,
+            1,
+            vk::SampleCountFlagBits::e1,
+            vk::ImageTiling::eOptimal,
+            usage,
+            vk::SharingMode::eExclusive,
+            0,
+            nullptr,
+            vk::ImageLayout::eUndefined,
+        };
+        vma::AllocationCreateInfo allocationInfo{};
+        allocationInfo.usage = vma::MemoryUsage::eGpuOnly;
+
+        Image image;
+        std::tie(image.image, image.allocation) = m_allocator.createImage(imageInfo, allocationInfo, Core::AllocationCategory::Framebuffer);
+        vk::ImageViewCreateInfo viewInfo{
+            vk::ImageViewCreateFlags(),
+            image.image,
+            vk::ImageViewType::e2D,
+            format,
+            vk::ComponentMapping(),
+            COLOUR_RANGE,
+        };
+        image.view = m_device.createImageView(viewInfo);
+        return image;
+    }
+
+    void SpatialUpscaler::destroyImage(Image& image) {
+        m_device.destroyImageView(image.view);
+        m_allocator.destroyImage(image.image, image.allocation);
+    }
+
+    void SpatialUpscaler::destroySlots() {
+        for (Slot& slot : m_slots) {
+            destroyImage(slot.upscaled);
+            destroyImage(slot.output);
+        }
+        m_slots.clear();
+        if (m_descriptorPool) {
+            // Destroying the pool frees the slots' sets
+            m_device.destroyDescriptorPool(m_descriptorPool);
+            m_descriptorPool = vk::DescriptorPool();
+        }
+        if (m_queryPool) {
+            m_device.destroyQueryPool(m_queryPool);
+            m_queryPool = vk::QueryPool();
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Core/DescriptorSetLayout.hpp>
+#include <Core/Denoiser.hpp>
+#include <Core/MemoryAllocator.hpp>
+#include <Core/PipelineLayout.hpp>
+#include <Core/RenderTypes.hpp>
+#include <Core/Renderer.hpp>
+#include <Core/Shader.hpp>
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
+
+namespace RT2 {
+
+    /**
+     * The compute shader version of Core::Denoiser (denoise.comp), which filters the same inputs with the same math,
+     * so the two images can be compared and the CPU and GPU costs traded against each other.
+     *
+     * Each denoise is recorded into the frame's command buffer as its own stage: the inputs are copied from a host
+     * visible staging buffer to device local memory, then each iteration is a dispatch, and the last also tone maps
+     * into an 8 bit output buffer that is copied to the swapchain. Timestamps around the copy and the dispatches time
+     * the two parts separately on the GPU.
+     */
+    class GpuDenoiser {
+    public:
+        GpuDenoiser(Core::Renderer& renderer, Core::MemoryAllocator& allocator);
+        ~GpuDenoiser();
+
+        /// Disallowed operations
+        GpuDenoiser(const GpuDenoiser&) = delete;
+        GpuDenoiser(GpuDenoiser&&) = delete;
+        GpuDenoiser& operator=(const GpuDenoiser&) = delete;
+        GpuDenoiser& operator=(GpuDenoiser&&) = delete;
+
+        /// -- Members for configuration --
+
+        /// Recreate the buffers for an image size. Nothing recorded with the old buffers may still be in use.
+        void resize(uint32_t width, uint32_t height);
+        void setSettings(const Core::DenoiserSettings& settings);
+        [[nodiscard]] const Core::DenoiserSettings& getSettings() const;
+
+        /// -- End members for configuration --
+
+        /**
+         * Stage the inputs of the next recorded denoise. The last denoise recorded must have completed.
+         * @param inputs: Core::Denoiser::PlaneCount planes of the image size, laid out as Core::Denoiser::getInputs()
+         */
+        void upload(std::span<const float> inputs);
+
+        /**
+         * Record a denoise of the uploaded inputs. The output is ready for transfer reads once the commands complete.
+         * @param buffer: The command buffer to record into
+         * @param bgra: Write blue first, for BGRA formats
+         * @param exposure: Multiplies radiance before tone mapping
+         */
+        void recordDenoise(vk::CommandBuffer& buffer, bool bgra, float exposure);
+
+        /// The tone mapped pixels of the last recorded denoise, 4 bytes each with rows tightly packed
+        [[nodiscard]] vk::Buffer getOutput() const;
+
+        /// Read the timestamps of the last recorded denoise, once the commands have completed
+        void collectTimings();
+
+        struct Stats {
+            uint64_t denoises;
+            Core::TimeDelta lastUploadTime; // GPU time copying the inputs to device local memory
+            Core::TimeDelta lastFilterTime; // GPU time of every iteration's dispatch
+            Core::TimeDelta averageUploadTime;
+            Core::TimeDelta averageFilterTime;
+        };
+
+        [[nodiscard]] Stats getStats() const;
+        void resetStats();
+        void printStats(std::ostream& out) const;
+
+    private:
+        vk::Device m_device;
+        Core::MemoryAllocator& m_allocator;
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+        Core::DenoiserSettings m_settings;
+
+        std::shared_ptr<Core::Shader> m_shader;
+        std::unique_ptr<Core::DescriptorSetLayout> m_descriptorSetLayout;
+        std::unique_ptr<Core::PipelineLayout> m_pipelineLayout;
+        vk::Pipeline m_pipeline;
+        vk::DescriptorPool m_descriptorPool;
+        vk::DescriptorSet m_descriptorSet;
+
+        struct Buffer {
+            vk::Buffer buffer;
+            vma::Allocation allocation;
+            vk::DeviceSize size = 0;
+        };
+        Buffer m_staging; // Host visible, written by upload()
+        Buffer m_inputs;
+        Buffer m_iterations; // Two sets of Core::Denoiser::FILTERED_PLANE_COUNT planes
+        Buffer m_output;
+        float* m_stagingData = nullptr;
+
+        /// Before the copy, between the copy and the dispatches, and after the dispatches
+        vk::QueryPool m_queryPool;
+        bool m_timestampsSupported;
+        double m_timestampPeriod; // Nanoseconds per tick
+        bool m_timingsPending = false;
+
+        uint64_t m_denoises = 0;
+        Core::TimeDelta m_lastUploadTime = Core::TimeDelta::zero();
+        Core::TimeDelta m_lastFilterTime = Core::TimeDelta::zero();
+        Core::TimeDelta m_uploadTimeSum = Core::TimeDelta::zero();
+        Core::TimeDelta m_filterTimeSum = Core::TimeDelta::zero();
+
+        Buffer createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vma::MemoryUsage memoryUsage, Core::AllocationCategory category);
+        void destroyBuffers();
+    };
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace RT2 {
+
+    /// A pinhole camera, looking down -z at zero yaw and pitch
+    struct Camera {
+        glm::vec3 position;
+        float yaw;         // Radians about +y
+        float pitch;       // Radians above the horizon
+        float verticalFov; // Radians
+    };
+
+    /// What a path first hit, which guides denoising
+    struct PathFeatures {
+        glm::vec3 albedo; // The sky's radiance for paths that hit nothing
+        glm::vec3 normal;
+        float depth;      // Distance from the camera
+    };
+
+    /**
+     * A CPU path tracer over a fixed scene of diffuse spheres under a sky, used to feed the accumulation buffer
+     * until RT2 has a ray tracing pipeline.
+     *
+     * tracePixel() only reads the tracer, so any number of threads may trace at once.
+     */
+    class PathTracer {
+    public:
+        /**
+         * @param maxBounces: The most surfaces a path may bounce off before it is cut short
+         */
+        explicit PathTracer(uint32_t maxBounces);
+
+        void setCamera(const Camera& camera);
+        [[nodiscard]] const Camera& getCamera() const;
+
+        /// Set the size of the image that pixels are traced for
+        void setImageSize(uint32_t width, uint32_t height);
+
+        /**
+         * Trace one path through a pixel
+         * @param x: The pixel's column
+         * @param y: The pixel's row, from the top
+         * @param sampleIndex: The pixel's sample number, so that every sample takes a different path
+         * @param features: If not null, receives what the path first hit
+         * @return The path's linear radiance
+         */
+        [[nodiscard]] glm::vec3 tracePixel(uint32_t x, uint32_t y, uint32_t sampleIndex, PathFeatures* features = nullptr) const;
+
+        /// The unit direction of the camera's ray through a point of the image, in pixels from the top left corner
+        [[nodiscard]] glm::vec3 getRayDirection(glm::vec2 imagePoint) const;
+
+        /**
+         * Find where a point appears to a camera, eg. the previous frame's, for reprojecting samples between views
+         * @param camera: The camera, with the tracer's image size
+         * @param point: The point in world space
+         * @param imagePoint: Receives the point's position in pixels from the top left corner of the image
+         * @return Whether the point is in front of the camera
+         */
+        [[nodiscard]] bool project(const Camera& camera, glm::vec3 point, glm::vec2& imagePoint) const;
+
+    private:
+        struct Sphere {
+            glm::vec3 centre;
+            float radius;
+            glm::vec3 albedo;
+            glm::vec3 emission;
+        };
+
+        uint32_t m_maxBounces;
+        std::vector<Sphere> m_spheres;
+
+        Camera m_camera;
+        uint32_t m_width = 1;
+        uint32_t m_height = 1;
+
+        /// Derived from the camera and image size
+        glm::vec3 m_forward;
+        glm::vec3 m_right;
+        glm::vec3 m_up;
+
+        /**
+         * Find the closest sphere a ray hits
+         * @return The sphere's index and the distance along the ray, or -1 when nothing is hit
+         */
+        [[nodiscard]] int intersect(glm::vec3 origin, glm::vec3 direction, float& distance) const;
+
+        [[nodiscard]] glm::vec3 sky(glm::vec3 direction) const;
+    };
+}
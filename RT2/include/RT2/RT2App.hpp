@@ -1,11 +1,48 @@
 #pragma once
 
+#include "RT2/GpuDenoiser.hpp"
+#include "RT2/PathTracer.hpp"
+
+#include <Core/AccumulationBuffer.hpp>
+#include <Core/Denoiser.hpp>
+#include <Core/MemoryAllocator.hpp>
+#include <Core/TemporalReprojector.hpp>
+#include <Core/ThreadPool.hpp>
 #include <Core/V2AppBase.hpp>
 
+#include <cstddef>
+#include <vector>
+
 namespace RT2 {
+
+    /// Where the accumulated image is denoised before it is displayed
+    enum class DenoiseMode {
+        Off,
+        Cpu, // Core::Denoiser on the thread pool
+        Gpu, // GpuDenoiser, recorded before the copy to the swapchain
+    };
+    constexpr std::size_t DenoiseModeCount = 3;
+
+    const char* to_string(DenoiseMode mode);
+
     class RT2App final : public Core::V2AppBase {
     public:
-        explicit RT2App(Core::Renderer& renderer, Core::V2AppBase::Parameters& parameters);
+        /// Parameters of the path tracer and its accumulation
+        struct Parameters : public Core::V2AppBase::Parameters {
+            uint32_t tileSize = 16;
+            float targetError = 0.02f;      // The relative noise at which a tile stops receiving samples
+            uint32_t minSamples = 8;        // Samples per pixel before a tile's noise is trusted
+            uint32_t samplesPerFrame = 1;   // Samples per pixel of the whole image traced each frame
+            uint32_t maxSamplesPerPass = 8; // The most samples per pixel one tile takes in a frame
+            uint32_t maxBounces = 4;
+            float exposure = 1.0f;
+            DenoiseMode denoiseMode = DenoiseMode::Off;
+            uint32_t denoiseIterations = 5; // At least one
+            bool temporal = false;           // Reproject the accumulation when the camera moves, instead of restarting it
+            uint32_t maxHistorySamples = 64; // The most samples per pixel carried over from the previous view
+        };
+
+        explicit RT2App(Core::Renderer& renderer, Parameters& parameters);
         ~RT2App() noexcept final;
 
         /// Disallowed operations
@@ -16,10 +53,92 @@ namespace RT2 {
 
         void simulateFrame(Core::TimePoint now, Core::TimeDelta delta) final;
 
+        /**
+         * Handle key presses.
+         * W, A, S, D, Q and E move the camera, and the arrow keys turn it, which restarts or reprojects accumulation.
+         * F2 prints the accumulation, reprojection and denoiser statistics, F3 cycles through the denoise modes,
+         * and F4 toggles temporal reprojection.
+         */
+        bool keyPressed(int key, int mods) final;
+
     protected:
         void createDynamicRenderResources(const ResourceParameters& parameters) final;
         void cleanupDynamicRenderResources() final;
         void recordCommandBuffersInitial(std::vector<vk::CommandBuffer>& buffers) final;
         void recordCommandBuffersPerFrame(std::vector<vk::CommandBuffer>& buffers) final;
+
+    private:
+        Parameters& m_runtimeParameters;
+        Core::MemoryAllocator m_allocator;
+        uint32_t m_frameIndex = 0;
+
+        PathTracer m_pathTracer;
+        Core::AccumulationBuffer m_accumulation;
+        Core::TimePoint m_accumulationStart;
+        bool m_reportedConvergence = false;
+
+        /// Per pixel sums of what each sample of the current view first hit, averaged into the denoiser's guides
+        std::vector<glm::vec3> m_albedoSums;
+        std::vector<glm::vec3> m_normalSums;
+        std::vector<float> m_depthSums;
+        std::vector<uint32_t> m_featureCounts; // Reprojected samples carry no features
+
+        /// The camera the accumulated samples were traced from, and set when the tracer's camera has moved away from it
+        Camera m_accumulatedCamera{};
+        bool m_viewChanged = false;
+
+        /// The accumulation of the previous view, and what it needs to be reprojected into the new one
+        Core::AccumulationBuffer m_history;
+        Camera m_historyCamera{};
+        std::vector<float> m_historyDepths;
+        std::vector<Core::PixelReprojection> m_reprojections;
+        Core::TemporalReprojector m_reprojector;
+
+        Core::Denoiser m_denoiser;
+        GpuDenoiser m_gpuDenoiser;
+        /// Set when the displayed image must be resolved again without new samples, eg. after the denoise mode changes
+        bool m_displayStale = false;
+
+        /// The tone mapped image, unless the GPU denoiser's output is displayed
+        vk::Buffer m_stagingBuffer;
+        vma::Allocation m_stagingAllocation;
+        uint8_t* m_stagingData = nullptr;
+        bool m_bgra = false;
+
+        /// Traces tiles and resolves rows. Declared last, so its workers finish before anything they use is destroyed.
+        Core::ThreadPool m_workers;
+
+        /**
+         * Trace a pass of samples
+         * @return Whether any samples were traced, false once every tile has converged
+         */
+        bool tracePass();
+
+        /// Keep the accumulation as history and start the camera's new view
+        void beginView();
+
+        /// Find each pixel's motion vector from its depth and the two cameras, and carry the history into the new view
+        void reprojectHistory();
+
+        /**
+         * Resolve the accumulated image for display, denoising it in the current mode
+         * @return Whether a GPU denoise of the uploaded inputs must be recorded
+         */
+        bool resolveImage();
+
+        /// Average the accumulation and its features into the denoiser's inputs
+        void fillDenoiserInputs();
+
+        /// Record the copy of the displayed image into the current swapchain image
+        void recordPresentCopy(vk::CommandBuffer& buffer, vk::Buffer source);
+
+        /// Trace a tile's samples for the pass, on a worker
+        void traceTile(const Core::AccumulationBuffer::TileWork& work);
+
+        /// Restart accumulation, eg. after the camera moves
+        void restartAccumulation();
+
+        /// Restart or reproject accumulation after the camera moves
+        void cameraMoved();
     };
 }
@@ -0,0 +1,311 @@
+#include "RT2/GpuDenoiser.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+    /// Must match denoise.comp's workgroup size
+    constexpr uint32_t WORKGROUP_SIZE = 8;
+
+    constexpr uint32_t TIMESTAMP_COUNT = 3;
+
+    /// Must match denoise.comp's push constants
+    struct PushConstants {
+        uint32_t width;
+        uint32_t height;
+        uint32_t iteration;
+        uint32_t resolve;
+        uint32_t bgra;
+        float colourScale;
+        float normalPhi;
+        float albedoPhi;
+        float depthPhi;
+        float exposure;
+    };
+}
+
+namespace RT2 {
+
+    GpuDenoiser::GpuDenoiser(Core::Renderer& renderer, Core::MemoryAllocator& allocator)
+        : m_device(renderer.getDevice())
+        , m_allocator(allocator) {
+        vk::DescriptorSetLayoutBinding bindings[3];
+        for (uint32_t binding = 0; binding < std::size(bindings); binding++) {
+            bindings[binding] = vk::DescriptorSetLayoutBinding{
+                binding,
+                vk::DescriptorType::eStorageBuffer,
+                1,
+                vk::ShaderStageFlagBits::eCompute,
+                nullptr,
+            };
+        }
+        m_descriptorSetLayout = std::make_unique<Core::DescriptorSetLayout>(m_device, static_cast<uint32_t>(std::size(bindings)), bindings);
+
+        vk::PushConstantRange pushConstantRange{
+            vk::ShaderStageFlagBits::eCompute,
+            0,
+            sizeof(PushConstants),
+        };
+        m_pipelineLayout = std::make_unique<Core::PipelineLayout>(m_device, 1, &m_descriptorSetLayout->getHandle(), 1, &pushConstantRange);
+
+        m_shader = renderer.getShaderLibrary().load("Resources/Shaders/denoise.comp.spv", vk::ShaderStageFlagBits::eCompute);
+        vk::ComputePipelineCreateInfo pipelineInfo{
+            vk::PipelineCreateFlags(),
+            m_shader->getPipelineStageCreateInfo(),
+            m_pipelineLayout->getHandle(),
+        };
+        m_pipeline = m_device.createComputePipelines(vk::PipelineCache(), pipelineInfo)[0];
+
+        vk::DescriptorPoolSize poolSize{
+            vk::DescriptorType::eStorageBuffer,
+            static_cast<uint32_t>(std::size(bindings)),
+        };
+        vk::DescriptorPoolCreateInfo poolInfo{
+            vk::DescriptorPoolCreateFlags(),
+            1,
+            1,
+            &poolSize,
+        };
+        m_descriptorPool = m_device.createDescriptorPool(poolInfo);
+        vk::DescriptorSetAllocateInfo setInfo{
+            m_descriptorPool,
+            1,
+            &m_descriptorSetLayout->getHandle(),
+        };
+        m_descriptorSet = m_device.allocateDescriptorSets(setInfo)[0];
+
+        // Queues without valid timestamp bits cannot be timed, and the stats say so instead
+        uint32_t family = renderer.getQueue(Core::QueueType::Graphics).familyIndex;
+        m_timestampsSupported = renderer.getPhysicalDevice().getQueueFamilyProperties()[family].timestampValidBits > 0;
+        m_timestampPeriod = renderer.getPhysicalDevice().getProperties().limits.timestampPeriod;
+        vk::QueryPoolCreateInfo queryInfo{
+            vk::QueryPoolCreateFlags(),
+            vk::QueryType::eTimestamp,
+            TIMESTAMP_COUNT,
+            vk::QueryPipelineStatisticFlags(),
+        };
+        m_queryPool = m_device.createQueryPool(queryInfo);
+    }
+
+    GpuDenoiser::~GpuDenoiser() {
+        destroyBuffers();
+        m_device.destroyQueryPool(m_queryPool);
+        // Destroying the pool frees its set
+        m_device.destroyDescriptorPool(m_descriptorPool);
+        m_device.destroyPipeline(m_pipeline);
+    }
+
+    void GpuDenoiser::resize(uint32_t width, uint32_t height) {
+        destroyBuffers();
+        m_width = width;
+        m_height = height;
+        m_timingsPending = false;
+
+        vk::DeviceSize planeBytes = vk::DeviceSize(width) * height * sizeof(float);
+        vk::DeviceSize inputBytes = planeBytes * Core::Denoiser::PlaneCount;
+        m_staging = createBuffer(inputBytes, vk::BufferUsageFlagBits::eTransferSrc, vma::MemoryUsage::eCpuToGpu, Core::AllocationCategory::Staging);
+        m_stagingData = static_cast<float*>(m_allocator.getHandle().getAllocationInfo(m_staging.allocation).pMappedData);
+        // Sized with the image, so they are accounted and placed like render targets
+        m_inputs = createBuffer(inputBytes,
+                                vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                vma::MemoryUsage::eGpuOnly,
+                                Core::AllocationCategory::Framebuffer);
+        m_iterations = createBuffer(
+            planeBytes * Core::Denoiser::FILTERED_PLANE_COUNT * 2, vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eGpuOnly, Core::AllocationCategory::Framebuffer);
+        m_output = createBuffer(vk::DeviceSize(width) * height * 4,
+                                vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+                                vma::MemoryUsage::eGpuOnly,
+                                Core::AllocationCategory::Framebuffer);
+
+        vk::DescriptorBufferInfo bufferInfos[] = {
+            vk::DescriptorBufferInfo{m_inputs.buffer, 0, VK_WHOLE_SIZE},
+            vk::DescriptorBufferInfo{m_iterations.buffer, 0, VK_WHOLE_SIZE},
+            vk::DescriptorBufferInfo{m_output.buffer, 0, VK_WHOLE_SIZE},
+        };
+        vk::WriteDescriptorSet writes[std::size(bufferInfos)];
+        for (uint32_t binding = 0; binding < std::size(bufferInfos); binding++) {
+            writes[binding] = vk::WriteDescriptorSet{
+                m_descriptorSet,
+                binding,
+                0,
+                1,
+                vk::DescriptorType::eStorageBuffer,
+                nullptr,
+                &bufferInfos[binding],
+                nullptr,
+            };
+        }
+        m_device.updateDescriptorSets(static_cast<uint32_t>(std::size(writes)), writes, 0, nullptr);
+    }
+
+    void GpuDenoiser::setSettings(const Core::DenoiserSettings& settings) { m_settings = settings; }
+
+    const Core::DenoiserSettings& GpuDenoiser::getSettings() const { return m_settings; }
+
+    void GpuDenoiser::upload(std::span<const float> inputs) {
+        if (inputs.size_bytes() != m_staging.size) {
+            throw std::runtime_error("The denoiser inputs do not match the size of the GPU denoiser");
+        }
+        std::memcpy(m_stagingData, inputs.data(), inputs.size_bytes());
+        m_allocator.getHandle().flushAllocation(m_staging.allocation, 0, VK_WHOLE_SIZE);
+    }
+
+    void GpuDenoiser::recordDenoise(vk::CommandBuffer& buffer, bool bgra, float exposure) {
+        buffer.resetQueryPool(m_queryPool, 0, TIMESTAMP_COUNT);
+        buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_queryPool, 0);
+
+        vk::BufferCopy region{0, 0, m_staging.size};
+        buffer.copyBuffer(m_staging.buffer, m_inputs.buffer, 1, &region);
+        buffer.writeTimestamp(vk::PipelineStageFlagBits::eTransfer, m_queryPool, 1);
+
+        vk::MemoryBarrier uploadBarrier{
+            vk::AccessFlagBits::eTransferWrite,
+            vk::AccessFlagBits::eShaderRead,
+        };
+        buffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), 1, &uploadBarrier, 0, nullptr, 0, nullptr);
+
+        buffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_pipeline);
+        buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_pipelineLayout->getHandle(), 0, 1, &m_descriptorSet, 0, nullptr);
+
+        // Only an iteration writes the output, so at least one runs
+        uint32_t iterations = std::max(m_settings.iterations, 1u);
+        for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+            if (iteration > 0) {
+                // Each iteration reads the whole of the last
+                vk::MemoryBarrier iterationBarrier{
+                    vk::AccessFlagBits::eShaderWrite,
+                    vk::AccessFlagBits::eShaderRead,
+                };
+                buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                       vk::PipelineStageFlagBits::eComputeShader,
+                                       vk::DependencyFlags(),
+                                       1,
+                                       &iterationBarrier,
+                                       0,
+                                       nullptr,
+                                       0,
+                                       nullptr);
+            }
+
+            uint32_t step = 1u << iteration;
+            PushConstants constants{
+                m_width,
+                m_height,
+                iteration,
+                iteration + 1 == iterations,
+                bgra,
+                1.0f / (m_settings.colourSigma * m_settings.colourSigma),
+                m_settings.normalPhi,
+                m_settings.albedoPhi,
+                m_settings.depthPhi / float(step * step),
+                exposure,
+            };
+            buffer.pushConstants(m_pipelineLayout->getHandle(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+            buffer.dispatch((m_width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (m_height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+        }
+        buffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, m_queryPool, 2);
+
+        vk::BufferMemoryBarrier outputBarrier{
+            vk::AccessFlagBits::eShaderWrite,
+            vk::AccessFlagBits::eTransferRead,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            m_output.buffer,
+            0,
+            VK_WHOLE_SIZE,
+        };
+        buffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 1, &outputBarrier, 0, nullptr);
+
+        m_timingsPending = true;
+    }
+
+    vk::Buffer GpuDenoiser::getOutput() const { return m_output.buffer; }
+
+    void GpuDenoiser::collectTimings() {
+        if (!m_timingsPending) {
+            return;
+        }
+        m_timingsPending = false;
+        m_denoises++;
+        if (!m_timestampsSupported) {
+            return;
+        }
+
+        uint64_t timestamps[TIMESTAMP_COUNT];
+        vk::Result result = m_device.getQueryPoolResults(
+            m_queryPool, 0, TIMESTAMP_COUNT, sizeof(timestamps), timestamps, sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+        if (result != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to read the GPU denoiser's timestamps: " + vk::to_string(result));
+        }
+        m_lastUploadTime = Core::TimeDelta((timestamps[1] - timestamps[0]) * m_timestampPeriod * 1e-9);
+        m_lastFilterTime = Core::TimeDelta((timestamps[2] - timestamps[1]) * m_timestampPeriod * 1e-9);
+        m_uploadTimeSum += m_lastUploadTime;
+        m_filterTimeSum += m_lastFilterTime;
+    }
+
+    GpuDenoiser::Stats GpuDenoiser::getStats() const {
+        Stats stats{};
+        stats.denoises = m_denoises;
+        stats.lastUploadTime = m_lastUploadTime;
+        stats.lastFilterTime = m_lastFilterTime;
+        if (m_denoises > 0) {
+            stats.averageUploadTime = m_uploadTimeSum / static_cast<double>(m_denoises);
+            stats.averageFilterTime = m_filterTimeSum / static_cast<double>(m_denoises);
+        }
+        return stats;
+    }
+
+    void GpuDenoiser::resetStats() {
+        m_denoises = 0;
+        m_uploadTimeSum = Core::TimeDelta::zero();
+        m_filterTimeSum = Core::TimeDelta::zero();
+    }
+
+    void GpuDenoiser::printStats(std::ostream& out) const {
+        Stats stats = getStats();
+        out << "GPU denoiser: " << m_settings.iterations << " iterations, ";
+        if (!m_timestampsSupported) {
+            out << stats.denoises << " denoises, the queue does not support timestamps" << std::endl;
+            return;
+        }
+        out << stats.averageFilterTime.count() * 1000.0 << " ms average filter and " << stats.averageUploadTime.count() * 1000.0
+            << " ms average upload over " << stats.denoises << " denoises, " << stats.lastFilterTime.count() * 1000.0 << " ms last filter" << std::endl;
+    }
+
+    GpuDenoiser::Buffer
+    GpuDenoiser::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vma::MemoryUsage memoryUsage, Core::AllocationCategory category) {
+        vk::BufferCreateInfo bufferInfo{
+            vk::BufferCreateFlags(),
+            size,
+            usage,
+            vk::SharingMode::eExclusive,
+        };
+        // Only the staging buffer is written by the host
+        vma::AllocationCreateFlags flags;
+        if (memoryUsage == vma::MemoryUsage::eCpuToGpu) {
+            flags = vma::AllocationCreateFlagBits::eMapped;
+        }
+        vma::AllocationCreateInfo allocationInfo{
+            flags,
+            memoryUsage,
+        };
+        Buffer buffer;
+        std::tie(buffer.buffer, buffer.allocation) = m_allocator.createBuffer(bufferInfo, allocationInfo, category);
+        buffer.size = size;
+        return buffer;
+    }
+
+    void GpuDenoiser::destroyBuffers() {
+        for (Buffer* buffer : {&m_staging, &m_inputs, &m_iterations, &m_output}) {
+            if (buffer->buffer) {
+                m_allocator.destroyBuffer(buffer->buffer, buffer->allocation);
+            }
+            *buffer = Buffer{};
+        }
+        m_stagingData = nullptr;
+    }
+}
@@ -0,0 +1,181 @@
+#include "RT2/PathTracer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    constexpr float PI = 3.14159265358979f;
+
+    /// Bounces are offset by this much, so a ray does not hit the surface it leaves
+    constexpr float SURFACE_EPSILON = 1e-3f;
+
+    /// The depth of paths that hit nothing, far enough that no surface blends with the sky
+    constexpr float SKY_DEPTH = 1e4f;
+
+    /// Bounces after which paths may be ended early, in proportion to how little they can still contribute
+    constexpr uint32_t RUSSIAN_ROULETTE_START = 2;
+
+    /// A PCG hash, whose outputs are uncorrelated enough that seeds need no more mixing than adding
+    uint32_t pcgHash(uint32_t value) {
+        uint32_t state = value * 747796405u + 2891336453u;
+        uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+
+    /// The unit directions a camera looks along, to its right and up
+    void getBasis(const RT2::Camera& camera, glm::vec3& forward, glm::vec3& right, glm::vec3& up) {
+        forward = glm::vec3(-std::sin(camera.yaw) * std::cos(camera.pitch), std::sin(camera.pitch), -std::cos(camera.yaw) * std::cos(camera.pitch));
+        right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+        up = glm::cross(right, forward);
+    }
+
+    /// A uniform float in [0, 1), advancing the state
+    float nextFloat(uint32_t& state) {
+        state = pcgHash(state);
+        return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+    }
+
+    /// A cosine weighted direction about a normal, whose pdf cancels the cosine and 1/pi of a diffuse bounce
+    glm::vec3 sampleCosineHemisphere(glm::vec3 normal, uint32_t& state) {
+        float angle = 2.0f * PI * nextFloat(state);
+        float radiusSquared = nextFloat(state);
+        float radius = std::sqrt(radiusSquared);
+
+        // An orthonormal basis without branches on the normal's direction (Duff et al. 2017)
+        float sign = std::copysign(1.0f, normal.z);
+        float a = -1.0f / (sign + normal.z);
+        float b = normal.x * normal.y * a;
+        glm::vec3 tangent(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+        glm::vec3 bitangent(b, sign + normal.y * normal.y * a, -normal.y);
+
+        return tangent * (radius * std::cos(angle)) + bitangent * (radius * std::sin(angle)) + normal * std::sqrt(1.0f - radiusSquared);
+    }
+}
+
+namespace RT2 {
+
+    PathTracer::PathTracer(uint32_t maxBounces)
+        : m_maxBounces(maxBounces)
+        , m_camera{glm::vec3(0.0f, 1.0f, 4.0f), 0.0f, -0.1f, glm::radians(50.0f)} {
+        m_spheres = {
+            {glm::vec3(0.0f, -1000.0f, 0.0f), 1000.0f, glm::vec3(0.6f, 0.6f, 0.55f), glm::vec3(0.0f)}, // The ground
+            {glm::vec3(0.0f, 1.0f, 0.0f), 1.0f, glm::vec3(0.8f, 0.3f, 0.25f), glm::vec3(0.0f)},
+            {glm::vec3(-2.2f, 0.7f, 0.6f), 0.7f, glm::vec3(0.25f, 0.5f, 0.8f), glm::vec3(0.0f)},
+            {glm::vec3(2.0f, 0.5f, 1.0f), 0.5f, glm::vec3(0.9f, 0.9f, 0.9f), glm::vec3(0.0f)},
+            {glm::vec3(1.0f, 0.25f, 2.0f), 0.25f, glm::vec3(0.0f), glm::vec3(8.0f, 6.0f, 3.0f)}, // A small, bright light
+        };
+        setCamera(m_camera);
+    }
+
+    void PathTracer::setCamera(const Camera& camera) {
+        m_camera = camera;
+        getBasis(camera, m_forward, m_right, m_up);
+    }
+
+    const Camera& PathTracer::getCamera() const { return m_camera; }
+
+    void PathTracer::setImageSize(uint32_t width, uint32_t height) {
+        m_width = std::max(width, 1u);
+        m_height = std::max(height, 1u);
+    }
+
+    glm::vec3 PathTracer::tracePixel(uint32_t x, uint32_t y, uint32_t sampleIndex, PathFeatures* features) const {
+        uint32_t state = pcgHash(y * m_width + x) + pcgHash(sampleIndex * 0x9e3779b9u);
+
+        // Jittered within the pixel, which antialiases the image as samples accumulate
+        float jitterX = nextFloat(state);
+        float jitterY = nextFloat(state);
+
+        glm::vec3 origin = m_camera.position;
+        glm::vec3 direction = getRayDirection(glm::vec2(x + jitterX, y + jitterY));
+        glm::vec3 throughput(1.0f);
+        glm::vec3 radiance(0.0f);
+        for (uint32_t bounce = 0; bounce <= m_maxBounces; bounce++) {
+            float distance;
+            int hit = intersect(origin, direction, distance);
+            if (hit < 0) {
+                if (features && bounce == 0) {
+                    *features = PathFeatures{sky(direction), -direction, SKY_DEPTH};
+                }
+                radiance += throughput * sky(direction);
+                break;
+            }
+
+            const Sphere& sphere = m_spheres[hit];
+            glm::vec3 position = origin + direction * distance;
+            glm::vec3 normal = (position - sphere.centre) / sphere.radius;
+            if (features && bounce == 0) {
+                // Lights have no albedo, so their emission stands in for it
+                *features = PathFeatures{sphere.albedo + sphere.emission, normal, distance};
+            }
+            radiance += throughput * sphere.emission;
+            throughput *= sphere.albedo;
+
+            if (bounce >= RUSSIAN_ROULETTE_START) {
+                float survival = std::min(std::max(throughput.r, std::max(throughput.g, throughput.b)), 0.95f);
+                if (nextFloat(state) >= survival) {
+                    break;
+                }
+                throughput /= survival;
+            }
+
+            origin = position + normal * SURFACE_EPSILON;
+            direction = sampleCosineHemisphere(normal, state);
+        }
+        return radiance;
+    }
+
+    glm::vec3 PathTracer::getRayDirection(glm::vec2 imagePoint) const {
+        float tanHalfFov = std::tan(m_camera.verticalFov * 0.5f);
+        float aspect = static_cast<float>(m_width) / m_height;
+        float screenX = (2.0f * imagePoint.x / m_width - 1.0f) * tanHalfFov * aspect;
+        float screenY = (1.0f - 2.0f * imagePoint.y / m_height) * tanHalfFov;
+        return glm::normalize(m_forward + m_right * screenX + m_up * screenY);
+    }
+
+    bool PathTracer::project(const Camera& camera, glm::vec3 point, glm::vec2& imagePoint) const {
+        glm::vec3 forward, right, up;
+        getBasis(camera, forward, right, up);
+
+        // The inverse of getRayDirection(), through the camera's basis instead of the current one
+        glm::vec3 offset = point - camera.position;
+        float distanceAhead = glm::dot(offset, forward);
+        if (distanceAhead <= 0.0f) {
+            return false;
+        }
+        float tanHalfFov = std::tan(camera.verticalFov * 0.5f);
+        float aspect = static_cast<float>(m_width) / m_height;
+        float screenX = glm::dot(offset, right) / (distanceAhead * tanHalfFov * aspect);
+        float screenY = glm::dot(offset, up) / (distanceAhead * tanHalfFov);
+        imagePoint = glm::vec2((screenX + 1.0f) * 0.5f * m_width, (1.0f - screenY) * 0.5f * m_height);
+        return true;
+    }
+
+    int PathTracer::intersect(glm::vec3 origin, glm::vec3 direction, float& distance) const {
+        int closest = -1;
+        distance = std::numeric_limits<float>::max();
+        for (std::size_t i = 0; i < m_spheres.size(); i++) {
+            // The direction is normalized, so the quadratic's first coefficient is one
+            glm::vec3 offset = origin - m_spheres[i].centre;
+            float b = glm::dot(offset, direction);
+            float c = glm::dot(offset, offset) - m_spheres[i].radius * m_spheres[i].radius;
+            float discriminant = b * b - c;
+            if (discriminant < 0.0f) {
+                continue;
+            }
+            float root = std::sqrt(discriminant);
+            float t = -b - root > 0.0f ? -b - root : -b + root;
+            if (t > 0.0f && t < distance) {
+                distance = t;
+                closest = static_cast<int>(i);
+            }
+        }
+        return closest;
+    }
+
+    glm::vec3 PathTracer::sky(glm::vec3 direction) const {
+        float height = std::max(direction.y, 0.0f);
+        return glm::mix(glm::vec3(0.9f, 0.85f, 0.8f), glm::vec3(0.35f, 0.55f, 0.9f), std::sqrt(height));
+    }
+}
@@ -1,15 +1,444 @@
 #include "RT2/RT2App.hpp"
 
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+    constexpr float MOVE_STEP = 0.25f;
+    constexpr float TURN_STEP = 0.05f; // Radians
+
+    /// Rows resolved by one task
+    constexpr uint32_t RESOLVE_ROWS = 32;
+
+    /// Wait for every task before rethrowing the first failure, since the others still reference the app
+    void waitForAll(std::vector<std::future<void>>& tasks) {
+        for (std::future<void>& task : tasks) {
+            task.wait();
+        }
+        for (std::future<void>& task : tasks) {
+            task.get();
+        }
+    }
+}
+
 namespace RT2 {
-    RT2::RT2App::RT2App(Core::Renderer& renderer, Core::V2AppBase::Parameters& parameters)
-        : V2AppBase(renderer, parameters) {}
+    const char* to_string(DenoiseMode mode) {
+        switch (mode) {
+        case DenoiseMode::Off:
+            return "Off";
+        case DenoiseMode::Cpu:
+            return "Cpu";
+        case DenoiseMode::Gpu:
+            return "Gpu";
+        }
+        return "Unknown";
+    }
+
+    RT2::RT2App::RT2App(Core::Renderer& renderer, Parameters& parameters)
+        : V2AppBase(renderer, parameters)
+        , m_runtimeParameters(parameters)
+        , m_allocator(renderer)
+        , m_pathTracer(parameters.maxBounces)
+        , m_accumulation(0, 0, parameters.tileSize)
+        , m_history(0, 0, parameters.tileSize)
+        , m_denoiser(0, 0)
+        , m_gpuDenoiser(renderer, m_allocator) {
+        // History is swapped with the accumulation, so both converge alike
+        m_accumulation.setConvergence(parameters.targetError, parameters.minSamples, parameters.maxSamplesPerPass);
+        m_history.setConvergence(parameters.targetError, parameters.minSamples, parameters.maxSamplesPerPass);
+
+        Core::TemporalSettings temporalSettings;
+        temporalSettings.maxHistorySamples = parameters.maxHistorySamples;
+        m_reprojector.setSettings(temporalSettings);
+
+        Core::DenoiserSettings settings;
+        settings.iterations = std::max(parameters.denoiseIterations, 1u);
+        m_denoiser.setSettings(settings);
+        m_gpuDenoiser.setSettings(settings);
+    }
 
     RT2App::~RT2App() noexcept {}
 
-    void RT2App::createDynamicRenderResources(const Core::V2AppBase::ResourceParameters& parameters) {}
-    void RT2App::cleanupDynamicRenderResources() {}
-    void RT2App::recordCommandBuffersInitial(std::vector<vk::CommandBuffer>& buffers) {}
-    void RT2App::recordCommandBuffersPerFrame(std::vector<vk::CommandBuffer>& buffers) {}
+    void RT2App::createDynamicRenderResources(const Core::V2AppBase::ResourceParameters& parameters) {
+        switch (m_renderer.getOutputFormat()) {
+        case vk::Format::eR8G8B8A8Unorm:
+        case vk::Format::eR8G8B8A8Srgb:
+            m_bgra = false;
+            break;
+        case vk::Format::eB8G8R8A8Unorm:
+        case vk::Format::eB8G8R8A8Srgb:
+            m_bgra = true;
+            break;
+        default:
+            throw std::runtime_error("RT2 does not support the swapchain format " + vk::to_string(m_renderer.getOutputFormat()));
+        }
+
+        // The swapchain may not match the viewport exactly
+        vk::Extent2D extent = m_renderer.getSwapchainExtents();
+        m_pathTracer.setImageSize(extent.width, extent.height);
+        m_accumulation.resize(extent.width, extent.height);
+        m_history.resize(extent.width, extent.height);
+        std::size_t pixelCount = std::size_t(extent.width) * extent.height;
+        m_albedoSums.resize(pixelCount);
+        m_normalSums.resize(pixelCount);
+        m_depthSums.resize(pixelCount);
+        m_featureCounts.resize(pixelCount);
+        m_historyDepths.resize(pixelCount);
+        m_reprojections.resize(pixelCount);
+        m_denoiser.resize(extent.width, extent.height);
+        m_gpuDenoiser.resize(extent.width, extent.height);
+        restartAccumulation();
+
+        vk::BufferCreateInfo bufferInfo{
+            vk::BufferCreateFlags(),
+            vk::DeviceSize(extent.width) * extent.height * 4,
+            vk::BufferUsageFlagBits::eTransferSrc,
+            vk::SharingMode::eExclusive,
+        };
+        vma::AllocationCreateInfo allocationInfo{
+            vma::AllocationCreateFlagBits::eMapped,
+            vma::MemoryUsage::eCpuToGpu,
+        };
+        std::tie(m_stagingBuffer, m_stagingAllocation) = m_allocator.createBuffer(bufferInfo, allocationInfo, Core::AllocationCategory::Staging);
+        m_stagingData = static_cast<uint8_t*>(m_allocator.getHandle().getAllocationInfo(m_stagingAllocation).pMappedData);
+        std::fill_n(m_stagingData, bufferInfo.size, uint8_t(0));
+        m_allocator.getHandle().flushAllocation(m_stagingAllocation, 0, VK_WHOLE_SIZE);
+    }
+
+    void RT2App::cleanupDynamicRenderResources() {
+        m_allocator.destroyBuffer(m_stagingBuffer, m_stagingAllocation);
+        m_stagingData = nullptr;
+    }
+
+    void RT2App::recordCommandBuffersInitial(std::vector<vk::CommandBuffer>& buffers) {
+        // Whether the image comes from the staging buffer or the GPU denoiser changes between frames, so every
+        // command buffer is recorded per frame
+    }
+
+    void RT2App::recordCommandBuffersPerFrame(std::vector<vk::CommandBuffer>& buffers) {
+        // The previous frame has completed, so the staging buffers are free to write and its timestamps can be read
+        m_allocator.beginFrame(m_frameIndex++);
+        m_gpuDenoiser.collectTimings();
+
+        bool recordGpuDenoise = false;
+        if (tracePass() || m_displayStale) {
+            recordGpuDenoise = resolveImage();
+            m_displayStale = false;
+        }
+
+        vk::CommandBuffer& buffer = buffers[0];
+        buffer.reset(vk::CommandBufferResetFlags());
+        buffer.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+        if (recordGpuDenoise) {
+            m_gpuDenoiser.recordDenoise(buffer, m_bgra, m_runtimeParameters.exposure);
+        }
+        // Without new samples the GPU denoiser's output still holds the last denoise
+        recordPresentCopy(buffer, m_runtimeParameters.denoiseMode == DenoiseMode::Gpu ? m_gpuDenoiser.getOutput() : m_stagingBuffer);
+        buffer.end();
+    }
 
     void RT2App::simulateFrame(Core::TimePoint now, Core::TimeDelta delta) {}
+
+    bool RT2App::keyPressed(int key, int mods) {
+        if (key == GLFW_KEY_F2) {
+            m_accumulation.printStats(std::cout);
+            m_reprojector.printStats(std::cout);
+            m_denoiser.printStats(std::cout);
+            m_gpuDenoiser.printStats(std::cout);
+            return true;
+        }
+        if (key == GLFW_KEY_F3) {
+            m_runtimeParameters.denoiseMode = static_cast<DenoiseMode>((static_cast<std::size_t>(m_runtimeParameters.denoiseMode) + 1) % DenoiseModeCount);
+            m_displayStale = true;
+            std::cout << "Denoise mode: " << to_string(m_runtimeParameters.denoiseMode) << std::endl;
+            return true;
+        }
+        if (key == GLFW_KEY_F4) {
+            m_runtimeParameters.temporal = !m_runtimeParameters.temporal;
+            std::cout << "Temporal reprojection " << (m_runtimeParameters.temporal ? "on" : "off") << std::endl;
+            return true;
+        }
+
+        Camera camera = m_pathTracer.getCamera();
+        // Moves stay level, whatever the pitch
+        glm::vec3 forward(-std::sin(camera.yaw), 0.0f, -std::cos(camera.yaw));
+        glm::vec3 right(-forward.z, 0.0f, forward.x);
+        switch (key) {
+        case GLFW_KEY_W:
+            camera.position += forward * MOVE_STEP;
+            break;
+        case GLFW_KEY_S:
+            camera.position -= forward * MOVE_STEP;
+            break;
+        case GLFW_KEY_D:
+            camera.position += right * MOVE_STEP;
+            break;
+        case GLFW_KEY_A:
+            camera.position -= right * MOVE_STEP;
+            break;
+        case GLFW_KEY_E:
+            camera.position.y += MOVE_STEP;
+            break;
+        case GLFW_KEY_Q:
+            camera.position.y -= MOVE_STEP;
+            break;
+        case GLFW_KEY_LEFT:
+            camera.yaw += TURN_STEP;
+            break;
+        case GLFW_KEY_RIGHT:
+            camera.yaw -= TURN_STEP;
+            break;
+        case GLFW_KEY_UP:
+            camera.pitch = std::min(camera.pitch + TURN_STEP, 1.5f);
+            break;
+        case GLFW_KEY_DOWN:
+            camera.pitch = std::max(camera.pitch - TURN_STEP, -1.5f);
+            break;
+        default:
+            return false;
+        }
+        m_pathTracer.setCamera(camera);
+        cameraMoved();
+        return true;
+    }
+
+    bool RT2App::tracePass() {
+        // Any number of moves since the last pass make one new view
+        bool newView = m_viewChanged;
+        if (newView) {
+            beginView();
+        }
+
+        uint64_t sampleBudget = uint64_t(m_runtimeParameters.samplesPerFrame) * m_accumulation.getWidth() * m_accumulation.getHeight();
+        std::vector<Core::AccumulationBuffer::TileWork> work = m_accumulation.planPass(sampleBudget);
+        if (work.empty()) {
+            // Every tile has converged, so the displayed image is already final
+            if (!m_reportedConvergence) {
+                std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - m_accumulationStart;
+                std::cout << "Converged in " << elapsed.count() << " s" << std::endl;
+                m_accumulation.printStats(std::cout);
+                m_reportedConvergence = true;
+            }
+            return false;
+        }
+
+        std::vector<std::future<void>> tasks;
+        tasks.reserve(work.size());
+        for (const Core::AccumulationBuffer::TileWork& tile : work) {
+            tasks.push_back(m_workers.submit([this, tile]() { traceTile(tile); }));
+        }
+        waitForAll(tasks);
+
+        // The new view's first samples are needed to clamp the history to
+        if (newView) {
+            reprojectHistory();
+        }
+        return true;
+    }
+
+    void RT2App::beginView() {
+        // The depths the history was seen at, which tell whether the new view still sees the same surfaces
+        for (std::size_t pixel = 0; pixel < m_depthSums.size(); pixel++) {
+            m_historyDepths[pixel] = m_featureCounts[pixel] > 0 ? m_depthSums[pixel] / m_featureCounts[pixel] : 0.0f;
+        }
+        m_history.swap(m_accumulation);
+        m_historyCamera = m_accumulatedCamera;
+        restartAccumulation();
+    }
+
+    void RT2App::reprojectHistory() {
+        std::vector<std::future<void>> tasks;
+        uint32_t width = m_accumulation.getWidth();
+        uint32_t height = m_accumulation.getHeight();
+        for (uint32_t row = 0; row < height; row += RESOLVE_ROWS) {
+            uint32_t lastRow = std::min(row + RESOLVE_ROWS, height);
+            tasks.push_back(m_workers.submit([this, width, row, lastRow]() {
+                glm::vec3 origin = m_accumulatedCamera.position;
+                for (uint32_t y = row; y < lastRow; y++) {
+                    for (uint32_t x = 0; x < width; x++) {
+                        std::size_t pixel = std::size_t(y) * width + x;
+                        Core::PixelReprojection& reprojection = m_reprojections[pixel];
+                        reprojection = Core::PixelReprojection{glm::vec2(0.0f), 0.0f};
+                        if (m_featureCounts[pixel] == 0) {
+                            continue;
+                        }
+
+                        // The surface seen through the pixel's centre, at the average depth of its samples
+                        glm::vec2 centre(x + 0.5f, y + 0.5f);
+                        glm::vec3 point = origin + m_pathTracer.getRayDirection(centre) * (m_depthSums[pixel] / m_featureCounts[pixel]);
+                        glm::vec2 previous;
+                        if (m_pathTracer.project(m_historyCamera, point, previous)) {
+                            reprojection.motion = centre - previous;
+                            reprojection.previousDepth = glm::length(point - m_historyCamera.position);
+                        }
+                    }
+                }
+            }));
+        }
+        waitForAll(tasks);
+
+        m_reprojector.reproject(m_history, m_historyDepths, m_reprojections, m_accumulation, m_workers);
+    }
+
+    bool RT2App::resolveImage() {
+        DenoiseMode mode = m_runtimeParameters.denoiseMode;
+        if (mode != DenoiseMode::Off) {
+            fillDenoiserInputs();
+        }
+        if (mode == DenoiseMode::Gpu) {
+            m_gpuDenoiser.upload(m_denoiser.getInputs());
+            return true;
+        }
+        if (mode == DenoiseMode::Cpu) {
+            m_denoiser.denoise(m_workers);
+        }
+
+        // Resolving the whole image each pass keeps converged tiles on screen, and costs far less than tracing
+        std::vector<std::future<void>> tasks;
+        uint32_t width = m_accumulation.getWidth();
+        uint32_t height = m_accumulation.getHeight();
+        std::size_t rowPitch = std::size_t(width) * 4;
+        for (uint32_t row = 0; row < height; row += RESOLVE_ROWS) {
+            uint32_t rowCount = std::min(RESOLVE_ROWS, height - row);
+            tasks.push_back(m_workers.submit([this, mode, row, rowCount, rowPitch]() {
+                uint8_t* out = m_stagingData + row * rowPitch;
+                if (mode == DenoiseMode::Cpu) {
+                    m_denoiser.resolveRows(row, rowCount, out, rowPitch, m_bgra, m_runtimeParameters.exposure);
+                } else {
+                    m_accumulation.resolveRows(row, rowCount, out, rowPitch, m_bgra, m_runtimeParameters.exposure);
+                }
+            }));
+        }
+        waitForAll(tasks);
+        m_allocator.getHandle().flushAllocation(m_stagingAllocation, 0, VK_WHOLE_SIZE);
+        return false;
+    }
+
+    void RT2App::fillDenoiserInputs() {
+        std::vector<std::future<void>> tasks;
+        uint32_t width = m_accumulation.getWidth();
+        uint32_t height = m_accumulation.getHeight();
+        for (uint32_t row = 0; row < height; row += RESOLVE_ROWS) {
+            uint32_t lastRow = std::min(row + RESOLVE_ROWS, height);
+            tasks.push_back(m_workers.submit([this, width, row, lastRow]() {
+                for (uint32_t y = row; y < lastRow; y++) {
+                    for (uint32_t x = 0; x < width; x++) {
+                        std::size_t pixel = std::size_t(y) * width + x;
+                        uint32_t count = m_accumulation.getSampleCount(x, y);
+                        uint32_t featureCount = m_featureCounts[pixel];
+                        float inverseFeatureCount = featureCount > 0 ? 1.0f / featureCount : 0.0f;
+                        // The noise of the mean, rather than of one sample
+                        m_denoiser.setPixel(x,
+                                            y,
+                                            m_accumulation.getMean(x, y),
+                                            count > 0 ? m_accumulation.getLuminanceVariance(x, y) / count : 0.0f,
+                                            m_albedoSums[pixel] * inverseFeatureCount,
+                                            m_normalSums[pixel] * inverseFeatureCount,
+                                            m_depthSums[pixel] * inverseFeatureCount);
+                    }
+                }
+            }));
+        }
+        waitForAll(tasks);
+    }
+
+    void RT2App::recordPresentCopy(vk::CommandBuffer& buffer, vk::Buffer source) {
+        vk::Image image = m_renderer.getSwapchainImages()[getSwapchainImageIndex()];
+        vk::ImageSubresourceRange colourRange{
+            vk::ImageAspectFlagBits::eColor,
+            0,
+            1,
+            0,
+            1,
+        };
+
+        // The previous contents are overwritten entirely
+        vk::ImageMemoryBarrier transferBarrier{
+            vk::AccessFlags(),
+            vk::AccessFlagBits::eTransferWrite,
+            vk::ImageLayout::eUndefined,
+            vk::ImageLayout::eTransferDstOptimal,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            image,
+            colourRange,
+        };
+        buffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &transferBarrier);
+
+        vk::BufferImageCopy region{
+            0,
+            0, // Rows are tightly packed
+            0,
+            vk::ImageSubresourceLayers{
+                vk::ImageAspectFlagBits::eColor,
+                0,
+                0,
+                1,
+            },
+            vk::Offset3D(0, 0, 0),
+            vk::Extent3D(m_renderer.getSwapchainExtents(), 1),
+        };
+        buffer.copyBufferToImage(source, image, vk::ImageLayout::eTransferDstOptimal, 1, &region);
+
+        vk::ImageMemoryBarrier presentBarrier{
+            vk::AccessFlagBits::eTransferWrite,
+            vk::AccessFlags(),
+            vk::ImageLayout::eTransferDstOptimal,
+            vk::ImageLayout::ePresentSrcKHR,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            image,
+            colourRange,
+        };
+        buffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &presentBarrier);
+    }
+
+    void RT2App::traceTile(const Core::AccumulationBuffer::TileWork& work) {
+        uint32_t width = m_accumulation.getWidth();
+        for (uint32_t y = work.y0; y < work.y1; y++) {
+            for (uint32_t x = work.x0; x < work.x1; x++) {
+                std::size_t pixel = std::size_t(y) * width + x;
+                uint32_t firstSample = m_accumulation.getSampleCount(x, y);
+                for (uint32_t sample = 0; sample < work.samplesPerPixel; sample++) {
+                    PathFeatures features;
+                    m_accumulation.addSample(x, y, m_pathTracer.tracePixel(x, y, firstSample + sample, &features));
+                    m_albedoSums[pixel] += features.albedo;
+                    m_normalSums[pixel] += features.normal;
+                    m_depthSums[pixel] += features.depth;
+                    m_featureCounts[pixel]++;
+                }
+            }
+        }
+        m_accumulation.finishTile(work.tile);
+    }
+
+    void RT2App::restartAccumulation() {
+        m_accumulation.reset();
+        std::fill(m_albedoSums.begin(), m_albedoSums.end(), glm::vec3(0.0f));
+        std::fill(m_normalSums.begin(), m_normalSums.end(), glm::vec3(0.0f));
+        std::fill(m_depthSums.begin(), m_depthSums.end(), 0.0f);
+        std::fill(m_featureCounts.begin(), m_featureCounts.end(), 0u);
+        m_accumulatedCamera = m_pathTracer.getCamera();
+        m_viewChanged = false;
+        m_accumulationStart = std::chrono::high_resolution_clock::now();
+        m_reportedConvergence = false;
+    }
+
+    void RT2App::cameraMoved() {
+        if (m_runtimeParameters.temporal) {
+            // Reprojected when the next pass has traced the new view
+            m_viewChanged = true;
+        } else {
+            restartAccumulation();
+        }
+    }
 }
@@ -8,6 +8,7 @@
 #include <vulkan/vulkan.hpp>
 
 #include <iostream>
+#include <string>
 
 const char* DESIRED_INSTANCE_EXTENSIONS[] = {
     VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME,
@@ -23,8 +24,62 @@ const char* DESIRED_DEVICE_EXTENSIONS[] = {
     VK_NV_RAY_TRACING_EXTENSION_NAME,
 };
 
+/**
+ * Read the path tracing options from the command line:
+ *  --tile-size N              The width and height of the tiles samples are shared between
+ *  --target-error E           The relative noise at which a tile stops receiving samples
+ *  --min-samples N            Samples per pixel before a tile's noise is trusted
+ *  --samples-per-frame N      Samples per pixel of the whole image traced each frame
+ *  --max-samples-per-pass N   The most samples per pixel one tile takes in a frame
+ *  --max-bounces N            The most surfaces a path bounces off
+ *  --exposure E               Multiplies radiance before tone mapping
+ *  --denoise off|cpu|gpu      Where the image is denoised before it is displayed
+ *  --denoise-iterations N     Passes of the denoiser's 5x5 kernel, each twice as wide
+ *  --temporal                 Reproject the accumulation when the camera moves, instead of restarting it
+ *  --max-history N            The most samples per pixel carried over from the previous view
+ */
+void parseArguments(int argc, char** argv, RT2::RT2App::Parameters& parameters) {
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--tile-size" && i + 1 < argc) {
+            parameters.tileSize = std::stoul(argv[++i]);
+        } else if (argument == "--target-error" && i + 1 < argc) {
+            parameters.targetError = std::stof(argv[++i]);
+        } else if (argument == "--min-samples" && i + 1 < argc) {
+            parameters.minSamples = std::stoul(argv[++i]);
+        } else if (argument == "--samples-per-frame" && i + 1 < argc) {
+            parameters.samplesPerFrame = std::stoul(argv[++i]);
+        } else if (argument == "--max-samples-per-pass" && i + 1 < argc) {
+            parameters.maxSamplesPerPass = std::stoul(argv[++i]);
+        } else if (argument == "--max-bounces" && i + 1 < argc) {
+            parameters.maxBounces = std::stoul(argv[++i]);
+        } else if (argument == "--exposure" && i + 1 < argc) {
+            parameters.exposure = std::stof(argv[++i]);
+        } else if (argument == "--denoise" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "off") {
+                parameters.denoiseMode = RT2::DenoiseMode::Off;
+            } else if (mode == "cpu") {
+                parameters.denoiseMode = RT2::DenoiseMode::Cpu;
+            } else if (mode == "gpu") {
+                parameters.denoiseMode = RT2::DenoiseMode::Gpu;
+            } else {
+                throw std::runtime_error("Unknown denoise mode: " + mode);
+            }
+        } else if (argument == "--denoise-iterations" && i + 1 < argc) {
+            parameters.denoiseIterations = std::stoul(argv[++i]);
+        } else if (argument == "--temporal") {
+            parameters.temporal = true;
+        } else if (argument == "--max-history" && i + 1 < argc) {
+            parameters.maxHistorySamples = std::stoul(argv[++i]);
+        } else {
+            throw std::runtime_error("Unknown argument: " + argument);
+        }
+    }
+}
+
 int
-main() {
+main(int argc, char** argv) {
     if (!glfwInit()) {
         throw std::runtime_error("Failed to initialize glfw!");
     }
@@ -39,10 +94,10 @@ main() {
     // No features required
     vk::PhysicalDeviceFeatures features{};
 
-    Core::V2AppBase::Parameters parameters{
-        1920,
-        1080,
-    };
+    RT2::RT2App::Parameters parameters;
+    parameters.width = 1920;
+    parameters.height = 1080;
+    parseArguments(argc, argv, parameters);
 
     Core::WindowedRenderer<Core::V2WindowBase, RT2::RT2App> renderer(glfwExtensionCount,
                                                                glfwExtensions,
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "RTCook/ImportedScene.hpp"
+
+#include <Core/BvhBuilder.hpp>
+#include <Core/MeshOptimizer.hpp>
+#include <Core/ThreadPool.hpp>
+#include <Core/VertexFormat.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace RTCook {
+
+    /**
+     * Converts source assets into a single packed scene file.
+     *
+     * Each input is cooked on its own into a cache file named after a hash of its contents, its dependencies and the
+     * cooking options, so only assets that changed since the last run are imported and processed again. The cached
+     * scenes are then linked into the output. Importing, mesh processing and cache writing run on a thread pool,
+     * with every mesh of every stale asset processed independently.
+     */
+    class Cooker {
+    public:
+        struct Options {
+            Core::VertexFormat vertexFormat = Core::VertexFormat::Compressed;
+            std::string cacheDirectory = ".rtcook";
+            std::size_t threadCount = 0; // Zero for one per hardware thread
+            bool force = false;          // Cook every asset, even if its cache file is up to date
+        };
+
+        explicit Cooker(const Options& options);
+        ~Cooker();
+
+        /**
+         * Cook assets into a scene
+         * @param inputs: The .obj, .gltf or .glb files to cook, in the order their contents appear in the output
+         * @param output: The scene file to write
+         * Throws std::runtime_error if an asset cannot be read or the output cannot be written
+         */
+        void cook(const std::vector<std::string>& inputs, const std::string& output);
+
+    private:
+        /// -- Members for configuration --
+        Options m_options;
+
+        /// -- Members for processing --
+        Core::ThreadPool m_threadPool;
+
+        /// A mesh ready to be written
+        struct CookedMesh {
+            Core::IndexedMesh mesh;
+            Core::VertexQuantization quantization;
+            Core::BvhBuilder::Result bvh;
+            uint32_t material;
+        };
+
+        /// The progress of one input through the stages
+        struct Asset {
+            std::string path;
+            std::string cachePath;
+            bool upToDate = false;
+            ImportedScene scene;
+            std::vector<CookedMesh> meshes;
+        };
+
+        [[nodiscard]] std::string computeCachePath(const std::string& path) const;
+        [[nodiscard]] CookedMesh cookMesh(const ImportedMesh& mesh) const;
+        void writeCache(const Asset& asset) const;
+    };
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "RTCook/ImportedScene.hpp"
+
+#include <string>
+#include <vector>
+
+namespace RTCook {
+
+    /**
+     * Import a glTF 2.0 asset, either .gltf with external or embedded buffers, or binary .glb.
+     * Each triangle primitive becomes a mesh, and every node that references a mesh instances its primitives
+     * with the node's world transform. Positions, normals, the first UV set and the metallic-roughness material
+     * factors are read. Textures, skins, morph targets and sparse accessors are not supported.
+     * @param path: The .gltf or .glb file
+     * @return The imported scene
+     */
+    ImportedScene importGltf(const std::string& path);
+
+    /// The files a glTF asset reads besides itself, ie. its external buffers
+    std::vector<std::string> findGltfDependencies(const std::string& path);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Core/SceneFormat.hpp>
+#include <Core/VertexFormat.hpp>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace RTCook {
+
+    /// One mesh as read from a source asset, before any processing
+    struct ImportedMesh {
+        std::string name;
+        std::vector<Core::FullVertex> triangles; // A triangle soup, three vertices per triangle
+        uint32_t material;
+    };
+
+    struct ImportedInstance {
+        uint32_t mesh;
+        glm::mat4 transform;
+    };
+
+    /// The contents of one source asset, in the units of the scene format
+    struct ImportedScene {
+        std::vector<ImportedMesh> meshes;
+        std::vector<Core::SceneMaterial> materials;
+        std::vector<ImportedInstance> instances;
+    };
+
+    /// The material given to geometry that does not reference one
+    Core::SceneMaterial getDefaultMaterial();
+
+    /// Fill in face normals for triangles whose normals are all zero, eg. because the source had none
+    void generateMissingNormals(std::vector<Core::FullVertex>& triangles);
+
+    /// Read a whole file into memory. Throws std::runtime_error if it cannot be read.
+    std::string readFile(const std::string& path);
+}
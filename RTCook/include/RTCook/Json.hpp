@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace RTCook {
+
+    /**
+     * A parsed JSON document, enough to read glTF.
+     * Accessors throw std::runtime_error when the value has a different type, so malformed assets fail with a message.
+     */
+    class JsonValue {
+    public:
+        enum class Type {
+            Null,
+            Bool,
+            Number,
+            String,
+            Array,
+            Object,
+        };
+
+        JsonValue();
+        ~JsonValue();
+
+        /**
+         * Parse a whole document
+         * @param text: The JSON text
+         * @return The root value
+         */
+        static JsonValue parse(std::string_view text);
+
+        [[nodiscard]] Type getType() const;
+        [[nodiscard]] bool isNull() const;
+
+        [[nodiscard]] bool asBool() const;
+        [[nodiscard]] double asNumber() const;
+        [[nodiscard]] const std::string& asString() const;
+
+        /// The number of elements of an array, or members of an object
+        [[nodiscard]] std::size_t size() const;
+
+        /// Array element access
+        const JsonValue& operator[](std::size_t index) const;
+
+        /// Object member access, throws if the member is missing
+        const JsonValue& operator[](const std::string& key) const;
+
+        /// Object member access, nullptr if the member is missing or this is not an object
+        [[nodiscard]] const JsonValue* find(const std::string& key) const;
+
+        /// -- Convenience accessors for optional members --
+
+        [[nodiscard]] double getNumber(const std::string& key, double fallback) const;
+        [[nodiscard]] std::string getString(const std::string& key, const std::string& fallback) const;
+
+        /// -- End convenience accessors --
+
+    private:
+        Type m_type = Type::Null;
+        bool m_bool = false;
+        double m_number = 0.0;
+        std::string m_string;
+        std::vector<std::string> m_keys;  // Object member names, parallel to m_values
+        std::vector<JsonValue> m_values; // Array elements or object member values
+
+        class Parser;
+    };
+}
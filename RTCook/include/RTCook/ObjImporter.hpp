@@ -0,0 +1,21 @@
+#pragma once
+
+#include "RTCook/ImportedScene.hpp"
+
+#include <string>
+#include <vector>
+
+namespace RTCook {
+
+    /**
+     * Import a Wavefront OBJ file, along with the materials of its MTL libraries.
+     * Each object or group, split further by material, becomes one mesh with a single identity instance.
+     * Polygons are triangulated as fans, and faces without normals get face normals.
+     * @param path: The OBJ file
+     * @return The imported scene
+     */
+    ImportedScene importObj(const std::string& path);
+
+    /// The files an OBJ file reads besides itself, ie. its MTL libraries
+    std::vector<std::string> findObjDependencies(const std::string& path);
+}
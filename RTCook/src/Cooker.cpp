@@ -0,0 +1,242 @@
+#include "RTCook/Cooker.hpp"
+
+#include "RTCook/GltfImporter.hpp"
+#include "RTCook/ObjImporter.hpp"
+
+#include <Core/ContentHash.hpp>
+#include <Core/SceneFile.hpp>
+#include <Core/SceneWriter.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+    /// Bump whenever cooking produces different output for the same input, to invalidate every cache file
+    constexpr uint32_t COOKER_VERSION = 1;
+
+    enum class AssetType {
+        Obj,
+        Gltf,
+    };
+
+    AssetType getAssetType(const std::string& path) {
+        std::string extension = std::filesystem::path(path).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        if (extension == ".obj") {
+            return AssetType::Obj;
+        } else if (extension == ".gltf" || extension == ".glb") {
+            return AssetType::Gltf;
+        }
+        throw std::runtime_error("Unsupported asset type: " + path);
+    }
+
+    /// Write through a temporary file, so an interrupted cook never leaves a truncated file behind
+    void writeAtomically(const Core::SceneWriter& writer, const std::string& path) {
+        std::string temporaryPath = path + ".tmp";
+        writer.write(temporaryPath);
+        std::filesystem::rename(temporaryPath, path);
+    }
+
+    /// Wait for every task, so none outlives the data it references, then rethrow the first failure
+    void collect(std::vector<std::future<void>>& futures) {
+        std::exception_ptr failure;
+        for (std::future<void>& future : futures) {
+            try {
+                future.get();
+            } catch (...) {
+                if (!failure) {
+                    failure = std::current_exception();
+                }
+            }
+        }
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+
+    double getMillisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+namespace RTCook {
+
+    Cooker::Cooker(const Options& options)
+        : m_options(options)
+        , m_threadPool(options.threadCount) {}
+
+    Cooker::~Cooker() = default;
+
+    void Cooker::cook(const std::vector<std::string>& inputs, const std::string& output) {
+        auto start = std::chrono::steady_clock::now();
+        std::filesystem::create_directories(m_options.cacheDirectory);
+
+        std::vector<Asset> assets(inputs.size());
+        for (std::size_t i = 0; i < inputs.size(); i++) {
+            assets[i].path = inputs[i];
+        }
+
+        // -- Find the assets that changed --
+        std::vector<std::future<void>> hashTasks;
+        for (Asset& asset : assets) {
+            hashTasks.push_back(m_threadPool.submit([this, &asset]() {
+                asset.cachePath = computeCachePath(asset.path);
+                asset.upToDate = !m_options.force && std::filesystem::exists(asset.cachePath);
+            }));
+        }
+        collect(hashTasks);
+
+        // An input given twice, or two inputs with the same contents, share a cache file that is cooked once
+        std::vector<Asset*> staleAssets;
+        std::unordered_set<std::string> staleCachePaths;
+        for (Asset& asset : assets) {
+            if (!asset.upToDate && staleCachePaths.insert(asset.cachePath).second) {
+                staleAssets.push_back(&asset);
+            }
+        }
+        double hashTime = getMillisecondsSince(start);
+
+        // -- Import --
+        std::vector<std::future<void>> importTasks;
+        for (Asset* asset : staleAssets) {
+            importTasks.push_back(m_threadPool.submit([asset]() {
+                asset->scene = getAssetType(asset->path) == AssetType::Obj ? importObj(asset->path) : importGltf(asset->path);
+                asset->meshes.resize(asset->scene.meshes.size());
+            }));
+        }
+        collect(importTasks);
+        double importTime = getMillisecondsSince(start) - hashTime;
+
+        // -- Optimize, quantize and build BVHs, one task per mesh across every asset --
+        std::size_t meshCount = 0;
+        std::vector<std::future<void>> meshTasks;
+        for (Asset* asset : staleAssets) {
+            for (std::size_t mesh = 0; mesh < asset->scene.meshes.size(); mesh++) {
+                meshTasks.push_back(m_threadPool.submit([this, asset, mesh]() { asset->meshes[mesh] = cookMesh(asset->scene.meshes[mesh]); }));
+            }
+            meshCount += asset->scene.meshes.size();
+        }
+        collect(meshTasks);
+        double meshTime = getMillisecondsSince(start) - hashTime - importTime;
+
+        // -- Write the cache files --
+        std::vector<std::future<void>> writeTasks;
+        for (Asset* asset : staleAssets) {
+            writeTasks.push_back(m_threadPool.submit([this, asset]() { writeCache(*asset); }));
+        }
+        collect(writeTasks);
+
+        // -- Link --
+        auto linkStart = std::chrono::steady_clock::now();
+        Core::SceneWriter writer(m_options.vertexFormat);
+        for (const Asset& asset : assets) {
+            Core::SceneFile scene(asset.cachePath);
+            writer.addScene(scene);
+        }
+        std::filesystem::path outputDirectory = std::filesystem::path(output).parent_path();
+        if (!outputDirectory.empty()) {
+            std::filesystem::create_directories(outputDirectory);
+        }
+        writeAtomically(writer, output);
+        double linkTime = getMillisecondsSince(linkStart);
+
+        std::cout << "Cooked " << staleAssets.size() << " of " << assets.size() << " assets (" << meshCount << " meshes) on "
+                  << m_threadPool.getThreadCount() << " threads in " << getMillisecondsSince(start) << "ms" << std::endl;
+        std::cout << "  hash " << hashTime << "ms, import " << importTime << "ms, meshes " << meshTime << "ms, link " << linkTime << "ms" << std::endl;
+    }
+
+    std::string Cooker::computeCachePath(const std::string& path) const {
+        Core::ContentHash hash;
+        hash.addValue(COOKER_VERSION);
+        hash.addValue(m_options.vertexFormat);
+        hash.addFile(path);
+
+        std::vector<std::string> dependencies = getAssetType(path) == AssetType::Obj ? findObjDependencies(path) : findGltfDependencies(path);
+        for (const std::string& dependency : dependencies) {
+            hash.addString(dependency);
+            // A missing dependency is hashed as such, the importer reports it if the asset is cooked
+            if (std::filesystem::exists(dependency)) {
+                hash.addFile(dependency);
+            }
+        }
+
+        std::string stem = std::filesystem::path(path).stem().string();
+        return (std::filesystem::path(m_options.cacheDirectory) / (stem + "-" + hash.toHex() + ".rtscene")).string();
+    }
+
+    Cooker::CookedMesh Cooker::cookMesh(const ImportedMesh& mesh) const {
+        CookedMesh result;
+        result.material = mesh.material;
+
+        Core::MeshOptimizer optimizer(sizeof(Core::FullVertex), offsetof(Core::FullVertex, position));
+        result.mesh = optimizer.ingest(mesh.triangles.data(), mesh.triangles.size());
+
+        const auto* vertices = reinterpret_cast<const Core::FullVertex*>(result.mesh.vertices.data());
+        uint32_t vertexCount = result.mesh.getVertexCount();
+        std::vector<glm::vec3> positions(vertexCount);
+
+        if (m_options.vertexFormat == Core::VertexFormat::Compressed) {
+            result.quantization = Core::computeQuantization(vertices, vertexCount);
+            std::vector<Core::CompressedVertex> compressed = Core::compressVertices(vertices, vertexCount, result.quantization);
+
+            // Bound the positions the GPU will see, so quantization error cannot poke triangles out of their boxes
+            for (uint32_t i = 0; i < vertexCount; i++) {
+                positions[i] = Core::decompressVertex(compressed[i], result.quantization).position;
+            }
+
+            const auto* bytes = reinterpret_cast<const uint8_t*>(compressed.data());
+            result.mesh.vertices.assign(bytes, bytes + compressed.size() * sizeof(Core::CompressedVertex));
+            result.mesh.vertexStride = sizeof(Core::CompressedVertex);
+        } else {
+            result.quantization = Core::getIdentityQuantization();
+            for (uint32_t i = 0; i < vertexCount; i++) {
+                positions[i] = vertices[i].position;
+            }
+        }
+
+        result.bvh = Core::BvhBuilder().build(positions.data(), result.mesh.indices.data(), result.mesh.getTriangleCount());
+        return result;
+    }
+
+    void Cooker::writeCache(const Asset& asset) const {
+        Core::SceneWriter writer(m_options.vertexFormat);
+        for (const Core::SceneMaterial& material : asset.scene.materials) {
+            writer.addMaterial(material);
+        }
+
+        // Meshes without triangles are dropped, along with their instances
+        std::vector<uint32_t> meshIndices(asset.meshes.size(), ~0u);
+        for (std::size_t i = 0; i < asset.meshes.size(); i++) {
+            const CookedMesh& mesh = asset.meshes[i];
+            if (mesh.mesh.getTriangleCount() > 0) {
+                meshIndices[i] = writer.addMesh(mesh.mesh, mesh.quantization, mesh.material, mesh.bvh.nodes, mesh.bvh.triangles);
+            }
+        }
+
+        for (const ImportedInstance& imported : asset.scene.instances) {
+            if (meshIndices[imported.mesh] == ~0u) {
+                continue;
+            }
+
+            Core::SceneInstance instance{};
+            for (int row = 0; row < 3; row++) {
+                for (int column = 0; column < 4; column++) {
+                    // glm is column major
+                    instance.transform[row][column] = imported.transform[column][row];
+                }
+            }
+            instance.mesh = meshIndices[imported.mesh];
+            instance.material = Core::SCENE_MESH_MATERIAL;
+            writer.addInstance(instance);
+        }
+
+        writeAtomically(writer, asset.cachePath);
+    }
+}
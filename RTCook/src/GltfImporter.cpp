@@ -0,0 +1,550 @@
+#include "RTCook/GltfImporter.hpp"
+
+#include "RTCook/Json.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+    constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+    constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+    constexpr int GLTF_MODE_TRIANGLES = 4;
+
+    enum ComponentType {
+        Byte = 5120,
+        UnsignedByte = 5121,
+        Short = 5122,
+        UnsignedShort = 5123,
+        UnsignedInt = 5125,
+        Float = 5126,
+    };
+
+    uint32_t getComponentSize(int componentType) {
+        switch (componentType) {
+        case Byte:
+        case UnsignedByte:
+            return 1;
+        case Short:
+        case UnsignedShort:
+            return 2;
+        case UnsignedInt:
+        case Float:
+            return 4;
+        default:
+            throw std::runtime_error("glTF: unknown component type " + std::to_string(componentType));
+        }
+    }
+
+    uint32_t getComponentCount(const std::string& type) {
+        if (type == "SCALAR") {
+            return 1;
+        } else if (type == "VEC2") {
+            return 2;
+        } else if (type == "VEC3") {
+            return 3;
+        } else if (type == "VEC4" || type == "MAT2") {
+            return 4;
+        } else if (type == "MAT3") {
+            return 9;
+        } else if (type == "MAT4") {
+            return 16;
+        }
+        throw std::runtime_error("glTF: unknown accessor type " + type);
+    }
+
+    std::string decodeBase64(std::string_view text) {
+        auto decodeCharacter = [](char c) -> int {
+            if (c >= 'A' && c <= 'Z') {
+                return c - 'A';
+            } else if (c >= 'a' && c <= 'z') {
+                return c - 'a' + 26;
+            } else if (c >= '0' && c <= '9') {
+                return c - '0' + 52;
+            } else if (c == '+') {
+                return 62;
+            } else if (c == '/') {
+                return 63;
+            }
+            return -1;
+        };
+
+        std::string result;
+        result.reserve(text.size() * 3 / 4);
+        uint32_t bits = 0;
+        int bitCount = 0;
+        for (char c : text) {
+            int value = decodeCharacter(c);
+            if (value < 0) {
+                // Padding, or the end of the data
+                break;
+            }
+            bits = (bits << 6) | static_cast<uint32_t>(value);
+            bitCount += 6;
+            if (bitCount >= 8) {
+                bitCount -= 8;
+                result += static_cast<char>((bits >> bitCount) & 0xFF);
+            }
+        }
+        return result;
+    }
+
+    /// The value of a hexadecimal digit, or -1 if it is not one
+    int getHexDigit(char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    /// Relative URIs may be percent encoded. The asset path is only for errors.
+    std::string decodeUri(const std::string& uri, const std::string& path) {
+        std::string result;
+        for (std::size_t i = 0; i < uri.size(); i++) {
+            if (uri[i] == '%') {
+                int high = i + 2 < uri.size() ? getHexDigit(uri[i + 1]) : -1;
+                int low = i + 2 < uri.size() ? getHexDigit(uri[i + 2]) : -1;
+                if (high < 0 || low < 0) {
+                    throw std::runtime_error("glTF: malformed percent escape in URI " + uri + " in " + path);
+                }
+                result += static_cast<char>(high * 16 + low);
+                i += 2;
+            } else {
+                result += uri[i];
+            }
+        }
+        return result;
+    }
+
+    /// The parts of a glTF asset that are needed to read geometry
+    struct GltfDocument {
+        RTCook::JsonValue json;
+        std::vector<std::string> buffers;
+    };
+
+    /// Split a file into its JSON and, for .glb, its binary chunk
+    void readContainer(const std::string& path, std::string& json, std::string& binaryChunk) {
+        std::string file = RTCook::readFile(path);
+
+        uint32_t magic = 0;
+        if (file.size() >= 4) {
+            memcpy(&magic, file.data(), sizeof(magic));
+        }
+        if (magic != GLB_MAGIC) {
+            json = std::move(file);
+            return;
+        }
+
+        // 12 byte header, then chunks of (length, type, data)
+        std::size_t offset = 12;
+        while (offset + 8 <= file.size()) {
+            uint32_t chunkLength = 0;
+            uint32_t chunkType = 0;
+            memcpy(&chunkLength, file.data() + offset, sizeof(chunkLength));
+            memcpy(&chunkType, file.data() + offset + 4, sizeof(chunkType));
+            offset += 8;
+            if (offset + chunkLength > file.size()) {
+                throw std::runtime_error("glTF: truncated GLB chunk in " + path);
+            }
+
+            if (chunkType == GLB_CHUNK_JSON) {
+                json = file.substr(offset, chunkLength);
+            } else if (chunkType == GLB_CHUNK_BIN && binaryChunk.empty()) {
+                binaryChunk = file.substr(offset, chunkLength);
+            }
+            offset += chunkLength;
+        }
+    }
+
+    GltfDocument loadDocument(const std::string& path) {
+        std::string json;
+        std::string binaryChunk;
+        readContainer(path, json, binaryChunk);
+
+        GltfDocument document;
+        document.json = RTCook::JsonValue::parse(json);
+
+        std::filesystem::path directory = std::filesystem::path(path).parent_path();
+        if (const RTCook::JsonValue* buffers = document.json.find("buffers")) {
+            for (std::size_t i = 0; i < buffers->size(); i++) {
+                const RTCook::JsonValue& buffer = (*buffers)[i];
+                const RTCook::JsonValue* uri = buffer.find("uri");
+                if (!uri) {
+                    // Only the first buffer of a GLB may omit its URI, it is the binary chunk
+                    document.buffers.push_back(i == 0 ? binaryChunk : std::string());
+                } else if (uri->asString().rfind("data:", 0) == 0) {
+                    std::size_t dataStart = uri->asString().find(";base64,");
+                    if (dataStart == std::string::npos) {
+                        throw std::runtime_error("glTF: unsupported data URI encoding in " + path);
+                    }
+                    document.buffers.push_back(decodeBase64(std::string_view(uri->asString()).substr(dataStart + 8)));
+                } else {
+                    document.buffers.push_back(RTCook::readFile((directory / decodeUri(uri->asString(), path)).string()));
+                }
+            }
+        }
+
+        return document;
+    }
+
+    /**
+     * Read an accessor as floats, converting normalized integers. Elements with fewer components than requested are
+     * zero filled.
+     */
+    std::vector<float> readAccessor(const GltfDocument& document, std::size_t accessorIndex, uint32_t componentsWanted) {
+        const RTCook::JsonValue& accessor = document.json["accessors"][accessorIndex];
+        if (accessor.find("sparse")) {
+            throw std::runtime_error("glTF: sparse accessors are not supported");
+        }
+
+        auto count = static_cast<std::size_t>(accessor["count"].asNumber());
+        auto componentType = static_cast<int>(accessor["componentType"].asNumber());
+        uint32_t componentCount = getComponentCount(accessor["type"].asString());
+        uint32_t componentSize = getComponentSize(componentType);
+        bool normalized = accessor.find("normalized") && accessor["normalized"].asBool();
+
+        std::vector<float> result(count * componentsWanted, 0.0f);
+        const RTCook::JsonValue* bufferViewIndex = accessor.find("bufferView");
+        if (!bufferViewIndex) {
+            // No data means all zeros
+            return result;
+        }
+
+        const RTCook::JsonValue& bufferView = document.json["bufferViews"][static_cast<std::size_t>(bufferViewIndex->asNumber())];
+        const std::string& buffer = document.buffers.at(static_cast<std::size_t>(bufferView["buffer"].asNumber()));
+        auto offset = static_cast<std::size_t>(bufferView.getNumber("byteOffset", 0) + accessor.getNumber("byteOffset", 0));
+        auto stride = static_cast<std::size_t>(bufferView.getNumber("byteStride", componentCount * componentSize));
+        if (count > 0 && offset + (count - 1) * stride + componentCount * componentSize > buffer.size()) {
+            throw std::runtime_error("glTF: accessor " + std::to_string(accessorIndex) + " reads past the end of its buffer");
+        }
+
+        for (std::size_t element = 0; element < count; element++) {
+            const char* source = buffer.data() + offset + element * stride;
+            for (uint32_t component = 0; component < std::min(componentCount, componentsWanted); component++) {
+                const char* data = source + component * componentSize;
+                float value = 0.0f;
+                switch (componentType) {
+                case Byte: {
+                    int8_t raw;
+                    memcpy(&raw, data, sizeof(raw));
+                    value = normalized ? std::max(raw / 127.0f, -1.0f) : raw;
+                    break;
+                }
+                case UnsignedByte: {
+                    uint8_t raw;
+                    memcpy(&raw, data, sizeof(raw));
+                    value = normalized ? raw / 255.0f : raw;
+                    break;
+                }
+                case Short: {
+                    int16_t raw;
+                    memcpy(&raw, data, sizeof(raw));
+                    value = normalized ? std::max(raw / 32767.0f, -1.0f) : raw;
+                    break;
+                }
+                case UnsignedShort: {
+                    uint16_t raw;
+                    memcpy(&raw, data, sizeof(raw));
+                    value = normalized ? raw / 65535.0f : raw;
+                    break;
+                }
+                case UnsignedInt: {
+                    uint32_t raw;
+                    memcpy(&raw, data, sizeof(raw));
+                    value = static_cast<float>(raw);
+                    break;
+                }
+                case Float:
+                    memcpy(&value, data, sizeof(value));
+                    break;
+                }
+                result[element * componentsWanted + component] = value;
+            }
+        }
+        return result;
+    }
+
+    /// Indices are read separately, as 32 bit values do not survive a trip through float
+    std::vector<uint32_t> readIndices(const GltfDocument& document, std::size_t accessorIndex) {
+        const RTCook::JsonValue& accessor = document.json["accessors"][accessorIndex];
+        auto count = static_cast<std::size_t>(accessor["count"].asNumber());
+        auto componentType = static_cast<int>(accessor["componentType"].asNumber());
+        uint32_t componentSize = getComponentSize(componentType);
+
+        const RTCook::JsonValue& bufferView = document.json["bufferViews"][static_cast<std::size_t>(accessor["bufferView"].asNumber())];
+        const std::string& buffer = document.buffers.at(static_cast<std::size_t>(bufferView["buffer"].asNumber()));
+        auto offset = static_cast<std::size_t>(bufferView.getNumber("byteOffset", 0) + accessor.getNumber("byteOffset", 0));
+        if (offset + count * componentSize > buffer.size()) {
+            throw std::runtime_error("glTF: index accessor " + std::to_string(accessorIndex) + " reads past the end of its buffer");
+        }
+
+        std::vector<uint32_t> result(count);
+        for (std::size_t i = 0; i < count; i++) {
+            const char* data = buffer.data() + offset + i * componentSize;
+            if (componentType == UnsignedByte) {
+                result[i] = static_cast<uint8_t>(*data);
+            } else if (componentType == UnsignedShort) {
+                uint16_t index;
+                memcpy(&index, data, sizeof(index));
+                result[i] = index;
+            } else if (componentType == UnsignedInt) {
+                memcpy(&result[i], data, sizeof(uint32_t));
+            } else {
+                throw std::runtime_error("glTF: indices must be unsigned integers");
+            }
+        }
+        return result;
+    }
+
+    glm::mat4 getNodeTransform(const RTCook::JsonValue& node) {
+        if (const RTCook::JsonValue* matrix = node.find("matrix")) {
+            // Column major, as glm is
+            float values[16];
+            for (std::size_t i = 0; i < 16; i++) {
+                values[i] = static_cast<float>((*matrix)[i].asNumber());
+            }
+            return glm::make_mat4(values);
+        }
+
+        glm::vec3 translation(0.0f);
+        glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+        glm::vec3 scale(1.0f);
+        if (const RTCook::JsonValue* t = node.find("translation")) {
+            translation = glm::vec3((*t)[0].asNumber(), (*t)[1].asNumber(), (*t)[2].asNumber());
+        }
+        if (const RTCook::JsonValue* r = node.find("rotation")) {
+            // glTF stores x, y, z, w. glm's constructor takes w first.
+            rotation = glm::quat(static_cast<float>((*r)[3].asNumber()),
+                                 static_cast<float>((*r)[0].asNumber()),
+                                 static_cast<float>((*r)[1].asNumber()),
+                                 static_cast<float>((*r)[2].asNumber()));
+        }
+        if (const RTCook::JsonValue* s = node.find("scale")) {
+            scale = glm::vec3((*s)[0].asNumber(), (*s)[1].asNumber(), (*s)[2].asNumber());
+        }
+
+        glm::mat4 result = glm::mat4_cast(rotation);
+        result[0] *= scale.x;
+        result[1] *= scale.y;
+        result[2] *= scale.z;
+        result[3] = glm::vec4(translation, 1.0f);
+        return result;
+    }
+}
+
+namespace RTCook {
+
+    ImportedScene importGltf(const std::string& path) {
+        GltfDocument document = loadDocument(path);
+        const JsonValue& json = document.json;
+
+        ImportedScene scene;
+
+        if (const JsonValue* materials = json.find("materials")) {
+            for (std::size_t i = 0; i < materials->size(); i++) {
+                const JsonValue& source = (*materials)[i];
+                Core::SceneMaterial material = getDefaultMaterial();
+                material.baseColour = glm::vec4(1.0f);
+                material.metallic = 1.0f;
+
+                if (const JsonValue* pbr = source.find("pbrMetallicRoughness")) {
+                    if (const JsonValue* factor = pbr->find("baseColorFactor")) {
+                        material.baseColour =
+                            glm::vec4((*factor)[0].asNumber(), (*factor)[1].asNumber(), (*factor)[2].asNumber(), (*factor)[3].asNumber());
+                    }
+                    material.metallic = static_cast<float>(pbr->getNumber("metallicFactor", 1.0));
+                    material.roughness = static_cast<float>(pbr->getNumber("roughnessFactor", 1.0));
+                }
+                if (const JsonValue* emissive = source.find("emissiveFactor")) {
+                    material.emission = glm::vec4((*emissive)[0].asNumber(), (*emissive)[1].asNumber(), (*emissive)[2].asNumber(), 0.0f);
+                }
+                scene.materials.push_back(material);
+            }
+        }
+        // Primitives may only reference the asset's own materials, not the default one added after them
+        std::size_t materialCount = scene.materials.size();
+        uint32_t defaultMaterial = ~0u;
+
+        // Every glTF mesh becomes one imported mesh per triangle primitive
+        std::vector<std::vector<uint32_t>> meshPrimitives;
+        if (const JsonValue* meshes = json.find("meshes")) {
+            for (std::size_t meshIndex = 0; meshIndex < meshes->size(); meshIndex++) {
+                const JsonValue& mesh = (*meshes)[meshIndex];
+                std::string name = mesh.getString("name", "mesh" + std::to_string(meshIndex));
+                meshPrimitives.emplace_back();
+
+                const JsonValue& primitives = mesh["primitives"];
+                for (std::size_t primitiveIndex = 0; primitiveIndex < primitives.size(); primitiveIndex++) {
+                    const JsonValue& primitive = primitives[primitiveIndex];
+                    if (static_cast<int>(primitive.getNumber("mode", GLTF_MODE_TRIANGLES)) != GLTF_MODE_TRIANGLES) {
+                        std::cout << "Skipping non-triangle primitive " << primitiveIndex << " of " << name << " in " << path << std::endl;
+                        continue;
+                    }
+
+                    const JsonValue& attributes = primitive["attributes"];
+                    std::vector<float> positions = readAccessor(document, static_cast<std::size_t>(attributes["POSITION"].asNumber()), 3);
+                    std::size_t vertexCount = positions.size() / 3;
+
+                    std::vector<float> normals(vertexCount * 3, 0.0f);
+                    if (const JsonValue* normal = attributes.find("NORMAL")) {
+                        normals = readAccessor(document, static_cast<std::size_t>(normal->asNumber()), 3);
+                    }
+                    std::vector<float> uvs(vertexCount * 2, 0.0f);
+                    if (const JsonValue* uv = attributes.find("TEXCOORD_0")) {
+                        uvs = readAccessor(document, static_cast<std::size_t>(uv->asNumber()), 2);
+                    }
+                    if (normals.size() != vertexCount * 3 || uvs.size() != vertexCount * 2) {
+                        throw std::runtime_error("glTF: attributes of " + name + " have different counts");
+                    }
+
+                    std::vector<uint32_t> indices;
+                    if (const JsonValue* indexAccessor = primitive.find("indices")) {
+                        indices = readIndices(document, static_cast<std::size_t>(indexAccessor->asNumber()));
+                    } else {
+                        indices.resize(vertexCount);
+                        for (uint32_t i = 0; i < vertexCount; i++) {
+                            indices[i] = i;
+                        }
+                    }
+
+                    uint32_t material;
+                    if (const JsonValue* materialIndex = primitive.find("material")) {
+                        double index = materialIndex->asNumber();
+                        if (!(index >= 0.0 && index < static_cast<double>(materialCount))) {
+                            std::ostringstream message;
+                            message << "glTF: primitive " << primitiveIndex << " of " << name << " references material " << index << ", but " << path
+                                    << " has " << materialCount;
+                            throw std::runtime_error(message.str());
+                        }
+                        material = static_cast<uint32_t>(index);
+                    } else {
+                        if (defaultMaterial == ~0u) {
+                            defaultMaterial = static_cast<uint32_t>(scene.materials.size());
+                            scene.materials.push_back(getDefaultMaterial());
+                        }
+                        material = defaultMaterial;
+                    }
+
+                    ImportedMesh imported{name, {}, material};
+                    imported.triangles.reserve(indices.size() - indices.size() % 3);
+                    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+                        for (int corner = 0; corner < 3; corner++) {
+                            uint32_t index = indices[i + corner];
+                            if (index >= vertexCount) {
+                                throw std::runtime_error("glTF: index out of range in " + name);
+                            }
+                            imported.triangles.push_back(Core::FullVertex{
+                                glm::vec3(positions[index * 3], positions[index * 3 + 1], positions[index * 3 + 2]),
+                                glm::vec3(normals[index * 3], normals[index * 3 + 1], normals[index * 3 + 2]),
+                                glm::vec2(uvs[index * 2], uvs[index * 2 + 1]),
+                            });
+                        }
+                    }
+                    generateMissingNormals(imported.triangles);
+
+                    meshPrimitives.back().push_back(static_cast<uint32_t>(scene.meshes.size()));
+                    scene.meshes.push_back(std::move(imported));
+                }
+            }
+        }
+
+        const JsonValue* nodes = json.find("nodes");
+        if (!nodes || nodes->size() == 0) {
+            // Geometry without a node hierarchy is placed at the origin
+            for (uint32_t mesh = 0; mesh < scene.meshes.size(); mesh++) {
+                scene.instances.push_back(ImportedInstance{mesh, glm::mat4(1.0f)});
+            }
+            return scene;
+        }
+
+        // The default scene's roots, or every node that is nobody's child when there are no scenes
+        std::vector<std::size_t> roots;
+        const JsonValue* scenes = json.find("scenes");
+        if (scenes && scenes->size() > 0) {
+            const JsonValue& rootScene = (*scenes)[static_cast<std::size_t>(json.getNumber("scene", 0))];
+            if (const JsonValue* sceneNodes = rootScene.find("nodes")) {
+                for (std::size_t i = 0; i < sceneNodes->size(); i++) {
+                    roots.push_back(static_cast<std::size_t>((*sceneNodes)[i].asNumber()));
+                }
+            }
+        } else {
+            std::vector<bool> isChild(nodes->size(), false);
+            for (std::size_t i = 0; i < nodes->size(); i++) {
+                if (const JsonValue* children = (*nodes)[i].find("children")) {
+                    for (std::size_t child = 0; child < children->size(); child++) {
+                        isChild.at(static_cast<std::size_t>((*children)[child].asNumber())) = true;
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < nodes->size(); i++) {
+                if (!isChild[i]) {
+                    roots.push_back(i);
+                }
+            }
+        }
+
+        // Walk the hierarchy, with a depth limit in case of cycles in a malformed file
+        struct PendingNode {
+            std::size_t node;
+            glm::mat4 parentTransform;
+            std::size_t depth;
+        };
+        std::vector<PendingNode> pending;
+        for (std::size_t root : roots) {
+            pending.push_back(PendingNode{root, glm::mat4(1.0f), 0});
+        }
+        while (!pending.empty()) {
+            PendingNode current = pending.back();
+            pending.pop_back();
+            if (current.depth > nodes->size()) {
+                throw std::runtime_error("glTF: the node hierarchy of " + path + " has a cycle");
+            }
+
+            const JsonValue& node = (*nodes)[current.node];
+            glm::mat4 transform = current.parentTransform * getNodeTransform(node);
+
+            if (const JsonValue* mesh = node.find("mesh")) {
+                for (uint32_t primitive : meshPrimitives.at(static_cast<std::size_t>(mesh->asNumber()))) {
+                    scene.instances.push_back(ImportedInstance{primitive, transform});
+                }
+            }
+            if (const JsonValue* children = node.find("children")) {
+                for (std::size_t child = 0; child < children->size(); child++) {
+                    pending.push_back(PendingNode{static_cast<std::size_t>((*children)[child].asNumber()), transform, current.depth + 1});
+                }
+            }
+        }
+
+        return scene;
+    }
+
+    std::vector<std::string> findGltfDependencies(const std::string& path) {
+        std::string json;
+        std::string binaryChunk;
+        readContainer(path, json, binaryChunk);
+        JsonValue document = JsonValue::parse(json);
+
+        std::vector<std::string> dependencies;
+        std::filesystem::path directory = std::filesystem::path(path).parent_path();
+        if (const JsonValue* buffers = document.find("buffers")) {
+            for (std::size_t i = 0; i < buffers->size(); i++) {
+                const JsonValue* uri = (*buffers)[i].find("uri");
+                if (uri && uri->asString().rfind("data:", 0) != 0) {
+                    dependencies.push_back((directory / decodeUri(uri->asString(), path)).string());
+                }
+            }
+        }
+        return dependencies;
+    }
+}
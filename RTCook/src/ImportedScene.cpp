@@ -0,0 +1,43 @@
+#include "RTCook/ImportedScene.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace RTCook {
+
+    Core::SceneMaterial getDefaultMaterial() {
+        Core::SceneMaterial material{};
+        material.baseColour = glm::vec4(0.8f, 0.8f, 0.8f, 1.0f);
+        material.emission = glm::vec4(0.0f);
+        material.roughness = 1.0f;
+        material.metallic = 0.0f;
+        return material;
+    }
+
+    void generateMissingNormals(std::vector<Core::FullVertex>& triangles) {
+        for (std::size_t first = 0; first + 2 < triangles.size(); first += 3) {
+            Core::FullVertex* triangle = &triangles[first];
+            if (triangle[0].normal != glm::vec3(0.0f) || triangle[1].normal != glm::vec3(0.0f) || triangle[2].normal != glm::vec3(0.0f)) {
+                continue;
+            }
+
+            glm::vec3 normal = glm::cross(triangle[1].position - triangle[0].position, triangle[2].position - triangle[0].position);
+            float length = glm::length(normal);
+            normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            for (int corner = 0; corner < 3; corner++) {
+                triangle[corner].normal = normal;
+            }
+        }
+    }
+
+    std::string readFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Failed to open " + path);
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+}
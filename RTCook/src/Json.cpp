@@ -0,0 +1,310 @@
+#include "RTCook/Json.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace RTCook {
+
+    class JsonValue::Parser {
+    public:
+        explicit Parser(std::string_view text)
+            : m_text(text) {}
+
+        JsonValue parseDocument() {
+            JsonValue value = parseValue(0);
+            skipWhitespace();
+            if (m_position != m_text.size()) {
+                fail("trailing characters");
+            }
+            return value;
+        }
+
+    private:
+        /// Deeper documents are rejected rather than overflowing the stack
+        static constexpr int MAX_DEPTH = 256;
+
+        std::string_view m_text;
+        std::size_t m_position = 0;
+
+        [[noreturn]] void fail(const std::string& reason) const {
+            throw std::runtime_error("JSON: " + reason + " at offset " + std::to_string(m_position));
+        }
+
+        void skipWhitespace() {
+            while (m_position < m_text.size() &&
+                   (m_text[m_position] == ' ' || m_text[m_position] == '\t' || m_text[m_position] == '\n' || m_text[m_position] == '\r')) {
+                m_position++;
+            }
+        }
+
+        char peek() {
+            skipWhitespace();
+            if (m_position >= m_text.size()) {
+                fail("unexpected end of document");
+            }
+            return m_text[m_position];
+        }
+
+        void expect(char c) {
+            if (peek() != c) {
+                fail(std::string("expected '") + c + "'");
+            }
+            m_position++;
+        }
+
+        void expectLiteral(std::string_view literal) {
+            if (m_text.substr(m_position, literal.size()) != literal) {
+                fail("invalid literal");
+            }
+            m_position += literal.size();
+        }
+
+        JsonValue parseValue(int depth) {
+            if (depth > MAX_DEPTH) {
+                fail("nested too deeply");
+            }
+
+            JsonValue value;
+            char c = peek();
+            if (c == '{') {
+                m_position++;
+                value.m_type = Type::Object;
+                if (peek() == '}') {
+                    m_position++;
+                    return value;
+                }
+                while (true) {
+                    if (peek() != '"') {
+                        fail("expected a member name");
+                    }
+                    value.m_keys.push_back(parseString());
+                    expect(':');
+                    value.m_values.push_back(parseValue(depth + 1));
+                    if (peek() == ',') {
+                        m_position++;
+                        continue;
+                    }
+                    expect('}');
+                    return value;
+                }
+            } else if (c == '[') {
+                m_position++;
+                value.m_type = Type::Array;
+                if (peek() == ']') {
+                    m_position++;
+                    return value;
+                }
+                while (true) {
+                    value.m_values.push_back(parseValue(depth + 1));
+                    if (peek() == ',') {
+                        m_position++;
+                        continue;
+                    }
+                    expect(']');
+                    return value;
+                }
+            } else if (c == '"') {
+                value.m_type = Type::String;
+                value.m_string = parseString();
+            } else if (c == 't') {
+                expectLiteral("true");
+                value.m_type = Type::Bool;
+                value.m_bool = true;
+            } else if (c == 'f') {
+                expectLiteral("false");
+                value.m_type = Type::Bool;
+            } else if (c == 'n') {
+                expectLiteral("null");
+            } else {
+                value.m_type = Type::Number;
+                value.m_number = parseNumber();
+            }
+            return value;
+        }
+
+        double parseNumber() {
+            // strtod accepts a superset of JSON numbers, and the text is not null terminated, so copy the token out
+            std::size_t start = m_position;
+            auto isNumberCharacter = [](char c) { return isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; };
+            while (m_position < m_text.size() && isNumberCharacter(m_text[m_position])) {
+                m_position++;
+            }
+            std::string token(m_text.substr(start, m_position - start));
+
+            char* end = nullptr;
+            double number = strtod(token.c_str(), &end);
+            if (token.empty() || end != token.c_str() + token.size()) {
+                m_position = start;
+                fail("invalid number");
+            }
+            return number;
+        }
+
+        uint32_t parseHex4() {
+            if (m_position + 4 > m_text.size()) {
+                fail("truncated escape");
+            }
+            uint32_t result = 0;
+            for (int i = 0; i < 4; i++) {
+                char c = m_text[m_position++];
+                result <<= 4;
+                if (c >= '0' && c <= '9') {
+                    result |= c - '0';
+                } else if (c >= 'a' && c <= 'f') {
+                    result |= c - 'a' + 10;
+                } else if (c >= 'A' && c <= 'F') {
+                    result |= c - 'A' + 10;
+                } else {
+                    fail("invalid escape");
+                }
+            }
+            return result;
+        }
+
+        static void appendUtf8(std::string& out, uint32_t codepoint) {
+            if (codepoint < 0x80) {
+                out += static_cast<char>(codepoint);
+            } else if (codepoint < 0x800) {
+                out += static_cast<char>(0xC0 | (codepoint >> 6));
+                out += static_cast<char>(0x80 | (codepoint & 0x3F));
+            } else if (codepoint < 0x10000) {
+                out += static_cast<char>(0xE0 | (codepoint >> 12));
+                out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codepoint & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (codepoint >> 18));
+                out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codepoint & 0x3F));
+            }
+        }
+
+        std::string parseString() {
+            expect('"');
+            std::string result;
+            while (true) {
+                if (m_position >= m_text.size()) {
+                    fail("unterminated string");
+                }
+                char c = m_text[m_position++];
+                if (c == '"') {
+                    return result;
+                }
+                if (c != '\\') {
+                    result += c;
+                    continue;
+                }
+
+                if (m_position >= m_text.size()) {
+                    fail("unterminated string");
+                }
+                char escape = m_text[m_position++];
+                switch (escape) {
+                case '"':
+                case '\\':
+                case '/':
+                    result += escape;
+                    break;
+                case 'b':
+                    result += '\b';
+                    break;
+                case 'f':
+                    result += '\f';
+                    break;
+                case 'n':
+                    result += '\n';
+                    break;
+                case 'r':
+                    result += '\r';
+                    break;
+                case 't':
+                    result += '\t';
+                    break;
+                case 'u': {
+                    uint32_t codepoint = parseHex4();
+                    // Characters outside the basic plane are escaped as a surrogate pair
+                    if (codepoint >= 0xD800 && codepoint < 0xDC00 && m_text.substr(m_position, 2) == "\\u") {
+                        m_position += 2;
+                        uint32_t low = parseHex4();
+                        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(result, codepoint);
+                    break;
+                }
+                default:
+                    fail("invalid escape");
+                }
+            }
+        }
+    };
+
+    JsonValue::JsonValue() = default;
+    JsonValue::~JsonValue() = default;
+
+    JsonValue JsonValue::parse(std::string_view text) { return Parser(text).parseDocument(); }
+
+    JsonValue::Type JsonValue::getType() const { return m_type; }
+    bool JsonValue::isNull() const { return m_type == Type::Null; }
+
+    bool JsonValue::asBool() const {
+        if (m_type != Type::Bool) {
+            throw std::runtime_error("JSON: expected a boolean");
+        }
+        return m_bool;
+    }
+
+    double JsonValue::asNumber() const {
+        if (m_type != Type::Number) {
+            throw std::runtime_error("JSON: expected a number");
+        }
+        return m_number;
+    }
+
+    const std::string& JsonValue::asString() const {
+        if (m_type != Type::String) {
+            throw std::runtime_error("JSON: expected a string");
+        }
+        return m_string;
+    }
+
+    std::size_t JsonValue::size() const { return m_values.size(); }
+
+    const JsonValue& JsonValue::operator[](std::size_t index) const {
+        if (m_type != Type::Array || index >= m_values.size()) {
+            throw std::runtime_error("JSON: array index " + std::to_string(index) + " out of range");
+        }
+        return m_values[index];
+    }
+
+    const JsonValue& JsonValue::operator[](const std::string& key) const {
+        const JsonValue* value = find(key);
+        if (!value) {
+            throw std::runtime_error("JSON: missing member \"" + key + "\"");
+        }
+        return *value;
+    }
+
+    const JsonValue* JsonValue::find(const std::string& key) const {
+        if (m_type != Type::Object) {
+            return nullptr;
+        }
+        for (std::size_t i = 0; i < m_keys.size(); i++) {
+            if (m_keys[i] == key) {
+                return &m_values[i];
+            }
+        }
+        return nullptr;
+    }
+
+    double JsonValue::getNumber(const std::string& key, double fallback) const {
+        const JsonValue* value = find(key);
+        return value ? value->asNumber() : fallback;
+    }
+
+    std::string JsonValue::getString(const std::string& key, const std::string& fallback) const {
+        const JsonValue* value = find(key);
+        return value ? value->asString() : fallback;
+    }
+}
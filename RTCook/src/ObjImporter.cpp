@@ -0,0 +1,252 @@
+#include "RTCook/ObjImporter.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+    /// Splits a file into lines and lines into whitespace separated tokens, without copying
+    class LineTokenizer {
+    public:
+        explicit LineTokenizer(std::string_view line)
+            : m_line(line) {}
+
+        /// The next token, or an empty view at the end of the line
+        std::string_view next() {
+            while (m_position < m_line.size() && isspace(static_cast<unsigned char>(m_line[m_position]))) {
+                m_position++;
+            }
+            std::size_t start = m_position;
+            while (m_position < m_line.size() && !isspace(static_cast<unsigned char>(m_line[m_position]))) {
+                m_position++;
+            }
+            return m_line.substr(start, m_position - start);
+        }
+
+        /// Everything left on the line, without surrounding whitespace. Used for names, which may contain spaces.
+        std::string_view rest() {
+            std::string_view remainder = m_line.substr(m_position);
+            std::size_t first = remainder.find_first_not_of(" \t\r");
+            if (first == std::string_view::npos) {
+                return std::string_view();
+            }
+            std::size_t last = remainder.find_last_not_of(" \t\r");
+            return remainder.substr(first, last - first + 1);
+        }
+
+        float nextFloat(float fallback = 0.0f) {
+            std::string_view token = next();
+            if (token.empty()) {
+                return fallback;
+            }
+            // Tokens are short, a stack copy gives strtof its terminator
+            char buffer[64];
+            std::size_t length = std::min(token.size(), sizeof(buffer) - 1);
+            token.copy(buffer, length);
+            buffer[length] = '\0';
+            return strtof(buffer, nullptr);
+        }
+
+    private:
+        std::string_view m_line;
+        std::size_t m_position = 0;
+    };
+
+    template<typename F>
+    void forEachLine(std::string_view text, F&& function) {
+        std::size_t start = 0;
+        while (start < text.size()) {
+            std::size_t end = text.find('\n', start);
+            if (end == std::string_view::npos) {
+                end = text.size();
+            }
+            function(text.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+
+    /// OBJ indices are one based, and negative indices count back from the latest element
+    int64_t resolveIndex(std::string_view token, std::size_t elementCount) {
+        if (token.empty()) {
+            throw std::runtime_error("OBJ: face corner is missing a position index");
+        }
+        char buffer[32];
+        std::size_t length = std::min(token.size(), sizeof(buffer) - 1);
+        token.copy(buffer, length);
+        buffer[length] = '\0';
+
+        long long index = strtoll(buffer, nullptr, 10);
+        if (index < 0) {
+            index += static_cast<long long>(elementCount);
+        } else {
+            index -= 1;
+        }
+        if (index < 0 || index >= static_cast<long long>(elementCount)) {
+            throw std::runtime_error("OBJ: face index " + std::string(token) + " is out of range");
+        }
+        return index;
+    }
+
+    void loadMaterialLibrary(const std::filesystem::path& path, RTCook::ImportedScene& scene, std::unordered_map<std::string, uint32_t>& materialIndices) {
+        std::string text = RTCook::readFile(path.string());
+
+        Core::SceneMaterial* material = nullptr;
+        forEachLine(text, [&](std::string_view line) {
+            LineTokenizer tokens(line);
+            std::string_view keyword = tokens.next();
+
+            if (keyword == "newmtl") {
+                materialIndices[std::string(tokens.rest())] = static_cast<uint32_t>(scene.materials.size());
+                scene.materials.push_back(RTCook::getDefaultMaterial());
+                material = &scene.materials.back();
+            } else if (!material) {
+                return;
+            } else if (keyword == "Kd") {
+                // Argument evaluation order is unspecified, so each component is read in its own statement
+                float r = tokens.nextFloat();
+                float g = tokens.nextFloat(r);
+                float b = tokens.nextFloat(r);
+                material->baseColour = glm::vec4(r, g, b, material->baseColour.a);
+            } else if (keyword == "Ke") {
+                float r = tokens.nextFloat();
+                float g = tokens.nextFloat(r);
+                float b = tokens.nextFloat(r);
+                material->emission = glm::vec4(r, g, b, 0.0f);
+            } else if (keyword == "d") {
+                material->baseColour.a = tokens.nextFloat(1.0f);
+            } else if (keyword == "Ns") {
+                // Blinn-Phong exponent to roughness, unless the PBR extension gives it directly
+                float exponent = tokens.nextFloat();
+                material->roughness = std::sqrt(2.0f / (exponent + 2.0f));
+            } else if (keyword == "Pr") {
+                material->roughness = tokens.nextFloat(1.0f);
+            } else if (keyword == "Pm") {
+                material->metallic = tokens.nextFloat();
+            }
+        });
+    }
+}
+
+namespace RTCook {
+
+    ImportedScene importObj(const std::string& path) {
+        std::string text = readFile(path);
+        std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+        ImportedScene scene;
+        std::unordered_map<std::string, uint32_t> materialIndices;
+
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> uvs;
+
+        std::string groupName = std::filesystem::path(path).stem().string();
+        uint32_t defaultMaterial = ~0u;
+        uint32_t currentMaterial = ~0u;
+        ImportedMesh* mesh = nullptr;
+
+        // Meshes are started lazily, so that groups and material switches without faces do not leave empty meshes
+        auto currentMesh = [&]() -> ImportedMesh& {
+            if (!mesh) {
+                if (currentMaterial == ~0u) {
+                    if (defaultMaterial == ~0u) {
+                        defaultMaterial = static_cast<uint32_t>(scene.materials.size());
+                        scene.materials.push_back(getDefaultMaterial());
+                    }
+                    currentMaterial = defaultMaterial;
+                }
+                scene.meshes.push_back(ImportedMesh{groupName, {}, currentMaterial});
+                mesh = &scene.meshes.back();
+            }
+            return *mesh;
+        };
+
+        std::vector<Core::FullVertex> polygon;
+        forEachLine(text, [&](std::string_view line) {
+            LineTokenizer tokens(line);
+            std::string_view keyword = tokens.next();
+
+            if (keyword == "v") {
+                float x = tokens.nextFloat();
+                float y = tokens.nextFloat();
+                positions.emplace_back(x, y, tokens.nextFloat());
+            } else if (keyword == "vn") {
+                float x = tokens.nextFloat();
+                float y = tokens.nextFloat();
+                normals.emplace_back(x, y, tokens.nextFloat());
+            } else if (keyword == "vt") {
+                float u = tokens.nextFloat();
+                // OBJ texture coordinates start at the bottom, Vulkan's at the top
+                uvs.emplace_back(u, 1.0f - tokens.nextFloat());
+            } else if (keyword == "f") {
+                polygon.clear();
+                for (std::string_view corner = tokens.next(); !corner.empty(); corner = tokens.next()) {
+                    // v, v/vt, v//vn or v/vt/vn
+                    std::size_t firstSlash = corner.find('/');
+                    std::size_t secondSlash = firstSlash == std::string_view::npos ? std::string_view::npos : corner.find('/', firstSlash + 1);
+
+                    Core::FullVertex vertex{};
+                    vertex.position = positions[resolveIndex(corner.substr(0, firstSlash), positions.size())];
+                    if (firstSlash != std::string_view::npos) {
+                        std::string_view uvToken = corner.substr(firstSlash + 1, secondSlash == std::string_view::npos ? std::string_view::npos
+                                                                                                                        : secondSlash - firstSlash - 1);
+                        if (!uvToken.empty()) {
+                            vertex.uv = uvs[resolveIndex(uvToken, uvs.size())];
+                        }
+                    }
+                    if (secondSlash != std::string_view::npos && secondSlash + 1 < corner.size()) {
+                        vertex.normal = normals[resolveIndex(corner.substr(secondSlash + 1), normals.size())];
+                    }
+                    polygon.push_back(vertex);
+                }
+
+                std::vector<Core::FullVertex>& triangles = currentMesh().triangles;
+                for (std::size_t corner = 2; corner < polygon.size(); corner++) {
+                    triangles.push_back(polygon[0]);
+                    triangles.push_back(polygon[corner - 1]);
+                    triangles.push_back(polygon[corner]);
+                }
+            } else if (keyword == "o" || keyword == "g") {
+                std::string_view name = tokens.rest();
+                groupName = name.empty() ? groupName : std::string(name);
+                mesh = nullptr;
+            } else if (keyword == "usemtl") {
+                auto material = materialIndices.find(std::string(tokens.rest()));
+                currentMaterial = material != materialIndices.end() ? material->second : ~0u;
+                mesh = nullptr;
+            } else if (keyword == "mtllib") {
+                for (std::string_view library = tokens.next(); !library.empty(); library = tokens.next()) {
+                    loadMaterialLibrary(directory / std::string(library), scene, materialIndices);
+                }
+            }
+        });
+
+        for (uint32_t meshIndex = 0; meshIndex < scene.meshes.size(); meshIndex++) {
+            generateMissingNormals(scene.meshes[meshIndex].triangles);
+            scene.instances.push_back(ImportedInstance{meshIndex, glm::mat4(1.0f)});
+        }
+
+        return scene;
+    }
+
+    std::vector<std::string> findObjDependencies(const std::string& path) {
+        std::string text = readFile(path);
+        std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+        std::vector<std::string> dependencies;
+        forEachLine(text, [&](std::string_view line) {
+            LineTokenizer tokens(line);
+            if (tokens.next() == "mtllib") {
+                for (std::string_view library = tokens.next(); !library.empty(); library = tokens.next()) {
+                    dependencies.push_back((directory / std::string(library)).string());
+                }
+            }
+        });
+        return dependencies;
+    }
+}
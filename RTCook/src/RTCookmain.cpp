@@ -0,0 +1,66 @@
+
+#include "RTCook/Cooker.hpp"
+
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Read the cooking options from the command line:
+ *  --vertex-format full|compressed    The vertex format of the output, compressed by default
+ *  --cache DIR                        Where cooked assets are kept between runs
+ *  --threads N                        The number of worker threads, one per hardware thread by default
+ *  --force                            Cook every asset, even if it has not changed
+ *  -o FILE                            The scene file to write
+ * Every other argument is an asset to cook.
+ */
+void parseArguments(int argc, char** argv, RTCook::Cooker::Options& options, std::string& output, std::vector<std::string>& inputs) {
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--vertex-format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "full") {
+                options.vertexFormat = Core::VertexFormat::Full;
+            } else if (format == "compressed") {
+                options.vertexFormat = Core::VertexFormat::Compressed;
+            } else {
+                throw std::runtime_error("Unknown vertex format: " + format);
+            }
+        } else if (argument == "--cache" && i + 1 < argc) {
+            options.cacheDirectory = argv[++i];
+        } else if (argument == "--threads" && i + 1 < argc) {
+            options.threadCount = std::stoul(argv[++i]);
+        } else if (argument == "--force") {
+            options.force = true;
+        } else if (argument == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (argument.rfind("-", 0) == 0) {
+            throw std::runtime_error("Unknown argument: " + argument);
+        } else {
+            inputs.push_back(argument);
+        }
+    }
+
+    if (output.empty() || inputs.empty()) {
+        throw std::runtime_error("Usage: RTCook [--vertex-format full|compressed] [--cache DIR] [--threads N] [--force] -o OUTPUT INPUT...");
+    }
+}
+
+int
+main(int argc, char** argv) {
+    try {
+        RTCook::Cooker::Options options;
+        std::string output;
+        std::vector<std::string> inputs;
+        parseArguments(argc, argv, options, output, inputs);
+
+        RTCook::Cooker cooker(options);
+        cooker.cook(inputs, output);
+    } catch (const std::exception& exception) {
+        std::cerr << exception.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
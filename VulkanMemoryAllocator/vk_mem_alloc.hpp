@@ -139,7 +139,10 @@ namespace VMA_HPP_NAMESPACE {
     enum class AllocatorCreateFlagBits
     {
         eExternallySynchronized = VMA_ALLOCATOR_CREATE_EXTERNALLY_SYNCHRONIZED_BIT,
-        eKhrDedicatedAllocation = VMA_ALLOCATOR_CREATE_KHR_DEDICATED_ALLOCATION_BIT
+        eKhrDedicatedAllocation = VMA_ALLOCATOR_CREATE_KHR_DEDICATED_ALLOCATION_BIT,
+        /// DIVERGENCE -- vma 2.3.0
+        eExtMemoryBudget = VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT
+        /// END DIVERGENCE -- vma 2.3.0
     };
 }
 
@@ -150,6 +153,7 @@ namespace VULKAN_HPP_NAMESPACE {
         enum
         {
             allFlags = VkFlags(VMA_HPP_NAMESPACE::AllocatorCreateFlagBits::eExternallySynchronized) | VkFlags(VMA_HPP_NAMESPACE::AllocatorCreateFlagBits::eKhrDedicatedAllocation)
+                       | VkFlags(VMA_HPP_NAMESPACE::AllocatorCreateFlagBits::eExtMemoryBudget)
         };
     };
 }
@@ -162,6 +166,7 @@ namespace VMA_HPP_NAMESPACE {
         {
         case AllocatorCreateFlagBits::eExternallySynchronized : return "ExternallySynchronized";
         case AllocatorCreateFlagBits::eKhrDedicatedAllocation : return "KhrDedicatedAllocation";
+        case AllocatorCreateFlagBits::eExtMemoryBudget : return "ExtMemoryBudget";
         default: return "invalid";
         }
     }
@@ -185,6 +190,7 @@ namespace VMA_HPP_NAMESPACE {
 
         if ( value & AllocatorCreateFlagBits::eExternallySynchronized ) result += "ExternallySynchronized | ";
         if ( value & AllocatorCreateFlagBits::eKhrDedicatedAllocation ) result += "KhrDedicatedAllocation | ";
+        if ( value & AllocatorCreateFlagBits::eExtMemoryBudget ) result += "ExtMemoryBudget | ";
         return "{ " + result.substr(0, result.size() - 3) + " }";
     }
 
@@ -0,0 +1,35 @@
+cmake_minimum_required(VERSION 3.15 FATAL_ERROR)
+
+# Turns a SPIR-V binary into a C++ source that registers it as an embedded shader.
+# Usage: cmake -DINPUT=<shader.spv> -DOUTPUT=<shader.cpp> -DNAME=<lookup name> -P embed_spirv.cmake
+
+file(READ ${INPUT} SPIRV HEX)
+string(LENGTH "${SPIRV}" HEX_LENGTH)
+math(EXPR TRAILING_BYTES "${HEX_LENGTH} % 8")
+if (HEX_LENGTH EQUAL 0 OR NOT TRAILING_BYTES EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not SPIR-V, its size is not a whole number of words")
+endif()
+
+# The file holds little endian words, so bytes aa bb cc dd become 0xddccbbaa
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " WORDS "${SPIRV}")
+# Eight words to a line. CMake regular expressions have no counted repetition, so the pattern is spelled out.
+string(REPEAT "0x[0-9a-f]+, " 8 EIGHT_WORDS)
+string(REGEX REPLACE "(${EIGHT_WORDS})" "\\1\n        " WORDS "${WORDS}")
+string(REPLACE " \n" "\n" WORDS "${WORDS}")
+string(STRIP "${WORDS}" WORDS)
+
+file(WRITE ${OUTPUT} "// Generated by cmake/embed_spirv.cmake from ${INPUT}, do not edit
+
+#include <Core/EmbeddedShaders.hpp>
+
+#include <cstdint>
+
+namespace {
+    constexpr uint32_t SPIRV[] = {
+        ${WORDS}
+    };
+    static_assert(SPIRV[0] == 0x07230203, \"Not SPIR-V, or not little endian\");
+
+    const Core::EmbeddedShaderRegistration REGISTRATION(\"${NAME}\", SPIRV);
+}
+")
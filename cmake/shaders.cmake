@@ -1,35 +1,87 @@
 cmake_minimum_required(VERSION 3.15 FATAL_ERROR)
 
+option(RT_EMBED_SHADERS "Compile SPIR-V into the executables, so shaders are not loaded from Resources/Shaders at runtime" ON)
+option(RT_OPTIMIZE_SHADERS "Run the spirv-opt performance passes on compiled shaders" ON)
+
+find_program(SPIRV_OPT spirv-opt)
+if (RT_OPTIMIZE_SHADERS AND NOT SPIRV_OPT)
+    message(STATUS "spirv-opt not found, shaders are optimized by glslc alone")
+endif()
+
+# Resolved here, inside add_shaders() it would be relative to the caller
+set(EMBED_SPIRV_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/embed_spirv.cmake)
+
+# Source extension and glslc stage name of every supported shader stage
+set(SHADER_STAGES
+        vert:vertex
+        frag:fragment
+        comp:compute
+        rgen:rgen
+        rmiss:rmiss
+        rchit:rchit
+        rahit:rahit
+        rint:rint
+        rcall:rcall
+)
+# Ray tracing needs SPIR-V 1.4
+set(RAY_TRACING_STAGES rgen rmiss rchit rahit rint rcall)
+
 function(add_shaders SHADER_FILES_OUT_NAME)
     set(ALL_SHADERS)
 
     # This will be the output directory for all shaders
     file(MAKE_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}/Resources/Shaders)
 
-    file(GLOB VERTEX_SHADERS ${CMAKE_CURRENT_SOURCE_DIR}/Resources/Shaders/*.vert)
-    foreach(SHADER ${VERTEX_SHADERS})
-        set(BUILT_SHADER_NAME "${SHADER}.spv")
-        string(REPLACE "${CMAKE_CURRENT_SOURCE_DIR}" "${CMAKE_CURRENT_BINARY_DIR}" BUILT_SHADER_NAME ${BUILT_SHADER_NAME})
-        add_custom_command(
-                OUTPUT ${BUILT_SHADER_NAME}
-                COMMAND  glslc ARGS -fshader-stage=vertex ${SHADER} -o ${BUILT_SHADER_NAME}
-                MAIN_DEPENDENCY ${SHADER}
-                WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}
-        )
-        list(APPEND ALL_SHADERS ${BUILT_SHADER_NAME})
-    endforeach()
+    foreach(STAGE ${SHADER_STAGES})
+        string(REPLACE ":" ";" STAGE ${STAGE})
+        list(GET STAGE 0 EXTENSION)
+        list(GET STAGE 1 GLSLC_STAGE)
 
-    file(GLOB FRAGMENT_SHADERS ${CMAKE_CURRENT_SOURCE_DIR}/Resources/Shaders/*.frag)
-    foreach(SHADER ${FRAGMENT_SHADERS})
-        set(BUILT_SHADER_NAME "${SHADER}.spv")
-        string(REPLACE "${CMAKE_CURRENT_SOURCE_DIR}" "${CMAKE_CURRENT_BINARY_DIR}" BUILT_SHADER_NAME ${BUILT_SHADER_NAME})
-        add_custom_command(
-                OUTPUT ${BUILT_SHADER_NAME}
-                COMMAND glslc ARGS -fshader-stage=fragment ${SHADER} -o ${BUILT_SHADER_NAME}
-                MAIN_DEPENDENCY ${SHADER}
-                WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}
-        )
-        list(APPEND ALL_SHADERS ${BUILT_SHADER_NAME})
+        set(GLSLC_FLAGS -fshader-stage=${GLSLC_STAGE})
+        if (EXTENSION IN_LIST RAY_TRACING_STAGES)
+            list(APPEND GLSLC_FLAGS --target-env=vulkan1.2)
+        endif()
+        if (RT_OPTIMIZE_SHADERS)
+            list(APPEND GLSLC_FLAGS -O)
+        endif()
+
+        file(GLOB STAGE_SHADERS ${CMAKE_CURRENT_SOURCE_DIR}/Resources/Shaders/*.${EXTENSION})
+        foreach(SHADER ${STAGE_SHADERS})
+            get_filename_component(SHADER_NAME ${SHADER} NAME)
+            set(BUILT_SHADER_NAME ${CMAKE_CURRENT_BINARY_DIR}/Resources/Shaders/${SHADER_NAME}.spv)
+
+            if (RT_OPTIMIZE_SHADERS AND SPIRV_OPT)
+                set(UNOPTIMIZED_SHADER_NAME ${CMAKE_CURRENT_BINARY_DIR}/Resources/Shaders/${SHADER_NAME}.unoptimized.spv)
+                add_custom_command(
+                        OUTPUT ${BUILT_SHADER_NAME}
+                        COMMAND glslc ARGS ${GLSLC_FLAGS} ${SHADER} -o ${UNOPTIMIZED_SHADER_NAME}
+                        COMMAND ${SPIRV_OPT} ARGS -O ${UNOPTIMIZED_SHADER_NAME} -o ${BUILT_SHADER_NAME}
+                        MAIN_DEPENDENCY ${SHADER}
+                        WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}
+                )
+            else()
+                add_custom_command(
+                        OUTPUT ${BUILT_SHADER_NAME}
+                        COMMAND glslc ARGS ${GLSLC_FLAGS} ${SHADER} -o ${BUILT_SHADER_NAME}
+                        MAIN_DEPENDENCY ${SHADER}
+                        WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}
+                )
+            endif()
+            list(APPEND ALL_SHADERS ${BUILT_SHADER_NAME})
+
+            # Registered under the path it would otherwise be loaded from, see Core/EmbeddedShaders.hpp
+            if (RT_EMBED_SHADERS)
+                set(EMBEDDED_SHADER_NAME ${CMAKE_CURRENT_BINARY_DIR}/EmbeddedShaders/${SHADER_NAME}.cpp)
+                add_custom_command(
+                        OUTPUT ${EMBEDDED_SHADER_NAME}
+                        COMMAND ${CMAKE_COMMAND} -DINPUT=${BUILT_SHADER_NAME} -DOUTPUT=${EMBEDDED_SHADER_NAME}
+                                -DNAME=Resources/Shaders/${SHADER_NAME}.spv -P ${EMBED_SPIRV_SCRIPT}
+                        DEPENDS ${BUILT_SHADER_NAME} ${EMBED_SPIRV_SCRIPT}
+                )
+                list(APPEND ALL_SHADERS ${EMBEDDED_SHADER_NAME})
+            endif()
+        endforeach()
     endforeach()
+
     set(${SHADER_FILES_OUT_NAME} ${ALL_SHADERS} PARENT_SCOPE)
 endfunction()